@@ -0,0 +1,78 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "bench.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+// replaces the global allocation functions of the benchmark executable;
+// array and nothrow forms forward to these by default, so every
+// container allocation in the compiler is seen
+static std::atomic<uint64_t> allocation_count { 0 };
+
+void *operator new(const size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+/* std::pmr::new_delete_resource() always allocates through the aligned forms */
+void *operator new(const size_t size, const std::align_val_t align)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    const auto alignment = std::max(static_cast<size_t>(align), sizeof(void *));
+    if (void *p = std::aligned_alloc(alignment, (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+namespace klr::bench
+{
+    uint64_t allocations()
+    {
+        return allocation_count.load(std::memory_order_relaxed);
+    }
+
+    uint64_t peak_rss_kb()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        rusage usage {};
+        getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+        return static_cast<uint64_t>(usage.ru_maxrss) / 1024; /* bytes on macOS */
+#else
+        return static_cast<uint64_t>(usage.ru_maxrss);
+#endif
+#else
+        return 0;
+#endif
+    }
+}
@@ -0,0 +1,184 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../bench.h"
+#include "../corpora.h"
+#include <compiler/analysis/include/symbols.h>
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/memory/include/interner.h>
+#include <compiler/parser/include/parser.h>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+using namespace klr::compiler;
+using klr::bench::best_of;
+
+namespace
+{
+    /* `functions` functions of nine declarations each over nested blocks, plus a few globals */
+    std::string module(const uint32_t functions)
+    {
+        const uint32_t globals = functions / 8 + 1;
+        std::string out;
+        for (uint32_t i = 0; i < globals; ++i)
+            out += "var g" + std::to_string(i) + ": i32 = " + std::to_string(i) + ";\n";
+
+        uint64_t state = 0x2545F4914F6CDD1DULL;
+        const auto below = [&](const uint32_t n)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return std::to_string(state % n);
+        };
+        for (uint32_t i = 0; i < functions; ++i)
+        {
+            out += "function fn" + std::to_string(i) + "(a: i32, b: i32, c: i32) -> i32 {\n"
+                   "    var x0: i32 = a + g" + below(globals) + ";\n"
+                   "    if (x0 > b) {\n"
+                   "        var x1: i32 = x0 * c + fn" + below(functions) + "(a, b, c);\n"
+                   "        while (x1 < a) { var x2: i32 = x1 + x0; x1 = x2 - b; }\n"
+                   "        x0 = x1;\n"
+                   "    }\n"
+                   "    for (var i: i32 = 0; i < c; i = i + 1) { var y: i32 = i + x0; x0 = y; }\n"
+                   "    return x0;\n"
+                   "}\n";
+        }
+        return out;
+    }
+
+    /* the textbook resolver: a hash map per scope, a lookup walks the chain outwards */
+    class MapPerScope
+    {
+    public:
+        uint32_t resolved = 0;
+
+        void resolve(const AST &ast)
+        {
+            resolved = 0;
+            scopes.clear();
+            std::vector<uint32_t> work { 0 };
+            while (!work.empty())
+            {
+                const uint32_t item = work.back();
+                work.pop_back();
+                const uint32_t node = item & ~EXIT;
+                const ASTNodeType type = ast.types[node];
+                if (item & EXIT)
+                {
+                    if (type == ASTNodeType::DECL)
+                        scopes.back()[ast.atoms[node]] = node;
+                    else
+                        scopes.pop_back();
+                    continue;
+                }
+
+                switch (type)
+                {
+                    case ASTNodeType::ROOT:
+                        scopes.emplace_back();
+                        for (const uint32_t child: ast.children(node))
+                            scopes.back()[ast.atoms[child]] = child;
+                        work.push_back(node | EXIT);
+                        break;
+                    case ASTNodeType::FUNCTION:
+                    case ASTNodeType::BLOCK:
+                    case ASTNodeType::FOR:
+                        scopes.emplace_back();
+                        work.push_back(node | EXIT);
+                        break;
+                    case ASTNodeType::DECL:
+                        if (ast.parents[node] != 0)
+                            work.push_back(node | EXIT);
+                        break;
+                    case ASTNodeType::IDENTIFIER:
+                        resolved += lookup(ast.atoms[node]) != 0;
+                        break;
+                    default:
+                        break;
+                }
+
+                if (type == ASTNodeType::BINARY_EXPR)
+                {
+                    work.push_back(ast.data[node].binary_expr.right);
+                    work.push_back(ast.data[node].binary_expr.left);
+                    continue;
+                }
+                if (type == ASTNodeType::UNARY_EXPR && !ast.first_child[node])
+                {
+                    work.push_back(ast.data[node].unary_expr.operand);
+                    continue;
+                }
+
+                const size_t first = work.size();
+                for (const uint32_t child: ast.children(node))
+                    work.push_back(child);
+                std::reverse(work.begin() + static_cast<std::ptrdiff_t>(first), work.end());
+            }
+        }
+
+    private:
+        static constexpr uint32_t EXIT = 1U << 31;
+        std::vector<std::unordered_map<uint32_t, uint32_t> > scopes;
+
+        [[nodiscard]] uint32_t lookup(const uint32_t atom) const
+        {
+            for (auto it = scopes.rbegin(); it != scopes.rend(); ++it)
+            {
+                if (const auto found = it->find(atom); found != it->end())
+                    return found->second;
+            }
+            return 0;
+        }
+    };
+}
+
+int main()
+{
+    constexpr int runs = 5;
+    const std::pair<std::string_view, std::string> corpora[] = {
+        { "module 25k fns", module(25000) },
+        { "realistic", klr::bench::realistic(16 << 20) },
+    };
+
+    std::cout << std::left << std::setw(18) << "corpus" << std::right << std::setw(10) << "nodes"
+              << std::setw(10) << "decls" << std::setw(10) << "refs" << std::setw(10) << "resolved"
+              << std::setw(14) << "symbols" << std::setw(14) << "map/scope" << std::setw(10) << "allocs"
+              << std::setw(12) << "tables" << "\n" << std::fixed;
+    for (const auto &[name, src]: corpora)
+    {
+        Interner interner;
+        Lexer lexer("bench.klr", src, simd::Level::AVX2, std::pmr::get_default_resource(), &interner);
+        auto tokens = lexer.tokenize();
+        Parser parser("bench.klr", src, std::move(tokens), lexer.get_line_starts());
+        const AST ast = parser.parse();
+
+        SymbolTable table;
+        const double symbols = best_of(runs, [&] { table.resolve(ast); });
+        const uint64_t before = klr::bench::allocations();
+        table.resolve(ast);
+        const uint64_t allocs = klr::bench::allocations() - before;
+
+        MapPerScope baseline;
+        const double maps = best_of(runs, [&] { baseline.resolve(ast); });
+
+        size_t refs = 0;
+        for (const ASTNodeType type: ast.types)
+            refs += type == ASTNodeType::IDENTIFIER;
+        const size_t resolved = refs - table.unresolved.size();
+        if (resolved != baseline.resolved)
+            std::cerr << name << ": baseline resolved " << baseline.resolved << " names\n";
+
+        const auto nodes = static_cast<double>(ast.size());
+        std::cout << std::left << std::setw(18) << name << std::right << std::setw(10) << ast.size()
+                  << std::setw(10) << table.symbols.size() - 1 << std::setw(10) << refs
+                  << std::setw(9) << std::setprecision(1) << 100.0 * static_cast<double>(resolved) /
+                  static_cast<double>(std::max<size_t>(refs, 1)) << "%"
+                  << std::setprecision(2) << std::setw(8) << symbols / nodes * 1e9 << " ns/nd"
+                  << std::setw(8) << maps / nodes * 1e9 << " ns/nd" << std::setw(10) << allocs
+                  << std::setw(8) << table.memory_bytes() / 1024 << " KiB\n";
+    }
+    return 0;
+}
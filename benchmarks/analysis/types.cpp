@@ -0,0 +1,97 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../bench.h"
+#include "../corpora.h"
+#include <compiler/analysis/include/checker.h>
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/memory/include/interner.h>
+#include <compiler/parser/include/parser.h>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace klr::compiler;
+using klr::bench::best_of;
+
+namespace
+{
+    /*
+     * `functions` functions with loops, calls and arrays; with infer set,
+     * every local is a `var x = ...` left for the checker to work out
+     */
+    std::string module(const uint32_t functions, const bool infer)
+    {
+        const auto local = [&](const std::string &name, const std::string_view type)
+        {
+            return "var " + name + (infer ? std::string() : ": " + std::string(type));
+        };
+
+        std::string out = "function id<T>(v: T) -> T { return v; }\n";
+        uint64_t state = 0x2545F4914F6CDD1DULL;
+        const auto below = [&](const uint32_t n)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return std::to_string(state % n);
+        };
+        for (uint32_t i = 0; i < functions; ++i)
+        {
+            out += "function fn" + std::to_string(i) + "(a: i64, b: f64, s: string) -> i64 {\n"
+                   "    " + local("x", "i64") + " = a * 3 + 1;\n"
+                   "    " + local("r", "f64") + " = b / 2.0 - 1;\n"
+                   "    " + local("xs", "i64[]") + " = {x, a, 7};\n"
+                   "    " + local("p", "Own<i64>") + " = new i64(x);\n"
+                   "    " + local("ok", "bool") + " = x < a && r >= b;\n"
+                   "    if (ok) { x = x + fn" + below(functions) + "(x, r, s + \"!\"); }\n"
+                   "    for (" + local("i", "i64") + " = 0; i < a; i = i + 1) { " +
+                   local("y", "i64") + " = id(i) + *p; x = y ^ x; }\n"
+                   "    return x;\n"
+                   "}\n";
+        }
+        return out;
+    }
+}
+
+int main()
+{
+    constexpr int runs = 5;
+    const std::pair<std::string_view, std::string> corpora[] = {
+        { "inferred 20k fns", module(20000, true) },
+        { "annotated 20k fns", module(20000, false) },
+        { "realistic", klr::bench::realistic(16 << 20) },
+    };
+
+    std::cout << std::left << std::setw(20) << "corpus" << std::right << std::setw(10) << "nodes"
+              << std::setw(10) << "errors" << std::setw(14) << "resolve" << std::setw(14) << "check"
+              << std::setw(10) << "types" << std::setw(10) << "allocs" << std::setw(12) << "table"
+              << "\n" << std::fixed;
+    for (const auto &[name, src]: corpora)
+    {
+        Interner interner;
+        Lexer lexer("bench.klr", src, simd::Level::AVX2, std::pmr::get_default_resource(), &interner);
+        auto tokens = lexer.tokenize();
+        Parser parser("bench.klr", src, std::move(tokens), lexer.get_line_starts());
+        const AST ast = parser.parse();
+
+        SymbolTable symbols;
+        const double resolve = best_of(runs, [&] { symbols.resolve(ast); });
+
+        /* one table across runs, as across the modules of a compilation */
+        TypeTable types;
+        TypeChecker checker(types, ast, symbols, parser.get_tokens());
+        const double check = best_of(runs, [&] { checker.check(); });
+        const uint64_t before = klr::bench::allocations();
+        checker.check();
+        const uint64_t allocs = klr::bench::allocations() - before;
+
+        const auto nodes = static_cast<double>(ast.size());
+        std::cout << std::left << std::setw(20) << name << std::right << std::setw(10) << ast.size()
+                  << std::setw(10) << checker.get_diagnostics().size() << std::setprecision(2)
+                  << std::setw(8) << resolve / nodes * 1e9 << " ns/nd" << std::setw(8) << check / nodes * 1e9
+                  << " ns/nd" << std::setw(10) << types.size() << std::setw(10) << allocs
+                  << std::setw(8) << types.memory_bytes() / 1024 << " KiB\n";
+    }
+    return 0;
+}
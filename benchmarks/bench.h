@@ -0,0 +1,32 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace klr::bench
+{
+    /* fastest of `runs` wall clock timings of fn, in seconds */
+    template<typename Fn>
+    double best_of(const int runs, Fn &&fn)
+    {
+        auto best = 1e300;
+        for (auto r = 0; r < runs; ++r)
+        {
+            const auto begin = std::chrono::steady_clock::now();
+            fn();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+            best = std::min(best, elapsed.count());
+        }
+        return best;
+    }
+
+    /* heap allocations made through global operator new since start-up; needs alloc.cpp */
+    uint64_t allocations();
+
+    /* peak resident set size of the process in KiB, 0 if unknown */
+    uint64_t peak_rss_kb();
+}
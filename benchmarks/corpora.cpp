@@ -0,0 +1,425 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "corpora.h"
+#include <iterator>
+#include <random>
+
+namespace klr::bench
+{
+    static constexpr const char *words[] = {
+        "buffer", "offset", "parent", "index", "child", "count", "node", "width", "length", "result",
+        "value", "entry", "key", "hash", "seed", "module", "scope", "symbol", "table", "cursor"
+    };
+
+    static constexpr const char *types[] = { "u8", "u16", "u32", "u64", "i32", "i64", "f32", "f64", "bool" };
+
+    /* operators the parser accepts inside expressions */
+    static constexpr const char *binary_ops[] = {
+        "+", "-", "*", "/", "%", "&", "|", "^", "&&", "||", "==", "!=", "<", "<=", ">", ">="
+    };
+
+    namespace
+    {
+        struct Generator
+        {
+            std::mt19937 rng;
+            std::string out;
+
+            explicit Generator(const uint32_t seed, const size_t bytes) : rng(seed)
+            {
+                out.reserve(bytes + 4096);
+            }
+
+            template<typename T, size_t N>
+            const T &pick(const T (&items)[N])
+            {
+                return items[rng() % N];
+            }
+
+            uint32_t below(const uint32_t n)
+            {
+                return rng() % n;
+            }
+
+            /* snake_case name of one to three words, sometimes numbered */
+            void name()
+            {
+                const uint32_t parts = 1 + below(3);
+                for (uint32_t i = 0; i < parts; ++i)
+                {
+                    if (i)
+                        out += '_';
+                    out += pick(words);
+                }
+                if (below(2))
+                    out += '_' + std::to_string(below(100));
+            }
+
+            void number()
+            {
+                switch (below(6))
+                {
+                    case 0:
+                        out += std::to_string(below(10));
+                        break;
+                    case 1:
+                        out += std::to_string(rng());
+                        break;
+                    case 2:
+                        out += "0x" + std::to_string(below(9000) + 1000) + "ABCDEF";
+                        break;
+                    case 3:
+                        out += "0b";
+                        for (uint32_t i = 0, n = 4 + below(28); i < n; ++i)
+                            out += static_cast<char>('0' + below(2));
+                        break;
+                    case 4:
+                        out += std::to_string(below(1000)) + "." + std::to_string(below(100000));
+                        break;
+                    default:
+                        out += std::to_string(1 + below(9)) + "." + std::to_string(below(1000)) + "e-" +
+                                std::to_string(below(20));
+                        break;
+                }
+            }
+
+            void string_literal()
+            {
+                static constexpr const char *phrases[] = {
+                    "the quick brown fox", "jumps over", "the lazy dog", "\\n", "\\t", "\\\"quoted\\\"",
+                    "lorem ipsum dolor sit amet", "0123456789", "\\\\"
+                };
+                out += '"';
+                for (uint32_t i = 0, n = 1 + below(6); i < n; ++i)
+                    out += pick(phrases);
+                out += '"';
+            }
+
+            /* operand; identifiers, calls, method calls or literals */
+            void operand()
+            {
+                switch (below(5))
+                {
+                    case 0:
+                        number();
+                        break;
+                    case 1:
+                        name();
+                        out += '(';
+                        name();
+                        out += ", ";
+                        number();
+                        out += ')';
+                        break;
+                    case 2:
+                        name();
+                        out += '.';
+                        name();
+                        out += "()";
+                        break;
+                    default:
+                        name();
+                        break;
+                }
+            }
+
+            /* flat binary chain of `terms` operands */
+            void expression(const uint32_t terms)
+            {
+                operand();
+                for (uint32_t i = 1; i < terms; ++i)
+                {
+                    out += ' ';
+                    out += pick(binary_ops);
+                    out += ' ';
+                    operand();
+                }
+            }
+        };
+    }
+
+    std::string identifier_heavy(const size_t bytes)
+    {
+        Generator gen(1, bytes);
+        while (gen.out.size() < bytes)
+        {
+            gen.out += gen.below(3) ? "var " : "const ";
+            gen.name();
+            if (gen.below(2))
+            {
+                gen.out += ": ";
+                gen.out += gen.pick(types);
+            }
+            gen.out += " = ";
+            gen.name();
+            for (uint32_t i = 0, n = 2 + gen.below(5); i < n; ++i)
+            {
+                gen.out += gen.below(2) ? " + " : " * ";
+                gen.name();
+            }
+            gen.out += ";\n";
+        }
+        return std::move(gen.out);
+    }
+
+    std::string literal_heavy(const size_t bytes)
+    {
+        Generator gen(2, bytes);
+        while (gen.out.size() < bytes)
+        {
+            gen.out += "const ";
+            gen.name();
+            gen.out += ": ";
+            gen.out += gen.pick(types);
+            gen.out += "[] = {";
+            for (uint32_t i = 0, n = 4 + gen.below(12); i < n; ++i)
+            {
+                gen.out += i ? ", " : " ";
+                switch (gen.below(8))
+                {
+                    case 0:
+                        gen.string_literal();
+                        break;
+                    case 1:
+                        gen.out += gen.below(2) ? "true" : "false";
+                        break;
+                    case 2:
+                        gen.out += "null";
+                        break;
+                    default:
+                        gen.number();
+                        break;
+                }
+            }
+            gen.out += " };\n";
+        }
+        return std::move(gen.out);
+    }
+
+    // parenthesised chains nested `depth` deep, alternating the side the
+    // nesting grows on and sprinkling unary operators and ternaries
+    static void nested(Generator &gen, const uint32_t depth)
+    {
+        if (depth == 0)
+        {
+            gen.operand();
+            return;
+        }
+
+        static constexpr const char *unary_ops[] = { "-", "!", "~" };
+        if (gen.below(8) == 0)
+            gen.out += gen.pick(unary_ops);
+
+        gen.out += '(';
+        if (gen.below(12) == 0)
+        {
+            gen.operand();
+            gen.out += " ? ";
+            nested(gen, depth - 1);
+            gen.out += " : ";
+            gen.operand();
+        }
+        else if (gen.below(2))
+        {
+            nested(gen, depth - 1);
+            gen.out += ' ';
+            gen.out += gen.pick(binary_ops);
+            gen.out += ' ';
+            gen.operand();
+        }
+        else
+        {
+            gen.operand();
+            gen.out += ' ';
+            gen.out += gen.pick(binary_ops);
+            gen.out += ' ';
+            nested(gen, depth - 1);
+        }
+        gen.out += ')';
+    }
+
+    std::string nested_expressions(const size_t bytes)
+    {
+        Generator gen(3, bytes);
+        while (gen.out.size() < bytes)
+        {
+            gen.out += "var ";
+            gen.name();
+            gen.out += " = ";
+            nested(gen, 8 + gen.below(56));
+            gen.out += ";\n";
+        }
+        return std::move(gen.out);
+    }
+
+    std::string comment_heavy(const size_t bytes)
+    {
+        static constexpr const char *prose[] = {
+            "computes the offset of the next entry in the table",
+            "TODO: this is quadratic for large modules, revisit once scopes are interned",
+            "NOTE: the caller owns the buffer; do not free it here",
+            "see the module docs for the layout of the header and how it is versioned",
+        };
+
+        Generator gen(4, bytes);
+        while (gen.out.size() < bytes)
+        {
+            if (gen.below(2))
+            {
+                gen.out += "/*\n";
+                for (uint32_t i = 0, n = 2 + gen.below(6); i < n; ++i)
+                {
+                    gen.out += " * ";
+                    gen.out += gen.pick(prose);
+                    gen.out += '\n';
+                }
+                gen.out += " */\n";
+            }
+            else
+            {
+                for (uint32_t i = 0, n = 1 + gen.below(4); i < n; ++i)
+                {
+                    gen.out += "// ";
+                    gen.out += gen.pick(prose);
+                    gen.out += '\n';
+                }
+            }
+
+            gen.out += "var ";
+            gen.name();
+            gen.out += " = ";
+            gen.expression(1 + gen.below(3));
+            gen.out += gen.below(3) ? ";\n" : "; /* trailing */ // and a line comment\n";
+        }
+        return std::move(gen.out);
+    }
+
+    // statements are emitted with a fixed nesting budget so blocks stay
+    // shallow, like most hand written code
+    static void statement(Generator &gen, const uint32_t depth, const std::string &indent)
+    {
+        gen.out += indent;
+        switch (depth ? gen.below(9) : 5 + gen.below(4))
+        {
+            case 0:
+                gen.out += "if (";
+                gen.expression(1 + gen.below(3));
+                gen.out += ")\n" + indent + "{\n";
+                for (uint32_t i = 0, n = 1 + gen.below(3); i < n; ++i)
+                    statement(gen, depth - 1, indent + "    ");
+                gen.out += indent + "}\n";
+                if (gen.below(2))
+                {
+                    gen.out += indent + "else\n" + indent + "{\n";
+                    statement(gen, depth - 1, indent + "    ");
+                    gen.out += indent + "}\n";
+                }
+                return;
+            case 1:
+                gen.out += "while (";
+                gen.expression(1 + gen.below(2));
+                gen.out += ")\n" + indent + "{\n";
+                for (uint32_t i = 0, n = 1 + gen.below(3); i < n; ++i)
+                    statement(gen, depth - 1, indent + "    ");
+                gen.out += indent + "}\n";
+                return;
+            case 2:
+                gen.out += "for (i = 0; i < ";
+                gen.name();
+                gen.out += "; i += 1)\n" + indent + "{\n";
+                for (uint32_t i = 0, n = 1 + gen.below(3); i < n; ++i)
+                    statement(gen, depth - 1, indent + "    ");
+                gen.out += indent + "}\n";
+                return;
+            case 3:
+                gen.out += "// ";
+                gen.name();
+                gen.out += " must be updated before ";
+                gen.name();
+                gen.out += '\n';
+                statement(gen, depth, indent);
+                return;
+            case 4:
+                gen.out += "var ";
+                gen.name();
+                gen.out += " = cast<";
+                gen.out += gen.pick(types);
+                gen.out += ">(";
+                gen.expression(1 + gen.below(3));
+                gen.out += ");\n";
+                return;
+            case 5:
+                gen.out += "var ";
+                gen.name();
+                gen.out += ": ";
+                gen.out += gen.pick(types);
+                gen.out += " = ";
+                gen.expression(1 + gen.below(4));
+                gen.out += ";\n";
+                return;
+            case 6:
+                gen.name();
+                gen.out += gen.below(2) ? " = " : " += ";
+                gen.expression(1 + gen.below(4));
+                gen.out += ";\n";
+                return;
+            case 7:
+                gen.name();
+                gen.out += '.';
+                gen.name();
+                gen.out += '(';
+                gen.expression(1 + gen.below(2));
+                gen.out += ", ";
+                gen.string_literal();
+                gen.out += ");\n";
+                return;
+            default:
+                gen.out += "return ";
+                gen.expression(1 + gen.below(3));
+                gen.out += ";\n";
+        }
+    }
+
+    std::string realistic(const size_t bytes)
+    {
+        Generator gen(5, bytes);
+        while (gen.out.size() < bytes)
+        {
+            if (gen.below(4) == 0)
+            {
+                gen.out += "const ";
+                gen.name();
+                gen.out += ": ";
+                gen.out += gen.pick(types);
+                gen.out += " = ";
+                gen.number();
+                gen.out += ";\n\n";
+                continue;
+            }
+
+            gen.out += "/* ";
+            gen.name();
+            gen.out += " helper */\nfunction ";
+            gen.name();
+            gen.out += '(';
+            for (uint32_t i = 0, n = gen.below(4); i < n; ++i)
+            {
+                if (i)
+                    gen.out += ", ";
+                gen.name();
+                gen.out += ": ";
+                gen.out += gen.pick(types);
+            }
+            gen.out += ") -> ";
+            gen.out += gen.pick(types);
+            gen.out += "\n{\n";
+            for (uint32_t i = 0, n = 3 + gen.below(8); i < n; ++i)
+                statement(gen, 2, "    ");
+            gen.out += "    return ";
+            gen.expression(1 + gen.below(3));
+            gen.out += ";\n}\n\n";
+        }
+        return std::move(gen.out);
+    }
+}
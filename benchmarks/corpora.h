@@ -0,0 +1,40 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace klr::bench
+{
+    /*
+     * deterministic synthetic modules; each generator appends whole
+     * top-level declarations until the source is at least `bytes` long,
+     * so every corpus lexes and parses cleanly at any size
+     */
+    std::string identifier_heavy(size_t bytes);
+
+    std::string literal_heavy(size_t bytes);
+
+    std::string nested_expressions(size_t bytes);
+
+    std::string comment_heavy(size_t bytes);
+
+    /* functions with control flow, calls, casts & comments, like hand written code */
+    std::string realistic(size_t bytes);
+
+    struct Corpus
+    {
+        std::string_view name;
+        std::string (*generate)(size_t bytes);
+    };
+
+    inline constexpr Corpus corpora[] = {
+        { "identifier_heavy", identifier_heavy },
+        { "literal_heavy", literal_heavy },
+        { "nested_expressions", nested_expressions },
+        { "comment_heavy", comment_heavy },
+        { "realistic", realistic },
+    };
+}
@@ -0,0 +1,116 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../bench.h"
+#include "../corpora.h"
+#include <compiler/analysis/include/folder.h>
+#include <compiler/ir/include/lowering.h>
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/memory/include/interner.h>
+#include <compiler/parser/include/parser.h>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace klr::compiler;
+using klr::bench::best_of;
+
+namespace
+{
+    /* `functions` functions of loops, branches, short circuits and calls over numbers, all of which lower */
+    std::string module(const uint32_t functions)
+    {
+        std::string out;
+        uint64_t state = 0x2545F4914F6CDD1DULL;
+        const auto below = [&](const uint32_t n)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return std::to_string(state % n);
+        };
+        for (uint32_t i = 0; i < functions; ++i)
+        {
+            out += "function fn" + std::to_string(i) + "(a: i64, b: f64) -> i64 {\n"
+                   "    var x: i64 = a * 3 + 1;\n"
+                   "    var r: f64 = b / 2.0 - 1.0;\n"
+                   "    var ok: bool = x < a && r >= b;\n"
+                   "    if (ok) { x = x + fn" + below(functions) + "(x, r); } else { r = r * 2.0; }\n"
+                   "    for (var i: i64 = 0; i < a; i += 1) {\n"
+                   "        var y: i64 = i > 4 ? i : -i;\n"
+                   "        if (y == 7) { continue; }\n"
+                   "        while (y > 0) { y -= 2; if (y == 3) { break; } }\n"
+                   "        x = y ^ x;\n"
+                   "    }\n"
+                   "    return x + cast<i64>(r);\n"
+                   "}\n";
+        }
+        return out;
+    }
+}
+
+int main()
+{
+    constexpr int runs = 5;
+    const std::pair<std::string_view, std::string> corpora[] = {
+        { "numeric 20k fns", module(20000) },
+        { "realistic", klr::bench::realistic(16 << 20) },
+    };
+
+    std::cout << std::left << std::setw(18) << "corpus" << std::right << std::setw(10) << "nodes"
+              << std::setw(10) << "E0017" << std::setw(14) << "lower" << std::setw(10) << "insts"
+              << std::setw(9) << "blocks" << std::setw(9) << "phis" << std::setw(10) << "allocs"
+              << std::setw(12) << "module" << "\n" << std::fixed;
+    for (const auto &[name, src]: corpora)
+    {
+        Interner interner;
+        Lexer lexer("bench.klr", src, simd::Level::AVX2, std::pmr::get_default_resource(), &interner);
+        auto tokens = lexer.tokenize();
+        Parser parser("bench.klr", src, std::move(tokens), lexer.get_line_starts());
+        AST ast = parser.parse();
+
+        SymbolTable symbols;
+        symbols.resolve(ast);
+        TypeTable types;
+        TypeChecker checker(types, ast, symbols, parser.get_tokens());
+        checker.check();
+        ConstantPool pool;
+        ConstantFolder(ast, pool, checker, symbols, parser.get_tokens()).fold();
+
+        /* the module is emptied, not freed, between runs, so they show the steady state */
+        IRModule module;
+        IRLowering lowering(module, ast, symbols, types, checker, pool, parser.get_tokens());
+        const auto reset = [&]
+        {
+            module.ops.clear();
+            module.types.clear();
+            module.a.clear();
+            module.b.clear();
+            module.extra.clear();
+            module.edges.clear();
+            module.blocks.clear();
+            module.functions.clear();
+        };
+        const double lower = best_of(runs, [&]
+        {
+            reset();
+            lowering.lower();
+        });
+        reset();
+        const uint64_t before = klr::bench::allocations();
+        lowering.lower();
+        const uint64_t allocs = klr::bench::allocations() - before;
+
+        size_t phis = 0;
+        for (const IROp op: module.ops)
+            phis += op == IROp::PHI;
+
+        const auto nodes = static_cast<double>(ast.size());
+        std::cout << std::left << std::setw(18) << name << std::right << std::setw(10) << ast.size()
+                  << std::setw(10) << lowering.get_diagnostics().size() << std::setprecision(2)
+                  << std::setw(8) << lower / nodes * 1e9 << " ns/nd" << std::setw(10) << module.size()
+                  << std::setw(9) << module.blocks.size() << std::setw(9) << phis << std::setw(10) << allocs
+                  << std::setw(8) << module.memory_bytes() / 1024 << " KiB\n";
+    }
+    return 0;
+}
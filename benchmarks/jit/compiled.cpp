@@ -0,0 +1,148 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../bench.h"
+#include <compiler/analysis/include/folder.h>
+#include <compiler/ir/include/lowering.h>
+#include <compiler/jit/include/jit.h>
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/memory/include/interner.h>
+#include <compiler/parser/include/parser.h>
+#include <compiler/vm/include/emitter.h>
+#include <compiler/vm/include/vm.h>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace klr::compiler;
+using klr::bench::best_of;
+
+namespace
+{
+    /* the VM benchmark's programs, so the two tables line up */
+    constexpr std::string_view source = R"(
+        function fib(n: i32) -> i32 { return n < 2 ? n : fib(n - 1) + fib(n - 2); }
+
+        function loops(n: i64) -> i64 {
+            var s: i64 = 0;
+            for (var i: i64 = 0; i < n; i += 1) {
+                for (var j: i64 = 0; j < n; j += 1) {
+                    if (((i ^ j) & 1) == 0) { s += i * j; } else { s -= j; }
+                }
+            }
+            return s;
+        }
+
+        function squares(n: u64) -> u64 {
+            var s: u64 = 0;
+            var i: u64 = 0;
+            while (i < n) { s += i * i % 7; i += 1; }
+            return s;
+        }
+
+        function leibniz(n: i32) -> f64 {
+            var s: f64 = 0.0;
+            var sign: f64 = 1.0;
+            for (var k: i32 = 0; k < n; k += 1) {
+                s += sign / cast<f64>(2 * k + 1);
+                sign = -sign;
+            }
+            return 4.0 * s;
+        }
+    )";
+
+    struct Case
+    {
+        std::string_view name;
+        std::string_view function;
+        Value arg;
+    };
+}
+
+int main()
+{
+    constexpr int runs = 5;
+
+    if (!JIT::supported())
+    {
+        std::cerr << "the JIT does not run on this host\n";
+        return 1;
+    }
+
+    Interner interner;
+    const std::string src(source);
+    Lexer lexer("bench.klr", src, simd::Level::AVX2, std::pmr::get_default_resource(), &interner);
+    auto tokens = lexer.tokenize();
+    Parser parser("bench.klr", src, std::move(tokens), lexer.get_line_starts());
+    AST ast = parser.parse();
+
+    SymbolTable symbols;
+    symbols.resolve(ast);
+    TypeTable types;
+    TypeChecker checker(types, ast, symbols, parser.get_tokens());
+    checker.check();
+    ConstantPool pool;
+    ConstantFolder(ast, pool, checker, symbols, parser.get_tokens()).fold();
+    IRModule module;
+    IRLowering lowering(module, ast, symbols, types, checker, pool, parser.get_tokens());
+    lowering.lower();
+    if (parser.has_errors() || checker.has_errors() || !lowering.get_diagnostics().empty())
+    {
+        std::cerr << "the benchmark's source does not compile\n";
+        return 1;
+    }
+
+    Program program;
+    BytecodeEmitter(program, module, types, pool).emit();
+    VM vm(program);
+
+    JIT jit(module, types, pool);
+    bool mapped = false;
+    const double compile = best_of(1, [&] { mapped = jit.compile(); });
+    if (!mapped)
+    {
+        std::cerr << "the compiled code could not be mapped executable\n";
+        return 1;
+    }
+
+    const Case cases[] = {
+        { "fib(30)", "fib", Value::integer(TypeKind::I32, 30) },
+        { "loops(3000)", "loops", Value::integer(TypeKind::I64, 3000) },
+        { "squares(10M)", "squares", Value::integer(TypeKind::U64, 10'000'000) },
+        { "leibniz(10M)", "leibniz", Value::integer(TypeKind::I32, 10'000'000) },
+    };
+
+    std::cout << std::left << std::setw(16) << "program" << std::right << std::setw(12) << "vm" << std::setw(12)
+              << "jit" << std::setw(10) << "speedup" << std::setw(10) << "allocs" << std::setw(24) << "result"
+              << "\n" << std::fixed;
+    for (const auto &[name, function, arg]: cases)
+    {
+        const uint32_t index = program.find(interner.intern(function));
+        const Value args[] = { arg };
+
+        const Result expected = vm.run(index, args);
+        const Result result = jit.run(index, args);
+        if (result.value.bits != expected.value.bits || result.trap != expected.trap)
+        {
+            std::cerr << name << ": the JIT and the VM disagree\n";
+            return 1;
+        }
+
+        const double interpreted = best_of(runs, [&] { (void) vm.run(index, args); });
+        const double compiled = best_of(runs, [&] { (void) jit.run(index, args); });
+        const uint64_t before = klr::bench::allocations();
+        (void) jit.run(index, args);
+        const uint64_t allocs = klr::bench::allocations() - before;
+
+        std::cout << std::left << std::setw(16) << name << std::right << std::setprecision(3) << std::setw(9)
+                  << interpreted * 1e3 << " ms" << std::setw(9) << compiled * 1e3 << " ms" << std::setprecision(1)
+                  << std::setw(9) << interpreted / compiled << "x" << std::setw(10) << allocs << std::setw(24);
+        if (TypeTable::is_float(result.value.kind))
+            std::cout << std::setprecision(9) << result.value.as_float() << "\n";
+        else
+            std::cout << result.value.as_int() << "\n";
+    }
+    std::cout << "\n" << jit.code_bytes() << " bytes of machine code, compiled in " << std::setprecision(3)
+              << compile * 1e6 << " us\n";
+    return 0;
+}
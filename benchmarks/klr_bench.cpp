@@ -0,0 +1,269 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "bench.h"
+#include "corpora.h"
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/memory/include/arena.h>
+#include <compiler/parser/include/parser.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace klr;
+using namespace klr::compiler;
+
+namespace
+{
+    struct Result
+    {
+        std::string_view corpus;
+        size_t bytes = 0;
+        size_t tokens = 0;
+        size_t nodes = 0;
+        size_t ast_bytes = 0; /* AST column capacity after parse() */
+        uint64_t arena_chunks = 0; /* chunks mapped over all runs; reset() reuses them */
+        size_t arena_used = 0;     /* bytes one lex + parse takes from the arena */
+        double lex_seconds = 0;
+        double parse_seconds = 0;
+        uint64_t lex_allocations = 0;
+        uint64_t parse_allocations = 0;
+        uint64_t peak_rss_kb = 0;
+        std::string error; /* parse failure; the corpus generators should never trigger it */
+    };
+
+    struct Options
+    {
+        size_t megabytes = 16;
+        int runs = 5;
+        std::string_view only;
+        std::string json;
+        bool arena = true;
+        bool huge_pages = false;
+    };
+
+    Result run(const bench::Corpus &corpus, const Options &options)
+    {
+        Result result;
+        result.corpus = corpus.name;
+
+        const std::string src = corpus.generate(options.megabytes << 20);
+        result.bytes = src.size();
+
+        result.lex_seconds = bench::best_of(options.runs, [&]
+        {
+            Lexer lexer(corpus.name, src);
+            result.tokens = lexer.tokenize()->size();
+        });
+
+        {
+            const uint64_t before = bench::allocations();
+            Lexer lexer(corpus.name, src);
+            const auto tokens = lexer.tokenize();
+            result.lex_allocations = bench::allocations() - before;
+        }
+
+        /* only parse() is timed; each run needs its own token stream and a rewound arena */
+        Arena arena(Arena::DEFAULT_CHUNK, options.huge_pages);
+        std::pmr::memory_resource *resource = options.arena ? &arena : std::pmr::get_default_resource();
+        result.parse_seconds = 1e300;
+        for (auto r = 0; r < options.runs && result.error.empty(); ++r)
+        {
+            arena.reset();
+            Lexer lexer(corpus.name, src, simd::Level::AVX2, resource);
+            auto tokens = lexer.tokenize();
+            Parser parser(corpus.name, src, std::move(tokens), lexer.get_line_starts(), resource);
+
+            const uint64_t before = bench::allocations();
+            const auto begin = std::chrono::steady_clock::now();
+            const AST ast = parser.parse();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+            result.parse_seconds = std::min(result.parse_seconds, elapsed.count());
+            result.parse_allocations = bench::allocations() - before;
+            result.nodes = ast.size();
+            result.ast_bytes = ast.memory_bytes();
+            result.arena_used = arena.used();
+
+            /* the corpora are valid code; a diagnostic means the generator or the parser is broken */
+            if (parser.has_errors())
+            {
+                std::ostringstream text;
+                parser.renderer().text(text, parser.get_diagnostics().front());
+                result.error = text.str();
+            }
+        }
+
+        result.arena_chunks = arena.chunks();
+        result.peak_rss_kb = bench::peak_rss_kb();
+        return result;
+    }
+
+    void print(std::ostream &os, const Result &r)
+    {
+        const double mb = static_cast<double>(r.bytes) / 1e6;
+        os << std::left << std::setw(20) << r.corpus << std::right << std::fixed << std::setprecision(1)
+           << std::setw(8) << mb << " MB"
+           << std::setw(10) << mb / r.lex_seconds << " MB/s"
+           << std::setw(9) << static_cast<double>(r.tokens) / r.lex_seconds / 1e6 << " Mtok/s"
+           << std::setw(9) << r.lex_allocations << " allocs";
+        if (r.error.empty())
+        {
+            os << std::setw(9) << static_cast<double>(r.nodes) / r.parse_seconds / 1e6 << " Mnode/s"
+               << std::setw(10) << r.parse_allocations << " allocs"
+               << std::setw(7) << static_cast<double>(r.ast_bytes) / static_cast<double>(r.nodes) << " B/node";
+        }
+        else
+        {
+            os << "  parse failed";
+        }
+        os << std::setw(9) << r.peak_rss_kb / 1024 << " MB peak\n";
+    }
+
+    /* corpus names and parse errors are the only strings; escape what JSON requires */
+    std::string json_string(const std::string_view s)
+    {
+        std::string out = "\"";
+        for (const char c: s)
+        {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+                continue;
+            }
+            out += c;
+        }
+        return out + '"';
+    }
+
+    void write_json(std::ostream &os, const Options &options, const std::vector<Result> &results)
+    {
+        os << std::setprecision(6) << std::defaultfloat
+           << "{\n  \"megabytes\": " << options.megabytes << ",\n  \"runs\": " << options.runs
+           << ",\n  \"arena\": " << (options.arena ? "true" : "false")
+           << ",\n  \"huge_pages\": " << (options.huge_pages ? "true" : "false")
+           << ",\n  \"peak_rss_kb\": " << bench::peak_rss_kb() << ",\n  \"corpora\": [";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result &r = results[i];
+            os << (i ? "," : "") << "\n    {\n"
+               << "      \"name\": " << json_string(r.corpus) << ",\n"
+               << "      \"bytes\": " << r.bytes << ",\n"
+               << "      \"tokens\": " << r.tokens << ",\n"
+               << "      \"lex\": { \"seconds\": " << r.lex_seconds
+               << ", \"mb_per_s\": " << static_cast<double>(r.bytes) / 1e6 / r.lex_seconds
+               << ", \"tokens_per_s\": " << static_cast<double>(r.tokens) / r.lex_seconds
+               << ", \"allocations\": " << r.lex_allocations << " },\n";
+            if (r.error.empty())
+            {
+                os << "      \"parse\": { \"seconds\": " << r.parse_seconds
+                   << ", \"nodes\": " << r.nodes
+                   << ", \"nodes_per_s\": " << static_cast<double>(r.nodes) / r.parse_seconds
+                   << ", \"ast_bytes\": " << r.ast_bytes
+                   << ", \"bytes_per_node\": " << static_cast<double>(r.ast_bytes) / static_cast<double>(r.nodes)
+                   << ", \"allocations\": " << r.parse_allocations
+                   << ", \"arena_chunks\": " << r.arena_chunks
+                   << ", \"arena_bytes\": " << r.arena_used << " },\n";
+            }
+            else
+            {
+                os << "      \"parse\": { \"error\": " << json_string(r.error) << " },\n";
+            }
+            os << "      \"peak_rss_kb\": " << r.peak_rss_kb << "\n    }";
+        }
+        os << "\n  ]\n}\n";
+    }
+
+    void usage()
+    {
+        std::cerr << "usage: klr-bench [--size MB] [--runs N] [--corpus NAME] [--json FILE|-] [--no-arena] "
+                "[--huge-pages]\ncorpora:";
+        for (const auto &corpus: bench::corpora)
+            std::cerr << ' ' << corpus.name;
+        std::cerr << '\n';
+    }
+}
+
+int main(const int argc, char **argv)
+{
+    Options options;
+    for (auto i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (arg == "--no-arena")
+        {
+            options.arena = false;
+            continue;
+        }
+        if (arg == "--huge-pages")
+        {
+            options.huge_pages = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 1;
+        }
+
+        const char *value = argv[++i];
+        if (arg == "--size")
+            options.megabytes = std::max(1UL, std::strtoul(value, nullptr, 10));
+        else if (arg == "--runs")
+            options.runs = std::max(1, std::atoi(value));
+        else if (arg == "--corpus")
+            options.only = value;
+        else if (arg == "--json")
+            options.json = value;
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    /* with JSON on stdout the table goes to stderr so the output stays parseable */
+    std::ostream &table = options.json == "-" ? std::cerr : std::cout;
+
+    std::vector<Result> results;
+    for (const auto &corpus: bench::corpora)
+    {
+        if (!options.only.empty() && corpus.name != options.only)
+            continue;
+
+        results.push_back(run(corpus, options));
+        print(table, results.back());
+        if (!results.back().error.empty())
+            std::cerr << results.back().error << '\n';
+    }
+
+    if (results.empty())
+    {
+        usage();
+        return 1;
+    }
+
+    if (options.json == "-")
+        write_json(std::cout, options, results);
+    else if (!options.json.empty())
+    {
+        std::ofstream out(options.json);
+        write_json(out, options, results);
+    }
+
+    /* a corpus that no longer parses is a regression as well */
+    for (const auto &r: results)
+    {
+        if (!r.error.empty())
+            return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../bench.h"
+#include "../corpora.h"
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/memory/include/interner.h>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace klr::compiler;
+using klr::bench::best_of;
+
+namespace
+{
+    size_t tokenize(const std::string &src, Interner *interner)
+    {
+        Lexer lexer("bench.klr", src, simd::Level::AVX2, std::pmr::get_default_resource(), interner);
+        return lexer.tokenize()->size();
+    }
+
+    size_t tokenize_parallel(const std::string &src, Interner *interner, const unsigned threads)
+    {
+        Lexer lexer("bench.klr", src, simd::Level::AVX2, std::pmr::get_default_resource(), interner);
+        return lexer.tokenize_parallel(threads)->size();
+    }
+
+    void keep(const size_t value)
+    {
+        asm volatile("" : : "g"(value) : "memory");
+    }
+}
+
+int main()
+{
+    constexpr size_t size = 32 << 20;
+    constexpr int runs = 5;
+    const unsigned threads = std::max(2U, std::thread::hardware_concurrency());
+    const std::pair<std::string_view, std::string> corpora[] = {
+        { "identifier_heavy", klr::bench::identifier_heavy(size) },
+        { "literal_heavy", klr::bench::literal_heavy(size) },
+        { "nested_expressions", klr::bench::nested_expressions(size) },
+        { "realistic", klr::bench::realistic(size) },
+    };
+
+    /* throughput of the lexer with and without the bulk intern pass */
+    std::cout << std::left << std::setw(20) << "corpus" << std::right << std::setw(14) << "plain"
+              << std::setw(14) << "interned" << std::setw(14) << "parallel" << std::setw(14) << "par+intern"
+              << "\n" << std::fixed << std::setprecision(1);
+    for (const auto &[name, src]: corpora)
+    {
+        const double mb = static_cast<double>(src.size()) / (1 << 20);
+        const double plain = best_of(runs, [&] { keep(tokenize(src, nullptr)); });
+        const double interned = best_of(runs, [&]
+        {
+            Interner interner;
+            keep(tokenize(src, &interner));
+        });
+        const double parallel = best_of(runs, [&] { keep(tokenize_parallel(src, nullptr, threads)); });
+        const double parallel_interned = best_of(runs, [&]
+        {
+            Interner interner;
+            keep(tokenize_parallel(src, &interner, threads));
+        });
+
+        std::cout << std::left << std::setw(20) << name << std::right
+                  << std::setw(9) << mb / plain << " MB/s" << std::setw(9) << mb / interned << " MB/s"
+                  << std::setw(9) << mb / parallel << " MB/s" << std::setw(9) << mb / parallel_interned << " MB/s\n";
+    }
+
+    /* one interner shared by every corpus, as by the modules of a compilation */
+    std::cout << "\n" << std::left << std::setw(24) << "shared interner" << std::right << std::setw(14) << "names"
+              << std::setw(14) << "atoms" << std::setw(10) << "dedup" << std::setw(14) << "bytes seen"
+              << std::setw(14) << "stored" << std::setw(14) << "interner" << "\n";
+    Interner shared;
+    for (const auto &[name, src]: corpora)
+    {
+        keep(tokenize(src, &shared));
+        const auto stats = shared.stats();
+        std::cout << std::left << std::setw(24) << ("  + " + std::string(name)) << std::right
+                  << std::setw(14) << stats.lookups << std::setw(14) << shared.size()
+                  << std::setw(9) << static_cast<double>(stats.lookups) / std::max(1U, shared.size()) << "x"
+                  << std::setw(11) << stats.bytes_seen / 1024 << " KiB" << std::setw(11) << stats.bytes_stored / 1024
+                  << " KiB" << std::setw(11) << shared.memory_bytes() / 1024 << " KiB\n";
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../bench.h"
+#include <compiler/lexer/include/lexer.h>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace klr::compiler;
+using klr::bench::best_of;
+
+/* keyword recognition before the perfect hash, kept as the baseline */
+static TokenType linear_lookup(const char *s, const size_t len)
+{
+    for (const auto &[str, type]: token_map)
+    {
+        if (str.length() == len && memcmp(str.data(), s, len) == 0)
+            return type;
+    }
+    return TokenType::IDENTIFIER;
+}
+
+/* roughly one keyword per three words, like declaration-heavy modules */
+static std::string make_identifier_dense(const size_t words)
+{
+    static constexpr const char *idents[] = {
+        "value", "count", "buffer", "index", "result", "node", "parent", "lhs", "rhs", "data",
+        "i", "x", "offset_table", "len", "self_ref", "ifx", "returned", "u81", "Owned"
+    };
+    static constexpr const char *keywords[] = {
+        "var", "const", "function", "return", "if", "else", "for", "while", "u32", "f64",
+        "string", "bool", "Own", "Ref", "cast", "@inline", "@pure", "struct", "true", "null"
+    };
+
+    std::mt19937 rng(42);
+    std::string out;
+    out.reserve(words * 8);
+    for (size_t i = 0; i < words; ++i)
+    {
+        out += rng() % 3 == 0 ? keywords[rng() % std::size(keywords)] : idents[rng() % std::size(idents)];
+        out += i % 12 == 11 ? '\n' : ' ';
+    }
+    return out;
+}
+
+int main()
+{
+    const std::string src = make_identifier_dense(1 << 20);
+
+    /* pre-split words so only recognition is timed */
+    std::vector<std::pair<uint32_t, uint16_t> > words;
+    for (size_t i = 0; i < src.size();)
+    {
+        const size_t end = src.find_first_of(" \n", i);
+        words.emplace_back(i, end - i);
+        i = end + 1;
+    }
+
+    uint64_t sink = 0;
+    const double linear = best_of(5, [&]
+    {
+        for (const auto &[start, len]: words)
+            sink += static_cast<uint8_t>(linear_lookup(src.data() + start, len));
+    });
+    const double hashed = best_of(5, [&]
+    {
+        for (const auto &[start, len]: words)
+            sink += static_cast<uint8_t>(lookup_keyword(src.data() + start, len));
+    });
+
+    size_t tokens = 0;
+    const double lexing = best_of(5, [&]
+    {
+        Lexer lexer("bench.klr", src);
+        tokens = lexer.tokenize()->size();
+    });
+
+    const double mb = static_cast<double>(src.size()) / 1e6;
+    std::cout << "words:             " << words.size() << " (" << mb << " MB)\n"
+              << "linear token_map:  " << linear * 1e9 / words.size() << " ns/word\n"
+              << "perfect hash:      " << hashed * 1e9 / words.size() << " ns/word ("
+              << linear / hashed << "x)\n"
+              << "tokenize:          " << mb / lexing << " MB/s, "
+              << tokens / lexing / 1e6 << " Mtok/s\n"
+              << "(checksum " << sink << ")\n";
+    return 0;
+}
@@ -0,0 +1,182 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../bench.h"
+#include "../corpora.h"
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/parser/include/parser.h>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace klr::compiler;
+using klr::bench::best_of;
+
+namespace
+{
+    /* hardware cache-miss counter of this thread; reads -1 where perf events are unavailable */
+    class MissCounter
+    {
+    public:
+        MissCounter()
+        {
+#if defined(__linux__)
+            perf_event_attr attr {};
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.size = sizeof(attr);
+            attr.config = PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                          PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+        }
+
+        ~MissCounter()
+        {
+#if defined(__linux__)
+            if (fd >= 0)
+                close(fd);
+#endif
+        }
+
+        MissCounter(const MissCounter &) = delete;
+
+        MissCounter &operator=(const MissCounter &) = delete;
+
+        /* L1D read misses during fn */
+        template<typename Fn>
+        int64_t count(Fn &&fn)
+        {
+#if defined(__linux__)
+            if (fd >= 0)
+            {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+                fn();
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+                int64_t misses = 0;
+                if (read(fd, &misses, sizeof(misses)) == sizeof(misses))
+                    return misses;
+                return -1;
+            }
+#endif
+            fn();
+            return -1;
+        }
+
+    private:
+        int fd = -1;
+    };
+
+    template<typename T>
+    void keep(const T &value)
+    {
+        asm volatile("" : : "g"(&value) : "memory");
+    }
+
+    // the access pattern of the parser: a few type checks per token, then the
+    // token is consumed; only identifiers and literals are stored in nodes, so
+    // only those need start and length. `gather` is the pre-cursor Parser::peek()
+    uint64_t consume_gather(const TokenList &tokens)
+    {
+        uint64_t sink = 0;
+        for (size_t i = 0; i + 1 < tokens.size(); ++i)
+        {
+            const Token a = tokens[i];
+            const Token b = tokens[i];
+            if (a.type == TokenType::SEMICOLON || b.type == TokenType::RIGHT_BRACE)
+                sink += 1;
+
+            if (const Token tk = tokens[i]; tk.type == TokenType::IDENTIFIER || tk.type == TokenType::NUM_LITERAL)
+                sink += tk.start + tk.len;
+            else
+                sink += static_cast<uint64_t>(tk.flags);
+        }
+        return sink;
+    }
+
+    uint64_t consume_cursor(const TokenList &tokens)
+    {
+        uint64_t sink = 0;
+        TokenCursor cursor(tokens);
+        while (!cursor.at_end())
+        {
+            if (cursor.peek_type() == TokenType::SEMICOLON || cursor.peek_type(0) == TokenType::RIGHT_BRACE)
+                sink += 1;
+
+            if (const TokenType type = cursor.peek_type();
+                type == TokenType::IDENTIFIER || type == TokenType::NUM_LITERAL)
+            {
+                const Token tk = cursor.advance();
+                sink += tk.start + tk.len;
+            }
+            else
+            {
+                cursor.skip();
+            }
+        }
+        return sink;
+    }
+}
+
+int main()
+{
+    constexpr size_t size = 64 << 20;
+    constexpr int runs = 5;
+    const std::pair<std::string_view, std::string> corpora[] = {
+        { "nested_expressions", klr::bench::nested_expressions(size) },
+        { "identifier_heavy", klr::bench::identifier_heavy(size) },
+        { "realistic", klr::bench::realistic(size) },
+    };
+
+    MissCounter counter;
+    std::cout << std::left << std::setw(20) << "corpus" << std::right << std::setw(14) << "gather"
+              << std::setw(14) << "cursor" << std::setw(18) << "gather misses" << std::setw(18) << "cursor misses"
+              << "\n" << std::fixed;
+    for (const auto &[name, src]: corpora)
+    {
+        Lexer lexer("bench.klr", src);
+        const auto tokens = lexer.tokenize();
+        const auto n = static_cast<double>(tokens->size());
+
+        const double gather = best_of(runs, [&] { keep(consume_gather(*tokens)); });
+        const double cursor = best_of(runs, [&] { keep(consume_cursor(*tokens)); });
+        const int64_t gather_misses = counter.count([&] { keep(consume_gather(*tokens)); });
+        const int64_t cursor_misses = counter.count([&] { keep(consume_cursor(*tokens)); });
+
+        std::cout << std::left << std::setw(20) << name << std::right << std::setprecision(2)
+                  << std::setw(8) << gather / n * 1e9 << " ns/tk" << std::setw(8) << cursor / n * 1e9 << " ns/tk";
+        if (gather_misses < 0 || cursor_misses < 0)
+            std::cout << std::setw(36) << "(perf events unavailable)";
+        else
+        {
+            std::cout << std::setprecision(4)
+                      << std::setw(11) << static_cast<double>(gather_misses) / n << " miss/tk"
+                      << std::setw(11) << static_cast<double>(cursor_misses) / n << " miss/tk";
+        }
+        std::cout << "\n";
+
+        /* the whole parser on the cursor, for scale */
+        Lexer parse_lexer("bench.klr", src);
+        auto parse_tokens = parse_lexer.tokenize();
+        Parser parser("bench.klr", src, std::move(parse_tokens), parse_lexer.get_line_starts());
+        const int64_t parse_misses = counter.count([&] { keep(parser.parse().size()); });
+        if (parse_misses >= 0)
+        {
+            std::cout << std::left << std::setw(20) << "  parse()" << std::right << std::setprecision(4)
+                      << std::setw(11) << static_cast<double>(parse_misses) / n << " miss/tk\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../corpora.h"
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/memory/include/arena.h>
+#include <compiler/parser/include/parser.h>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace klr::compiler;
+
+/* fastest parse() of `runs`, in seconds; lexing and the arena rewind are not timed */
+static double time_parse(const std::string &src, const ExprStrategy strategy, const int runs, size_t &nodes)
+{
+    Arena arena;
+    auto best = 1e300;
+    for (auto r = 0; r < runs; ++r)
+    {
+        arena.reset();
+        Lexer lexer("bench.klr", src, simd::Level::AVX2, &arena);
+        auto tokens = lexer.tokenize();
+        Parser parser("bench.klr", src, std::move(tokens), lexer.get_line_starts(), &arena, strategy);
+
+        const auto begin = std::chrono::steady_clock::now();
+        const AST ast = parser.parse();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        best = std::min(best, elapsed.count());
+        nodes = ast.size();
+        if (parser.has_errors())
+        {
+            std::cerr << "corpus does not parse\n";
+            std::exit(2);
+        }
+    }
+    return best;
+}
+
+int main()
+{
+    constexpr size_t size = 4 << 20;
+    constexpr int runs = 7;
+    const std::pair<std::string_view, std::string> corpora[] = {
+        { "nested_expressions", klr::bench::nested_expressions(size) },
+        { "identifier_heavy", klr::bench::identifier_heavy(size) },
+        { "realistic", klr::bench::realistic(size) },
+    };
+
+    std::cout << std::left << std::setw(20) << "corpus" << std::right << std::setw(16) << "descent"
+              << std::setw(16) << "pratt" << std::setw(10) << "speedup" << "\n" << std::fixed << std::setprecision(1);
+    for (const auto &[name, src]: corpora)
+    {
+        size_t nodes = 0;
+        const double descent = time_parse(src, ExprStrategy::DESCENT, runs, nodes);
+        const double pratt = time_parse(src, ExprStrategy::PRATT, runs, nodes);
+        std::cout << std::left << std::setw(20) << name << std::right
+                  << std::setw(9) << static_cast<double>(nodes) / descent / 1e6 << " Mnode/s"
+                  << std::setw(9) << static_cast<double>(nodes) / pratt / 1e6 << " Mnode/s"
+                  << std::setprecision(2) << std::setw(9) << descent / pratt << "x" << std::setprecision(1) << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../bench.h"
+#include <compiler/analysis/include/folder.h>
+#include <compiler/ir/include/lowering.h>
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/memory/include/interner.h>
+#include <compiler/parser/include/parser.h>
+#include <compiler/vm/include/emitter.h>
+#include <compiler/vm/include/vm.h>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace klr::compiler;
+using klr::bench::best_of;
+
+namespace
+{
+    /* arrays do not lower yet, so the sums are over series the loops compute */
+    constexpr std::string_view source = R"(
+        function fib(n: i32) -> i32 { return n < 2 ? n : fib(n - 1) + fib(n - 2); }
+
+        function loops(n: i64) -> i64 {
+            var s: i64 = 0;
+            for (var i: i64 = 0; i < n; i += 1) {
+                for (var j: i64 = 0; j < n; j += 1) {
+                    if (((i ^ j) & 1) == 0) { s += i * j; } else { s -= j; }
+                }
+            }
+            return s;
+        }
+
+        function squares(n: u64) -> u64 {
+            var s: u64 = 0;
+            var i: u64 = 0;
+            while (i < n) { s += i * i % 7; i += 1; }
+            return s;
+        }
+
+        function leibniz(n: i32) -> f64 {
+            var s: f64 = 0.0;
+            var sign: f64 = 1.0;
+            for (var k: i32 = 0; k < n; k += 1) {
+                s += sign / cast<f64>(2 * k + 1);
+                sign = -sign;
+            }
+            return 4.0 * s;
+        }
+    )";
+
+    struct Case
+    {
+        std::string_view name;
+        std::string_view function;
+        Value arg;
+    };
+}
+
+int main()
+{
+    constexpr int runs = 5;
+
+    Interner interner;
+    const std::string src(source);
+    Lexer lexer("bench.klr", src, simd::Level::AVX2, std::pmr::get_default_resource(), &interner);
+    auto tokens = lexer.tokenize();
+    Parser parser("bench.klr", src, std::move(tokens), lexer.get_line_starts());
+    AST ast = parser.parse();
+
+    SymbolTable symbols;
+    symbols.resolve(ast);
+    TypeTable types;
+    TypeChecker checker(types, ast, symbols, parser.get_tokens());
+    checker.check();
+    ConstantPool pool;
+    ConstantFolder(ast, pool, checker, symbols, parser.get_tokens()).fold();
+    IRModule module;
+    IRLowering lowering(module, ast, symbols, types, checker, pool, parser.get_tokens());
+    lowering.lower();
+    if (parser.has_errors() || checker.has_errors() || !lowering.get_diagnostics().empty())
+    {
+        std::cerr << "the benchmark's source does not compile\n";
+        return 1;
+    }
+
+    Program program;
+    BytecodeEmitter(program, module, types, pool).emit();
+    VM vm(program);
+
+    const Case cases[] = {
+        { "fib(30)", "fib", Value::integer(TypeKind::I32, 30) },
+        { "loops(3000)", "loops", Value::integer(TypeKind::I64, 3000) },
+        { "squares(10M)", "squares", Value::integer(TypeKind::U64, 10'000'000) },
+        { "leibniz(10M)", "leibniz", Value::integer(TypeKind::I32, 10'000'000) },
+    };
+
+    std::cout << std::left << std::setw(16) << "program" << std::right << std::setw(14) << "executed"
+              << std::setw(12) << "time" << std::setw(14) << "Minst/s" << std::setw(12) << "ns/inst"
+              << std::setw(10) << "allocs" << std::setw(24) << "result" << "\n" << std::fixed;
+    for (const auto &[name, function, arg]: cases)
+    {
+        const uint32_t index = program.find(interner.intern(function));
+        const Value args[] = { arg };
+
+        uint64_t executed = 0;
+        const Result result = vm.profile(index, args, executed);
+        const double time = best_of(runs, [&] { (void) vm.run(index, args); });
+        const uint64_t before = klr::bench::allocations();
+        (void) vm.run(index, args);
+        const uint64_t allocs = klr::bench::allocations() - before;
+
+        std::cout << std::left << std::setw(16) << name << std::right << std::setw(14) << executed
+                  << std::setprecision(3) << std::setw(10) << time * 1e3 << " ms" << std::setprecision(1)
+                  << std::setw(14) << static_cast<double>(executed) / time / 1e6 << std::setprecision(2)
+                  << std::setw(12) << time / static_cast<double>(executed) * 1e9 << std::setw(10) << allocs
+                  << std::setw(24);
+        if (TypeTable::is_float(result.value.kind))
+            std::cout << std::setprecision(9) << result.value.as_float() << "\n";
+        else
+            std::cout << result.value.as_int() << "\n";
+    }
+    std::cout << "\n" << program.code.size() << " instructions, " << program.memory_bytes() << " bytes\n";
+    return 0;
+}
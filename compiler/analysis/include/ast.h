@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
+#include <memory_resource>
 #include <vector>
 #include <ostream>
 #include <compiler/interfaces/include/tokens.h>
@@ -18,7 +20,7 @@ namespace klr::compiler
         BINARY_EXPR, /* binary expressions */
         UNARY_EXPR,  /* unary expressions */
         CAST_EXPR,   /* type casting expressions */
-        LITERAL,     /* literals (check tokens to determine if it's a string or number) */
+        LITERAL,     /* literals (check tokens to determine if it's a string or number, or data.literal once folded) */
         IDENTIFIER,  /* variable references */
         ARRAY_INIT,  /* array declaration */
         METHOD_CALL, /* method call */
@@ -31,6 +33,7 @@ namespace klr::compiler
         FOR,
         BREAK,
         CONTINUE,
+        ERROR,       /* placeholder for code that failed to parse; see the parser's diagnostics */
     };
 
     enum class ASTNodeFlags : uint8_t
@@ -54,63 +57,176 @@ namespace klr::compiler
         );
     }
 
+    /* per-node payload; the live member depends on the node type */
+    union ASTNodeData
+    {
+        struct
+        {
+            ASTNodeFlags flags;
+            uint32_t init_node; /* index to initialization expression */
+            uint32_t type_node; /* index to type expression */
+        } decl;
+
+        struct
+        {
+            uint32_t left;  /* index to left operand */
+            uint32_t right; /* index to right operand */
+            TokenType op;   /* operator type (e.g., PLUS, MINUS) */
+        } binary_expr;
+
+        struct
+        {
+            uint32_t operand; /* index to the operand */
+            TokenType op;     /* operator type (e.g., BANG, MINUS) */
+        } unary_expr;
+
+        struct
+        {
+            uint32_t operand;
+            uint32_t type_node;
+        } cast_expr;
+
+        struct
+        {
+            uint32_t ret_type; /* index to return type node */
+            uint32_t body;     /* index to function body */
+        } function;
+
+        struct
+        {
+            uint32_t constant; /* index into the module's ConstantPool, 0 until ConstantFolder has run */
+        } literal;
+
+        /* the header parts, 0 where left out; only the parts present are children, before the body */
+        struct
+        {
+            uint32_t init;
+            uint32_t condition;
+            uint32_t step;
+        } for_stmt;
+    };
+
+    /* one node gathered from the columns; a value copy, writes go through the AST */
     struct ASTNode
     {
-        std::vector<uint32_t> children; /* child indices */
-        Token token;                    /* the token (metadata is inside) */
-        uint32_t parent;                /* parent index */
+        Token token;     /* the token (metadata is inside) */
+        uint32_t parent; /* parent index */
+        uint32_t atom;   /* interned name, 0 if none */
         ASTNodeType type;
+        ASTNodeData data;
+    };
 
-        union
+    /*
+     * flat AST: every node is a row across POD columns, like TokenList.
+     * children are an intrusive sibling list (first_child -> next_sibling
+     * -> ... ), so adding a child never allocates and a node costs
+     * bytes_per_node no matter how many children it has. index 0 is the
+     * root and never a child, so 0 doubles as "none" in the link columns
+     *
+     * passes that do not care about tree shape just scan the columns
+     * from 0 to size(); nodes are stored in creation order
+     */
+    class AST
+    {
+    public:
+        std::pmr::vector<ASTNodeType> types;
+        std::pmr::vector<Token> tokens;
+        std::pmr::vector<uint32_t> parents;
+        std::pmr::vector<ASTNodeData> data;
+        std::pmr::vector<uint32_t> first_child;
+        std::pmr::vector<uint32_t> last_child;
+        std::pmr::vector<uint32_t> next_sibling;
+
+        /* interned name of declarations, references, calls, named types and string literals; 0 if none */
+        std::pmr::vector<uint32_t> atoms;
+
+        static constexpr size_t bytes_per_node = sizeof(ASTNodeType) + sizeof(Token) + sizeof(ASTNodeData) +
+                                                 5 * sizeof(uint32_t);
+
+        /* forward iteration over the sibling list of one node */
+        class ChildIterator
         {
-            struct
+        public:
+            using value_type = uint32_t;
+            using difference_type = std::ptrdiff_t;
+
+            ChildIterator() = default;
+
+            ChildIterator(const std::pmr::vector<uint32_t> *next, const uint32_t at) : next(next), at(at) {}
+
+            uint32_t operator*() const
             {
-                ASTNodeFlags flags;
-                uint32_t init_node; /* index to initialization expression */
-                uint32_t type_node; /* index to type expression */
-            } decl;
+                return at;
+            }
 
-            struct
+            ChildIterator &operator++()
             {
-                uint32_t left;  /* index to left operand */
-                uint32_t right; /* index to right operand */
-                TokenType op;   /* operator type (e.g., PLUS, MINUS) */
-            } binary_expr;
+                at = (*next)[at];
+                return *this;
+            }
 
-            struct
+            ChildIterator operator++(int)
             {
-                uint32_t operand; /* index to the operand */
-                TokenType op;     /* operator type (e.g., BANG, MINUS) */
-            } unary_expr;
+                const auto old = *this;
+                ++*this;
+                return old;
+            }
 
-            struct
+            bool operator==(const ChildIterator &other) const
             {
-                uint32_t operand;
-                uint32_t type_node;
-            } cast_expr;
+                return at == other.at;
+            }
+
+        private:
+            const std::pmr::vector<uint32_t> *next = nullptr;
+            uint32_t at = 0;
+        };
+
+        struct ChildRange
+        {
+            ChildIterator first;
 
-            struct
+            [[nodiscard]] ChildIterator begin() const
             {
-                uint32_t ret_type; /* index to return type node */
-                uint32_t body;     /* index to function body */
-            } function;
-        } data;
-    };
+                return first;
+            }
 
-    class AST
-    {
-    public:
-        std::vector<ASTNode> nodes;
+            /* the list ends at link 0, the root */
+            [[nodiscard]] static ChildIterator end()
+            {
+                return {};
+            }
+        };
+
+        /* columns live in resource, e.g. the module's Arena */
+        explicit AST(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
 
-        uint32_t add_node(ASTNodeType type, Token token);
+        uint32_t add_node(ASTNodeType type, Token token, uint32_t atom = 0);
 
+        /* appends child to the parent's children; a node can only have one parent */
         void add_child(uint32_t parent_idx, uint32_t child_idx);
 
+        [[nodiscard]] ChildRange children(uint32_t node_idx) const;
+
+        [[nodiscard]] size_t child_count(uint32_t node_idx) const;
+
+        [[nodiscard]] ASTNode operator[](uint32_t node_idx) const;
+
+        [[nodiscard]] size_t size() const
+        {
+            return types.size();
+        }
+
+        /* heap bytes held by the columns, capacity included */
+        [[nodiscard]] size_t memory_bytes() const;
+
+        void reserve(size_t n);
+
         void dump(std::ostream &os = std::cout, uint32_t node_idx = 0, size_t indent = 0) const;
 
     private:
-        /* dump() helper */
-        void dump_node(std::ostream &os, uint32_t node_idx, size_t indent, std::vector<bool> &visited) const;
+        /* dump() helper; prints one node, dump() walks the tree */
+        void dump_node(std::ostream &os, uint32_t node_idx, size_t indent) const;
 
         /* helpers */
         static void dump_token_flags(std::ostream &os, TokenFlags flags);
@@ -0,0 +1,136 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+#include <compiler/analysis/include/ast.h>
+#include <compiler/analysis/include/symbols.h>
+#include <compiler/analysis/include/types.h>
+#include <compiler/interfaces/include/diagnostics.h>
+
+namespace klr::compiler
+{
+    /*
+     * type checking and inference over one module's AST
+     *
+     * check() scans the node columns once, in creation order. a node whose
+     * type is not known yet, e.g. an operand created before the expression
+     * that uses it or a `var x = ...` declaration (TYPE_INFER), is given an
+     * inference variable, and each rule unifies the variables it touches.
+     * variables live in a union-find with path halving, so the order in
+     * which the rules meet does not matter
+     *
+     * number literals get a variable that only accepts numeric types and
+     * defaults to i32 (f64 for floats) if nothing else pins it down. anything
+     * still open at the end is reported on its declaration. needs a resolved
+     * SymbolTable; method calls and user types are not checked yet
+     */
+    class TypeChecker
+    {
+    public:
+        /* the tokens are the ones the AST was parsed from, see Parser::get_tokens() */
+        TypeChecker(TypeTable &types, const AST &ast, const SymbolTable &symbols, const TokenList &tokens,
+                    std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+        void check();
+
+        /* after check(): the type of every node, fully resolved; statements are void */
+        [[nodiscard]] TypeId type_of(const uint32_t node) const
+        {
+            return node_types[node];
+        }
+
+        /* in the order they were found; render them with the parser's renderer() */
+        [[nodiscard]] const std::pmr::vector<Diagnostic> &get_diagnostics() const
+        {
+            return diagnostics;
+        }
+
+        [[nodiscard]] bool has_errors() const
+        {
+            return !diagnostics.empty();
+        }
+
+    private:
+        /* what an inference variable may still become */
+        enum class VarClass : uint8_t { ANY, NUMERIC, INTEGER, FLOAT, POINTER };
+
+        static constexpr TypeId UNSET = ~0U;
+
+        TypeTable &types;
+        const AST &ast;
+        const SymbolTable &symbols;
+        const TokenList &tokens;
+
+        std::pmr::vector<TypeId> node_types;
+        std::pmr::vector<Diagnostic> diagnostics;
+
+        /* union-find over the variables; bound is UNSET while a root is still open */
+        std::pmr::vector<uint32_t> parents;
+        std::pmr::vector<uint32_t> sizes;
+        std::pmr::vector<TypeId> bound;
+        std::pmr::vector<VarClass> classes;
+        std::pmr::vector<TypeId> var_types; /* the VAR type of each variable */
+
+        /* scratch for unify(), occurs() and instantiate() */
+        std::pmr::vector<std::pair<TypeId, TypeId> > pending;
+        std::pmr::vector<TypeId> visiting;
+        std::pmr::vector<std::pair<uint32_t, TypeId> > substitution;
+        /* operands of types being built, used as a stack so nested builds can share it */
+        std::pmr::vector<TypeId> scratch;
+
+        void check_node(uint32_t node);
+
+        void check_binary(uint32_t node);
+
+        /* constrains both operands of node to cls, reporting the first that cannot be */
+        bool operands(uint32_t node, TypeId lhs, TypeId rhs, VarClass cls);
+
+        void check_unary(uint32_t node);
+
+        void check_call(uint32_t node);
+
+        /* the type of a node so far, a fresh variable for one not typed yet */
+        TypeId node_type(uint32_t node);
+
+        /* a TYPE or ARRAY_TYPE node as a type */
+        TypeId lower(uint32_t node);
+
+        TypeId signature(uint32_t function);
+
+        TypeId fresh(VarClass cls);
+
+        uint32_t find(uint32_t var);
+
+        /* follows bound variables until a type that is not one; an open variable is returned as its root */
+        TypeId resolve(TypeId type);
+
+        bool unify(TypeId a, TypeId b);
+
+        /* unifies and reports code at node if that fails */
+        void expect(TypeId expected, TypeId found, uint32_t node, DiagCode code = DiagCode::TYPE_MISMATCH);
+
+        bool constrain(TypeId type, VarClass cls);
+
+        /* what a variable of both classes may become; false if nothing */
+        static bool meet(VarClass a, VarClass b, VarClass &out);
+
+        bool bind(uint32_t var, TypeId type);
+
+        [[nodiscard]] bool occurs(uint32_t var, TypeId type);
+
+        /* type with every bound variable replaced by what it is bound to */
+        TypeId zonk(TypeId type);
+
+        /* a generic function type with fresh variables for its generic parameters */
+        TypeId instantiate(TypeId type);
+
+        TypeId substitute(TypeId type);
+
+        void error(DiagCode code, uint32_t node, TypeId expected = TypeTable::ERROR, TypeId found = TypeTable::ERROR);
+    };
+}
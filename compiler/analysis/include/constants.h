@@ -0,0 +1,91 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include <compiler/analysis/include/types.h>
+#include <compiler/interfaces/include/tokens.h>
+
+namespace klr::compiler
+{
+    /*
+     * one compile-time value. integers are kept wrapped to their width and
+     * sign- or zero-extended to 64 bits, floats as the bits of a double (an
+     * f32 is rounded to float first), bools as 0 or 1
+     */
+    struct Constant
+    {
+        TypeId type;
+        uint64_t bits;
+
+        [[nodiscard]] double as_float() const
+        {
+            return std::bit_cast<double>(bits);
+        }
+    };
+
+    /*
+     * the values of a module's constant expressions
+     *
+     * every distinct (type, bits) is stored once and named by a dense index,
+     * which is what a folded LITERAL keeps in ASTNodeData::literal. 0 is
+     * never a constant, so it doubles as "none"
+     */
+    class ConstantPool
+    {
+    public:
+        static constexpr uint32_t NONE = 0;
+
+        std::pmr::vector<Constant> constants;
+
+        explicit ConstantPool(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+        /* the one index of (type, bits), adding it if new; bits must already be in the form above */
+        uint32_t add(TypeId type, uint64_t bits);
+
+        [[nodiscard]] const Constant &operator[](const uint32_t id) const
+        {
+            return constants[id];
+        }
+
+        [[nodiscard]] size_t size() const
+        {
+            return constants.size();
+        }
+
+        /* e.g. `-3`, `2.5` or `true`; only builtin types have constants */
+        [[nodiscard]] std::string to_string(uint32_t id) const;
+
+        /* heap bytes held by the pool, capacity included */
+        [[nodiscard]] size_t memory_bytes() const;
+
+    private:
+        std::pmr::vector<uint32_t> slots; /* open addressing over constants; NONE = empty */
+
+        void grow();
+    };
+
+    /*
+     * Klare's arithmetic on builtin values, in the Constant encoding
+     *
+     * integers wrap around at their width, signed ones in two's complement,
+     * so INT_MIN / -1 is INT_MIN. a shift count is taken modulo the width and
+     * >> is arithmetic on signed types. float to integer casts truncate and
+     * saturate, NaN becoming 0. anything that evaluates Klare at compile or
+     * run time agrees with these
+     */
+    [[nodiscard]] uint64_t wrap_integer(TypeKind kind, uint64_t bits);
+
+    /* kind is the type of the operands; false if op does not apply or divides an integer by zero */
+    [[nodiscard]] bool evaluate_binary(TokenType op, TypeKind kind, uint64_t lhs, uint64_t rhs, uint64_t &out);
+
+    [[nodiscard]] bool evaluate_unary(TokenType op, TypeKind kind, uint64_t operand, uint64_t &out);
+
+    /* cast<to>(value of from); false unless both are numbers or bool */
+    [[nodiscard]] bool convert(TypeKind from, TypeKind to, uint64_t bits, uint64_t &out);
+}
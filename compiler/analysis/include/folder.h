@@ -0,0 +1,74 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+#include <compiler/analysis/include/ast.h>
+#include <compiler/analysis/include/checker.h>
+#include <compiler/analysis/include/constants.h>
+#include <compiler/interfaces/include/diagnostics.h>
+
+namespace klr::compiler
+{
+    /*
+     * constant folding over a checked AST
+     *
+     * fold() scans the nodes once in creation order, which puts every
+     * operand before the expression using it, and evaluates unary, binary,
+     * cast<T> and ternary expressions whose operands are constants, by the
+     * rules in constants.h and at the types the checker inferred. a `const`
+     * with a constant initializer is a constant wherever it is named
+     *
+     * a folded expression is rewritten in place into a LITERAL whose
+     * data.literal names its value in the pool, so node indexes (and
+     * TypeChecker::type_of) stay valid. its operands are left behind
+     * unlinked, so nothing walking the tree sees them again. number and
+     * bool literals get their pool entry too
+     */
+    class ConstantFolder
+    {
+    public:
+        /* checker has run check() over ast; the tokens are the ones the AST was parsed from */
+        ConstantFolder(AST &ast, ConstantPool &pool, const TypeChecker &checker, const SymbolTable &symbols,
+                       const TokenList &tokens, std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+        /* how many expressions were rewritten */
+        size_t fold();
+
+        /* the constant a node evaluates to, ConstantPool::NONE if it is not one */
+        [[nodiscard]] uint32_t constant(uint32_t node) const;
+
+        [[nodiscard]] const std::pmr::vector<Diagnostic> &get_diagnostics() const
+        {
+            return diagnostics;
+        }
+
+    private:
+        AST &ast;
+        ConstantPool &pool;
+        const TypeChecker &checker;
+        const SymbolTable &symbols;
+        const TokenList &tokens;
+
+        std::pmr::vector<Diagnostic> diagnostics;
+
+        uint32_t literal(uint32_t node);
+
+        uint32_t binary(uint32_t node);
+
+        uint32_t unary(uint32_t node);
+
+        uint32_t cast(uint32_t node);
+
+        uint32_t ternary(uint32_t node);
+
+        /* turns node into a LITERAL of constant and cuts it off from its operands */
+        void rewrite(uint32_t node, uint32_t constant);
+
+        /* the builtin kind of a node's checked type, ERROR for anything else */
+        [[nodiscard]] TypeKind kind(uint32_t node) const;
+    };
+}
@@ -0,0 +1,103 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+#include <compiler/analysis/include/ast.h>
+
+namespace klr::compiler
+{
+    /* a declared name: a DECL (variable, constant, parameter), a named FUNCTION or a generic parameter TYPE */
+    struct Symbol
+    {
+        uint32_t atom;     /* interned name */
+        uint32_t node;     /* declaring AST node */
+        uint32_t scope;    /* index into SymbolTable::scopes */
+        uint32_t shadowed; /* symbol the name meant right before this one was declared, 0 if none */
+    };
+
+    /* a ROOT, FUNCTION, BLOCK or FOR node; FOR scopes hold the header's declaration */
+    struct Scope
+    {
+        uint32_t node;   /* owning AST node */
+        uint32_t parent; /* enclosing scope; the module scope is its own parent */
+        uint32_t depth;  /* 0 for the module scope */
+    };
+
+    /*
+     * name resolution over one module's AST
+     *
+     * resolve() makes a single walk of the tree and binds every IDENTIFIER,
+     * CALL and named TYPE to the symbol its name means at that point. the
+     * names in scope live in one open-addressing table keyed by atom, not in
+     * a map per scope: a declaration overwrites its name's slot and keeps the
+     * previous symbol in `shadowed`, and leaving a scope puts those back. a
+     * lookup is therefore one probe, however deep the scope chain
+     *
+     * module-level functions and variables are visible in the whole module;
+     * inside functions a name is visible after its declaration, so a local's
+     * initializer still sees the outer meaning of the name. needs the atoms
+     * the parser records, i.e. a lexer given an Interner
+     */
+    class SymbolTable
+    {
+    public:
+        static constexpr uint32_t NONE = 0;
+
+        std::pmr::vector<Symbol> symbols; /* in declaration order; [0] is NONE */
+        std::pmr::vector<Scope> scopes;   /* in opening order; [0] is the module scope */
+
+        /* per AST node: the symbol a reference resolves to, or a declaration introduces; NONE otherwise */
+        std::pmr::vector<uint32_t> bindings;
+
+        std::pmr::vector<uint32_t> unresolved; /* IDENTIFIER nodes with no declaration in scope */
+        std::pmr::vector<uint32_t> redeclared; /* declarations repeating a name already declared in their scope */
+
+        /* the tables live in resource, e.g. the module's Arena */
+        explicit SymbolTable(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+        /* resolves ast from scratch; only node indexes are kept, so ast need not outlive the table */
+        void resolve(const AST &ast);
+
+        /* the declaring node of whatever node refers to or declares; 0 if none */
+        [[nodiscard]] uint32_t declaration(const uint32_t node) const
+        {
+            return node < bindings.size() ? symbols[bindings[node]].node : 0;
+        }
+
+        /* heap bytes held by the tables, capacity included */
+        [[nodiscard]] size_t memory_bytes() const;
+
+    private:
+        /* (atom, symbol) slots; a name out of scope keeps its slot with symbol NONE until the next grow() */
+        std::pmr::vector<std::pair<uint32_t, uint32_t> > slots;
+        uint32_t used = 0;
+
+        /* declarations of the open scopes, innermost last; closing a scope pops its own */
+        std::pmr::vector<uint32_t> live;
+        std::pmr::vector<uint32_t> scope_starts; /* live.size() when each open scope was opened */
+        uint32_t current = 0;                    /* innermost open scope */
+
+        /* nodes still to visit during resolve(); see the walk there */
+        std::pmr::vector<uint32_t> work;
+
+        [[nodiscard]] size_t find(uint32_t atom) const;
+
+        /* the slot of atom, claiming one if atom was never declared */
+        size_t claim(uint32_t atom);
+
+        void grow();
+
+        void open_scope(uint32_t node);
+
+        void close_scope();
+
+        void declare(uint32_t node, uint32_t atom);
+
+        void reference(uint32_t node, uint32_t atom, bool report);
+    };
+}
@@ -0,0 +1,144 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace klr::compiler
+{
+    class Interner;
+
+    /* the builtins come first, in TokenType order, so each one's TypeId is its kind */
+    enum class TypeKind : uint8_t
+    {
+        ERROR, /* a type that could not be worked out; unifies with anything, so errors do not cascade */
+        U8,
+        I8,
+        U16,
+        I16,
+        U32,
+        I32,
+        U64,
+        I64,
+        F32,
+        F64,
+        STRING,
+        BOOL,
+        VOID,
+        ARRAY,    /* operands: element */
+        OWN,      /* operands: pointee */
+        SHARE,
+        REF,
+        PIN,
+        FUNCTION, /* operands: return type, then parameters */
+        GENERIC,  /* a generic parameter; name: atom, operands: its declaring TYPE node, not a TypeId */
+        NAMED,    /* a user type, not checked yet; name: atom, operands: type arguments */
+        VAR,      /* an inference variable; name: its index in the TypeChecker that made it */
+    };
+
+    using TypeId = uint32_t;
+
+    /* one hash-consed type */
+    struct Type
+    {
+        TypeKind kind;
+        uint8_t flags;     /* TypeTable::HAS_VAR, HAS_GENERIC */
+        uint16_t count;    /* operands */
+        uint32_t name;     /* see TypeKind */
+        uint32_t operands; /* first operand in TypeTable::operands */
+    };
+
+    /*
+     * hash-consed types
+     *
+     * every structurally distinct type is stored once and named by a dense
+     * TypeId, so type equality anywhere after checking is an integer compare.
+     * a type is a row (kind, name, operands) with its operands, themselves
+     * TypeIds, in one shared pool. builtins are interned up front: the id of
+     * a builtin is its TypeKind, e.g. TypeTable::I32
+     *
+     * meant to be shared by the modules of a compilation, though not across
+     * threads. VAR types only mean something to the checker that made them
+     */
+    class TypeTable
+    {
+    public:
+        static constexpr TypeId ERROR = static_cast<TypeId>(TypeKind::ERROR);
+        static constexpr TypeId I32 = static_cast<TypeId>(TypeKind::I32);
+        static constexpr TypeId F64 = static_cast<TypeId>(TypeKind::F64);
+        static constexpr TypeId STRING = static_cast<TypeId>(TypeKind::STRING);
+        static constexpr TypeId BOOL = static_cast<TypeId>(TypeKind::BOOL);
+        static constexpr TypeId VOID = static_cast<TypeId>(TypeKind::VOID);
+
+        /* Type::flags, inherited from the operands so substitution can skip closed types */
+        static constexpr uint8_t HAS_VAR = 1 << 0;
+        static constexpr uint8_t HAS_GENERIC = 1 << 1;
+
+        std::pmr::vector<Type> types;
+        std::pmr::vector<TypeId> operands;
+
+        explicit TypeTable(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+        /* the one TypeId of (kind, name, operands), adding it if new */
+        TypeId intern(TypeKind kind, uint32_t name = 0, std::span<const TypeId> args = {});
+
+        /* ARRAY, OWN, SHARE, REF or PIN of inner */
+        TypeId wrap(const TypeKind kind, const TypeId inner)
+        {
+            return intern(kind, 0, std::span(&inner, 1));
+        }
+
+        [[nodiscard]] static TypeId builtin(const TypeKind kind)
+        {
+            return static_cast<TypeId>(kind);
+        }
+
+        [[nodiscard]] const Type &operator[](const TypeId id) const
+        {
+            return types[id];
+        }
+
+        [[nodiscard]] std::span<const TypeId> args(const TypeId id) const
+        {
+            return { operands.data() + types[id].operands, types[id].count };
+        }
+
+        [[nodiscard]] size_t size() const
+        {
+            return types.size();
+        }
+
+        /* e.g. `Own<i32[]>` or `function(T, string) -> T`; names need the interner the atoms came from */
+        [[nodiscard]] std::string to_string(TypeId id, const Interner *names = nullptr) const;
+
+        [[nodiscard]] static bool is_integer(TypeKind kind)
+        {
+            return kind >= TypeKind::U8 && kind <= TypeKind::I64;
+        }
+
+        [[nodiscard]] static bool is_float(TypeKind kind)
+        {
+            return kind == TypeKind::F32 || kind == TypeKind::F64;
+        }
+
+        [[nodiscard]] static bool is_pointer(TypeKind kind)
+        {
+            return kind >= TypeKind::OWN && kind <= TypeKind::PIN;
+        }
+
+        /* heap bytes held by the table, capacity included */
+        [[nodiscard]] size_t memory_bytes() const;
+
+    private:
+        std::pmr::vector<TypeId> slots; /* open addressing over types; 0 (ERROR, never looked up) = empty */
+
+        void grow();
+
+        [[nodiscard]] static uint64_t hash(TypeKind kind, uint32_t name, std::span<const TypeId> args);
+    };
+}
@@ -2,42 +2,152 @@
 
 namespace klr::compiler
 {
-    uint32_t AST::add_node(const ASTNodeType type, const Token token)
+    AST::AST(std::pmr::memory_resource *resource) : types(resource), tokens(resource), parents(resource)
+                                                  , data(resource), first_child(resource), last_child(resource)
+                                                  , next_sibling(resource), atoms(resource) {}
+
+    uint32_t AST::add_node(const ASTNodeType type, const Token token, const uint32_t atom)
     {
-        const uint32_t index = nodes.size();
-        nodes.emplace_back(ASTNode {
-            .children = {},
-            .token = token,
-            .parent = 0,
-            .type = type,
-            .data = {}
-        });
+        const uint32_t index = types.size();
+        types.push_back(type);
+        tokens.push_back(token);
+        parents.push_back(0);
+        data.push_back({});
+        first_child.push_back(0);
+        last_child.push_back(0);
+        next_sibling.push_back(0);
+        atoms.push_back(atom);
         return index;
     }
 
-    void AST::add_child(uint32_t parent_idx, uint32_t child_idx)
+    void AST::add_child(const uint32_t parent_idx, const uint32_t child_idx)
     {
-        if (parent_idx >= nodes.size() || child_idx >= nodes.size())
+        if (parent_idx >= size() || child_idx >= size() || child_idx == 0)
             return;
 
-        nodes[parent_idx].children.push_back(child_idx);
-        nodes[child_idx].parent = parent_idx;
+        if (first_child[parent_idx])
+            next_sibling[last_child[parent_idx]] = child_idx;
+        else
+            first_child[parent_idx] = child_idx;
+        last_child[parent_idx] = child_idx;
+        parents[child_idx] = parent_idx;
     }
 
-    void AST::dump(std::ostream &os, const uint32_t node_idx, const size_t indent) const
+    AST::ChildRange AST::children(const uint32_t node_idx) const
     {
-        std::vector visited(nodes.size(), false);
-        dump_node(os, node_idx, indent, visited);
+        return { ChildIterator(&next_sibling, first_child[node_idx]) };
     }
 
-    void AST::dump_node(std::ostream &os, const uint32_t node_idx, const size_t indent, // NOLINT(*-no-recursion)
-                        std::vector<bool> &visited) const
+    size_t AST::child_count(const uint32_t node_idx) const
     {
-        if (node_idx >= nodes.size() || visited[node_idx])
-            return;
+        size_t count = 0;
+        for (uint32_t child = first_child[node_idx]; child; child = next_sibling[child])
+            ++count;
+        return count;
+    }
+
+    ASTNode AST::operator[](const uint32_t node_idx) const
+    {
+        return {
+            .token = tokens[node_idx],
+            .parent = parents[node_idx],
+            .atom = atoms[node_idx],
+            .type = types[node_idx],
+            .data = data[node_idx]
+        };
+    }
+
+    size_t AST::memory_bytes() const
+    {
+        return types.capacity() * sizeof(ASTNodeType) +
+               tokens.capacity() * sizeof(Token) +
+               data.capacity() * sizeof(ASTNodeData) +
+               (parents.capacity() + first_child.capacity() + last_child.capacity() + next_sibling.capacity() +
+                atoms.capacity()) *
+               sizeof(uint32_t);
+    }
+
+    void AST::reserve(const size_t n)
+    {
+        types.reserve(n);
+        tokens.reserve(n);
+        parents.reserve(n);
+        data.reserve(n);
+        first_child.reserve(n);
+        last_child.reserve(n);
+        next_sibling.reserve(n);
+        atoms.reserve(n);
+    }
+
+    // depth first on an explicit stack, so arbitrarily deep trees print without
+    // recursing; successors are pushed in reverse so they pop in source order.
+    // payload links (operands, types, bodies) come before the linked children,
+    // and a node reachable both ways is printed once, at its first visit
+    void AST::dump(std::ostream &os, const uint32_t node_idx, const size_t indent) const
+    {
+        std::vector visited(size(), false);
+        std::vector<std::pair<uint32_t, size_t> > stack { { node_idx, indent } };
+        std::vector<uint32_t> next;
 
-        visited[node_idx] = true;
-        const auto &node = nodes[node_idx];
+        while (!stack.empty())
+        {
+            const auto [idx, depth] = stack.back();
+            stack.pop_back();
+            if (idx >= size() || visited[idx])
+                continue;
+
+            visited[idx] = true;
+            dump_node(os, idx, depth);
+
+            next.clear();
+            const ASTNodeData &payload = data[idx];
+            switch (types[idx])
+            {
+                case ASTNodeType::BINARY_EXPR:
+                {
+                    next.push_back(payload.binary_expr.left);
+                    next.push_back(payload.binary_expr.right);
+                    break;
+                }
+                case ASTNodeType::UNARY_EXPR:
+                {
+                    next.push_back(payload.unary_expr.operand);
+                    break;
+                }
+                case ASTNodeType::DECL:
+                {
+                    if (payload.decl.type_node)
+                        next.push_back(payload.decl.type_node);
+                    if (payload.decl.init_node)
+                        next.push_back(payload.decl.init_node);
+                    break;
+                }
+                case ASTNodeType::FUNCTION:
+                {
+                    next.push_back(payload.function.ret_type);
+                    next.push_back(payload.function.body);
+                    break;
+                }
+                case ASTNodeType::CAST_EXPR:
+                {
+                    next.push_back(payload.cast_expr.type_node);
+                    next.push_back(payload.cast_expr.operand);
+                    break;
+                }
+                default:
+                    break;
+            }
+
+            for (const uint32_t child: children(idx))
+                next.push_back(child);
+            for (auto it = next.rbegin(); it != next.rend(); ++it)
+                stack.emplace_back(*it, depth + 1);
+        }
+    }
+
+    void AST::dump_node(std::ostream &os, const uint32_t node_idx, const size_t indent) const
+    {
+        const ASTNode node = (*this)[node_idx];
         std::string indent_str;
 
         if (indent > 0)
@@ -116,6 +226,25 @@ namespace klr::compiler
                         << "└─ type_node: " << node.data.cast_expr.type_node << ColorCode::RESET << "\n";
                 break;
             }
+            case ASTNodeType::FOR:
+            {
+                os << data_indent << ColorCode::CYAN
+                        << "└─ init: " << node.data.for_stmt.init << ColorCode::RESET << "\n";
+                os << data_indent << ColorCode::CYAN
+                        << "└─ condition: " << node.data.for_stmt.condition << ColorCode::RESET << "\n";
+                os << data_indent << ColorCode::CYAN
+                        << "└─ step: " << node.data.for_stmt.step << ColorCode::RESET << "\n";
+                break;
+            }
+            case ASTNodeType::LITERAL:
+            {
+                if (node.data.literal.constant)
+                {
+                    os << data_indent << ColorCode::CYAN
+                            << "└─ constant: " << node.data.literal.constant << ColorCode::RESET << "\n";
+                }
+                break;
+            }
             default:
                 break;
         }
@@ -123,58 +252,18 @@ namespace klr::compiler
         os << data_indent << ColorCode::RED
                 << "└─ parent: " << node.parent << ColorCode::RESET << "\n";
 
-        if (!node.children.empty())
+        if (first_child[node_idx])
         {
             os << data_indent << ColorCode::MAGENTA
                     << "└─ children: [";
-            for (size_t i = 0; i < node.children.size(); ++i)
+            for (const uint32_t child: children(node_idx))
             {
-                os << node.children[i];
-                if (i < node.children.size() - 1)
+                if (child != first_child[node_idx])
                     os << ", ";
+                os << child;
             }
             os << "]" << ColorCode::RESET << "\n";
         }
-
-        switch (node.type)
-        {
-            case ASTNodeType::BINARY_EXPR:
-            {
-                dump_node(os, node.data.binary_expr.left, indent + 1, visited);
-                dump_node(os, node.data.binary_expr.right, indent + 1, visited);
-                break;
-            }
-            case ASTNodeType::UNARY_EXPR:
-            {
-                dump_node(os, node.data.unary_expr.operand, indent + 1, visited);
-                break;
-            }
-            case ASTNodeType::DECL:
-            {
-                if (node.data.decl.type_node)
-                    dump_node(os, node.data.decl.type_node, indent + 1, visited);
-                if (node.data.decl.init_node)
-                    dump_node(os, node.data.decl.init_node, indent + 1, visited);
-                break;
-            }
-            case ASTNodeType::FUNCTION:
-            {
-                dump_node(os, node.data.function.ret_type, indent + 1, visited);
-                dump_node(os, node.data.function.body, indent + 1, visited);
-                break;
-            }
-            case ASTNodeType::CAST_EXPR:
-            {
-                dump_node(os, node.data.cast_expr.type_node, indent + 1, visited);
-                dump_node(os, node.data.cast_expr.operand, indent + 1, visited);
-                break;
-            }
-            default:
-                break;
-        }
-
-        for (const auto &child: node.children)
-            dump_node(os, child, indent + 1, visited);
     }
 
     void AST::dump_token_flags(std::ostream &os, const TokenFlags flags)
@@ -250,6 +339,8 @@ namespace klr::compiler
                 return "CONTINUE";
             case ASTNodeType::CAST_EXPR:
                 return "CAST_EXPR";
+            case ASTNodeType::ERROR:
+                return "ERROR";
             default:
                 return "UNKNOWN";
         }
@@ -0,0 +1,758 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/analysis/include/checker.h>
+#include <algorithm>
+
+namespace klr::compiler
+{
+    namespace
+    {
+        /* the builtin named by a U8 ... VOID token */
+        TypeKind builtin_kind(const TokenType type)
+        {
+            return static_cast<TypeKind>(static_cast<uint8_t>(type) - static_cast<uint8_t>(TokenType::U8) + 1);
+        }
+
+        bool is_assignment(const TokenType op)
+        {
+            return op == TokenType::EQUAL || (op >= TokenType::PLUS_EQ && op <= TokenType::XOR_EQ) ||
+                   op == TokenType::LEFT_SHIFT_EQ || op == TokenType::RIGHT_SHIFT_EQ;
+        }
+    }
+
+    TypeChecker::TypeChecker(TypeTable &types, const AST &ast, const SymbolTable &symbols, const TokenList &tokens,
+                             std::pmr::memory_resource *resource) : types(types), ast(ast), symbols(symbols)
+                                                                  , tokens(tokens), node_types(resource)
+                                                                  , diagnostics(resource), parents(resource)
+                                                                  , sizes(resource), bound(resource)
+                                                                  , classes(resource), var_types(resource)
+                                                                  , pending(resource), visiting(resource)
+                                                                  , substitution(resource), scratch(resource) {}
+
+    void TypeChecker::check()
+    {
+        node_types.assign(ast.size(), UNSET);
+        diagnostics.clear();
+        parents.clear();
+        sizes.clear();
+        bound.clear();
+        classes.clear();
+        var_types.clear();
+
+        for (uint32_t node = 0; node < ast.size(); ++node)
+            check_node(node);
+
+        /* literals nothing else pinned down take their default */
+        for (uint32_t var = 0; var < parents.size(); ++var)
+        {
+            if (find(var) != var || bound[var] != UNSET)
+                continue;
+
+            if (classes[var] == VarClass::NUMERIC || classes[var] == VarClass::INTEGER)
+                bound[var] = TypeTable::I32;
+            else if (classes[var] == VarClass::FLOAT)
+                bound[var] = TypeTable::F64;
+        }
+
+        for (uint32_t node = 0; node < ast.size(); ++node)
+        {
+            if (ast.types[node] == ASTNodeType::DECL &&
+                (ast.data[node].decl.flags & ASTNodeFlags::TYPE_INFER) == ASTNodeFlags::TYPE_INFER &&
+                types[zonk(node_type(node))].flags & TypeTable::HAS_VAR)
+                error(DiagCode::CANNOT_INFER, node);
+        }
+
+        /* what is still open was reported above, or belongs to an expression whose error was */
+        for (uint32_t node = 0; node < ast.size(); ++node)
+        {
+            const TypeId type = zonk(node_type(node));
+            node_types[node] = types[type].flags & TypeTable::HAS_VAR ? TypeTable::ERROR : type;
+        }
+    }
+
+    void TypeChecker::check_node(const uint32_t node)
+    {
+        switch (ast.types[node])
+        {
+            case ASTNodeType::DECL:
+            {
+                if (const uint32_t init = ast.data[node].decl.init_node)
+                    expect(node_type(node), node_type(init), init);
+                break;
+            }
+
+            case ASTNodeType::BINARY_EXPR:
+            {
+                check_binary(node);
+                break;
+            }
+
+            case ASTNodeType::UNARY_EXPR:
+            {
+                check_unary(node);
+                break;
+            }
+
+            case ASTNodeType::CALL:
+            {
+                check_call(node);
+                break;
+            }
+
+            case ASTNodeType::TERNARY:
+            {
+                const uint32_t condition = ast.first_child[node];
+                const uint32_t then_branch = ast.next_sibling[condition];
+                const uint32_t else_branch = ast.next_sibling[then_branch];
+                expect(TypeTable::BOOL, node_type(condition), condition);
+                expect(node_type(then_branch), node_type(else_branch), else_branch);
+                expect(node_type(node), node_type(then_branch), node);
+                break;
+            }
+
+            case ASTNodeType::ARRAY_INIT:
+            {
+                const TypeId element = fresh(VarClass::ANY);
+                for (const uint32_t child: ast.children(node))
+                    expect(element, node_type(child), child);
+                expect(node_type(node), types.wrap(TypeKind::ARRAY, element), node);
+                break;
+            }
+
+            case ASTNodeType::RETURN:
+            {
+                uint32_t function = ast.parents[node];
+                while (function && ast.types[function] != ASTNodeType::FUNCTION)
+                    function = ast.parents[function];
+                if (!function)
+                    break;
+
+                const TypeId returns = types.args(node_type(function))[0];
+                if (const uint32_t value = ast.first_child[node])
+                    expect(returns, node_type(value), value);
+                else
+                    expect(returns, TypeTable::VOID, node);
+                break;
+            }
+
+            case ASTNodeType::IF:
+            case ASTNodeType::WHILE:
+            {
+                const uint32_t condition = ast.first_child[node];
+                expect(TypeTable::BOOL, node_type(condition), condition);
+                break;
+            }
+
+            case ASTNodeType::FOR:
+            {
+                if (const uint32_t condition = ast.data[node].for_stmt.condition)
+                    expect(TypeTable::BOOL, node_type(condition), condition);
+                break;
+            }
+
+            default:
+            {
+                /* types, literals, names and functions are typed by what they are */
+                node_type(node);
+                break;
+            }
+        }
+    }
+
+    void TypeChecker::check_binary(const uint32_t node)
+    {
+        const auto [left, right, op] = ast.data[node].binary_expr;
+        const TypeId lhs = node_type(left);
+        const TypeId rhs = node_type(right);
+
+        if (is_assignment(op))
+        {
+            if (const uint32_t decl = symbols.declaration(left);
+                ast.types[left] == ASTNodeType::IDENTIFIER && ast.types[decl] == ASTNodeType::DECL &&
+                (ast.data[decl].decl.flags & ASTNodeFlags::IS_CONST) == ASTNodeFlags::IS_CONST)
+                error(DiagCode::ASSIGN_TO_CONST, left);
+        }
+
+        switch (op)
+        {
+            case TokenType::EQUAL:
+            {
+                expect(lhs, rhs, right);
+                expect(node_type(node), lhs, node);
+                return;
+            }
+
+            case TokenType::LOGICAL_AND:
+            case TokenType::LOGICAL_OR:
+            {
+                expect(TypeTable::BOOL, lhs, left);
+                expect(TypeTable::BOOL, rhs, right);
+                expect(node_type(node), TypeTable::BOOL, node);
+                return;
+            }
+
+            case TokenType::EQ:
+            case TokenType::NE:
+            {
+                expect(lhs, rhs, right);
+                expect(node_type(node), TypeTable::BOOL, node);
+                return;
+            }
+
+            case TokenType::LESS:
+            case TokenType::GREATER:
+            case TokenType::LE:
+            case TokenType::GE:
+            {
+                if (operands(node, lhs, rhs, VarClass::NUMERIC))
+                    expect(lhs, rhs, right);
+                expect(node_type(node), TypeTable::BOOL, node);
+                return;
+            }
+
+            default:
+                break;
+        }
+
+        /* arithmetic and bit operations, plain or compound: both sides and the result share one type */
+        const bool bitwise = op == TokenType::AND || op == TokenType::OR || op == TokenType::XOR ||
+                             op == TokenType::LEFT_SHIFT || op == TokenType::RIGHT_SHIFT ||
+                             op == TokenType::AND_EQ || op == TokenType::OR_EQ || op == TokenType::XOR_EQ ||
+                             op == TokenType::LEFT_SHIFT_EQ || op == TokenType::RIGHT_SHIFT_EQ;
+        const bool concat = (op == TokenType::PLUS || op == TokenType::PLUS_EQ) &&
+                            (resolve(lhs) == TypeTable::STRING || resolve(rhs) == TypeTable::STRING);
+
+        if (concat || operands(node, lhs, rhs, bitwise ? VarClass::INTEGER : VarClass::NUMERIC))
+        {
+            expect(lhs, rhs, right);
+            expect(node_type(node), lhs, node);
+        }
+        else
+        {
+            unify(node_type(node), TypeTable::ERROR);
+        }
+    }
+
+    bool TypeChecker::operands(const uint32_t node, const TypeId lhs, const TypeId rhs, const VarClass cls)
+    {
+        /* checked one side at a time so `true + 1` is one error about the operator, not a mismatch too */
+        for (const TypeId side: { lhs, rhs })
+        {
+            if (!constrain(side, cls))
+            {
+                error(DiagCode::INVALID_OPERAND, node, TypeTable::ERROR, zonk(side));
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void TypeChecker::check_unary(const uint32_t node)
+    {
+        const auto [operand, op] = ast.data[node].unary_expr;
+        switch (op)
+        {
+            case TokenType::MINUS:
+            case TokenType::BANG:
+            case TokenType::TILDE:
+            {
+                const TypeId type = node_type(operand);
+                const bool valid = op == TokenType::BANG
+                                       ? unify(type, TypeTable::BOOL)
+                                       : constrain(type, op == TokenType::MINUS ? VarClass::NUMERIC : VarClass::INTEGER);
+                if (!valid)
+                    error(DiagCode::INVALID_OPERAND, node, TypeTable::ERROR, zonk(type));
+                expect(node_type(node), type, node);
+                break;
+            }
+
+            case TokenType::AND:
+            {
+                expect(node_type(node), types.wrap(TypeKind::REF, node_type(operand)), node);
+                break;
+            }
+
+            case TokenType::STAR:
+            {
+                /* a pointer of a kind not known yet leaves the result open */
+                const TypeId pointer = resolve(node_type(operand));
+                if (TypeTable::is_pointer(types[pointer].kind))
+                    expect(node_type(node), types.args(pointer)[0], node);
+                else if (!constrain(pointer, VarClass::POINTER))
+                    error(DiagCode::INVALID_OPERAND, node, TypeTable::ERROR, zonk(pointer));
+                break;
+            }
+
+            case TokenType::NEW:
+            {
+                /* `new T` or `new T(init)`: the type comes first among the children */
+                const uint32_t type_node = ast.first_child[node];
+                const TypeId type = node_type(type_node);
+                if (const uint32_t init = ast.next_sibling[type_node])
+                    expect(type, node_type(init), init);
+                expect(node_type(node), types.wrap(TypeKind::OWN, type), node);
+                break;
+            }
+
+            case TokenType::DELETE:
+            {
+                if (!constrain(node_type(operand), VarClass::POINTER))
+                    error(DiagCode::INVALID_OPERAND, node, TypeTable::ERROR, zonk(node_type(operand)));
+                expect(node_type(node), TypeTable::VOID, node);
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    void TypeChecker::check_call(const uint32_t node)
+    {
+        const uint32_t callee = ast.first_child[node];
+        TypeId function = resolve(node_type(callee));
+        if (function == TypeTable::ERROR)
+        {
+            unify(node_type(node), TypeTable::ERROR);
+            return;
+        }
+
+        const uint32_t first = ast.next_sibling[callee];
+        size_t count = 0;
+        for (uint32_t arg = first; arg; arg = ast.next_sibling[arg])
+            ++count;
+
+        /* a callee only known as a variable becomes a function of the arguments' types */
+        const size_t base = scratch.size();
+        if (types[function].kind == TypeKind::VAR)
+        {
+            scratch.push_back(fresh(VarClass::ANY));
+            for (uint32_t arg = first; arg; arg = ast.next_sibling[arg])
+                scratch.push_back(node_type(arg));
+            const TypeId shape = types.intern(TypeKind::FUNCTION, 0, std::span(scratch).subspan(base));
+            scratch.resize(base);
+            unify(function, shape);
+            function = resolve(function);
+        }
+
+        if (types[function].kind != TypeKind::FUNCTION)
+        {
+            error(DiagCode::NOT_CALLABLE, callee, TypeTable::ERROR, zonk(function));
+            unify(node_type(node), TypeTable::ERROR);
+            return;
+        }
+
+        if (types[function].flags & TypeTable::HAS_GENERIC)
+            function = instantiate(function);
+
+        const auto signature = types.args(function);
+        if (signature.size() - 1 != count)
+            error(DiagCode::ARGUMENT_COUNT, callee, signature.size() - 1, count);
+
+        /* copied: unifying may intern new types and move the operand pool */
+        const TypeId returns = signature[0];
+        scratch.insert(scratch.end(), signature.begin() + 1, signature.end());
+        size_t param = base;
+        for (uint32_t arg = first; arg && param < scratch.size(); arg = ast.next_sibling[arg])
+            expect(scratch[param++], node_type(arg), arg);
+        scratch.resize(base);
+        expect(node_type(node), returns, node);
+    }
+
+    TypeId TypeChecker::node_type(const uint32_t node)
+    {
+        if (node_types[node] != UNSET)
+            return node_types[node];
+
+        TypeId type;
+        switch (ast.types[node])
+        {
+            case ASTNodeType::TYPE:
+            case ASTNodeType::ARRAY_TYPE:
+            {
+                type = lower(node);
+                break;
+            }
+
+            case ASTNodeType::FUNCTION:
+            {
+                type = signature(node);
+                break;
+            }
+
+            case ASTNodeType::DECL:
+            {
+                const auto &decl = ast.data[node].decl;
+                type = (decl.flags & ASTNodeFlags::TYPE_INFER) == ASTNodeFlags::TYPE_INFER || !decl.type_node
+                           ? fresh(VarClass::ANY)
+                           : node_type(decl.type_node);
+                break;
+            }
+
+            case ASTNodeType::LITERAL:
+            {
+                switch (ast.tokens[node].type)
+                {
+                    case TokenType::STR_LITERAL:
+                        type = TypeTable::STRING;
+                        break;
+                    case TokenType::TRUE:
+                    case TokenType::FALSE:
+                        type = TypeTable::BOOL;
+                        break;
+                    case TokenType::NIL:
+                        type = fresh(VarClass::POINTER);
+                        break;
+                    default:
+                    {
+                        const auto it = std::ranges::lower_bound(tokens.starts, ast.tokens[node].start);
+                        const NumLiteral *value = tokens.literal(it - tokens.starts.begin());
+                        type = fresh(value && value->is_float ? VarClass::FLOAT : VarClass::NUMERIC);
+                        break;
+                    }
+                }
+                break;
+            }
+
+            case ASTNodeType::IDENTIFIER:
+            {
+                /* a generic parameter named as a value has no type either */
+                const uint32_t decl = symbols.declaration(node);
+                type = decl && ast.types[decl] != ASTNodeType::TYPE ? node_type(decl) : TypeTable::ERROR;
+                break;
+            }
+
+            case ASTNodeType::CAST_EXPR:
+            {
+                type = node_type(ast.data[node].cast_expr.type_node);
+                break;
+            }
+
+            case ASTNodeType::ROOT:
+            case ASTNodeType::BLOCK:
+            case ASTNodeType::RETURN:
+            case ASTNodeType::IF:
+            case ASTNodeType::WHILE:
+            case ASTNodeType::FOR:
+            case ASTNodeType::BREAK:
+            case ASTNodeType::CONTINUE:
+            {
+                type = TypeTable::VOID;
+                break;
+            }
+
+            case ASTNodeType::ERROR:
+            case ASTNodeType::METHOD_CALL:
+            {
+                type = TypeTable::ERROR;
+                break;
+            }
+
+            default:
+            {
+                type = fresh(VarClass::ANY);
+                break;
+            }
+        }
+
+        node_types[node] = type;
+        return type;
+    }
+
+    TypeId TypeChecker::lower(const uint32_t node) // NOLINT(*-no-recursion)
+    {
+        const uint32_t first = ast.first_child[node];
+        if (ast.types[node] == ASTNodeType::ARRAY_TYPE)
+            return types.wrap(TypeKind::ARRAY, first ? node_type(first) : TypeTable::ERROR);
+        if (ast.types[node] != ASTNodeType::TYPE)
+            return TypeTable::ERROR;
+
+        switch (const TokenType token = ast.tokens[node].type)
+        {
+            case TokenType::OWN:
+            case TokenType::SHARE:
+            case TokenType::REF:
+            case TokenType::PIN:
+            {
+                const auto kind = static_cast<TypeKind>(static_cast<uint8_t>(TypeKind::OWN) +
+                                                        static_cast<uint8_t>(token) -
+                                                        static_cast<uint8_t>(TokenType::OWN));
+                return types.wrap(kind, first ? node_type(first) : TypeTable::ERROR);
+            }
+
+            case TokenType::IDENTIFIER:
+            {
+                /* a generic parameter is its declaring TYPE node, which is also the node itself */
+                if (const uint32_t decl = symbols.declaration(node); decl && ast.types[decl] == ASTNodeType::TYPE)
+                    return types.intern(TypeKind::GENERIC, ast.atoms[decl], std::span(&decl, 1));
+
+                const size_t base = scratch.size();
+                for (const uint32_t child: ast.children(node))
+                    scratch.push_back(node_type(child));
+                const TypeId named = types.intern(TypeKind::NAMED, ast.atoms[node], std::span(scratch).subspan(base));
+                scratch.resize(base);
+                return named;
+            }
+
+            default:
+            {
+                if (token >= TokenType::U8 && token <= TokenType::VOID)
+                    return TypeTable::builtin(builtin_kind(token));
+                return TypeTable::ERROR;
+            }
+        }
+    }
+
+    TypeId TypeChecker::signature(const uint32_t function)
+    {
+        const uint32_t ret_type = ast.data[function].function.ret_type;
+        const size_t base = scratch.size();
+        scratch.push_back(ret_type ? node_type(ret_type) : TypeTable::VOID);
+        for (const uint32_t child: ast.children(function))
+        {
+            if (ast.types[child] == ASTNodeType::DECL)
+                scratch.push_back(node_type(child));
+        }
+        const TypeId shape = types.intern(TypeKind::FUNCTION, 0, std::span(scratch).subspan(base));
+        scratch.resize(base);
+        return shape;
+    }
+
+    TypeId TypeChecker::fresh(const VarClass cls)
+    {
+        const auto var = static_cast<uint32_t>(parents.size());
+        parents.push_back(var);
+        sizes.push_back(1);
+        bound.push_back(UNSET);
+        classes.push_back(cls);
+        var_types.push_back(types.intern(TypeKind::VAR, var));
+        return var_types.back();
+    }
+
+    uint32_t TypeChecker::find(uint32_t var)
+    {
+        /* path halving */
+        while (parents[var] != var)
+        {
+            parents[var] = parents[parents[var]];
+            var = parents[var];
+        }
+        return var;
+    }
+
+    TypeId TypeChecker::resolve(TypeId type)
+    {
+        while (types[type].kind == TypeKind::VAR)
+        {
+            const uint32_t root = find(types[type].name);
+            if (bound[root] == UNSET)
+                return var_types[root];
+            type = bound[root];
+        }
+        return type;
+    }
+
+    bool TypeChecker::unify(const TypeId a, const TypeId b)
+    {
+        bool unified = true;
+        pending.clear();
+        pending.emplace_back(a, b);
+        while (!pending.empty())
+        {
+            const TypeId x = resolve(pending.back().first);
+            const TypeId y = resolve(pending.back().second);
+            pending.pop_back();
+            if (x == y)
+                continue;
+
+            /* an error absorbs a variable it meets, so nothing downstream reports it again */
+            if (x == TypeTable::ERROR || y == TypeTable::ERROR)
+            {
+                if (const TypeId other = x == TypeTable::ERROR ? y : x; types[other].kind == TypeKind::VAR)
+                    bound[find(types[other].name)] = TypeTable::ERROR;
+                continue;
+            }
+
+            const Type tx = types[x];
+            const Type ty = types[y];
+            if (tx.kind == TypeKind::VAR && ty.kind == TypeKind::VAR)
+            {
+                /* union by size; the root keeps what both sides allow */
+                uint32_t rx = find(tx.name);
+                uint32_t ry = find(ty.name);
+                VarClass cls;
+                if (!meet(classes[rx], classes[ry], cls))
+                {
+                    unified = false;
+                    continue;
+                }
+
+                if (sizes[rx] < sizes[ry])
+                    std::swap(rx, ry);
+                parents[ry] = rx;
+                sizes[rx] += sizes[ry];
+                classes[rx] = cls;
+            }
+            else if (tx.kind == TypeKind::VAR || ty.kind == TypeKind::VAR)
+            {
+                if (tx.kind == TypeKind::VAR ? !bind(find(tx.name), y) : !bind(find(ty.name), x))
+                    unified = false;
+            }
+            else if (tx.kind == ty.kind && tx.kind != TypeKind::GENERIC && tx.name == ty.name && tx.count == ty.count)
+            {
+                for (uint16_t i = 0; i < tx.count; ++i)
+                    pending.emplace_back(types.operands[tx.operands + i], types.operands[ty.operands + i]);
+            }
+            else
+            {
+                unified = false;
+            }
+        }
+        return unified;
+    }
+
+    void TypeChecker::expect(const TypeId expected, const TypeId found, const uint32_t node, const DiagCode code)
+    {
+        if (!unify(expected, found))
+            error(code, node, zonk(expected), zonk(found));
+    }
+
+    bool TypeChecker::constrain(const TypeId type, const VarClass cls)
+    {
+        const TypeId resolved = resolve(type);
+        const TypeKind kind = types[resolved].kind;
+        if (kind == TypeKind::VAR)
+        {
+            const uint32_t root = find(types[resolved].name);
+            return meet(classes[root], cls, classes[root]);
+        }
+
+        switch (cls)
+        {
+            case VarClass::NUMERIC:
+                return kind == TypeKind::ERROR || TypeTable::is_integer(kind) || TypeTable::is_float(kind);
+            case VarClass::INTEGER:
+                return kind == TypeKind::ERROR || TypeTable::is_integer(kind);
+            case VarClass::FLOAT:
+                return kind == TypeKind::ERROR || TypeTable::is_float(kind);
+            case VarClass::POINTER:
+                return kind == TypeKind::ERROR || TypeTable::is_pointer(kind);
+            default:
+                return true;
+        }
+    }
+
+    bool TypeChecker::meet(const VarClass a, const VarClass b, VarClass &out)
+    {
+        /* ANY allows everything, NUMERIC narrows to INTEGER or FLOAT; POINTER only meets itself */
+        if (a == b || b == VarClass::ANY)
+            out = a;
+        else if (a == VarClass::ANY)
+            out = b;
+        else if (a == VarClass::NUMERIC && (b == VarClass::INTEGER || b == VarClass::FLOAT))
+            out = b;
+        else if (b == VarClass::NUMERIC && (a == VarClass::INTEGER || a == VarClass::FLOAT))
+            out = a;
+        else
+            return false;
+        return true;
+    }
+
+    bool TypeChecker::bind(const uint32_t var, const TypeId type)
+    {
+        if (!constrain(type, classes[var]) || occurs(var, type))
+            return false;
+
+        bound[var] = type;
+        return true;
+    }
+
+    bool TypeChecker::occurs(const uint32_t var, const TypeId type)
+    {
+        if (!(types[type].flags & TypeTable::HAS_VAR))
+            return false;
+
+        visiting.assign(1, type);
+        while (!visiting.empty())
+        {
+            const TypeId current = resolve(visiting.back());
+            visiting.pop_back();
+
+            const Type &t = types[current];
+            if (t.kind == TypeKind::VAR && find(t.name) == var)
+                return true;
+            if (t.kind != TypeKind::GENERIC && t.flags & TypeTable::HAS_VAR)
+            {
+                for (const TypeId arg: types.args(current))
+                    visiting.push_back(arg);
+            }
+        }
+        return false;
+    }
+
+    TypeId TypeChecker::zonk(const TypeId type) // NOLINT(*-no-recursion)
+    {
+        if (!(types[type].flags & TypeTable::HAS_VAR))
+            return type;
+
+        const TypeId resolved = resolve(type);
+        if (types[resolved].kind == TypeKind::VAR)
+            return resolved;
+        if (!(types[resolved].flags & TypeTable::HAS_VAR))
+            return resolved;
+
+        const size_t base = scratch.size();
+        scratch.insert(scratch.end(), types.args(resolved).begin(), types.args(resolved).end());
+        for (size_t i = base; i < scratch.size(); ++i)
+            scratch[i] = zonk(scratch[i]);
+        const TypeId zonked = types.intern(types[resolved].kind, types[resolved].name,
+                                           std::span(scratch).subspan(base));
+        scratch.resize(base);
+        return zonked;
+    }
+
+    TypeId TypeChecker::instantiate(const TypeId type)
+    {
+        substitution.clear();
+        return substitute(type);
+    }
+
+    TypeId TypeChecker::substitute(const TypeId type) // NOLINT(*-no-recursion)
+    {
+        const Type t = types[type];
+        if (!(t.flags & TypeTable::HAS_GENERIC))
+            return type;
+
+        if (t.kind == TypeKind::GENERIC)
+        {
+            /* keyed by the declaring node, the one operand of a GENERIC */
+            const uint32_t decl = types.args(type)[0];
+            const auto it = std::ranges::find(substitution, decl, &std::pair<uint32_t, TypeId>::first);
+            if (it != substitution.end())
+                return it->second;
+
+            substitution.emplace_back(decl, fresh(VarClass::ANY));
+            return substitution.back().second;
+        }
+
+        const size_t base = scratch.size();
+        scratch.insert(scratch.end(), types.args(type).begin(), types.args(type).end());
+        for (size_t i = base; i < scratch.size(); ++i)
+            scratch[i] = substitute(scratch[i]);
+        const TypeId substituted = types.intern(t.kind, t.name, std::span(scratch).subspan(base));
+        scratch.resize(base);
+        return substituted;
+    }
+
+    void TypeChecker::error(const DiagCode code, const uint32_t node, const TypeId expected, const TypeId found)
+    {
+        const auto it = std::ranges::lower_bound(tokens.starts, ast.tokens[node].start);
+        diagnostics.push_back({
+            .token = static_cast<offset_t>(it - tokens.starts.begin()),
+            .args = { expected, found },
+            .code = code,
+            .level = ErrorLevel::ERROR
+        });
+    }
+}
@@ -0,0 +1,368 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/analysis/include/constants.h>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+namespace klr::compiler
+{
+    namespace
+    {
+        uint32_t width(const TypeKind kind)
+        {
+            switch (kind)
+            {
+                case TypeKind::U8:
+                case TypeKind::I8:
+                    return 8;
+                case TypeKind::U16:
+                case TypeKind::I16:
+                    return 16;
+                case TypeKind::U32:
+                case TypeKind::I32:
+                    return 32;
+                default:
+                    return 64;
+            }
+        }
+
+        bool is_signed(const TypeKind kind)
+        {
+            return kind == TypeKind::I8 || kind == TypeKind::I16 || kind == TypeKind::I32 || kind == TypeKind::I64;
+        }
+
+        double to_double(const uint64_t bits)
+        {
+            return std::bit_cast<double>(bits);
+        }
+
+        /* f32 results are rounded to float before they are widened back */
+        uint64_t from_double(const TypeKind kind, const double value)
+        {
+            return std::bit_cast<uint64_t>(kind == TypeKind::F32 ? static_cast<double>(static_cast<float>(value))
+                                                                 : value);
+        }
+
+        /* truncates toward zero, clamping to the range of kind */
+        uint64_t saturate(const TypeKind kind, const double value)
+        {
+            if (std::isnan(value))
+                return 0;
+
+            const uint32_t bits = width(kind);
+            if (is_signed(kind))
+            {
+                /* -2^(bits-1) is exact as a double, its positive counterpart is one past the range */
+                const int64_t min = std::numeric_limits<int64_t>::min() >> (64 - bits);
+                if (value >= -static_cast<double>(min))
+                    return static_cast<uint64_t>(std::numeric_limits<int64_t>::max() >> (64 - bits));
+                if (value <= static_cast<double>(min))
+                    return static_cast<uint64_t>(min);
+                return static_cast<uint64_t>(static_cast<int64_t>(value));
+            }
+
+            if (value >= std::ldexp(1.0, static_cast<int>(bits)))
+                return ~0ULL >> (64 - bits);
+            if (value <= 0)
+                return 0;
+            return static_cast<uint64_t>(value);
+        }
+    }
+
+    ConstantPool::ConstantPool(std::pmr::memory_resource *resource) : constants(resource), slots(resource)
+    {
+        constants.push_back({ TypeTable::ERROR, 0 });
+    }
+
+    uint32_t ConstantPool::add(const TypeId type, const uint64_t bits)
+    {
+        /* at most half full */
+        if (constants.size() * 2 > slots.size())
+            grow();
+
+        const size_t mask = slots.size() - 1;
+        size_t i = ((static_cast<uint64_t>(type) << 48 ^ bits) * 0x9E3779B97F4A7C15ULL) >> 32 & mask;
+        for (; slots[i] != NONE; i = (i + 1) & mask)
+        {
+            if (constants[slots[i]].type == type && constants[slots[i]].bits == bits)
+                return slots[i];
+        }
+
+        const auto id = static_cast<uint32_t>(constants.size());
+        constants.push_back({ type, bits });
+        slots[i] = id;
+        return id;
+    }
+
+    std::string ConstantPool::to_string(const uint32_t id) const
+    {
+        const Constant &constant = constants[id];
+        const auto kind = static_cast<TypeKind>(constant.type);
+        if (kind == TypeKind::BOOL)
+            return constant.bits ? "true" : "false";
+        if (is_signed(kind))
+            return std::to_string(static_cast<int64_t>(constant.bits));
+        if (TypeTable::is_integer(kind))
+            return std::to_string(constant.bits);
+
+        char buffer[32];
+        const auto result = kind == TypeKind::F32
+                                ? std::to_chars(std::begin(buffer), std::end(buffer),
+                                                static_cast<float>(constant.as_float()))
+                                : std::to_chars(std::begin(buffer), std::end(buffer), constant.as_float());
+        return { buffer, result.ptr };
+    }
+
+    size_t ConstantPool::memory_bytes() const
+    {
+        return constants.capacity() * sizeof(Constant) + slots.capacity() * sizeof(uint32_t);
+    }
+
+    void ConstantPool::grow()
+    {
+        std::pmr::vector<uint32_t> old(std::max<size_t>(slots.size() * 2, 64), NONE, slots.get_allocator());
+        old.swap(slots);
+
+        const size_t mask = slots.size() - 1;
+        for (auto id = static_cast<uint32_t>(1); id < constants.size(); ++id)
+        {
+            const auto [type, bits] = constants[id];
+            size_t i = ((static_cast<uint64_t>(type) << 48 ^ bits) * 0x9E3779B97F4A7C15ULL) >> 32 & mask;
+            while (slots[i] != NONE)
+                i = (i + 1) & mask;
+            slots[i] = id;
+        }
+    }
+
+    uint64_t wrap_integer(const TypeKind kind, const uint64_t bits)
+    {
+        const uint32_t n = width(kind);
+        if (n == 64)
+            return bits;
+
+        const uint64_t mask = (1ULL << n) - 1;
+        const uint64_t low = bits & mask;
+        const uint64_t sign = 1ULL << (n - 1);
+        return is_signed(kind) && low & sign ? low | ~mask : low;
+    }
+
+    bool evaluate_binary(const TokenType op, const TypeKind kind, const uint64_t lhs, const uint64_t rhs,
+                         uint64_t &out)
+    {
+        if (kind == TypeKind::BOOL)
+        {
+            switch (op)
+            {
+                case TokenType::EQ:
+                    out = lhs == rhs;
+                    return true;
+                case TokenType::NE:
+                    out = lhs != rhs;
+                    return true;
+                case TokenType::LOGICAL_AND:
+                    out = lhs && rhs;
+                    return true;
+                case TokenType::LOGICAL_OR:
+                    out = lhs || rhs;
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        if (TypeTable::is_float(kind))
+        {
+            const double a = to_double(lhs);
+            const double b = to_double(rhs);
+            switch (op)
+            {
+                case TokenType::PLUS:
+                    out = from_double(kind, kind == TypeKind::F32 ? static_cast<float>(a) + static_cast<float>(b)
+                                                                  : a + b);
+                    return true;
+                case TokenType::MINUS:
+                    out = from_double(kind, kind == TypeKind::F32 ? static_cast<float>(a) - static_cast<float>(b)
+                                                                  : a - b);
+                    return true;
+                case TokenType::STAR:
+                    out = from_double(kind, kind == TypeKind::F32 ? static_cast<float>(a) * static_cast<float>(b)
+                                                                  : a * b);
+                    return true;
+                case TokenType::SLASH:
+                    out = from_double(kind, kind == TypeKind::F32 ? static_cast<float>(a) / static_cast<float>(b)
+                                                                  : a / b);
+                    return true;
+                case TokenType::PERCENT:
+                    out = from_double(kind, kind == TypeKind::F32
+                                                ? std::fmod(static_cast<float>(a), static_cast<float>(b))
+                                                : std::fmod(a, b));
+                    return true;
+                case TokenType::EQ:
+                    out = a == b;
+                    return true;
+                case TokenType::NE:
+                    out = a != b;
+                    return true;
+                case TokenType::LESS:
+                    out = a < b;
+                    return true;
+                case TokenType::GREATER:
+                    out = a > b;
+                    return true;
+                case TokenType::LE:
+                    out = a <= b;
+                    return true;
+                case TokenType::GE:
+                    out = a >= b;
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        if (!TypeTable::is_integer(kind))
+            return false;
+
+        /* both operands are already extended to 64 bits, so only the result needs wrapping */
+        const bool sign = is_signed(kind);
+        const auto a = static_cast<int64_t>(lhs);
+        const auto b = static_cast<int64_t>(rhs);
+        const uint32_t count = static_cast<uint32_t>(rhs) & (width(kind) - 1);
+        switch (op)
+        {
+            case TokenType::PLUS:
+                out = wrap_integer(kind, lhs + rhs);
+                return true;
+            case TokenType::MINUS:
+                out = wrap_integer(kind, lhs - rhs);
+                return true;
+            case TokenType::STAR:
+                out = wrap_integer(kind, lhs * rhs);
+                return true;
+            case TokenType::SLASH:
+            case TokenType::PERCENT:
+            {
+                if (rhs == 0)
+                    return false;
+
+                const bool div = op == TokenType::SLASH;
+                if (!sign)
+                    out = div ? lhs / rhs : lhs % rhs;
+                else if (b == -1) /* INT64_MIN / -1 traps in hardware; it wraps like any other overflow */
+                    out = div ? wrap_integer(kind, 0 - lhs) : 0;
+                else
+                    out = wrap_integer(kind, static_cast<uint64_t>(div ? a / b : a % b));
+                return true;
+            }
+            case TokenType::AND:
+                out = lhs & rhs;
+                return true;
+            case TokenType::OR:
+                out = lhs | rhs;
+                return true;
+            case TokenType::XOR:
+                out = lhs ^ rhs;
+                return true;
+            case TokenType::LEFT_SHIFT:
+                out = wrap_integer(kind, lhs << count);
+                return true;
+            case TokenType::RIGHT_SHIFT:
+                out = sign ? static_cast<uint64_t>(a >> count) : lhs >> count;
+                return true;
+            case TokenType::EQ:
+                out = lhs == rhs;
+                return true;
+            case TokenType::NE:
+                out = lhs != rhs;
+                return true;
+            case TokenType::LESS:
+                out = sign ? a < b : lhs < rhs;
+                return true;
+            case TokenType::GREATER:
+                out = sign ? a > b : lhs > rhs;
+                return true;
+            case TokenType::LE:
+                out = sign ? a <= b : lhs <= rhs;
+                return true;
+            case TokenType::GE:
+                out = sign ? a >= b : lhs >= rhs;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool evaluate_unary(const TokenType op, const TypeKind kind, const uint64_t operand, uint64_t &out)
+    {
+        switch (op)
+        {
+            case TokenType::BANG:
+            {
+                if (kind != TypeKind::BOOL)
+                    return false;
+                out = !operand;
+                return true;
+            }
+            case TokenType::MINUS:
+            {
+                if (TypeTable::is_float(kind))
+                    out = from_double(kind, -to_double(operand));
+                else if (TypeTable::is_integer(kind))
+                    out = wrap_integer(kind, 0 - operand);
+                else
+                    return false;
+                return true;
+            }
+            case TokenType::TILDE:
+            {
+                if (!TypeTable::is_integer(kind))
+                    return false;
+                out = wrap_integer(kind, ~operand);
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    bool convert(const TypeKind from, const TypeKind to, const uint64_t bits, uint64_t &out)
+    {
+        const auto number = [](const TypeKind kind)
+        {
+            return TypeTable::is_integer(kind) || TypeTable::is_float(kind) || kind == TypeKind::BOOL;
+        };
+        if (!number(from) || !number(to))
+            return false;
+
+        if (to == TypeKind::BOOL)
+        {
+            out = TypeTable::is_float(from) ? to_double(bits) != 0 : bits != 0;
+            return true;
+        }
+
+        if (TypeTable::is_float(from))
+        {
+            const double value = to_double(bits);
+            out = TypeTable::is_float(to) ? from_double(to, value) : saturate(to, value);
+            return true;
+        }
+
+        /* bools are 0 or 1, which reads the same as an unsigned integer.
+           f32 converts straight from the integer, going through double would round twice */
+        if (TypeTable::is_float(to))
+        {
+            const auto signed_bits = static_cast<int64_t>(bits);
+            if (to == TypeKind::F32)
+                out = from_double(to, is_signed(from) ? static_cast<float>(signed_bits) : static_cast<float>(bits));
+            else
+                out = from_double(to, is_signed(from) ? static_cast<double>(signed_bits) : static_cast<double>(bits));
+            return true;
+        }
+
+        out = wrap_integer(to, bits);
+        return true;
+    }
+}
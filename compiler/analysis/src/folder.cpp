@@ -0,0 +1,188 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/analysis/include/folder.h>
+#include <algorithm>
+
+namespace klr::compiler
+{
+    ConstantFolder::ConstantFolder(AST &ast, ConstantPool &pool, const TypeChecker &checker,
+                                   const SymbolTable &symbols, const TokenList &tokens,
+                                   std::pmr::memory_resource *resource) : ast(ast), pool(pool), checker(checker)
+                                                                        , symbols(symbols), tokens(tokens)
+                                                                        , diagnostics(resource) {}
+
+    size_t ConstantFolder::fold()
+    {
+        diagnostics.clear();
+
+        size_t folded = 0;
+        for (uint32_t node = 0; node < ast.size(); ++node)
+        {
+            uint32_t value = ConstantPool::NONE;
+            switch (ast.types[node])
+            {
+                case ASTNodeType::LITERAL:
+                {
+                    /* folded ones already name their constant */
+                    if (!ast.data[node].literal.constant)
+                        ast.data[node].literal.constant = literal(node);
+                    continue;
+                }
+                case ASTNodeType::BINARY_EXPR:
+                    value = binary(node);
+                    break;
+                case ASTNodeType::UNARY_EXPR:
+                    value = unary(node);
+                    break;
+                case ASTNodeType::CAST_EXPR:
+                    value = cast(node);
+                    break;
+                case ASTNodeType::TERNARY:
+                    value = ternary(node);
+                    break;
+                default:
+                    continue;
+            }
+
+            if (value != ConstantPool::NONE)
+            {
+                rewrite(node, value);
+                ++folded;
+            }
+        }
+        return folded;
+    }
+
+    uint32_t ConstantFolder::constant(uint32_t node) const
+    {
+        /* through `const` names to the initializer; a cycle of them is a type error, but must not hang here */
+        for (size_t steps = 0; ast.types[node] == ASTNodeType::IDENTIFIER && steps < ast.size(); ++steps)
+        {
+            const uint32_t decl = symbols.declaration(node);
+            if (!decl || ast.types[decl] != ASTNodeType::DECL ||
+                (ast.data[decl].decl.flags & ASTNodeFlags::IS_CONST) != ASTNodeFlags::IS_CONST)
+                return ConstantPool::NONE;
+            node = ast.data[decl].decl.init_node;
+        }
+        return ast.types[node] == ASTNodeType::LITERAL ? ast.data[node].literal.constant : ConstantPool::NONE;
+    }
+
+    uint32_t ConstantFolder::literal(const uint32_t node)
+    {
+        const TypeKind type = kind(node);
+        switch (ast.tokens[node].type)
+        {
+            case TokenType::TRUE:
+            case TokenType::FALSE:
+            {
+                return type == TypeKind::BOOL
+                           ? pool.add(TypeTable::BOOL, ast.tokens[node].type == TokenType::TRUE)
+                           : ConstantPool::NONE;
+            }
+            case TokenType::NUM_LITERAL:
+            {
+                const auto it = std::ranges::lower_bound(tokens.starts, ast.tokens[node].start);
+                const NumLiteral *value = tokens.literal(it - tokens.starts.begin());
+                if (!value || type == TypeKind::ERROR)
+                    return ConstantPool::NONE;
+
+                /* integer literals can be floats too, `var x: f64 = 1` */
+                uint64_t bits;
+                if (!convert(value->is_float ? TypeKind::F64 : TypeKind::U64, type, value->bits, bits))
+                    return ConstantPool::NONE;
+                return pool.add(TypeTable::builtin(type), bits);
+            }
+            default:
+                return ConstantPool::NONE;
+        }
+    }
+
+    uint32_t ConstantFolder::binary(const uint32_t node)
+    {
+        const auto [left, right, op] = ast.data[node].binary_expr;
+        const uint32_t lhs = constant(left);
+
+        /* the right side of a decided && or || never runs, so it need not be constant */
+        if (lhs && (op == TokenType::LOGICAL_AND || op == TokenType::LOGICAL_OR) &&
+            (pool[lhs].bits != 0) == (op == TokenType::LOGICAL_OR))
+            return lhs;
+
+        const uint32_t rhs = constant(right);
+        if (!lhs || !rhs)
+            return ConstantPool::NONE;
+
+        const TypeKind type = kind(left);
+        if ((op == TokenType::SLASH || op == TokenType::PERCENT) && TypeTable::is_integer(type) && !pool[rhs].bits)
+        {
+            const auto it = std::ranges::lower_bound(tokens.starts, ast.tokens[node].start);
+            diagnostics.push_back({
+                .token = static_cast<offset_t>(it - tokens.starts.begin()),
+                .args = { 0, 0 },
+                .code = DiagCode::DIVISION_BY_ZERO,
+                .level = ErrorLevel::ERROR
+            });
+            return ConstantPool::NONE;
+        }
+
+        uint64_t bits;
+        if (type == TypeKind::ERROR || kind(node) == TypeKind::ERROR ||
+            !evaluate_binary(op, type, pool[lhs].bits, pool[rhs].bits, bits))
+            return ConstantPool::NONE;
+        return pool.add(checker.type_of(node), bits);
+    }
+
+    uint32_t ConstantFolder::unary(const uint32_t node)
+    {
+        /* only -, ! and ~ evaluate; `new` of a constant is an allocation all the same */
+        const auto [operand, op] = ast.data[node].unary_expr;
+        const uint32_t value = constant(operand);
+        uint64_t bits;
+        if (!value || kind(node) == TypeKind::ERROR || !evaluate_unary(op, kind(operand), pool[value].bits, bits))
+            return ConstantPool::NONE;
+        return pool.add(checker.type_of(node), bits);
+    }
+
+    uint32_t ConstantFolder::cast(const uint32_t node)
+    {
+        const uint32_t operand = ast.data[node].cast_expr.operand;
+        const uint32_t value = constant(operand);
+        uint64_t bits;
+        if (!value || !convert(kind(operand), kind(node), pool[value].bits, bits))
+            return ConstantPool::NONE;
+        return pool.add(checker.type_of(node), bits);
+    }
+
+    uint32_t ConstantFolder::ternary(const uint32_t node)
+    {
+        /* only the branch taken has to be constant */
+        const uint32_t condition = ast.first_child[node];
+        const uint32_t then_branch = ast.next_sibling[condition];
+        const uint32_t value = constant(condition);
+        if (!value || kind(condition) != TypeKind::BOOL || kind(node) == TypeKind::ERROR)
+            return ConstantPool::NONE;
+        return constant(pool[value].bits ? then_branch : ast.next_sibling[then_branch]);
+    }
+
+    void ConstantFolder::rewrite(const uint32_t node, const uint32_t constant)
+    {
+        /* the token keeps pointing at the operator for diagnostics; the pool is what holds the value */
+        ast.types[node] = ASTNodeType::LITERAL;
+        ast.tokens[node].type = pool[constant].type != TypeTable::BOOL
+                                    ? TokenType::NUM_LITERAL
+                                    : pool[constant].bits ? TokenType::TRUE : TokenType::FALSE;
+        ast.data[node] = {};
+        ast.data[node].literal.constant = constant;
+        ast.first_child[node] = 0;
+        ast.last_child[node] = 0;
+        ast.atoms[node] = 0;
+    }
+
+    TypeKind ConstantFolder::kind(const uint32_t node) const
+    {
+        const TypeId type = checker.type_of(node);
+        return type >= TypeTable::builtin(TypeKind::U8) && type <= TypeTable::BOOL
+                   ? static_cast<TypeKind>(type)
+                   : TypeKind::ERROR;
+    }
+}
@@ -0,0 +1,270 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/analysis/include/symbols.h>
+#include <algorithm>
+#include <bit>
+
+namespace klr::compiler
+{
+    namespace
+    {
+        /* work items are node indexes; the top bit marks the visit after a node's children */
+        constexpr uint32_t EXIT = 1U << 31;
+        constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+        /* fibonacci hashing; dense atoms would cluster under a plain mask */
+        size_t slot_of(const uint32_t atom, const size_t capacity)
+        {
+            return (atom * 0x9E3779B97F4A7C15ULL) >> (64 - std::countr_zero(capacity));
+        }
+    }
+
+    SymbolTable::SymbolTable(std::pmr::memory_resource *resource) : symbols(resource), scopes(resource)
+                                                                  , bindings(resource), unresolved(resource)
+                                                                  , redeclared(resource), slots(resource)
+                                                                  , live(resource), scope_starts(resource)
+                                                                  , work(resource) {}
+
+    void SymbolTable::resolve(const AST &ast)
+    {
+        symbols.assign(1, {});
+        scopes.clear();
+        bindings.assign(ast.size(), NONE);
+        unresolved.clear();
+        redeclared.clear();
+        slots.clear();
+        used = 0;
+        live.clear();
+        scope_starts.clear();
+        current = 0;
+        if (ast.size() == 0)
+            return;
+
+        /* 0 in an operand slot is a missing operand, not the root */
+        const auto visit = [&](const uint32_t operand)
+        {
+            if (operand != 0)
+                work.push_back(operand);
+        };
+
+        // one pre-order walk on a heap stack, like the parser's. a node is pushed
+        // again with EXIT under its children when something has to happen after
+        // them: closing its scope, or declaring a local once its initializer
+        // has been resolved
+        work.assign(1, 0);
+        while (!work.empty())
+        {
+            const uint32_t item = work.back();
+            work.pop_back();
+
+            const uint32_t node = item & ~EXIT;
+            const ASTNodeType type = ast.types[node];
+            if (item & EXIT)
+            {
+                if (type == ASTNodeType::DECL)
+                    declare(node, ast.atoms[node]);
+                else
+                    close_scope();
+                continue;
+            }
+
+            switch (type)
+            {
+                case ASTNodeType::ROOT:
+                {
+                    /* module-level names are visible throughout the module, before their declaration too */
+                    open_scope(node);
+                    for (const uint32_t child: ast.children(node))
+                    {
+                        if (ast.types[child] == ASTNodeType::DECL || ast.types[child] == ASTNodeType::FUNCTION)
+                            declare(child, ast.atoms[child]);
+                    }
+                    work.push_back(node | EXIT);
+                    break;
+                }
+
+                case ASTNodeType::FUNCTION:
+                case ASTNodeType::BLOCK:
+                case ASTNodeType::FOR:
+                {
+                    open_scope(node);
+                    work.push_back(node | EXIT);
+                    break;
+                }
+
+                case ASTNodeType::DECL:
+                {
+                    /* module-level ones were declared up front */
+                    if (ast.parents[node] != 0)
+                        work.push_back(node | EXIT);
+                    break;
+                }
+
+                case ASTNodeType::TYPE:
+                {
+                    /* a FUNCTION's TYPE children other than its return type are its generic parameters */
+                    const uint32_t parent = ast.parents[node];
+                    if (ast.types[parent] == ASTNodeType::FUNCTION && ast.data[parent].function.ret_type != node)
+                        declare(node, ast.atoms[node]);
+                    else
+                        reference(node, ast.atoms[node], false); /* may be a builtin or imported type */
+                    break;
+                }
+
+                case ASTNodeType::IDENTIFIER:
+                {
+                    reference(node, ast.atoms[node], true);
+                    break;
+                }
+
+                case ASTNodeType::CALL:
+                {
+                    /* its IDENTIFIER child is the one reported if the callee is missing */
+                    reference(node, ast.atoms[node], false);
+                    break;
+                }
+
+                default:
+                    break;
+            }
+
+            /* operators keep their operands in the payload, as AST::dump walks them; `new` links its own as children */
+            const ASTNodeData &payload = ast.data[node];
+            if (type == ASTNodeType::BINARY_EXPR)
+            {
+                visit(payload.binary_expr.right);
+                visit(payload.binary_expr.left);
+                continue;
+            }
+            if (type == ASTNodeType::UNARY_EXPR && !ast.first_child[node])
+            {
+                visit(payload.unary_expr.operand);
+                continue;
+            }
+
+            /* children in source order: push them, then flip the pushed run */
+            const size_t first = work.size();
+            for (const uint32_t child: ast.children(node))
+                work.push_back(child);
+            std::reverse(work.begin() + static_cast<std::ptrdiff_t>(first), work.end());
+        }
+    }
+
+    size_t SymbolTable::memory_bytes() const
+    {
+        return symbols.capacity() * sizeof(Symbol) + scopes.capacity() * sizeof(Scope) +
+               (bindings.capacity() + unresolved.capacity() + redeclared.capacity() + live.capacity() +
+                scope_starts.capacity() + work.capacity()) * sizeof(uint32_t) +
+               slots.capacity() * sizeof(slots[0]);
+    }
+
+    size_t SymbolTable::find(const uint32_t atom) const
+    {
+        if (slots.empty())
+            return NOT_FOUND;
+
+        const size_t mask = slots.size() - 1;
+        for (size_t i = slot_of(atom, slots.size()); slots[i].first != NONE; i = (i + 1) & mask)
+        {
+            if (slots[i].first == atom)
+                return i;
+        }
+        return NOT_FOUND;
+    }
+
+    size_t SymbolTable::claim(const uint32_t atom)
+    {
+        /* at most half full */
+        if ((used + 1) * 2 > slots.size())
+            grow();
+
+        const size_t mask = slots.size() - 1;
+        size_t i = slot_of(atom, slots.size());
+        for (; slots[i].first != NONE; i = (i + 1) & mask)
+        {
+            if (slots[i].first == atom)
+                return i;
+        }
+
+        slots[i] = { atom, NONE };
+        ++used;
+        return i;
+    }
+
+    void SymbolTable::grow()
+    {
+        std::pmr::vector<std::pair<uint32_t, uint32_t> > old(std::max<size_t>(slots.size() * 2, 64),
+                                                             slots.get_allocator());
+        old.swap(slots);
+
+        /* names out of scope are dropped, the live ones are all reachable through their slot */
+        used = 0;
+        const size_t mask = slots.size() - 1;
+        for (const auto &[atom, symbol]: old)
+        {
+            if (symbol == NONE)
+                continue;
+
+            size_t i = slot_of(atom, slots.size());
+            while (slots[i].first != NONE)
+                i = (i + 1) & mask;
+            slots[i] = { atom, symbol };
+            ++used;
+        }
+    }
+
+    void SymbolTable::open_scope(const uint32_t node)
+    {
+        const auto index = static_cast<uint32_t>(scopes.size());
+        if (scopes.empty())
+            scopes.push_back({ node, index, 0 });
+        else
+            scopes.push_back({ node, current, scopes[current].depth + 1 });
+
+        current = index;
+        scope_starts.push_back(static_cast<uint32_t>(live.size()));
+    }
+
+    void SymbolTable::close_scope()
+    {
+        /* innermost first, so a name declared twice in the scope unwinds through both */
+        const uint32_t start = scope_starts.back();
+        scope_starts.pop_back();
+        while (live.size() > start)
+        {
+            const Symbol &symbol = symbols[live.back()];
+            live.pop_back();
+            slots[find(symbol.atom)].second = symbol.shadowed;
+        }
+        current = scopes[current].parent;
+    }
+
+    void SymbolTable::declare(const uint32_t node, const uint32_t atom)
+    {
+        if (atom == NONE)
+            return;
+
+        const size_t slot = claim(atom);
+        const uint32_t shadowed = slots[slot].second;
+        if (shadowed != NONE && symbols[shadowed].scope == current)
+            redeclared.push_back(node);
+
+        const auto symbol = static_cast<uint32_t>(symbols.size());
+        symbols.push_back({ atom, node, current, shadowed });
+        slots[slot].second = symbol;
+        live.push_back(symbol);
+        bindings[node] = symbol;
+    }
+
+    void SymbolTable::reference(const uint32_t node, const uint32_t atom, const bool report)
+    {
+        if (atom == NONE)
+            return;
+
+        const size_t slot = find(atom);
+        bindings[node] = slot == NOT_FOUND ? NONE : slots[slot].second;
+        if (report && bindings[node] == NONE)
+            unresolved.push_back(node);
+    }
+}
@@ -0,0 +1,133 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/analysis/include/types.h>
+#include <compiler/interfaces/include/tokens.h>
+#include <compiler/memory/include/interner.h>
+#include <algorithm>
+#include <bit>
+
+namespace klr::compiler
+{
+    TypeTable::TypeTable(std::pmr::memory_resource *resource) : types(resource), operands(resource)
+                                                              , slots(resource)
+    {
+        /* ERROR sits at 0 outside the hash table, the builtins follow in kind order */
+        types.push_back({ TypeKind::ERROR, 0, 0, 0, 0 });
+        for (auto kind = static_cast<uint8_t>(TypeKind::U8); kind <= static_cast<uint8_t>(TypeKind::VOID); ++kind)
+            intern(static_cast<TypeKind>(kind));
+    }
+
+    TypeId TypeTable::intern(const TypeKind kind, const uint32_t name, const std::span<const TypeId> args)
+    {
+        /* at most half full */
+        if ((types.size() + 1) * 2 > slots.size())
+            grow();
+
+        const uint64_t h = hash(kind, name, args);
+        const size_t mask = slots.size() - 1;
+        size_t i = h & mask;
+        for (; slots[i] != ERROR; i = (i + 1) & mask)
+        {
+            const TypeId id = slots[i];
+            const Type &type = types[id];
+            if (type.kind == kind && type.name == name && type.count == args.size() &&
+                std::ranges::equal(this->args(id), args))
+                return id;
+        }
+
+        uint8_t flags = kind == TypeKind::VAR ? HAS_VAR : kind == TypeKind::GENERIC ? HAS_GENERIC : 0;
+        if (kind != TypeKind::GENERIC)
+        {
+            for (const TypeId arg: args)
+                flags |= types[arg].flags;
+        }
+
+        const auto id = static_cast<TypeId>(types.size());
+        types.push_back({
+            kind, flags, static_cast<uint16_t>(args.size()), name, static_cast<uint32_t>(operands.size())
+        });
+        operands.insert(operands.end(), args.begin(), args.end());
+        slots[i] = id;
+        return id;
+    }
+
+    std::string TypeTable::to_string(const TypeId id, const Interner *names) const
+    {
+        const Type &type = types[id];
+        const auto list = [&](const std::span<const TypeId> items)
+        {
+            std::string out;
+            for (size_t i = 0; i < items.size(); ++i)
+                out += (i ? ", " : "") + to_string(items[i], names);
+            return out;
+        };
+        const auto name = [&]
+        {
+            return names ? std::string(names->str(type.name)) : "#" + std::to_string(type.name);
+        };
+
+        switch (type.kind)
+        {
+            case TypeKind::ERROR:
+                return "{error}";
+            case TypeKind::ARRAY:
+                return to_string(args(id)[0], names) + "[]";
+            case TypeKind::OWN:
+            case TypeKind::SHARE:
+            case TypeKind::REF:
+            case TypeKind::PIN:
+            {
+                const auto token = static_cast<TokenType>(static_cast<uint8_t>(TokenType::OWN) +
+                                                          static_cast<uint8_t>(type.kind) -
+                                                          static_cast<uint8_t>(TypeKind::OWN));
+                return std::string(token_to_str(token)) + "<" + to_string(args(id)[0], names) + ">";
+            }
+            case TypeKind::FUNCTION:
+                return "function(" + list(args(id).subspan(1)) + ") -> " + to_string(args(id)[0], names);
+            case TypeKind::GENERIC:
+                return name();
+            case TypeKind::NAMED:
+                return type.count ? name() + "<" + list(args(id)) + ">" : name();
+            case TypeKind::VAR:
+                return "?" + std::to_string(type.name);
+            default:
+            {
+                /* builtins share the TokenType order */
+                return std::string(token_to_str(static_cast<TokenType>(static_cast<uint8_t>(TokenType::U8) +
+                                                                       static_cast<uint8_t>(type.kind) - 1)));
+            }
+        }
+    }
+
+    size_t TypeTable::memory_bytes() const
+    {
+        return types.capacity() * sizeof(Type) + (operands.capacity() + slots.capacity()) * sizeof(TypeId);
+    }
+
+    void TypeTable::grow()
+    {
+        std::pmr::vector<TypeId> old(std::max<size_t>(slots.size() * 2, 64), ERROR, slots.get_allocator());
+        old.swap(slots);
+
+        /* the rows keep everything a slot needs */
+        const size_t mask = slots.size() - 1;
+        for (auto id = static_cast<TypeId>(1); id < types.size(); ++id)
+        {
+            const Type &type = types[id];
+            size_t i = hash(type.kind, type.name, args(id)) & mask;
+            while (slots[i] != ERROR)
+                i = (i + 1) & mask;
+            slots[i] = id;
+        }
+    }
+
+    uint64_t TypeTable::hash(const TypeKind kind, const uint32_t name, const std::span<const TypeId> args)
+    {
+        constexpr uint64_t k = 0x9E3779B97F4A7C15ULL;
+        uint64_t h = (static_cast<uint64_t>(kind) << 32 | name) * k;
+        for (const TypeId arg: args)
+            h = (std::rotl(h, 23) ^ arg) * k;
+        return h ^ h >> 31;
+    }
+}
@@ -0,0 +1,58 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <compiler/interfaces/include/diagnostics.h>
+#include <compiler/interfaces/include/tokens.h>
+
+namespace klr::compiler
+{
+    /*
+     * turns Diagnostic records into text on demand
+     *
+     * a renderer is a view over one module's source, tokens and line table;
+     * it must not outlive them. nothing here runs unless a caller asks, so
+     * tools that only count errors or need locations never format a string
+     */
+    class DiagnosticRenderer
+    {
+    public:
+        struct Location
+        {
+            size_t line;    /* 1-based */
+            offset_t column; /* 1-based, in bytes */
+            offset_t length; /* of the token, in bytes */
+        };
+
+        DiagnosticRenderer(std::string_view module_name, std::string_view source, const TokenList &tokens,
+                           const std::vector<offset_t> &line_starts);
+
+        [[nodiscard]] Location locate(const Diagnostic &diagnostic) const;
+
+        /* the message with its arguments substituted */
+        [[nodiscard]] std::string message(const Diagnostic &diagnostic) const;
+
+        /* "module:line:column", the message, the offending line and a caret */
+        void text(std::ostream &os, const Diagnostic &diagnostic, bool color = false) const;
+
+        /* a JSON array with one object per diagnostic */
+        void json(std::ostream &os, std::span<const Diagnostic> diagnostics) const;
+
+        /* a SARIF 2.1.0 log with a single run, for code scanning tools */
+        void sarif(std::ostream &os, std::span<const Diagnostic> diagnostics) const;
+
+    private:
+        std::string_view mod_name;
+        std::string_view src;
+        const TokenList &tokens;
+        const std::vector<offset_t> &line_starts;
+
+        [[nodiscard]] std::string_view line_text(size_t line) const;
+    };
+}
@@ -0,0 +1,208 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/diagnostics/include/renderer.h>
+#include <algorithm>
+#include <cstdio>
+
+namespace klr::compiler
+{
+    static constexpr std::string_view RED = "\033[31m";
+    static constexpr std::string_view BRIGHT_RED = "\033[91m";
+    static constexpr std::string_view RESET = "\033[0m";
+
+    /* longest token text quoted in a message before it is cut short */
+    static constexpr size_t MAX_QUOTED = 32;
+
+    static void write_json_string(std::ostream &os, const std::string_view s)
+    {
+        os << '"';
+        for (const char c: s)
+        {
+            switch (c)
+            {
+                case '"':
+                    os << "\\\"";
+                    break;
+                case '\\':
+                    os << "\\\\";
+                    break;
+                case '\n':
+                    os << "\\n";
+                    break;
+                case '\r':
+                    os << "\\r";
+                    break;
+                case '\t':
+                    os << "\\t";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                    {
+                        char buf[8];
+                        std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                        os << buf;
+                    }
+                    else
+                    {
+                        os << c;
+                    }
+            }
+        }
+        os << '"';
+    }
+
+    DiagnosticRenderer::DiagnosticRenderer(const std::string_view module_name, const std::string_view source,
+                                           const TokenList &tokens, const std::vector<offset_t> &line_starts)
+        : mod_name(module_name), src(source), tokens(tokens), line_starts(line_starts) {}
+
+    DiagnosticRenderer::Location DiagnosticRenderer::locate(const Diagnostic &diagnostic) const
+    {
+        if (tokens.size() == 0)
+            return { 1, 1, 0 };
+
+        const size_t index = std::min<size_t>(diagnostic.token, tokens.size() - 1);
+        const offset_t start = tokens.starts[index];
+        const auto line_it = std::ranges::upper_bound(line_starts, start);
+        const size_t line = line_it == line_starts.begin() ? 0 : std::distance(line_starts.begin(), line_it) - 1;
+        const offset_t line_start = line_starts.empty() ? 0 : line_starts[line];
+        return { line + 1, start - line_start + 1, tokens.length(index) };
+    }
+
+    std::string DiagnosticRenderer::message(const Diagnostic &diagnostic) const
+    {
+        const std::string_view format = diag_info(diagnostic.code).message;
+        std::string out;
+        out.reserve(format.size() + 16);
+
+        for (size_t i = 0; i < format.size(); ++i)
+        {
+            if (format[i] != '{' || i + 2 >= format.size() || format[i + 2] != '}')
+            {
+                out += format[i];
+                continue;
+            }
+
+            if (const char slot = format[i + 1]; slot == '0' || slot == '1')
+            {
+                out += token_to_str(static_cast<TokenType>(diagnostic.args[slot - '0']));
+            }
+            else if (slot == '@')
+            {
+                const size_t index = std::min<size_t>(diagnostic.token, tokens.size() - 1);
+                if (tokens.size() == 0 || tokens.types[index] == TokenType::END_OF_FILE)
+                {
+                    out += "end of file";
+                }
+                else
+                {
+                    const std::string_view text = src.substr(tokens.starts[index], tokens.length(index));
+                    out += '\'';
+                    out += text.substr(0, MAX_QUOTED);
+                    out += text.size() > MAX_QUOTED ? "...'" : "'";
+                }
+            }
+            else
+            {
+                out += format.substr(i, 3);
+            }
+            i += 2;
+        }
+        return out;
+    }
+
+    std::string_view DiagnosticRenderer::line_text(const size_t line) const
+    {
+        if (line_starts.empty())
+            return src;
+
+        const offset_t begin = line_starts[line];
+        const size_t end = line + 1 < line_starts.size() ? line_starts[line + 1] : src.size();
+        std::string_view text = src.substr(begin, end - begin);
+        while (!text.empty() && (text.back() == '\n' || text.back() == '\r'))
+            text.remove_suffix(1);
+        return text;
+    }
+
+    void DiagnosticRenderer::text(std::ostream &os, const Diagnostic &diagnostic, const bool color) const
+    {
+        const auto [line, column, length] = locate(diagnostic);
+        const DiagInfo &info = diag_info(diagnostic.code);
+        const auto paint = [&](const std::string_view code) { return color ? code : std::string_view(); };
+
+        os << paint(RED) << mod_name << ":" << line << ":" << column << paint(RESET) << "\n"
+           << paint(BRIGHT_RED) << level_to_str(diagnostic.level) << "[" << info.id << "]: "
+           << message(diagnostic) << paint(RESET) << "\n\n";
+
+        /* the caret underlines the token, clipped to the end of its line */
+        const std::string_view excerpt = line_text(line - 1);
+        const std::string gutter = std::to_string(line);
+        const size_t room = excerpt.size() >= column ? excerpt.size() - column + 1 : 1;
+        const size_t marks = std::clamp<size_t>(length, 1, room);
+        os << " " << paint(RED) << gutter << " | " << paint(RESET) << excerpt << "\n"
+           << " " << std::string(gutter.size(), ' ') << " | " << std::string(column - 1, ' ')
+           << paint(BRIGHT_RED) << "^" << std::string(marks - 1, '~') << paint(RESET) << "\n";
+
+        if (!info.help.empty())
+            os << paint(RED) << "help: " << info.help << paint(RESET) << "\n";
+    }
+
+    void DiagnosticRenderer::json(std::ostream &os, const std::span<const Diagnostic> diagnostics) const
+    {
+        os << "[";
+        for (size_t i = 0; i < diagnostics.size(); ++i)
+        {
+            const Diagnostic &d = diagnostics[i];
+            const auto [line, column, length] = locate(d);
+            const DiagInfo &info = diag_info(d.code);
+
+            os << (i ? ",\n  " : "\n  ") << "{ \"code\": \"" << info.id << "\", \"severity\": \""
+               << level_to_str(d.level) << "\", \"file\": ";
+            write_json_string(os, mod_name);
+            os << ", \"line\": " << line << ", \"column\": " << column << ", \"length\": " << length
+               << ", \"message\": ";
+            write_json_string(os, message(d));
+            os << ", \"help\": ";
+            write_json_string(os, info.help);
+            os << " }";
+        }
+        os << (diagnostics.empty() ? "]\n" : "\n]\n");
+    }
+
+    void DiagnosticRenderer::sarif(std::ostream &os, const std::span<const Diagnostic> diagnostics) const
+    {
+        os << "{\n"
+           << "  \"$schema\": \"https://json.schemastore.org/sarif-2.1.0.json\",\n"
+           << "  \"version\": \"2.1.0\",\n"
+           << "  \"runs\": [{\n"
+           << "    \"tool\": { \"driver\": { \"name\": \"klr\", \"rules\": [";
+
+        /* rules are the whole catalogue, so ruleIndex is simply the code */
+        for (size_t i = 0; i < std::size(diag_table); ++i)
+        {
+            os << (i ? ",\n" : "\n") << "      { \"id\": \"" << diag_table[i].id << "\", \"shortDescription\": { \"text\": ";
+            write_json_string(os, diag_table[i].message);
+            os << " }, \"help\": { \"text\": ";
+            write_json_string(os, diag_table[i].help);
+            os << " } }";
+        }
+        os << "\n    ] } },\n"
+           << "    \"results\": [";
+
+        for (size_t i = 0; i < diagnostics.size(); ++i)
+        {
+            const Diagnostic &d = diagnostics[i];
+            const auto [line, column, length] = locate(d);
+
+            os << (i ? ",\n" : "\n") << "      { \"ruleId\": \"" << diag_info(d.code).id << "\", \"ruleIndex\": "
+               << static_cast<size_t>(d.code) << ", \"level\": \"" << level_to_str(d.level)
+               << "\", \"message\": { \"text\": ";
+            write_json_string(os, message(d));
+            os << " }, \"locations\": [{ \"physicalLocation\": { \"artifactLocation\": { \"uri\": ";
+            write_json_string(os, mod_name);
+            os << " }, \"region\": { \"startLine\": " << line << ", \"startColumn\": " << column
+               << ", \"endColumn\": " << column + std::max<offset_t>(length, 1) << " } } }] }";
+        }
+        os << (diagnostics.empty() ? "]\n" : "\n    ]\n") << "  }]\n}\n";
+    }
+}
@@ -0,0 +1,110 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <compiler/interfaces/include/tokens.h>
+
+namespace klr::compiler
+{
+    enum class ErrorLevel : uint8_t
+    {
+        ERROR,
+        WARNING,
+        NOTE,
+    };
+
+    enum class DiagCode : uint16_t
+    {
+        EXPECTED_TOKEN,      /* arg 0: the expected TokenType */
+        EXPECTED_NAME,
+        EXPECTED_PARAMETER,
+        EXPECTED_COMMA,
+        EXPECTED_TYPE,
+        EXPECTED_EXPRESSION,
+        EXPECTED_CALL,
+        UNTERMINATED_BLOCK,
+        NESTING_TOO_DEEP,
+
+        /* type checking; args: the expected and found TypeId, or for ARGUMENT_COUNT the counts */
+        TYPE_MISMATCH,
+        INVALID_OPERAND,
+        NOT_CALLABLE,
+        ARGUMENT_COUNT,
+        CANNOT_INFER,
+        ASSIGN_TO_CONST,
+
+        /* constant folding */
+        DIVISION_BY_ZERO,
+
+        /* lowering */
+        NOT_LOWERED,
+        COUNT
+    };
+
+    /*
+     * one reported problem, as recorded
+     *
+     * nothing is formatted when a diagnostic is raised: the record only
+     * names the message (code), where it points (an index into the module's
+     * TokenList) and up to two arguments. text, line and column are worked
+     * out by a renderer when, and if, someone asks for them
+     */
+    struct Diagnostic
+    {
+        offset_t token;
+        std::array<uint32_t, 2> args;
+        DiagCode code;
+        ErrorLevel level;
+    };
+
+    struct DiagInfo
+    {
+        std::string_view id;      /* stable, e.g. for SARIF rule ids and docs */
+        std::string_view message; /* {0}/{1}: argument as a token spelling, {@}: the token's own text */
+        std::string_view help;
+    };
+
+    static constexpr DiagInfo diag_table[] = {
+        { "E0001", "expected '{0}', found {@}", "" },
+        { "E0002", "expected a name, found {@}", "is this a valid name?" },
+        { "E0003", "expected a parameter name, found {@}", "parameters are written as `name: type`" },
+        { "E0004", "invalid parameter list", "parameters must be separated by commas" },
+        { "E0005", "expected a type, found {@}", "expected a valid type" },
+        { "E0006", "expected an expression, found {@}", "unable to parse this token as a primary expression" },
+        { "E0007", "invalid method call", "method calls must be followed by parentheses" },
+        { "E0008", "unterminated block", "this '{' is never closed" },
+        { "E0009", "nesting is too deep", "split this into smaller expressions or functions" },
+        { "E0010", "mismatched types at {@}", "both sides must have the same type; cast<T>(...) converts" },
+        { "E0011", "{@} cannot be applied to this type", "math needs numbers, bit operations integers, logic bools" },
+        { "E0012", "{@} is not a function", "only functions and lambdas can be called" },
+        { "E0013", "wrong number of arguments to {@}", "pass one argument per parameter" },
+        { "E0014", "cannot infer the type of {@}", "add a type annotation, e.g. `var x: i32 = ...`" },
+        { "E0015", "cannot assign to constant {@}", "declare it with `var` to allow assignment" },
+        { "E0016", "division by zero in {@}", "the right side is zero whenever this runs" },
+        { "E0017", "{@} cannot be compiled yet", "only numbers, bools and calls to named functions lower to IR so far" },
+    };
+
+    static_assert(std::size(diag_table) == static_cast<size_t>(DiagCode::COUNT), "every DiagCode needs an entry");
+
+    constexpr const DiagInfo &diag_info(const DiagCode code)
+    {
+        return diag_table[static_cast<size_t>(code)];
+    }
+
+    constexpr std::string_view level_to_str(const ErrorLevel level)
+    {
+        switch (level)
+        {
+            case ErrorLevel::ERROR:
+                return "error";
+            case ErrorLevel::WARNING:
+                return "warning";
+            default:
+                return "note";
+        }
+    }
+}
@@ -3,7 +3,13 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace klr::compiler
@@ -160,26 +166,66 @@ namespace klr::compiler
         INVALID_IDENTIFIER_START = 1 << 6,
         INVALID_IDENTIFIER_CHAR = 1 << 7,
 
-        /* flags */
-        COMPOUND_START = 0x20,
-        COMPOUND_END = 0x40
+        /* number literals only: the value does not fit u64 / f64 */
+        LITERAL_OUT_OF_RANGE = 0x80
     };
 
+    /*
+     * source offsets; the KLR_WIDE_TOKENS build option widens them to
+     * 64 bits for sources above 4 GiB at the cost of a 16 byte Token
+     */
+#ifdef KLR_WIDE_TOKENS
+    using offset_t = uint64_t;
+#else
+    using offset_t = uint32_t;
+#endif
+
     struct alignas(8) Token
     {
-        uint32_t start;
+        /* len of every token this long or longer; the real length is in TokenList::long_lens */
+        static constexpr uint16_t LONG_TOKEN = 0xFFFF;
+
+        offset_t start;
         uint16_t len;
         TokenType type;
         TokenFlags flags;
     };
 
+    static_assert(sizeof(Token) == sizeof(offset_t) * 2, "Token must stay compact");
+
+    /* value of a NUM_LITERAL, decoded once by the lexer; floats keep their IEEE-754 bits */
+    struct NumLiteral
+    {
+        uint64_t bits;
+        bool is_float;
+
+        [[nodiscard]] double as_float() const
+        {
+            return std::bit_cast<double>(bits);
+        }
+    };
+
     struct alignas(8) TokenList
     {
-        std::vector<uint32_t> starts;
+        std::vector<offset_t> starts;
         std::vector<uint16_t> lens;
         std::vector<TokenType> types;
         std::vector<TokenFlags> flags;
 
+        /* (token index, real length) of every LONG_TOKEN, ascending by index */
+        std::pmr::vector<std::pair<offset_t, offset_t> > long_lens;
+
+        /* (token index, value) of every well-formed NUM_LITERAL, ascending by index */
+        std::pmr::vector<std::pair<offset_t, NumLiteral> > literals;
+
+        /* interned name of every IDENTIFIER and STR_LITERAL, 0 elsewhere; empty unless lexed with an Interner */
+        std::vector<uint32_t> atoms;
+
+        TokenList() = default;
+
+        /* the side tables live in resource; the token columns stay on the heap */
+        explicit TokenList(std::pmr::memory_resource *resource) : long_lens(resource), literals(resource) {}
+
         void emplace_back(const Token &tk)
         {
             starts.emplace_back(tk.start);
@@ -196,6 +242,56 @@ namespace klr::compiler
             flags.push_back(tk.flags);
         }
 
+        /* records the real length of an oversized token, call before pushing it */
+        void emplace_long(const offset_t len)
+        {
+            long_lens.emplace_back(static_cast<offset_t>(size()), len);
+        }
+
+        /* records the decoded value of a number literal, call before pushing it */
+        void emplace_literal(const NumLiteral &value)
+        {
+            literals.emplace_back(static_cast<offset_t>(size()), value);
+        }
+
+        void append(const TokenList &other)
+        {
+            for (const auto &[index, len]: other.long_lens)
+                long_lens.emplace_back(static_cast<offset_t>(size() + index), len);
+            for (const auto &[index, value]: other.literals)
+                literals.emplace_back(static_cast<offset_t>(size() + index), value);
+            starts.insert(starts.end(), other.starts.begin(), other.starts.end());
+            lens.insert(lens.end(), other.lens.begin(), other.lens.end());
+            types.insert(types.end(), other.types.begin(), other.types.end());
+            flags.insert(flags.end(), other.flags.begin(), other.flags.end());
+            atoms.insert(atoms.end(), other.atoms.begin(), other.atoms.end());
+        }
+
+        void pop_back()
+        {
+            if (!long_lens.empty() && long_lens.back().first == size() - 1)
+                long_lens.pop_back();
+            if (!literals.empty() && literals.back().first == size() - 1)
+                literals.pop_back();
+            if (atoms.size() == size())
+                atoms.pop_back();
+            starts.pop_back();
+            lens.pop_back();
+            types.pop_back();
+            flags.pop_back();
+        }
+
+        void clear()
+        {
+            starts.clear();
+            lens.clear();
+            types.clear();
+            flags.clear();
+            long_lens.clear();
+            literals.clear();
+            atoms.clear();
+        }
+
         void reserve(const uint32_t &n)
         {
             starts.reserve(n);
@@ -209,6 +305,25 @@ namespace klr::compiler
             return starts.size();
         }
 
+        /* full length, also for tokens whose len is LONG_TOKEN */
+        [[nodiscard]] offset_t length(const size_t index) const
+        {
+            if (lens[index] != Token::LONG_TOKEN)
+                return lens[index];
+
+            const auto it = std::ranges::lower_bound(long_lens, static_cast<offset_t>(index), {},
+                                                     &std::pair<offset_t, offset_t>::first);
+            return it->second;
+        }
+
+        /* decoded value of a NUM_LITERAL; nullptr if it was malformed or out of range */
+        [[nodiscard]] const NumLiteral *literal(const size_t index) const
+        {
+            const auto it = std::ranges::lower_bound(literals, static_cast<offset_t>(index), {},
+                                                     &std::pair<offset_t, NumLiteral>::first);
+            return it != literals.end() && it->first == index ? &it->second : nullptr;
+        }
+
         [[nodiscard]] Token operator[](const size_t index) const
         {
             return Token {
@@ -220,6 +335,93 @@ namespace klr::compiler
         }
     };
 
+    /*
+     * read position over a TokenList that touches only the columns a query needs:
+     * peek_type(), lookahead and skipping read the types column alone, token() and
+     * advance() gather all four. the list must end with END_OF_FILE, as every lexer
+     * output does; positions clamp to it, so lookahead past the end yields EOF
+     */
+    class TokenCursor
+    {
+    public:
+        TokenCursor() = default;
+
+        /* the list must outlive the cursor and keep its size */
+        explicit TokenCursor(const TokenList &list) : list(&list), types(list.types.data()),
+                                                      last(list.size() ? list.size() - 1 : 0) {}
+
+        [[nodiscard]] size_t position() const
+        {
+            return pos;
+        }
+
+        void seek(const size_t index)
+        {
+            pos = std::min(index, last);
+        }
+
+        [[nodiscard]] TokenType peek_type() const
+        {
+            return types[pos];
+        }
+
+        /* type of the token n ahead; peek_type(0) == peek_type() */
+        [[nodiscard]] TokenType peek_type(const size_t n) const
+        {
+            return types[std::min(pos + n, last)];
+        }
+
+        [[nodiscard]] bool at_end() const
+        {
+            return types[pos] == TokenType::END_OF_FILE;
+        }
+
+        [[nodiscard]] Token token() const
+        {
+            return (*list)[pos];
+        }
+
+        /* interned name of the current token; 0 if it has none or the list was not interned */
+        [[nodiscard]] uint32_t atom() const
+        {
+            return pos < list->atoms.size() ? list->atoms[pos] : 0;
+        }
+
+        /* the current token; steps past it unless it is the trailing EOF */
+        Token advance()
+        {
+            const Token tk = token();
+            skip();
+            return tk;
+        }
+
+        void skip()
+        {
+            pos += pos < last;
+        }
+
+        /* bulk skip of n tokens, stopping at EOF */
+        void skip(const size_t n)
+        {
+            pos = std::min(pos + n, last);
+        }
+
+        /* skips to the next token of type, or EOF; returns the number of tokens skipped */
+        size_t skip_to(const TokenType type)
+        {
+            const size_t from = pos;
+            while (types[pos] != type && pos < last)
+                ++pos;
+            return pos - from;
+        }
+
+    private:
+        const TokenList *list = nullptr;
+        const TokenType *types = nullptr;
+        size_t pos = 0;
+        size_t last = 0;
+    };
+
     static constexpr std::pair<std::string_view, TokenType> token_map[] = {
         { "true", TokenType::TRUE },
         { "false", TokenType::FALSE },
@@ -260,6 +462,9 @@ namespace klr::compiler
         { "namespace", TokenType::NAMESPACE },
         { "export", TokenType::EXPORT },
 
+        /* the README's spelling of i32; ahead of it, so token_to_str() still says i32 */
+        { "int", TokenType::I32 },
+
         { "u8", TokenType::U8 },
         { "i8", TokenType::I8 },
         { "u16", TokenType::U16 },
@@ -340,6 +545,105 @@ namespace klr::compiler
         { "@override", TokenType::OVERRIDE_ANNOT },
     };
 
+    /*
+     * perfect hash over the word-like entries of token_map (keywords,
+     * builtin types & annotations) keyed on length, first & last byte;
+     * the '@' of an annotation is skipped when picking the first byte.
+     * the seed is searched at compile time, so token_map stays the
+     * single source of truth and a colliding addition fails the build
+     */
+    namespace keyword_hash
+    {
+        static constexpr uint32_t BITS = 9;
+        static constexpr uint32_t SLOTS = 1U << BITS;
+        static constexpr size_t MIN_LEN = 2;
+        static constexpr size_t MAX_LEN = 16;
+
+        constexpr bool is_word(const std::string_view s)
+        {
+            const char c = s[0];
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '@';
+        }
+
+        constexpr uint32_t key(const char *s, const size_t len)
+        {
+            const uint32_t at = s[0] == '@';
+            return static_cast<uint8_t>(s[at]) |
+                   static_cast<uint8_t>(s[len - 1]) << 8 |
+                   static_cast<uint32_t>(len << 1 | at) << 16;
+        }
+
+        /* murmur3 finalizer */
+        constexpr uint32_t slot(uint32_t k, const uint32_t seed)
+        {
+            k ^= seed;
+            k *= 0x85EBCA6BU;
+            k ^= k >> 13;
+            k *= 0xC2B2AE35U;
+            k ^= k >> 16;
+            return k & (SLOTS - 1);
+        }
+
+        constexpr uint32_t find_seed()
+        {
+            /* stamp each slot with the seed that claimed it to avoid clearing */
+            std::array<uint32_t, SLOTS> claimed {};
+            for (uint32_t seed = 1; seed < 100000; ++seed)
+            {
+                auto perfect = true;
+                for (const auto &[str, token]: token_map)
+                {
+                    if (!is_word(str))
+                        continue;
+                    if (str.length() < MIN_LEN || str.length() > MAX_LEN)
+                        return 0;
+
+                    auto &owner = claimed[slot(key(str.data(), str.length()), seed)];
+                    if (owner == seed)
+                    {
+                        perfect = false;
+                        break;
+                    }
+                    owner = seed;
+                }
+
+                if (perfect)
+                    return seed;
+            }
+            return 0;
+        }
+
+        static constexpr uint32_t SEED = find_seed();
+        static_assert(SEED != 0, "token_map words must fit [MIN_LEN, MAX_LEN] and hash perfectly");
+        static_assert(std::size(token_map) < 0xFF, "slot entries are stored as uint8_t");
+
+        /* token_map index + 1 per slot, 0 = empty */
+        static constexpr std::array<uint8_t, SLOTS> slots = []
+        {
+            std::array<uint8_t, SLOTS> table {};
+            for (size_t i = 0; i < std::size(token_map); ++i)
+            {
+                if (const auto &str = token_map[i].first; is_word(str))
+                    table[slot(key(str.data(), str.length()), SEED)] = static_cast<uint8_t>(i + 1);
+            }
+            return table;
+        }();
+    }
+
+    /* keyword, builtin type or annotation spelled by [s, s + len); IDENTIFIER otherwise */
+    constexpr TokenType lookup_keyword(const char *s, const size_t len)
+    {
+        if (len < keyword_hash::MIN_LEN || len > keyword_hash::MAX_LEN)
+            return TokenType::IDENTIFIER;
+
+        const uint8_t entry = keyword_hash::slots[keyword_hash::slot(keyword_hash::key(s, len), keyword_hash::SEED)];
+        if (!entry)
+            return TokenType::IDENTIFIER;
+
+        const auto &[str, type] = token_map[entry - 1];
+        return str == std::string_view(s, len) ? type : TokenType::IDENTIFIER;
+    }
+
     static constexpr auto create_reverse_map()
     {
         std::array<std::string_view, static_cast<size_t>(TokenType::END_OF_FILE) + 1> map {};
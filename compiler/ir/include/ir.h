@@ -0,0 +1,153 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <vector>
+#include <compiler/analysis/include/constants.h>
+#include <compiler/analysis/include/types.h>
+
+namespace klr::compiler
+{
+    class Interner;
+
+    /* what an instruction computes; a and b are IRModule's operand columns */
+    enum class IROp : uint8_t
+    {
+        UNDEF,  /* a value nothing defines, e.g. for code the IR cannot express yet */
+        CONST,  /* a: index into the ConstantPool */
+        STRING, /* a: atom of the string's text */
+        PARAM,  /* a: parameter index */
+
+        /* a, b: values of the same type; signedness comes from the type */
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        REM,
+        AND,
+        OR,
+        XOR,
+        SHL,
+        SHR,
+
+        /* a, b: values of the same type; the result is bool */
+        EQ,
+        NE,
+        LT,
+        LE,
+        GT,
+        GE,
+
+        /* a: value */
+        NEG,
+        NOT,   /* bool */
+        COMPL, /* bitwise */
+        CAST,  /* to the instruction's type */
+
+        CALL, /* a: first entry in extra, b: count; the callee's function index, then the arguments */
+        PHI,  /* a: first entry in extra, b: count; one value per predecessor, in IRBlock order */
+
+        /* terminators, always and only last in their block; the targets are the block's successors */
+        JUMP,
+        BRANCH, /* a: bool value; to successor 0 if true, 1 if false */
+        RETURN, /* a: value, IRModule::NONE in a void function */
+    };
+
+    /* a run of instructions ending in a terminator; phis come first */
+    struct IRBlock
+    {
+        uint32_t first; /* instruction */
+        uint32_t count;
+        uint32_t preds; /* first entry in IRModule::edges */
+        uint32_t pred_count;
+        uint32_t succs[2]; /* IRModule::NONE when absent */
+    };
+
+    struct IRFunction
+    {
+        uint32_t node; /* the FUNCTION in the AST */
+        uint32_t atom; /* its name */
+        TypeId type;   /* its signature */
+        uint32_t first_block;
+        uint32_t block_count;
+        uint32_t first; /* instruction */
+        uint32_t count;
+    };
+
+    /*
+     * a module in SSA form
+     *
+     * every instruction of every function is a row across flat columns,
+     * like the AST's, and the value an instruction defines is named by its
+     * row index, with its type in `types`. a function's blocks, and a
+     * block's instructions, are contiguous index ranges, so a pass over a
+     * function is a loop over integers. operand lists that do not fit in a
+     * and b (calls, phis) live in the shared `extra` pool; a block's
+     * predecessors live in `edges`
+     *
+     * made by IRLowering; check it with verify()
+     */
+    class IRModule
+    {
+    public:
+        static constexpr uint32_t NONE = ~0U;
+
+        std::pmr::vector<IROp> ops;
+        std::pmr::vector<TypeId> types;
+        std::pmr::vector<uint32_t> a;
+        std::pmr::vector<uint32_t> b;
+
+        std::pmr::vector<uint32_t> extra;
+        std::pmr::vector<uint32_t> edges; /* block indexes */
+        std::pmr::vector<IRBlock> blocks;
+        std::pmr::vector<IRFunction> functions;
+
+        explicit IRModule(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+        [[nodiscard]] size_t size() const
+        {
+            return ops.size();
+        }
+
+        /* the entries of a CALL or PHI */
+        [[nodiscard]] std::span<const uint32_t> list(const uint32_t inst) const
+        {
+            return { extra.data() + a[inst], b[inst] };
+        }
+
+        [[nodiscard]] std::span<const uint32_t> preds(const uint32_t block) const
+        {
+            return { edges.data() + blocks[block].preds, blocks[block].pred_count };
+        }
+
+        [[nodiscard]] static bool is_terminator(const IROp op)
+        {
+            return op >= IROp::JUMP;
+        }
+
+        /* how many of a and b hold values */
+        [[nodiscard]] static uint32_t value_operands(IROp op);
+
+        /*
+         * as text, e.g. `%2: bool = lt %0, %1`; values are numbered from %0
+         * and blocks from b0 within each function. names need the interner
+         * the atoms came from
+         */
+        void dump(std::ostream &os, const TypeTable &table, const ConstantPool &constants,
+                  const Interner *names = nullptr) const;
+
+        /* heap bytes held by the columns, capacity included */
+        [[nodiscard]] size_t memory_bytes() const;
+
+        [[nodiscard]] static const char *op_to_string(IROp op);
+    };
+
+    /* every broken invariant found, one message each; empty if the module is well formed */
+    [[nodiscard]] std::vector<std::string> verify(const IRModule &module, const TypeTable &table);
+}
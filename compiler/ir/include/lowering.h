@@ -0,0 +1,211 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+#include <compiler/analysis/include/ast.h>
+#include <compiler/analysis/include/checker.h>
+#include <compiler/analysis/include/constants.h>
+#include <compiler/analysis/include/symbols.h>
+#include <compiler/interfaces/include/diagnostics.h>
+#include <compiler/ir/include/ir.h>
+
+namespace klr::compiler
+{
+    /*
+     * AST to SSA, one function at a time
+     *
+     * the source only has structured control flow, so SSA is built on the
+     * way down instead of from a dominance frontier: each local has one
+     * current value, every edge into a join carries a snapshot of those
+     * values, and a join gets a phi for each local the snapshots disagree
+     * on. a loop header gets a phi per local up front, since its back edges
+     * are lowered after it; the ones that turn out trivial are removed when
+     * the function is finished, and its instructions compacted
+     *
+     * statements and expressions are lowered on a heap stack of tasks
+     * rather than by recursion, so neither deep nesting nor a long operator
+     * chain can run out of native stack
+     *
+     * expects a module that checked without errors, with constants folded.
+     * named functions are lowered, except generic ones, which wait for
+     * instantiation; lambdas, globals other than constants, strings beyond
+     * literals, arrays, pointers and methods are reported as E0017 and
+     * become undef
+     */
+    class IRLowering
+    {
+    public:
+        /* the tokens are the ones the AST was parsed from, see Parser::get_tokens() */
+        IRLowering(IRModule &module, const AST &ast, const SymbolTable &symbols, const TypeTable &table,
+                   const TypeChecker &checker, const ConstantPool &constants, const TokenList &tokens,
+                   std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+        /* appends every named function of the AST to the module, in source order */
+        void lower();
+
+        [[nodiscard]] const std::pmr::vector<Diagnostic> &get_diagnostics() const
+        {
+            return diagnostics;
+        }
+
+    private:
+        static constexpr uint32_t NONE = IRModule::NONE;
+
+        /* an edge into a join: the block it leaves and the locals' values at that point, in `saved` */
+        struct Incoming
+        {
+            uint32_t block;
+            uint32_t snapshot;
+        };
+
+        /* where a construct resumes; each names what was just lowered */
+        enum class Step : uint8_t
+        {
+            STATEMENT,
+            BLOCK, /* the child at `at`, or none left */
+            DECL,
+            RETURN,
+            DISCARD,
+            IF_CONDITION,
+            IF_THEN,
+            IF_ELSE,
+            WHILE_CONDITION,
+            WHILE_BODY,
+            FOR_INIT,
+            FOR_CONDITION,
+            FOR_BODY,
+            FOR_STEP,
+            EXPRESSION,
+            UNARY,
+            CAST,
+            ASSIGN,
+            BINARY,
+            LOGICAL_LEFT,
+            LOGICAL_RIGHT,
+            TERNARY_CONDITION,
+            TERNARY_THEN,
+            TERNARY_ELSE,
+            CALL,
+        };
+
+        /* a node on the work stack and what a construct keeps between its steps */
+        struct Task
+        {
+            uint32_t node;
+            Step step;
+            uint32_t n = 0;     /* locals in scope at the construct */
+            uint32_t at = 0;    /* its first block; a BLOCK's next child */
+            uint32_t mark = 0;  /* its first entry in incoming; for a FOR, the locals outside it */
+            Incoming edge = {}; /* the branch into it, a loop's entry, the edge skipping a logical's right side */
+            Incoming test = {}; /* a loop's edge out of its condition */
+        };
+
+        struct Loop
+        {
+            uint32_t exit;
+            uint32_t next;      /* where `continue` goes */
+            uint32_t breaks;    /* first of its entries in breaks */
+            uint32_t continues; /* first of its entries in continues */
+            uint32_t locals;    /* locals in scope at the loop */
+        };
+
+        IRModule &module;
+        const AST &ast;
+        const SymbolTable &symbols;
+        const TypeTable &table;
+        const TypeChecker &checker;
+        const ConstantPool &constants;
+        const TokenList &tokens;
+
+        std::pmr::vector<Diagnostic> diagnostics;
+
+        /* per AST node: the slot of a local DECL, the index of a named FUNCTION */
+        std::pmr::vector<uint32_t> index_of;
+
+        /* the current value of each local in scope, by slot */
+        std::pmr::vector<uint32_t> defs;
+        std::pmr::vector<uint32_t> saved;
+
+        /* used as stacks, each construct taking what it pushed */
+        std::pmr::vector<Incoming> incoming;
+        std::pmr::vector<Incoming> breaks;
+        std::pmr::vector<Incoming> continues;
+        std::pmr::vector<Loop> loops;
+        std::pmr::vector<Task> work;
+        std::pmr::vector<uint32_t> values; /* of the expressions lowered and not yet used, innermost last */
+
+        /* finish() scratch: forward and order by instruction within the function, renumber by block */
+        std::pmr::vector<uint32_t> forward;
+        std::pmr::vector<uint32_t> order;
+        std::pmr::vector<uint32_t> renumber;
+        std::pmr::vector<IRBlock> layout;
+
+        uint32_t current = NONE; /* block being filled; NONE after a terminator, until the next join */
+        uint32_t function_first = 0;
+
+        void function(uint32_t node);
+
+        /* runs the work stack until it is empty */
+        void run();
+
+        void statement(const Task &task);
+
+        void if_statement(const Task &task);
+
+        void while_statement(const Task &task);
+
+        void for_statement(const Task &task);
+
+        void expression(const Task &task);
+
+        void binary(const Task &task);
+
+        void logical(const Task &task);
+
+        void ternary(const Task &task);
+
+        void call(const Task &task);
+
+        /* pops the value of the expression lowered last */
+        uint32_t take();
+
+        uint32_t load(uint32_t node);
+
+        void store(uint32_t target, uint32_t value);
+
+        /* reports node as E0017 and stands in an undef of its type */
+        uint32_t unsupported(uint32_t node);
+
+        uint32_t emit(IROp op, TypeId type, uint32_t a = NONE, uint32_t b = NONE);
+
+        uint32_t new_block();
+
+        /* makes block current, with these predecessors */
+        void start(uint32_t block, std::span<const Incoming> preds);
+
+        void jump(uint32_t target);
+
+        void branch(uint32_t condition, uint32_t if_true, uint32_t if_false);
+
+        /* the values of the first n locals */
+        uint32_t snapshot(uint32_t n);
+
+        void restore(uint32_t snapshot, uint32_t n);
+
+        /* starts block with phis for whatever the first n locals disagree on; false if nothing flows in */
+        bool merge(uint32_t block, std::span<const Incoming> preds, uint32_t n);
+
+        /* fills in a loop header's predecessors and the operands of its phis, one per local */
+        void close_header(uint32_t header, Incoming entry, std::span<const Incoming> back, uint32_t n);
+
+        /* drops trivial phis, unstarted blocks, and lays the blocks out in order */
+        void finish(IRFunction &function);
+
+        uint32_t resolve(uint32_t value) const;
+    };
+}
@@ -0,0 +1,188 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/ir/include/ir.h>
+#include <compiler/memory/include/interner.h>
+
+namespace klr::compiler
+{
+    IRModule::IRModule(std::pmr::memory_resource *resource) : ops(resource), types(resource), a(resource)
+                                                            , b(resource), extra(resource), edges(resource)
+                                                            , blocks(resource), functions(resource) {}
+
+    uint32_t IRModule::value_operands(const IROp op)
+    {
+        if (op >= IROp::ADD && op <= IROp::GE)
+            return 2;
+        if ((op >= IROp::NEG && op <= IROp::CAST) || op == IROp::BRANCH || op == IROp::RETURN)
+            return 1;
+        return 0;
+    }
+
+    void IRModule::dump(std::ostream &os, const TypeTable &table, const ConstantPool &constants,
+                        const Interner *names) const
+    {
+        const auto name = [&](const uint32_t atom)
+        {
+            return names ? std::string(names->str(atom)) : "#" + std::to_string(atom);
+        };
+
+        for (const IRFunction &function: functions)
+        {
+            /* `function(i32) -> i32` with the name spliced in */
+            os << "function " << name(function.atom) << table.to_string(function.type, names).substr(8) << "\n";
+
+            const auto value = [&](const uint32_t inst)
+            {
+                return inst == NONE ? std::string("none") : "%" + std::to_string(inst - function.first);
+            };
+            const auto block = [&](const uint32_t index)
+            {
+                return "b" + std::to_string(index - function.first_block);
+            };
+
+            for (uint32_t bi = function.first_block; bi < function.first_block + function.block_count; ++bi)
+            {
+                os << block(bi) << ":";
+                for (uint32_t i = 0; i < blocks[bi].pred_count; ++i)
+                    os << (i ? ", " : " <- ") << block(preds(bi)[i]);
+                os << "\n";
+
+                const IRBlock &current = blocks[bi];
+                for (uint32_t inst = current.first; inst < current.first + current.count; ++inst)
+                {
+                    const IROp op = ops[inst];
+                    os << "    ";
+                    if (!is_terminator(op))
+                        os << value(inst) << ": " << table.to_string(types[inst], names) << " = ";
+                    os << op_to_string(op);
+
+                    switch (op)
+                    {
+                        case IROp::CONST:
+                            os << " " << constants.to_string(a[inst]);
+                            break;
+                        case IROp::STRING:
+                            os << " " << (names ? "\"" + name(a[inst]) + "\"" : name(a[inst]));
+                            break;
+                        case IROp::PARAM:
+                            os << " " << a[inst];
+                            break;
+                        case IROp::CALL:
+                        {
+                            const auto entries = list(inst);
+                            os << " " << name(functions[entries[0]].atom) << "(";
+                            for (size_t i = 1; i < entries.size(); ++i)
+                                os << (i > 1 ? ", " : "") << value(entries[i]);
+                            os << ")";
+                            break;
+                        }
+                        case IROp::PHI:
+                        {
+                            const auto entries = list(inst);
+                            for (size_t i = 0; i < entries.size(); ++i)
+                                os << (i ? ", [" : " [") << value(entries[i]) << ", " << block(preds(bi)[i]) << "]";
+                            break;
+                        }
+                        case IROp::JUMP:
+                            os << " " << block(current.succs[0]);
+                            break;
+                        case IROp::BRANCH:
+                            os << " " << value(a[inst]) << ", " << block(current.succs[0]) << ", "
+                                    << block(current.succs[1]);
+                            break;
+                        case IROp::RETURN:
+                            if (a[inst] != NONE)
+                                os << " " << value(a[inst]);
+                            break;
+                        default:
+                        {
+                            const uint32_t count = value_operands(op);
+                            if (count > 0)
+                                os << " " << value(a[inst]);
+                            if (count > 1)
+                                os << ", " << value(b[inst]);
+                            break;
+                        }
+                    }
+                    os << "\n";
+                }
+            }
+            os << "\n";
+        }
+    }
+
+    size_t IRModule::memory_bytes() const
+    {
+        return ops.capacity() * sizeof(IROp) +
+               (types.capacity() + a.capacity() + b.capacity() + extra.capacity() + edges.capacity()) *
+               sizeof(uint32_t) + blocks.capacity() * sizeof(IRBlock) + functions.capacity() * sizeof(IRFunction);
+    }
+
+    const char *IRModule::op_to_string(const IROp op)
+    {
+        switch (op)
+        {
+            case IROp::UNDEF:
+                return "undef";
+            case IROp::CONST:
+                return "const";
+            case IROp::STRING:
+                return "string";
+            case IROp::PARAM:
+                return "param";
+            case IROp::ADD:
+                return "add";
+            case IROp::SUB:
+                return "sub";
+            case IROp::MUL:
+                return "mul";
+            case IROp::DIV:
+                return "div";
+            case IROp::REM:
+                return "rem";
+            case IROp::AND:
+                return "and";
+            case IROp::OR:
+                return "or";
+            case IROp::XOR:
+                return "xor";
+            case IROp::SHL:
+                return "shl";
+            case IROp::SHR:
+                return "shr";
+            case IROp::EQ:
+                return "eq";
+            case IROp::NE:
+                return "ne";
+            case IROp::LT:
+                return "lt";
+            case IROp::LE:
+                return "le";
+            case IROp::GT:
+                return "gt";
+            case IROp::GE:
+                return "ge";
+            case IROp::NEG:
+                return "neg";
+            case IROp::NOT:
+                return "not";
+            case IROp::COMPL:
+                return "compl";
+            case IROp::CAST:
+                return "cast";
+            case IROp::CALL:
+                return "call";
+            case IROp::PHI:
+                return "phi";
+            case IROp::JUMP:
+                return "jump";
+            case IROp::BRANCH:
+                return "branch";
+            case IROp::RETURN:
+                return "return";
+            default:
+                return "unknown";
+        }
+    }
+}
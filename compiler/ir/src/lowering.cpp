@@ -0,0 +1,1144 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/ir/include/lowering.h>
+#include <algorithm>
+
+namespace klr::compiler
+{
+    namespace
+    {
+        /* plain and compound arithmetic; NONE for anything else */
+        IROp arithmetic(const TokenType op)
+        {
+            switch (op)
+            {
+                case TokenType::PLUS:
+                case TokenType::PLUS_EQ:
+                    return IROp::ADD;
+                case TokenType::MINUS:
+                case TokenType::MINUS_EQ:
+                    return IROp::SUB;
+                case TokenType::STAR:
+                case TokenType::STAR_EQ:
+                    return IROp::MUL;
+                case TokenType::SLASH:
+                case TokenType::SLASH_EQ:
+                    return IROp::DIV;
+                case TokenType::PERCENT:
+                case TokenType::PERCENT_EQ:
+                    return IROp::REM;
+                case TokenType::AND:
+                case TokenType::AND_EQ:
+                    return IROp::AND;
+                case TokenType::OR:
+                case TokenType::OR_EQ:
+                    return IROp::OR;
+                case TokenType::XOR:
+                case TokenType::XOR_EQ:
+                    return IROp::XOR;
+                case TokenType::LEFT_SHIFT:
+                case TokenType::LEFT_SHIFT_EQ:
+                    return IROp::SHL;
+                case TokenType::RIGHT_SHIFT:
+                case TokenType::RIGHT_SHIFT_EQ:
+                    return IROp::SHR;
+                case TokenType::EQ:
+                    return IROp::EQ;
+                case TokenType::NE:
+                    return IROp::NE;
+                case TokenType::LESS:
+                    return IROp::LT;
+                case TokenType::LE:
+                    return IROp::LE;
+                case TokenType::GREATER:
+                    return IROp::GT;
+                case TokenType::GE:
+                    return IROp::GE;
+                default:
+                    return IROp::UNDEF;
+            }
+        }
+
+        bool is_compound(const TokenType op)
+        {
+            return op >= TokenType::PLUS_EQ && op <= TokenType::RIGHT_SHIFT_EQ && op != TokenType::LEFT_SHIFT &&
+                   op != TokenType::RIGHT_SHIFT;
+        }
+    }
+
+    IRLowering::IRLowering(IRModule &module, const AST &ast, const SymbolTable &symbols, const TypeTable &table,
+                           const TypeChecker &checker, const ConstantPool &constants, const TokenList &tokens,
+                           std::pmr::memory_resource *resource) : module(module), ast(ast), symbols(symbols)
+                                                                , table(table), checker(checker)
+                                                                , constants(constants), tokens(tokens)
+                                                                , diagnostics(resource), index_of(resource)
+                                                                , defs(resource), saved(resource)
+                                                                , incoming(resource), breaks(resource)
+                                                                , continues(resource), loops(resource)
+                                                                , work(resource), values(resource)
+                                                                , forward(resource), order(resource)
+                                                                , renumber(resource), layout(resource) {}
+
+    void IRLowering::lower()
+    {
+        diagnostics.clear();
+        if (ast.size() == 0)
+            return;
+        index_of.assign(ast.size(), NONE);
+
+        /* numbered up front, so a call can name a function defined further down */
+        const auto first = static_cast<uint32_t>(module.functions.size());
+        for (const uint32_t child: ast.children(0))
+        {
+            if (ast.types[child] == ASTNodeType::FUNCTION &&
+                !(table[checker.type_of(child)].flags & TypeTable::HAS_GENERIC))
+            {
+                index_of[child] = static_cast<uint32_t>(module.functions.size());
+                module.functions.push_back({ child, ast.atoms[child], TypeTable::ERROR, 0, 0, 0, 0 });
+            }
+        }
+
+        for (uint32_t index = first; index < module.functions.size(); ++index)
+            function(module.functions[index].node);
+    }
+
+    void IRLowering::function(const uint32_t node)
+    {
+        IRFunction &function = module.functions[index_of[node]];
+        function.type = checker.type_of(node);
+        function.first_block = static_cast<uint32_t>(module.blocks.size());
+        function.first = static_cast<uint32_t>(module.size());
+        function_first = function.first;
+
+        defs.clear();
+        saved.clear();
+        start(new_block(), {});
+
+        uint32_t param = 0;
+        for (const uint32_t child: ast.children(node))
+        {
+            if (ast.types[child] != ASTNodeType::DECL)
+                continue;
+            index_of[child] = static_cast<uint32_t>(defs.size());
+            defs.push_back(emit(IROp::PARAM, checker.type_of(child), param++));
+        }
+
+        if (const uint32_t body = ast.data[node].function.body)
+        {
+            work.push_back({ .node = body, .step = Step::STATEMENT });
+            run();
+        }
+
+        /* falling off the end; the checker does not insist on a return yet */
+        if (current != NONE)
+        {
+            const TypeId returns = table[function.type].kind == TypeKind::FUNCTION
+                                       ? table.args(function.type)[0]
+                                       : TypeTable::VOID;
+            const uint32_t value = returns == TypeTable::VOID ? NONE : emit(IROp::UNDEF, returns);
+            emit(IROp::RETURN, TypeTable::VOID, value);
+            current = NONE;
+        }
+        finish(function);
+    }
+
+    // one loop over a heap stack, like SymbolTable::resolve, so nesting and
+    // long operator chains are bounded by memory rather than the native
+    // stack. a construct pushes itself back with its next step under
+    // whatever it waits for
+    void IRLowering::run()
+    {
+        while (!work.empty())
+        {
+            const Task task = work.back();
+            work.pop_back();
+
+            switch (task.step)
+            {
+                case Step::STATEMENT:
+                case Step::BLOCK:
+                case Step::DECL:
+                case Step::RETURN:
+                case Step::DISCARD:
+                    statement(task);
+                    break;
+                case Step::IF_CONDITION:
+                case Step::IF_THEN:
+                case Step::IF_ELSE:
+                    if_statement(task);
+                    break;
+                case Step::WHILE_CONDITION:
+                case Step::WHILE_BODY:
+                    while_statement(task);
+                    break;
+                case Step::FOR_INIT:
+                case Step::FOR_CONDITION:
+                case Step::FOR_BODY:
+                case Step::FOR_STEP:
+                    for_statement(task);
+                    break;
+                case Step::EXPRESSION:
+                case Step::UNARY:
+                case Step::CAST:
+                    expression(task);
+                    break;
+                case Step::ASSIGN:
+                case Step::BINARY:
+                    binary(task);
+                    break;
+                case Step::LOGICAL_LEFT:
+                case Step::LOGICAL_RIGHT:
+                    logical(task);
+                    break;
+                case Step::TERNARY_CONDITION:
+                case Step::TERNARY_THEN:
+                case Step::TERNARY_ELSE:
+                    ternary(task);
+                    break;
+                case Step::CALL:
+                    call(task);
+                    break;
+            }
+        }
+    }
+
+    void IRLowering::statement(const Task &task)
+    {
+        const uint32_t node = task.node;
+        switch (task.step)
+        {
+            case Step::BLOCK:
+            {
+                /* the rest cannot run; locals declared inside go out of scope with it */
+                if (!task.at || current == NONE)
+                {
+                    defs.resize(task.n);
+                    return;
+                }
+                work.push_back({ .node = node, .step = Step::BLOCK, .n = task.n, .at = ast.next_sibling[task.at] });
+                work.push_back({ .node = task.at, .step = Step::STATEMENT });
+                return;
+            }
+            case Step::DECL:
+                index_of[node] = static_cast<uint32_t>(defs.size());
+                defs.push_back(take());
+                return;
+            case Step::RETURN:
+                emit(IROp::RETURN, TypeTable::VOID, take());
+                current = NONE;
+                return;
+            case Step::DISCARD:
+                take();
+                return;
+            default:
+                break;
+        }
+
+        switch (ast.types[node])
+        {
+            case ASTNodeType::BLOCK:
+                work.push_back({
+                    .node = node, .step = Step::BLOCK, .n = static_cast<uint32_t>(defs.size()),
+                    .at = ast.first_child[node]
+                });
+                break;
+
+            case ASTNodeType::DECL:
+            {
+                const uint32_t init = ast.data[node].decl.init_node;
+                work.push_back({ .node = node, .step = Step::DECL });
+                if (init)
+                    work.push_back({ .node = init, .step = Step::EXPRESSION });
+                else
+                    values.push_back(emit(IROp::UNDEF, checker.type_of(node)));
+                break;
+            }
+
+            case ASTNodeType::IF:
+                if_statement(task);
+                break;
+            case ASTNodeType::WHILE:
+                while_statement(task);
+                break;
+            case ASTNodeType::FOR:
+                for_statement(task);
+                break;
+
+            case ASTNodeType::RETURN:
+            {
+                if (!ast.first_child[node])
+                {
+                    emit(IROp::RETURN, TypeTable::VOID);
+                    current = NONE;
+                    break;
+                }
+                work.push_back({ .node = node, .step = Step::RETURN });
+                work.push_back({ .node = ast.first_child[node], .step = Step::EXPRESSION });
+                break;
+            }
+
+            case ASTNodeType::BREAK:
+            case ASTNodeType::CONTINUE:
+            {
+                /* the parser accepts both outside loops */
+                if (loops.empty())
+                {
+                    unsupported(node);
+                    break;
+                }
+
+                const Loop &loop = loops.back();
+                const bool is_break = ast.types[node] == ASTNodeType::BREAK;
+                (is_break ? breaks : continues).push_back({ current, snapshot(loop.locals) });
+                jump(is_break ? loop.exit : loop.next);
+                break;
+            }
+
+            case ASTNodeType::ERROR:
+                break;
+
+            default:
+                work.push_back({ .node = node, .step = Step::DISCARD });
+                work.push_back({ .node = node, .step = Step::EXPRESSION });
+                break;
+        }
+    }
+
+    void IRLowering::if_statement(const Task &task)
+    {
+        const uint32_t node = task.node;
+        const uint32_t condition = ast.first_child[node];
+        const uint32_t then_branch = ast.next_sibling[condition];
+        const uint32_t else_branch = ast.next_sibling[then_branch];
+
+        /* the blocks are then, else if there is one, and the join */
+        const uint32_t n = task.n;
+        const Incoming head = task.edge;
+        const uint32_t join = task.at + (else_branch ? 2 : 1);
+        const auto leave = [&]
+        {
+            if (current == NONE)
+                return;
+            incoming.push_back({ current, snapshot(n) });
+            jump(join);
+        };
+
+        switch (task.step)
+        {
+            case Step::IF_CONDITION:
+            {
+                const uint32_t value = take();
+                const uint32_t then_block = new_block();
+                const uint32_t else_block = else_branch ? new_block() : NONE;
+                const uint32_t after = new_block();
+
+                const Incoming edge = { current, snapshot(n) };
+                branch(value, then_block, else_branch ? else_block : after);
+
+                start(then_block, { &edge, 1 });
+                work.push_back({
+                    .node = node, .step = Step::IF_THEN, .n = n, .at = then_block,
+                    .mark = static_cast<uint32_t>(incoming.size()), .edge = edge
+                });
+                work.push_back({ .node = then_branch, .step = Step::STATEMENT });
+                break;
+            }
+
+            case Step::IF_THEN:
+            {
+                leave();
+                restore(head.snapshot, n);
+                if (else_branch)
+                {
+                    start(task.at + 1, { &head, 1 });
+                    Task next = task;
+                    next.step = Step::IF_ELSE;
+                    work.push_back(next);
+                    work.push_back({ .node = else_branch, .step = Step::STATEMENT });
+                    break;
+                }
+
+                incoming.push_back(head);
+                merge(join, std::span(incoming).subspan(task.mark), n);
+                incoming.resize(task.mark);
+                break;
+            }
+
+            case Step::IF_ELSE:
+            {
+                leave();
+                merge(join, std::span(incoming).subspan(task.mark), n);
+                incoming.resize(task.mark);
+                break;
+            }
+
+            default:
+            {
+                work.push_back({ .node = node, .step = Step::IF_CONDITION, .n = static_cast<uint32_t>(defs.size()) });
+                work.push_back({ .node = condition, .step = Step::EXPRESSION });
+                break;
+            }
+        }
+    }
+
+    void IRLowering::while_statement(const Task &task)
+    {
+        const uint32_t node = task.node;
+        const uint32_t condition = ast.first_child[node];
+        const uint32_t body = ast.next_sibling[condition];
+
+        /* the blocks are header, body and exit */
+        const uint32_t n = task.n;
+        const uint32_t header = task.at;
+        switch (task.step)
+        {
+            case Step::WHILE_CONDITION:
+            {
+                const uint32_t value = take();
+                const Incoming test = { current, snapshot(n) };
+                branch(value, header + 1, header + 2);
+
+                loops.push_back({
+                    header + 2, header, static_cast<uint32_t>(breaks.size()),
+                    static_cast<uint32_t>(continues.size()), n
+                });
+                start(header + 1, { &test, 1 });
+                Task next = task;
+                next.step = Step::WHILE_BODY;
+                next.test = test;
+                work.push_back(next);
+                work.push_back({ .node = body, .step = Step::STATEMENT });
+                break;
+            }
+
+            case Step::WHILE_BODY:
+            {
+                if (current != NONE)
+                {
+                    continues.push_back({ current, snapshot(n) });
+                    jump(header);
+                }
+
+                const Loop loop = loops.back();
+                loops.pop_back();
+                close_header(header, task.edge, std::span(continues).subspan(loop.continues), n);
+                continues.resize(loop.continues);
+
+                breaks.insert(breaks.begin() + loop.breaks, task.test);
+                merge(loop.exit, std::span(breaks).subspan(loop.breaks), n);
+                breaks.resize(loop.breaks);
+                break;
+            }
+
+            default:
+            {
+                const auto locals = static_cast<uint32_t>(defs.size());
+                const uint32_t first = new_block();
+                new_block();
+                new_block();
+
+                const Incoming entry = { current, snapshot(locals) };
+                jump(first);
+                close_header(first, entry, {}, locals);
+
+                /* the condition can span blocks of its own */
+                work.push_back({
+                    .node = node, .step = Step::WHILE_CONDITION, .n = locals, .at = first, .edge = entry
+                });
+                work.push_back({ .node = condition, .step = Step::EXPRESSION });
+                break;
+            }
+        }
+    }
+
+    void IRLowering::for_statement(const Task &task)
+    {
+        const uint32_t node = task.node;
+        const auto [init, condition, step] = ast.data[node].for_stmt;
+        const uint32_t body = ast.last_child[node];
+
+        /* the blocks are header, body, step if there is one, and exit; mark holds the locals outside the loop */
+        const uint32_t n = task.n;
+        const uint32_t header = task.at;
+        const uint32_t step_block = step ? header + 2 : NONE;
+        const auto leave = [&](const Loop &loop)
+        {
+            if (condition)
+                breaks.insert(breaks.begin() + loop.breaks, task.test);
+            merge(loop.exit, std::span(breaks).subspan(loop.breaks), n);
+            breaks.resize(loop.breaks);
+            defs.resize(task.mark);
+        };
+
+        switch (task.step)
+        {
+            case Step::FOR_INIT:
+            {
+                const auto locals = static_cast<uint32_t>(defs.size());
+                const uint32_t first = new_block();
+                new_block();
+                if (step)
+                    new_block();
+                new_block();
+
+                const Incoming entry = { current, snapshot(locals) };
+                jump(first);
+                close_header(first, entry, {}, locals);
+
+                /* without a condition the loop only ends by break or return */
+                work.push_back({
+                    .node = node, .step = Step::FOR_CONDITION, .n = locals, .at = first, .mark = task.mark,
+                    .edge = entry
+                });
+                if (condition)
+                    work.push_back({ .node = condition, .step = Step::EXPRESSION });
+                break;
+            }
+
+            case Step::FOR_CONDITION:
+            {
+                const uint32_t exit = header + (step ? 3 : 2);
+                const uint32_t value = condition ? take() : NONE;
+                const Incoming test = { current, snapshot(n) };
+                if (condition)
+                    branch(value, header + 1, exit);
+                else
+                    jump(header + 1);
+
+                loops.push_back({
+                    exit, step ? step_block : header, static_cast<uint32_t>(breaks.size()),
+                    static_cast<uint32_t>(continues.size()), n
+                });
+                start(header + 1, { &test, 1 });
+                Task next = task;
+                next.step = Step::FOR_BODY;
+                next.test = test;
+                work.push_back(next);
+                work.push_back({ .node = body, .step = Step::STATEMENT });
+                break;
+            }
+
+            case Step::FOR_BODY:
+            {
+                if (current != NONE)
+                {
+                    continues.push_back({ current, snapshot(n) });
+                    jump(step ? step_block : header);
+                }
+
+                /* every way around the loop passes through the step; the loop stays open while it is lowered */
+                if (step && merge(step_block, std::span(continues).subspan(loops.back().continues), n))
+                {
+                    Task next = task;
+                    next.step = Step::FOR_STEP;
+                    work.push_back(next);
+                    work.push_back({ .node = step, .step = Step::EXPRESSION });
+                    break;
+                }
+
+                const Loop loop = loops.back();
+                loops.pop_back();
+                if (step)
+                {
+                    continues.resize(loop.continues);
+                    close_header(header, task.edge, {}, n);
+                }
+                else
+                {
+                    close_header(header, task.edge, std::span(continues).subspan(loop.continues), n);
+                    continues.resize(loop.continues);
+                }
+                leave(loop);
+                break;
+            }
+
+            case Step::FOR_STEP:
+            {
+                take();
+                const Incoming back = { current, snapshot(n) };
+                jump(header);
+
+                const Loop loop = loops.back();
+                loops.pop_back();
+                continues.resize(loop.continues);
+                close_header(header, task.edge, { &back, 1 }, n);
+                leave(loop);
+                break;
+            }
+
+            default:
+            {
+                /* the header's declaration is scoped to the loop */
+                work.push_back({ .node = node, .step = Step::FOR_INIT, .mark = static_cast<uint32_t>(defs.size()) });
+                if (init)
+                    work.push_back({ .node = init, .step = Step::STATEMENT });
+                break;
+            }
+        }
+    }
+
+    void IRLowering::expression(const Task &task)
+    {
+        const uint32_t node = task.node;
+        switch (task.step)
+        {
+            case Step::UNARY:
+            {
+                const TokenType op = ast.data[node].unary_expr.op;
+                const IROp unary = op == TokenType::MINUS ? IROp::NEG : op == TokenType::BANG ? IROp::NOT : IROp::COMPL;
+                values.push_back(emit(unary, checker.type_of(node), take()));
+                return;
+            }
+            case Step::CAST:
+            {
+                const uint32_t value = take();
+                const TypeId type = checker.type_of(node);
+                values.push_back(module.types[value] == type ? value : emit(IROp::CAST, type, value));
+                return;
+            }
+            default:
+                break;
+        }
+
+        switch (ast.types[node])
+        {
+            case ASTNodeType::LITERAL:
+            {
+                if (const uint32_t constant = ast.data[node].literal.constant)
+                    values.push_back(emit(IROp::CONST, constants[constant].type, constant));
+                else if (ast.tokens[node].type == TokenType::STR_LITERAL)
+                    values.push_back(emit(IROp::STRING, TypeTable::STRING, ast.atoms[node]));
+                else
+                    values.push_back(unsupported(node));
+                break;
+            }
+
+            case ASTNodeType::IDENTIFIER:
+                values.push_back(load(node));
+                break;
+            case ASTNodeType::BINARY_EXPR:
+                binary(task);
+                break;
+            case ASTNodeType::TERNARY:
+                ternary(task);
+                break;
+            case ASTNodeType::CALL:
+                call(task);
+                break;
+
+            case ASTNodeType::UNARY_EXPR:
+            {
+                const auto [operand, op] = ast.data[node].unary_expr;
+                if (op != TokenType::MINUS && op != TokenType::BANG && op != TokenType::TILDE)
+                {
+                    values.push_back(unsupported(node));
+                    break;
+                }
+                work.push_back({ .node = node, .step = Step::UNARY });
+                work.push_back({ .node = operand, .step = Step::EXPRESSION });
+                break;
+            }
+
+            case ASTNodeType::CAST_EXPR:
+                work.push_back({ .node = node, .step = Step::CAST });
+                work.push_back({ .node = ast.data[node].cast_expr.operand, .step = Step::EXPRESSION });
+                break;
+
+            default:
+                values.push_back(unsupported(node));
+                break;
+        }
+    }
+
+    void IRLowering::binary(const Task &task)
+    {
+        const uint32_t node = task.node;
+        const auto [left, right, op] = ast.data[node].binary_expr;
+        switch (task.step)
+        {
+            case Step::ASSIGN:
+                store(left, values.back());
+                return;
+            case Step::BINARY:
+            {
+                const uint32_t rhs = take();
+                const uint32_t lhs = take();
+                const uint32_t value = emit(arithmetic(op), checker.type_of(node), lhs, rhs);
+                if (is_compound(op))
+                    store(left, value);
+                values.push_back(value);
+                return;
+            }
+            default:
+                break;
+        }
+
+        if (op == TokenType::LOGICAL_AND || op == TokenType::LOGICAL_OR)
+        {
+            logical(task);
+            return;
+        }
+
+        if (op == TokenType::EQUAL)
+        {
+            work.push_back({ .node = node, .step = Step::ASSIGN });
+            work.push_back({ .node = right, .step = Step::EXPRESSION });
+            return;
+        }
+
+        /* only numbers and bools so far; strings and user types need a runtime */
+        const TypeKind operands = table[checker.type_of(left)].kind;
+        if (arithmetic(op) == IROp::UNDEF || !(TypeTable::is_integer(operands) || TypeTable::is_float(operands) ||
+                                               operands == TypeKind::BOOL))
+        {
+            values.push_back(unsupported(node));
+            return;
+        }
+
+        work.push_back({ .node = node, .step = Step::BINARY });
+        work.push_back({ .node = right, .step = Step::EXPRESSION });
+        work.push_back({ .node = left, .step = Step::EXPRESSION });
+    }
+
+    void IRLowering::logical(const Task &task)
+    {
+        /* the left side's value is the answer when the right side is skipped; it rides along as a local */
+        const uint32_t node = task.node;
+        const auto [left, right, op] = ast.data[node].binary_expr;
+        const uint32_t n = task.n;
+        switch (task.step)
+        {
+            case Step::LOGICAL_LEFT:
+            {
+                const auto locals = static_cast<uint32_t>(defs.size());
+                defs.push_back(take());
+
+                const uint32_t rhs_block = new_block();
+                const uint32_t join = new_block();
+                const Incoming skip = { current, snapshot(locals + 1) };
+                if (op == TokenType::LOGICAL_AND)
+                    branch(defs[locals], rhs_block, join);
+                else
+                    branch(defs[locals], join, rhs_block);
+
+                start(rhs_block, { &skip, 1 });
+                work.push_back({ .node = node, .step = Step::LOGICAL_RIGHT, .n = locals, .at = join, .edge = skip });
+                work.push_back({ .node = right, .step = Step::EXPRESSION });
+                break;
+            }
+
+            case Step::LOGICAL_RIGHT:
+            {
+                defs[n] = take();
+                const auto mark = static_cast<uint32_t>(incoming.size());
+                incoming.push_back(task.edge);
+                incoming.push_back({ current, snapshot(n + 1) });
+                jump(task.at);
+
+                merge(task.at, std::span(incoming).subspan(mark), n + 1);
+                incoming.resize(mark);
+                values.push_back(defs[n]);
+                defs.resize(n);
+                break;
+            }
+
+            default:
+            {
+                work.push_back({ .node = node, .step = Step::LOGICAL_LEFT });
+                work.push_back({ .node = left, .step = Step::EXPRESSION });
+                break;
+            }
+        }
+    }
+
+    void IRLowering::ternary(const Task &task)
+    {
+        const uint32_t node = task.node;
+        const uint32_t condition = ast.first_child[node];
+        const uint32_t then_branch = ast.next_sibling[condition];
+        const uint32_t else_branch = ast.next_sibling[then_branch];
+
+        /* the blocks are then, else and the join; each branch's value rides along as one more local */
+        const uint32_t n = task.n;
+        const Incoming head = task.edge;
+        const uint32_t join = task.at + 2;
+        switch (task.step)
+        {
+            case Step::TERNARY_CONDITION:
+            {
+                const auto locals = static_cast<uint32_t>(defs.size());
+                const uint32_t value = take();
+                const uint32_t then_block = new_block();
+                const uint32_t else_block = new_block();
+                new_block();
+                const Incoming edge = { current, snapshot(locals) };
+                branch(value, then_block, else_block);
+
+                start(then_block, { &edge, 1 });
+                work.push_back({
+                    .node = node, .step = Step::TERNARY_THEN, .n = locals, .at = then_block,
+                    .mark = static_cast<uint32_t>(incoming.size()), .edge = edge
+                });
+                work.push_back({ .node = then_branch, .step = Step::EXPRESSION });
+                break;
+            }
+
+            case Step::TERNARY_THEN:
+            {
+                defs.push_back(take());
+                incoming.push_back({ current, snapshot(n + 1) });
+                jump(join);
+
+                restore(head.snapshot, n);
+                start(task.at + 1, { &head, 1 });
+                Task next = task;
+                next.step = Step::TERNARY_ELSE;
+                work.push_back(next);
+                work.push_back({ .node = else_branch, .step = Step::EXPRESSION });
+                break;
+            }
+
+            case Step::TERNARY_ELSE:
+            {
+                defs.push_back(take());
+                incoming.push_back({ current, snapshot(n + 1) });
+                jump(join);
+
+                merge(join, std::span(incoming).subspan(task.mark), n + 1);
+                incoming.resize(task.mark);
+                values.push_back(defs[n]);
+                defs.resize(n);
+                break;
+            }
+
+            default:
+            {
+                work.push_back({ .node = node, .step = Step::TERNARY_CONDITION });
+                work.push_back({ .node = condition, .step = Step::EXPRESSION });
+                break;
+            }
+        }
+    }
+
+    void IRLowering::call(const Task &task)
+    {
+        const uint32_t node = task.node;
+        const uint32_t first_arg = ast.next_sibling[ast.first_child[node]];
+        if (task.step == Step::CALL)
+        {
+            /* the arguments' values are the last ones on the stack */
+            uint32_t count = 0;
+            for (uint32_t arg = first_arg; arg; arg = ast.next_sibling[arg])
+                ++count;
+
+            const auto first = static_cast<uint32_t>(module.extra.size());
+            module.extra.push_back(index_of[symbols.declaration(node)]);
+            module.extra.insert(module.extra.end(), values.end() - count, values.end());
+            values.resize(values.size() - count);
+            values.push_back(emit(IROp::CALL, checker.type_of(node), first,
+                                  static_cast<uint32_t>(module.extra.size()) - first));
+            return;
+        }
+
+        const uint32_t callee = symbols.declaration(node);
+        if (!callee || ast.types[callee] != ASTNodeType::FUNCTION || index_of[callee] == NONE ||
+            ast.parents[callee] != 0)
+        {
+            values.push_back(unsupported(node));
+            return;
+        }
+
+        /* arguments in source order: push them, then flip the pushed run */
+        work.push_back({ .node = node, .step = Step::CALL });
+        const size_t pushed = work.size();
+        for (uint32_t arg = first_arg; arg; arg = ast.next_sibling[arg])
+            work.push_back({ .node = arg, .step = Step::EXPRESSION });
+        std::reverse(work.begin() + static_cast<std::ptrdiff_t>(pushed), work.end());
+    }
+
+    uint32_t IRLowering::take()
+    {
+        const uint32_t value = values.back();
+        values.pop_back();
+        return value;
+    }
+
+    uint32_t IRLowering::load(const uint32_t node)
+    {
+        const uint32_t decl = symbols.declaration(node);
+        if (!decl || ast.types[decl] != ASTNodeType::DECL)
+            return unsupported(node);
+
+        /* a module-level constant, folded or it would not be one */
+        if (ast.parents[decl] == 0)
+        {
+            const uint32_t init = ast.data[decl].decl.init_node;
+            const bool is_const = (ast.data[decl].decl.flags & ASTNodeFlags::IS_CONST) == ASTNodeFlags::IS_CONST;
+            if (!is_const || !init || ast.types[init] != ASTNodeType::LITERAL || !ast.data[init].literal.constant)
+                return unsupported(node);
+            const uint32_t constant = ast.data[init].literal.constant;
+            return emit(IROp::CONST, constants[constant].type, constant);
+        }
+
+        const uint32_t slot = index_of[decl];
+        return slot < defs.size() ? defs[slot] : unsupported(node);
+    }
+
+    void IRLowering::store(const uint32_t target, const uint32_t value)
+    {
+        const uint32_t decl = symbols.declaration(target);
+        if (ast.types[target] != ASTNodeType::IDENTIFIER || !decl || ast.types[decl] != ASTNodeType::DECL ||
+            ast.parents[decl] == 0 || index_of[decl] >= defs.size())
+        {
+            unsupported(target);
+            return;
+        }
+        defs[index_of[decl]] = value;
+    }
+
+    uint32_t IRLowering::unsupported(const uint32_t node)
+    {
+        const auto it = std::ranges::lower_bound(tokens.starts, ast.tokens[node].start);
+        diagnostics.push_back({
+            .token = static_cast<offset_t>(it - tokens.starts.begin()),
+            .args = { 0, 0 },
+            .code = DiagCode::NOT_LOWERED,
+            .level = ErrorLevel::ERROR
+        });
+        return emit(IROp::UNDEF, checker.type_of(node));
+    }
+
+    uint32_t IRLowering::emit(const IROp op, const TypeId type, const uint32_t a, const uint32_t b)
+    {
+        const auto inst = static_cast<uint32_t>(module.size());
+        module.ops.push_back(op);
+        module.types.push_back(type);
+        module.a.push_back(a);
+        module.b.push_back(b);
+        ++module.blocks[current].count;
+        return inst;
+    }
+
+    uint32_t IRLowering::new_block()
+    {
+        const auto block = static_cast<uint32_t>(module.blocks.size());
+        module.blocks.push_back({ NONE, 0, 0, 0, { NONE, NONE } });
+        return block;
+    }
+
+    void IRLowering::start(const uint32_t block, const std::span<const Incoming> preds)
+    {
+        IRBlock &target = module.blocks[block];
+        target.first = static_cast<uint32_t>(module.size());
+        target.preds = static_cast<uint32_t>(module.edges.size());
+        target.pred_count = static_cast<uint32_t>(preds.size());
+        for (const Incoming &pred: preds)
+            module.edges.push_back(pred.block);
+        current = block;
+    }
+
+    void IRLowering::jump(const uint32_t target)
+    {
+        module.blocks[current].succs[0] = target;
+        emit(IROp::JUMP, TypeTable::VOID);
+        current = NONE;
+    }
+
+    void IRLowering::branch(const uint32_t condition, const uint32_t if_true, const uint32_t if_false)
+    {
+        module.blocks[current].succs[0] = if_true;
+        module.blocks[current].succs[1] = if_false;
+        emit(IROp::BRANCH, TypeTable::VOID, condition);
+        current = NONE;
+    }
+
+    uint32_t IRLowering::snapshot(const uint32_t n)
+    {
+        const auto at = static_cast<uint32_t>(saved.size());
+        saved.insert(saved.end(), defs.begin(), defs.begin() + n);
+        return at;
+    }
+
+    void IRLowering::restore(const uint32_t snapshot, const uint32_t n)
+    {
+        defs.assign(saved.begin() + snapshot, saved.begin() + snapshot + n);
+    }
+
+    bool IRLowering::merge(const uint32_t block, const std::span<const Incoming> preds, const uint32_t n)
+    {
+        if (preds.empty())
+        {
+            current = NONE;
+            return false;
+        }
+
+        start(block, preds);
+        restore(preds[0].snapshot, n);
+        for (uint32_t slot = 0; slot < n; ++slot)
+        {
+            const uint32_t first = defs[slot];
+            if (std::ranges::all_of(preds, [&](const Incoming &pred) { return saved[pred.snapshot + slot] == first; }))
+                continue;
+
+            const auto at = static_cast<uint32_t>(module.extra.size());
+            for (const Incoming &pred: preds)
+                module.extra.push_back(saved[pred.snapshot + slot]);
+            defs[slot] = emit(IROp::PHI, module.types[first], at, static_cast<uint32_t>(preds.size()));
+        }
+        return true;
+    }
+
+    void IRLowering::close_header(const uint32_t header, const Incoming entry, const std::span<const Incoming> back,
+                                  const uint32_t n)
+    {
+        /* first call opens the header with a phi per local; the second knows the back edges */
+        IRBlock &block = module.blocks[header];
+        if (block.first == NONE)
+        {
+            start(header, {});
+            for (uint32_t slot = 0; slot < n; ++slot)
+                defs[slot] = emit(IROp::PHI, module.types[defs[slot]], 0, 0);
+            return;
+        }
+
+        block.preds = static_cast<uint32_t>(module.edges.size());
+        block.pred_count = static_cast<uint32_t>(back.size() + 1);
+        module.edges.push_back(entry.block);
+        for (const Incoming &pred: back)
+            module.edges.push_back(pred.block);
+
+        for (uint32_t slot = 0; slot < n; ++slot)
+        {
+            const uint32_t phi = block.first + slot;
+            module.a[phi] = static_cast<uint32_t>(module.extra.size());
+            module.b[phi] = block.pred_count;
+            module.extra.push_back(saved[entry.snapshot + slot]);
+            for (const Incoming &pred: back)
+                module.extra.push_back(saved[pred.snapshot + slot]);
+        }
+    }
+
+    void IRLowering::finish(IRFunction &function)
+    {
+        const uint32_t first = function.first;
+        const auto end = static_cast<uint32_t>(module.size());
+        forward.assign(end - first, NONE);
+
+        /* a phi whose operands are all one value, or itself, is that value; removing one can expose another */
+        for (bool changed = true; changed;)
+        {
+            changed = false;
+            for (uint32_t inst = first; inst < end; ++inst)
+            {
+                if (module.ops[inst] != IROp::PHI || forward[inst - first] != NONE)
+                    continue;
+
+                uint32_t same = NONE;
+                bool trivial = true;
+                for (const uint32_t operand: module.list(inst))
+                {
+                    const uint32_t value = resolve(operand);
+                    if (value == inst || value == same)
+                        continue;
+                    if (same != NONE)
+                    {
+                        trivial = false;
+                        break;
+                    }
+                    same = value;
+                }
+                if (trivial && same != NONE)
+                {
+                    forward[inst - first] = same;
+                    changed = true;
+                }
+            }
+        }
+
+        /* blocks never started had nothing flowing in; the rest are laid out in the order they were filled */
+        const auto block_count = static_cast<uint32_t>(module.blocks.size()) - function.first_block;
+        order.assign(end - first, NONE);
+        for (uint32_t block = 0; block < block_count; ++block)
+        {
+            if (const uint32_t at = module.blocks[function.first_block + block].first; at != NONE)
+                order[at - first] = block;
+        }
+
+        renumber.assign(block_count, NONE);
+        layout.clear();
+        for (const uint32_t block: order)
+        {
+            if (block == NONE)
+                continue;
+            renumber[block] = static_cast<uint32_t>(layout.size());
+            layout.push_back(module.blocks[function.first_block + block]);
+        }
+
+        /* new instruction numbers, removed phis left out */
+        uint32_t kept = first;
+        for (uint32_t inst = first; inst < end; ++inst)
+            order[inst - first] = forward[inst - first] == NONE ? kept++ : NONE;
+        const auto value = [&](const uint32_t operand)
+        {
+            return operand == NONE ? NONE : order[resolve(operand) - first];
+        };
+
+        /* compacted in place: an instruction only ever moves down */
+        uint32_t at = first;
+        for (IRBlock &block: layout)
+        {
+            for (uint32_t &succ: block.succs)
+                succ = succ == NONE ? NONE : function.first_block + renumber[succ - function.first_block];
+            for (uint32_t edge = block.preds; edge < block.preds + block.pred_count; ++edge)
+                module.edges[edge] = function.first_block + renumber[module.edges[edge] - function.first_block];
+
+            const uint32_t old_first = block.first;
+            block.first = at;
+            for (uint32_t inst = old_first; inst < old_first + block.count; ++inst)
+            {
+                if (forward[inst - first] != NONE)
+                    continue;
+
+                const IROp op = module.ops[inst];
+                if (op == IROp::CALL || op == IROp::PHI)
+                {
+                    for (uint32_t entry = module.a[inst] + (op == IROp::CALL); entry < module.a[inst] + module.b[inst];
+                         ++entry)
+                        module.extra[entry] = value(module.extra[entry]);
+                }
+                else
+                {
+                    const uint32_t operands = IRModule::value_operands(op);
+                    if (operands > 0)
+                        module.a[inst] = value(module.a[inst]);
+                    if (operands > 1)
+                        module.b[inst] = value(module.b[inst]);
+                }
+
+                module.ops[at] = op;
+                module.types[at] = module.types[inst];
+                module.a[at] = module.a[inst];
+                module.b[at] = module.b[inst];
+                ++at;
+            }
+            block.count = at - block.first;
+        }
+
+        module.blocks.resize(function.first_block);
+        module.blocks.insert(module.blocks.end(), layout.begin(), layout.end());
+        module.ops.resize(at);
+        module.types.resize(at);
+        module.a.resize(at);
+        module.b.resize(at);
+        function.block_count = static_cast<uint32_t>(layout.size());
+        function.count = at - first;
+    }
+
+    uint32_t IRLowering::resolve(uint32_t value) const
+    {
+        while (value != NONE && value >= function_first && forward[value - function_first] != NONE)
+            value = forward[value - function_first];
+        return value;
+    }
+}
@@ -0,0 +1,395 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/ir/include/ir.h>
+#include <algorithm>
+
+namespace klr::compiler
+{
+    namespace
+    {
+        constexpr uint32_t NONE = IRModule::NONE;
+
+        class Verifier
+        {
+        public:
+            Verifier(const IRModule &module, const TypeTable &table) : module(module), table(table) {}
+
+            std::vector<std::string> run()
+            {
+                for (uint32_t index = 0; index < module.functions.size(); ++index)
+                    function(index);
+                return std::move(errors);
+            }
+
+        private:
+            const IRModule &module;
+            const TypeTable &table;
+            std::vector<std::string> errors;
+
+            /* per function, reset each time */
+            const IRFunction *current = nullptr;
+            std::vector<uint32_t> block_of; /* by instruction within the function */
+            std::vector<uint32_t> rpo;      /* block indexes within the function, in reverse postorder */
+            std::vector<uint32_t> position; /* in rpo, by block; NONE if unreachable */
+            std::vector<uint32_t> idom;     /* by block */
+
+            void error(const std::string &what)
+            {
+                errors.push_back("function " + std::to_string(current - module.functions.data()) + ": " + what);
+            }
+
+            static std::string value(const uint32_t inst, const IRFunction &function)
+            {
+                return "%" + std::to_string(inst - function.first);
+            }
+
+            void function(const uint32_t index)
+            {
+                const IRFunction &function = module.functions[index];
+                current = &function;
+                if (function.first_block + function.block_count > module.blocks.size() ||
+                    function.first + function.count > module.size())
+                {
+                    error("blocks or instructions out of range");
+                    return;
+                }
+                if (function.block_count == 0)
+                {
+                    error("no blocks");
+                    return;
+                }
+                if (!shape(function))
+                    return;
+
+                dominators(function);
+                for (uint32_t block = 0; block < function.block_count; ++block)
+                {
+                    if (position[block] == NONE)
+                        error("b" + std::to_string(block) + " is unreachable");
+                }
+
+                for (uint32_t inst = function.first; inst < function.first + function.count; ++inst)
+                    instruction(function, inst);
+            }
+
+            /* blocks tile the function's instructions, each ends in its one terminator, and edges agree both ways */
+            bool shape(const IRFunction &function)
+            {
+                block_of.assign(function.count, NONE);
+                uint32_t next = function.first;
+                bool ok = true;
+                for (uint32_t block = 0; block < function.block_count; ++block)
+                {
+                    const IRBlock &b = module.blocks[function.first_block + block];
+                    const std::string name = "b" + std::to_string(block);
+                    if (b.first != next || b.count == 0 || b.first + b.count > function.first + function.count)
+                    {
+                        error(name + " does not follow the previous block or is empty");
+                        return false;
+                    }
+                    next = b.first + b.count;
+
+                    bool phis = true;
+                    for (uint32_t inst = b.first; inst < next; ++inst)
+                    {
+                        block_of[inst - function.first] = block;
+                        const IROp op = module.ops[inst];
+                        if (IRModule::is_terminator(op) != (inst == next - 1))
+                        {
+                            error(name + " must end in its only terminator");
+                            ok = false;
+                        }
+                        if (op == IROp::PHI && !phis)
+                        {
+                            error(name + ": phi " + value(inst, function) + " after other instructions");
+                            ok = false;
+                        }
+                        phis = phis && op == IROp::PHI;
+                    }
+
+                    const IROp last = module.ops[next - 1];
+                    const uint32_t wanted = last == IROp::BRANCH ? 2 : last == IROp::JUMP ? 1 : 0;
+                    for (uint32_t i = 0; i < 2; ++i)
+                    {
+                        const uint32_t succ = b.succs[i];
+                        if ((succ != NONE) != (i < wanted) ||
+                            (succ != NONE && (succ < function.first_block ||
+                                              succ >= function.first_block + function.block_count)))
+                        {
+                            error(name + ": successors do not fit its terminator");
+                            ok = false;
+                        }
+                    }
+                }
+                if (next != function.first + function.count)
+                {
+                    error("instructions after the last block");
+                    return false;
+                }
+                if (!ok)
+                    return false;
+
+                /* an edge is as many succs of one as it is preds of the other */
+                for (uint32_t block = 0; block < function.block_count; ++block)
+                {
+                    const uint32_t from = function.first_block + block;
+                    for (const uint32_t pred: module.preds(from))
+                    {
+                        if (pred < function.first_block || pred >= function.first_block + function.block_count)
+                        {
+                            error("b" + std::to_string(block) + " has a predecessor outside the function");
+                            return false;
+                        }
+                    }
+                    for (const uint32_t succ: module.blocks[from].succs)
+                    {
+                        if (succ == NONE)
+                            continue;
+                        const auto preds = module.preds(succ);
+                        const auto &succs = module.blocks[from].succs;
+                        if (std::ranges::count(preds, from) != std::ranges::count(succs, succ))
+                        {
+                            error("edge b" + std::to_string(block) + " -> b" +
+                                  std::to_string(succ - function.first_block) + " is not among its predecessors");
+                            ok = false;
+                        }
+                    }
+                    for (const uint32_t pred: module.preds(from))
+                    {
+                        if (!std::ranges::count(module.blocks[pred].succs, from))
+                        {
+                            error("b" + std::to_string(block) + " lists b" +
+                                  std::to_string(pred - function.first_block) + " as a predecessor, without an edge");
+                            ok = false;
+                        }
+                    }
+                }
+                return ok;
+            }
+
+            /* Cooper, Harvey and Kennedy's iteration over reverse postorder */
+            void dominators(const IRFunction &function)
+            {
+                const uint32_t count = function.block_count;
+                rpo.clear();
+                position.assign(count, NONE);
+                idom.assign(count, NONE);
+
+                /* iterative depth-first search, so deep nesting cannot overflow the stack */
+                std::vector<std::pair<uint32_t, uint32_t>> stack = { { 0, 0 } };
+                std::vector<bool> seen(count, false);
+                seen[0] = true;
+                while (!stack.empty())
+                {
+                    auto &[block, edge] = stack.back();
+                    const IRBlock &b = module.blocks[function.first_block + block];
+                    if (edge < 2 && b.succs[edge] != NONE)
+                    {
+                        const uint32_t succ = b.succs[edge++] - function.first_block;
+                        if (!seen[succ])
+                        {
+                            seen[succ] = true;
+                            stack.emplace_back(succ, 0);
+                        }
+                        continue;
+                    }
+                    rpo.push_back(block);
+                    stack.pop_back();
+                }
+                std::ranges::reverse(rpo);
+                for (uint32_t i = 0; i < rpo.size(); ++i)
+                    position[rpo[i]] = i;
+
+                idom[0] = 0;
+                for (bool changed = true; changed;)
+                {
+                    changed = false;
+                    for (uint32_t i = 1; i < rpo.size(); ++i)
+                    {
+                        const uint32_t block = rpo[i];
+                        uint32_t dom = NONE;
+                        for (const uint32_t pred: module.preds(function.first_block + block))
+                        {
+                            const uint32_t p = pred - function.first_block;
+                            if (idom[p] == NONE)
+                                continue;
+                            dom = dom == NONE ? p : intersect(p, dom);
+                        }
+                        if (dom != idom[block])
+                        {
+                            idom[block] = dom;
+                            changed = true;
+                        }
+                    }
+                }
+            }
+
+            [[nodiscard]] uint32_t intersect(uint32_t a, uint32_t b) const
+            {
+                while (a != b)
+                {
+                    while (position[a] > position[b])
+                        a = idom[a];
+                    while (position[b] > position[a])
+                        b = idom[b];
+                }
+                return a;
+            }
+
+            [[nodiscard]] bool dominates(const uint32_t a, uint32_t b) const
+            {
+                if (position[a] == NONE || position[b] == NONE)
+                    return false;
+                while (b != a && b != 0)
+                    b = idom[b];
+                return b == a;
+            }
+
+            /* an operand of inst, used at the end of block `at` for phis */
+            bool operand(const IRFunction &function, const uint32_t inst, const uint32_t used, const uint32_t at)
+            {
+                if (used < function.first || used >= function.first + function.count ||
+                    IRModule::is_terminator(module.ops[used]))
+                {
+                    error(value(inst, function) + " uses something that is not a value of this function");
+                    return false;
+                }
+
+                const uint32_t defined = block_of[used - function.first];
+                const bool before = module.ops[inst] == IROp::PHI
+                                        ? dominates(defined, at)
+                                        : defined == at ? used < inst : dominates(defined, at);
+                if (!before)
+                {
+                    error(value(inst, function) + " uses " + value(used, function) + " where it is not defined");
+                    return false;
+                }
+                return true;
+            }
+
+            void expect(const IRFunction &function, const uint32_t inst, const TypeId wanted, const TypeId found,
+                        const char *what)
+            {
+                if (wanted != found)
+                {
+                    error(value(inst, function) + ": " + what + " is " + table.to_string(found) + ", not " +
+                          table.to_string(wanted));
+                }
+            }
+
+            void instruction(const IRFunction &function, const uint32_t inst)
+            {
+                const IROp op = module.ops[inst];
+                const TypeId type = module.types[inst];
+                const uint32_t block = block_of[inst - function.first];
+                const uint32_t a = module.a[inst];
+                const uint32_t b = module.b[inst];
+                const auto signature = table[function.type].kind == TypeKind::FUNCTION
+                                           ? table.args(function.type)
+                                           : std::span<const TypeId>();
+
+                switch (op)
+                {
+                    case IROp::PARAM:
+                    {
+                        if (a + 1 >= signature.size())
+                            error(value(inst, function) + " names a parameter the function does not have");
+                        else
+                            expect(function, inst, signature[a + 1], type, "parameter");
+                        return;
+                    }
+
+                    case IROp::CALL:
+                    {
+                        const auto entries = module.list(inst);
+                        if (entries.empty() || entries[0] >= module.functions.size())
+                        {
+                            error(value(inst, function) + " calls no function");
+                            return;
+                        }
+                        const TypeId callee = module.functions[entries[0]].type;
+                        const auto params = table.args(callee);
+                        if (params.size() != entries.size())
+                        {
+                            error(value(inst, function) + " passes the wrong number of arguments");
+                            return;
+                        }
+                        expect(function, inst, params[0], type, "the result");
+                        for (size_t i = 1; i < entries.size(); ++i)
+                        {
+                            if (operand(function, inst, entries[i], block))
+                                expect(function, inst, params[i], module.types[entries[i]], "an argument");
+                        }
+                        return;
+                    }
+
+                    case IROp::PHI:
+                    {
+                        const auto preds = module.preds(function.first_block + block);
+                        if (b != preds.size())
+                        {
+                            error(value(inst, function) + " needs one value per predecessor");
+                            return;
+                        }
+                        const auto entries = module.list(inst);
+                        for (size_t i = 0; i < entries.size(); ++i)
+                        {
+                            if (operand(function, inst, entries[i], preds[i] - function.first_block))
+                                expect(function, inst, type, module.types[entries[i]], "an incoming value");
+                        }
+                        return;
+                    }
+
+                    case IROp::RETURN:
+                    {
+                        const TypeId returns = signature.empty() ? TypeTable::VOID : signature[0];
+                        if (a == NONE)
+                        {
+                            if (returns != TypeTable::VOID)
+                                error(value(inst, function) + " returns nothing from a non-void function");
+                        }
+                        else if (operand(function, inst, a, block))
+                        {
+                            expect(function, inst, returns, module.types[a], "the returned value");
+                        }
+                        return;
+                    }
+
+                    default:
+                        break;
+                }
+
+                const uint32_t operands = IRModule::value_operands(op);
+                if (operands > 0 && !operand(function, inst, a, block))
+                    return;
+                if (operands > 1 && !operand(function, inst, b, block))
+                    return;
+
+                if (op >= IROp::ADD && op <= IROp::SHR)
+                {
+                    expect(function, inst, type, module.types[a], "the left side");
+                    expect(function, inst, type, module.types[b], "the right side");
+                }
+                else if (op >= IROp::EQ && op <= IROp::GE)
+                {
+                    expect(function, inst, TypeTable::BOOL, type, "a comparison");
+                    expect(function, inst, module.types[a], module.types[b], "the right side");
+                }
+                else if (op == IROp::NOT || op == IROp::BRANCH)
+                {
+                    expect(function, inst, TypeTable::BOOL, module.types[a], "the condition");
+                }
+                else if (op == IROp::NEG || op == IROp::COMPL)
+                {
+                    expect(function, inst, type, module.types[a], "the operand");
+                }
+            }
+        };
+    }
+
+    std::vector<std::string> verify(const IRModule &module, const TypeTable &table)
+    {
+        return Verifier(module, table).run();
+    }
+}
@@ -0,0 +1,98 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+#include <compiler/ir/include/ir.h>
+#include <compiler/jit/include/assembler.h>
+
+namespace klr::compiler
+{
+    /* where a value lives while its function runs */
+    struct Location
+    {
+        enum class Kind : uint8_t
+        {
+            NONE,     /* defines nothing, e.g. a void call */
+            CONSTANT, /* rematerialised at each use */
+            GPR,
+            XMM,
+            SLOT, /* a spill slot of the frame */
+        };
+
+        Kind kind = Kind::NONE;
+        uint32_t index = 0; /* the Reg, the Xmm or the slot */
+
+        bool operator==(const Location &) const = default;
+    };
+
+    /*
+     * linear scan register allocation, after Poletto and Sarkar
+     *
+     * liveness comes from a backward data flow over the blocks; each value
+     * then gets one interval over the function's layout, from the first
+     * position it is live at to the last, holes included. intervals are
+     * taken by start; when registers run out, whichever of the new one and
+     * the active ones ends last is spilled to a slot of its own
+     *
+     * every register the allocator hands out is one the code generator
+     * never uses as scratch: rax, rcx, rdx, xmm0 and xmm1 are kept for
+     * instruction sequences, and the argument registers for calls. a value
+     * live across a call gets a callee-saved register or a slot; SysV has
+     * no callee-saved xmm registers, so such a float is always spilled
+     */
+    class LinearScan
+    {
+    public:
+        /* per instruction of the last function allocated */
+        std::pmr::vector<Location> locations;
+        uint32_t slots = 0;
+        uint32_t saved = 0; /* a bit per Reg: the callee-saved registers handed out */
+
+        explicit LinearScan(const IRModule &module,
+                            std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+        void allocate(const IRFunction &function);
+
+        /* whether inst is compiled to a call, which clobbers every caller-saved register */
+        [[nodiscard]] static bool calls(const IRModule &module, uint32_t inst);
+
+        [[nodiscard]] static bool callee_saved(Reg reg);
+
+    private:
+        struct Interval
+        {
+            uint32_t value; /* relative to the function's first instruction, as are positions */
+            uint32_t start;
+            uint32_t end;
+            bool floating;
+            bool across_call;
+        };
+
+        const IRModule &module;
+
+        uint32_t words = 0;                  /* per bit set */
+        std::pmr::vector<uint64_t> live_in;  /* a bit set per block */
+        std::pmr::vector<uint64_t> live_out; /* a bit set per block */
+        std::pmr::vector<uint64_t> live;
+
+        std::pmr::vector<Interval> intervals;
+        std::pmr::vector<uint32_t> interval_of; /* per instruction, while they are built */
+        std::pmr::vector<uint32_t> active; /* intervals holding a register */
+        std::pmr::vector<uint32_t> call_positions;
+
+        void liveness(const IRFunction &function);
+
+        void build(const IRFunction &function);
+
+        void scan();
+
+        /* a register of the interval's file that is free and allowed for it, or NONE */
+        [[nodiscard]] uint32_t pick(const Interval &interval, uint32_t used) const;
+
+        [[nodiscard]] bool needs_register(const IRFunction &function, uint32_t inst) const;
+    };
+}
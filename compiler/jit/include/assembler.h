@@ -0,0 +1,255 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+namespace klr::compiler
+{
+    /* general purpose registers, numbered as the encoding numbers them */
+    enum class Reg : uint8_t
+    {
+        RAX,
+        RCX,
+        RDX,
+        RBX,
+        RSP,
+        RBP,
+        RSI,
+        RDI,
+        R8,
+        R9,
+        R10,
+        R11,
+        R12,
+        R13,
+        R14,
+        R15,
+    };
+
+    enum class Xmm : uint8_t
+    {
+        XMM0,
+        XMM1,
+        XMM2,
+        XMM3,
+        XMM4,
+        XMM5,
+        XMM6,
+        XMM7,
+        XMM8,
+        XMM9,
+        XMM10,
+        XMM11,
+        XMM12,
+        XMM13,
+        XMM14,
+        XMM15,
+    };
+
+    /* condition codes; flipping the lowest bit negates one */
+    enum class Cond : uint8_t
+    {
+        O,
+        NO,
+        B, /* unsigned < */
+        AE,
+        E,
+        NE,
+        BE,
+        A,
+        S,
+        NS,
+        P, /* unordered, after ucomisd */
+        NP,
+        L, /* signed < */
+        GE,
+        LE,
+        G,
+    };
+
+    /* the /digit of the 0x81 group, and the op*8 + 3 form taking r/m */
+    enum class Alu : uint8_t
+    {
+        ADD = 0,
+        OR = 1,
+        AND = 4,
+        SUB = 5,
+        XOR = 6,
+        CMP = 7,
+    };
+
+    /* by cl */
+    enum class Shift : uint8_t
+    {
+        SHL = 4,
+        SHR = 5,
+        SAR = 7,
+    };
+
+    /* the 0xF7 group */
+    enum class Unary : uint8_t
+    {
+        NOT = 2,
+        NEG = 3,
+        DIV = 6, /* rdx:rax by the operand */
+        IDIV = 7,
+    };
+
+    /* scalar double SSE2, xmm by xmm or memory */
+    enum class Sse : uint8_t
+    {
+        MOVSD,
+        ADDSD,
+        SUBSD,
+        MULSD,
+        DIVSD,
+        CVTSD2SS,
+        CVTSS2SD,
+        UCOMISD,
+    };
+
+    /* [base + disp] */
+    struct Mem
+    {
+        Reg base;
+        int32_t disp;
+    };
+
+    /* the r/m operand: a register of either file, or memory */
+    struct RM
+    {
+        uint8_t code;
+        bool memory;
+        int32_t disp;
+
+        RM(const Reg reg) : code(static_cast<uint8_t>(reg)), memory(false), disp(0) {}
+
+        RM(const Xmm reg) : code(static_cast<uint8_t>(reg)), memory(false), disp(0) {}
+
+        RM(const Mem mem) : code(static_cast<uint8_t>(mem.base)), memory(true), disp(mem.disp) {}
+    };
+
+    struct Label
+    {
+        uint32_t id;
+    };
+
+    /*
+     * an x86-64 encoder, just the forms the JIT needs
+     *
+     * integer forms are 64-bit unless named otherwise. jumps and calls to
+     * labels are always rel32 and are patched by finish(), so a label can
+     * be used before it is bound
+     */
+    class Assembler
+    {
+    public:
+        static constexpr uint32_t UNBOUND = ~0U;
+
+        std::pmr::vector<uint8_t> code;
+
+        explicit Assembler(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+        [[nodiscard]] uint32_t size() const
+        {
+            return static_cast<uint32_t>(code.size());
+        }
+
+        [[nodiscard]] Label label();
+
+        void bind(Label label);
+
+        [[nodiscard]] uint32_t offset(const Label label) const
+        {
+            return labels[label.id];
+        }
+
+        void mov(Reg dst, RM src);
+
+        void mov(Mem dst, Reg src);
+
+        /* the shortest of mov r32, imm32 / mov r64, simm32 / mov r64, imm64 */
+        void mov_imm(Reg dst, uint64_t imm);
+
+        void mov_imm(Mem dst, int32_t imm);
+
+        /* mov r32, r/m32, which clears the upper half */
+        void mov32(Reg dst, RM src);
+
+        /* movsx / movzx from width 8, 16 or 32 bits of src to 64 */
+        void extend(Reg dst, RM src, uint32_t width, bool sign);
+
+        void lea(Reg dst, Mem src);
+
+        void alu(Alu op, Reg dst, RM src);
+
+        void alu(Alu op, RM dst, int32_t imm);
+
+        void imul(Reg dst, RM src);
+
+        void unary(Unary op, RM operand);
+
+        void shift(Shift op, RM operand);
+
+        void test(RM a, Reg b);
+
+        void cqo();
+
+        /* writes the low byte of dst only */
+        void setcc(Cond cond, Reg dst);
+
+        void push(Reg reg);
+
+        void pop(Reg reg);
+
+        void call(Label target);
+
+        void call(Reg target);
+
+        void jmp(Label target);
+
+        void jcc(Cond cond, Label target);
+
+        void ret();
+
+        void ud2();
+
+        void sse(Sse op, Xmm dst, RM src);
+
+        void movsd(Mem dst, Xmm src);
+
+        void movq(Xmm dst, Reg src);
+
+        void movq(Reg dst, Xmm src);
+
+        /* from a signed 64-bit integer */
+        void cvtsi2sd(Xmm dst, RM src);
+
+        /* from a signed 64-bit integer, rounded once to single precision */
+        void cvtsi2ss(Xmm dst, RM src);
+
+        /* patches every jump and call to its label; each must be bound by now */
+        void finish();
+
+    private:
+        std::pmr::vector<uint32_t> labels;
+        std::pmr::vector<std::pair<uint32_t, uint32_t>> fixups; /* rel32 position, label */
+
+        /*
+         * [prefix] [REX] opcode ModRM [SIB] [disp]; byte asks for a REX even
+         * when empty, so registers 4 to 7 are spl..dil rather than ah..bh
+         */
+        void emit(uint8_t prefix, bool wide, std::initializer_list<uint8_t> opcode, uint8_t reg, const RM &rm,
+                  bool byte = false);
+
+        void rel32(Label target);
+
+        void put32(uint32_t value);
+    };
+}
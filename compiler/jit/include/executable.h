@@ -0,0 +1,47 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace klr::compiler
+{
+    /*
+     * pages of machine code, never writable and executable at once: the
+     * code is copied in while they are read-write, then they are flipped
+     * to read-execute for good
+     */
+    class ExecutableMemory
+    {
+    public:
+        ExecutableMemory() = default;
+
+        ExecutableMemory(const ExecutableMemory &) = delete;
+
+        ExecutableMemory &operator=(const ExecutableMemory &) = delete;
+
+        ~ExecutableMemory();
+
+        /* replaces what was mapped before; false if the system refuses */
+        bool map(std::span<const uint8_t> code);
+
+        void release();
+
+        [[nodiscard]] const uint8_t *data() const
+        {
+            return pages;
+        }
+
+        [[nodiscard]] size_t size() const
+        {
+            return bytes;
+        }
+
+    private:
+        uint8_t *pages = nullptr;
+        size_t bytes = 0; /* whole pages */
+    };
+}
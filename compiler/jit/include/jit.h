@@ -0,0 +1,193 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <utility>
+#include <vector>
+#include <compiler/analysis/include/constants.h>
+#include <compiler/ir/include/ir.h>
+#include <compiler/jit/include/allocator.h>
+#include <compiler/jit/include/assembler.h>
+#include <compiler/jit/include/executable.h>
+#include <compiler/vm/include/vm.h>
+
+namespace klr::compiler
+{
+    /*
+     * IR to x86-64 machine code, in memory
+     *
+     * every function of the module is compiled to one function of the C
+     * ABI (System V) with its own signature: integers and bools in integer
+     * registers, extended to their width on entry; floats in xmm registers,
+     * f32 as single precision; strings as their atom. so function() can be
+     * called directly from C++, and compiled functions call each other
+     * with plain calls. arithmetic matches the VM and constant folding bit
+     * for bit, including wrapping, shift counts and saturating casts
+     *
+     * run() enters through a thunk that remembers the stack, so a trap
+     * (division by zero, or more than stack_bytes of native stack) unwinds
+     * straight back to it and comes out as the Result's trap, as in the VM.
+     * a trap in code entered directly, not through run(), is fatal
+     *
+     * expects a module that verify() accepts, and an x86-64 System V host
+     * to run on; see supported()
+     */
+    class JIT
+    {
+    public:
+        static constexpr size_t STACK_BYTES = 1 << 20;
+
+        JIT(const IRModule &module, const TypeTable &table, const ConstantPool &constants,
+            size_t stack_bytes = STACK_BYTES, std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+        /* the code and the thunks embed the address of the JIT */
+        JIT(const JIT &) = delete;
+
+        JIT &operator=(const JIT &) = delete;
+
+        /* whether this host can run what compile() makes */
+        [[nodiscard]] static bool supported();
+
+        /* compiles every function of the module and maps them executable; false where unsupported */
+        bool compile();
+
+        /* the first function named atom, or the module's function count */
+        [[nodiscard]] uint32_t find(uint32_t atom) const;
+
+        /* e.g. function<int32_t(int32_t)>(fib), for a function(i32) -> i32 */
+        template <typename Signature>
+        [[nodiscard]] Signature *function(const uint32_t index) const
+        {
+            return reinterpret_cast<Signature *>(const_cast<uint8_t *>(memory.data() + entries[index]));
+        }
+
+        /* args must match the function's parameters in number and kind */
+        Result run(uint32_t function, std::span<const Value> args);
+
+        /* machine code bytes, thunks included */
+        [[nodiscard]] size_t code_bytes() const
+        {
+            return code_size;
+        }
+
+    private:
+        static constexpr uint32_t NONE = IRModule::NONE;
+
+        /* a branch edge into a block with phis */
+        struct Stub
+        {
+            Label label;
+            uint32_t pred;
+            uint32_t target;
+        };
+
+        /* one pending move of an edge's parallel copy */
+        struct Move
+        {
+            Location dst;
+            Location src;
+            uint32_t value; /* the source, for a constant */
+            bool floating;
+        };
+
+        const IRModule &module;
+        const TypeTable &table;
+        const ConstantPool &constants;
+        const size_t stack_bytes;
+
+        Assembler assembler;
+        LinearScan allocator;
+        ExecutableMemory memory;
+        size_t code_size = 0;
+
+        std::pmr::vector<Label> function_labels;
+        std::pmr::vector<Label> block_labels; /* of the function being compiled */
+        std::pmr::vector<Stub> stubs;
+        std::pmr::vector<Move> moves;
+        std::pmr::vector<uint32_t> use_counts; /* per instruction of the function being compiled */
+        std::pmr::vector<uint32_t> stack_args; /* of the call or parameters being placed */
+        std::pmr::vector<uint32_t> entries; /* offsets of the functions */
+        std::pmr::vector<uint32_t> thunks;  /* offsets of their thunks, for run() */
+        std::pmr::vector<uint64_t> arguments;
+
+        Label division_by_zero{};
+        Label stack_overflow{};
+        Label epilogue{}; /* of the function being compiled */
+        uint32_t frame_saved = 0; /* its callee-saved registers, pushed after rbp */
+        uint32_t fused = NONE;    /* a comparison left in the flags for the branch after it */
+        Cond fused_cond = Cond::E;
+
+        /* read by the code: where run() left the stack, and how far down it may go */
+        uint64_t exit_sp = 0;
+        uint64_t stack_limit = 0;
+
+        void body(uint32_t index);
+
+        void prologue(const IRFunction &function);
+
+        void instruction(const IRFunction &function, uint32_t inst);
+
+        void terminator(const IRFunction &function, uint32_t block, uint32_t next);
+
+        void call(const IRFunction &function, uint32_t inst);
+
+        void division(const IRFunction &function, uint32_t inst);
+
+        void cast(const IRFunction &function, uint32_t inst);
+
+        void compare(const IRFunction &function, uint32_t inst);
+
+        /* the parallel copy into target's phis, on the edge from pred */
+        void edge(const IRFunction &function, uint32_t pred, uint32_t target);
+
+        void move(const Move &move);
+
+        void thunk(uint32_t index);
+
+        void traps();
+
+        [[nodiscard]] Location location(const IRFunction &function, uint32_t value) const;
+
+        /* the bits of a constant value */
+        [[nodiscard]] uint64_t immediate(uint32_t value) const;
+
+        [[nodiscard]] Mem slot(uint32_t index) const;
+
+        /* the value as an r/m operand, loaded into scratch if it is a constant */
+        [[nodiscard]] RM operand(const IRFunction &function, uint32_t value, Reg scratch);
+
+        [[nodiscard]] RM operand(const IRFunction &function, uint32_t value, Xmm scratch);
+
+        /* the value in a register: its own, or scratch */
+        Reg load(const IRFunction &function, uint32_t value, Reg scratch);
+
+        Xmm load(const IRFunction &function, uint32_t value, Xmm scratch);
+
+        /* the value into dst, whichever file it lives in */
+        void copy(const IRFunction &function, Reg dst, uint32_t value);
+
+        void copy(const IRFunction &function, Xmm dst, uint32_t value);
+
+        /* where inst's result is computed: its register, or scratch when it lives in a slot */
+        [[nodiscard]] Reg target(const IRFunction &function, uint32_t inst, Reg scratch) const;
+
+        [[nodiscard]] Xmm target(const IRFunction &function, uint32_t inst, Xmm scratch) const;
+
+        /* from into inst's location; bits cross between the files as they are */
+        void store(const IRFunction &function, uint32_t inst, Reg from);
+
+        void store(const IRFunction &function, uint32_t inst, Xmm from);
+
+        /* extends the low width bits of reg as kind says; a no-op for 64-bit kinds */
+        void wrap(Reg reg, TypeKind kind);
+
+        /* rounds a double to float and back, for f32 */
+        void round(Xmm reg, TypeKind kind);
+
+        void call_absolute(const void *address);
+    };
+}
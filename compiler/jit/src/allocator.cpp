@@ -0,0 +1,299 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/jit/include/allocator.h>
+#include <algorithm>
+#include <bit>
+
+namespace klr::compiler
+{
+    namespace
+    {
+        constexpr uint32_t NONE = IRModule::NONE;
+
+        /* caller-saved first, so a value that outlives no call leaves the callee-saved ones alone */
+        constexpr Reg GPRS[] = { Reg::R10, Reg::R11, Reg::RBX, Reg::R12, Reg::R13, Reg::R14, Reg::R15 };
+        constexpr Xmm XMMS[] = {
+            Xmm::XMM8, Xmm::XMM9, Xmm::XMM10, Xmm::XMM11, Xmm::XMM12, Xmm::XMM13, Xmm::XMM14, Xmm::XMM15,
+        };
+
+        TypeKind kind_of(const TypeId type)
+        {
+            return type <= TypeTable::VOID ? static_cast<TypeKind>(type) : TypeKind::ERROR;
+        }
+
+        /* calls f on each value inst reads, phis aside */
+        template <typename F>
+        void uses(const IRModule &module, const uint32_t inst, F &&f)
+        {
+            const IROp op = module.ops[inst];
+            if (op == IROp::CALL)
+            {
+                const auto entries = module.list(inst);
+                for (uint32_t i = 1; i < entries.size(); ++i)
+                    f(entries[i]);
+                return;
+            }
+
+            const uint32_t count = IRModule::value_operands(op);
+            if (count > 0 && module.a[inst] != NONE)
+                f(module.a[inst]);
+            if (count > 1)
+                f(module.b[inst]);
+        }
+    }
+
+    LinearScan::LinearScan(const IRModule &module,
+                           std::pmr::memory_resource *resource) : locations(resource), module(module)
+                                                                , live_in(resource), live_out(resource)
+                                                                , live(resource), intervals(resource)
+                                                                , interval_of(resource), active(resource)
+                                                                , call_positions(resource) {}
+
+    void LinearScan::allocate(const IRFunction &function)
+    {
+        locations.assign(function.count, {});
+        for (uint32_t inst = function.first; inst < function.first + function.count; ++inst)
+        {
+            const IROp op = module.ops[inst];
+            if (op == IROp::CONST || op == IROp::STRING || op == IROp::UNDEF)
+                locations[inst - function.first].kind = Location::Kind::CONSTANT;
+        }
+
+        liveness(function);
+        build(function);
+        scan();
+
+        saved = 0;
+        for (const Location &location: locations)
+        {
+            if (location.kind == Location::Kind::GPR && callee_saved(static_cast<Reg>(location.index)))
+                saved |= 1U << location.index;
+        }
+    }
+
+    bool LinearScan::calls(const IRModule &module, const uint32_t inst)
+    {
+        switch (module.ops[inst])
+        {
+            case IROp::CALL:
+                return true;
+            case IROp::REM:
+                return TypeTable::is_float(kind_of(module.types[inst]));
+            case IROp::CAST:
+            {
+                /* float to integer saturates, and u64 to float has no instruction of its own */
+                const TypeKind from = kind_of(module.types[module.a[inst]]);
+                const TypeKind to = kind_of(module.types[inst]);
+                return (TypeTable::is_float(from) && TypeTable::is_integer(to)) ||
+                       (from == TypeKind::U64 && TypeTable::is_float(to));
+            }
+            default:
+                return false;
+        }
+    }
+
+    bool LinearScan::callee_saved(const Reg reg)
+    {
+        return reg == Reg::RBX || reg == Reg::RBP || reg >= Reg::R12;
+    }
+
+    bool LinearScan::needs_register(const IRFunction &function, const uint32_t inst) const
+    {
+        const IROp op = module.ops[inst];
+        return locations[inst - function.first].kind != Location::Kind::CONSTANT && !IRModule::is_terminator(op) &&
+               module.types[inst] != TypeTable::VOID;
+    }
+
+    void LinearScan::liveness(const IRFunction &function)
+    {
+        words = (function.count + 63) / 64;
+        live_in.assign(static_cast<size_t>(function.block_count) * words, 0);
+        live_out.assign(static_cast<size_t>(function.block_count) * words, 0);
+        live.resize(words);
+
+        const auto set = [&](const uint32_t value)
+        {
+            if (needs_register(function, value))
+                live[(value - function.first) / 64] |= 1ULL << (value - function.first) % 64;
+        };
+
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (uint32_t b = function.block_count; b-- > 0;)
+            {
+                const uint32_t block = function.first_block + b;
+                const IRBlock &current = module.blocks[block];
+
+                /* what a successor needs, and what its phis read on this edge */
+                std::ranges::fill(live, 0);
+                for (const uint32_t succ: current.succs)
+                {
+                    if (succ == NONE)
+                        continue;
+                    const uint64_t *in = live_in.data() + static_cast<size_t>(succ - function.first_block) * words;
+                    for (uint32_t w = 0; w < words; ++w)
+                        live[w] |= in[w];
+
+                    const auto preds = module.preds(succ);
+                    const auto slot = static_cast<uint32_t>(std::ranges::find(preds, block) - preds.begin());
+                    for (uint32_t inst = module.blocks[succ].first; module.ops[inst] == IROp::PHI; ++inst)
+                        set(module.list(inst)[slot]);
+                }
+                std::ranges::copy(live, live_out.begin() + static_cast<ptrdiff_t>(b) * words);
+
+                for (uint32_t inst = current.first + current.count; inst-- > current.first;)
+                {
+                    if (needs_register(function, inst))
+                        live[(inst - function.first) / 64] &= ~(1ULL << (inst - function.first) % 64);
+                    if (module.ops[inst] != IROp::PHI)
+                        uses(module, inst, set);
+                }
+
+                const auto in = live_in.begin() + static_cast<ptrdiff_t>(b) * words;
+                if (!std::equal(live.begin(), live.end(), in))
+                {
+                    std::ranges::copy(live, in);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    void LinearScan::build(const IRFunction &function)
+    {
+        intervals.clear();
+        call_positions.clear();
+        interval_of.assign(function.count, NONE);
+        for (uint32_t inst = function.first; inst < function.first + function.count; ++inst)
+        {
+            const uint32_t position = inst - function.first;
+            if (calls(module, inst))
+                call_positions.push_back(position);
+            if (needs_register(function, inst))
+            {
+                interval_of[position] = static_cast<uint32_t>(intervals.size());
+                intervals.push_back({
+                    position, position, position, TypeTable::is_float(kind_of(module.types[inst])), false
+                });
+            }
+        }
+
+        const auto cover = [&](const uint32_t value, const uint32_t position)
+        {
+            Interval &interval = intervals[interval_of[value]];
+            interval.start = std::min(interval.start, position);
+            interval.end = std::max(interval.end, position);
+        };
+        const auto cover_set = [&](const uint64_t *bits, const uint32_t position)
+        {
+            for (uint32_t w = 0; w < words; ++w)
+            {
+                for (uint64_t word = bits[w]; word; word &= word - 1)
+                    cover(w * 64 + static_cast<uint32_t>(std::countr_zero(word)), position);
+            }
+        };
+
+        for (uint32_t b = 0; b < function.block_count; ++b)
+        {
+            const IRBlock &block = module.blocks[function.first_block + b];
+            const uint32_t first = block.first - function.first;
+            cover_set(live_in.data() + static_cast<size_t>(b) * words, first);
+            cover_set(live_out.data() + static_cast<size_t>(b) * words, first + block.count - 1);
+            for (uint32_t inst = block.first; inst < block.first + block.count; ++inst)
+            {
+                if (module.ops[inst] == IROp::PHI)
+                    continue;
+                uses(module, inst, [&](const uint32_t value)
+                {
+                    if (needs_register(function, value))
+                        cover(value - function.first, inst - function.first);
+                });
+            }
+        }
+
+        /* a call's own result and arguments are outside it; whatever spans it is not */
+        for (Interval &interval: intervals)
+        {
+            const auto next = std::ranges::upper_bound(call_positions, interval.start);
+            interval.across_call = next != call_positions.end() && *next < interval.end;
+        }
+        std::ranges::stable_sort(intervals, {}, &Interval::start);
+    }
+
+    void LinearScan::scan()
+    {
+        active.clear();
+        slots = 0;
+        uint32_t used[2] = {}; /* a bit per register, GPRs then XMMs */
+
+        for (uint32_t i = 0; i < intervals.size(); ++i)
+        {
+            const Interval &current = intervals[i];
+            std::erase_if(active, [&](const uint32_t j)
+            {
+                if (intervals[j].end >= current.start)
+                    return false;
+                used[intervals[j].floating] &= ~(1U << locations[intervals[j].value].index);
+                return true;
+            });
+
+            const auto kind = current.floating ? Location::Kind::XMM : Location::Kind::GPR;
+            if (const uint32_t reg = pick(current, used[current.floating]); reg != NONE)
+            {
+                locations[current.value] = { kind, reg };
+                used[current.floating] |= 1U << reg;
+                active.push_back(i);
+                continue;
+            }
+
+            /* out of registers: whichever ends last waits in memory */
+            uint32_t victim = NONE;
+            for (const uint32_t j: active)
+            {
+                const Interval &other = intervals[j];
+                if (other.floating != current.floating)
+                    continue;
+                const auto reg = locations[other.value].index;
+                const bool allowed = current.floating
+                                         ? !current.across_call
+                                         : !current.across_call || callee_saved(static_cast<Reg>(reg));
+                if (allowed && (victim == NONE || other.end > intervals[victim].end))
+                    victim = j;
+            }
+
+            if (victim != NONE && intervals[victim].end > current.end)
+            {
+                locations[current.value] = locations[intervals[victim].value];
+                locations[intervals[victim].value] = { Location::Kind::SLOT, slots++ };
+                *std::ranges::find(active, victim) = i;
+            }
+            else
+                locations[current.value] = { Location::Kind::SLOT, slots++ };
+        }
+    }
+
+    uint32_t LinearScan::pick(const Interval &interval, const uint32_t used) const
+    {
+        if (interval.floating)
+        {
+            if (interval.across_call)
+                return NONE;
+            for (const Xmm xmm: XMMS)
+            {
+                if (!(used & 1U << static_cast<uint32_t>(xmm)))
+                    return static_cast<uint32_t>(xmm);
+            }
+            return NONE;
+        }
+
+        for (const Reg reg: GPRS)
+        {
+            if (!(used & 1U << static_cast<uint32_t>(reg)) && (!interval.across_call || callee_saved(reg)))
+                return static_cast<uint32_t>(reg);
+        }
+        return NONE;
+    }
+}
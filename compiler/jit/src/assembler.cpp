@@ -0,0 +1,287 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/jit/include/assembler.h>
+#include <cstring>
+
+namespace klr::compiler
+{
+    namespace
+    {
+        bool is_int8(const int64_t value)
+        {
+            return value >= INT8_MIN && value <= INT8_MAX;
+        }
+
+        bool is_int32(const int64_t value)
+        {
+            return value >= INT32_MIN && value <= INT32_MAX;
+        }
+    }
+
+    Assembler::Assembler(std::pmr::memory_resource *resource) : code(resource), labels(resource)
+                                                              , fixups(resource) {}
+
+    Label Assembler::label()
+    {
+        labels.push_back(UNBOUND);
+        return { static_cast<uint32_t>(labels.size() - 1) };
+    }
+
+    void Assembler::bind(const Label label)
+    {
+        labels[label.id] = size();
+    }
+
+    void Assembler::mov(const Reg dst, const RM src)
+    {
+        emit(0, true, { 0x8B }, static_cast<uint8_t>(dst), src);
+    }
+
+    void Assembler::mov(const Mem dst, const Reg src)
+    {
+        emit(0, true, { 0x89 }, static_cast<uint8_t>(src), dst);
+    }
+
+    void Assembler::mov_imm(const Reg dst, const uint64_t imm)
+    {
+        const auto r = static_cast<uint8_t>(dst);
+        if (imm <= UINT32_MAX)
+        {
+            if (r >= 8)
+                code.push_back(0x41);
+            code.push_back(0xB8 + (r & 7));
+            put32(static_cast<uint32_t>(imm));
+        }
+        else if (is_int32(static_cast<int64_t>(imm)))
+        {
+            emit(0, true, { 0xC7 }, 0, dst);
+            put32(static_cast<uint32_t>(imm));
+        }
+        else
+        {
+            code.push_back(0x48 | (r >> 3));
+            code.push_back(0xB8 + (r & 7));
+            put32(static_cast<uint32_t>(imm));
+            put32(static_cast<uint32_t>(imm >> 32));
+        }
+    }
+
+    void Assembler::mov_imm(const Mem dst, const int32_t imm)
+    {
+        emit(0, true, { 0xC7 }, 0, dst);
+        put32(static_cast<uint32_t>(imm));
+    }
+
+    void Assembler::mov32(const Reg dst, const RM src)
+    {
+        emit(0, false, { 0x8B }, static_cast<uint8_t>(dst), src);
+    }
+
+    void Assembler::extend(const Reg dst, const RM src, const uint32_t width, const bool sign)
+    {
+        const auto r = static_cast<uint8_t>(dst);
+        if (width == 8)
+            emit(0, true, { 0x0F, static_cast<uint8_t>(sign ? 0xBE : 0xB6) }, r, src, true);
+        else if (width == 16)
+            emit(0, true, { 0x0F, static_cast<uint8_t>(sign ? 0xBF : 0xB7) }, r, src);
+        else if (sign)
+            emit(0, true, { 0x63 }, r, src);
+        else
+            mov32(dst, src);
+    }
+
+    void Assembler::lea(const Reg dst, const Mem src)
+    {
+        emit(0, true, { 0x8D }, static_cast<uint8_t>(dst), src);
+    }
+
+    void Assembler::alu(const Alu op, const Reg dst, const RM src)
+    {
+        emit(0, true, { static_cast<uint8_t>(static_cast<uint8_t>(op) * 8 + 3) }, static_cast<uint8_t>(dst), src);
+    }
+
+    void Assembler::alu(const Alu op, const RM dst, const int32_t imm)
+    {
+        if (is_int8(imm))
+        {
+            emit(0, true, { 0x83 }, static_cast<uint8_t>(op), dst);
+            code.push_back(static_cast<uint8_t>(imm));
+        }
+        else
+        {
+            emit(0, true, { 0x81 }, static_cast<uint8_t>(op), dst);
+            put32(static_cast<uint32_t>(imm));
+        }
+    }
+
+    void Assembler::imul(const Reg dst, const RM src)
+    {
+        emit(0, true, { 0x0F, 0xAF }, static_cast<uint8_t>(dst), src);
+    }
+
+    void Assembler::unary(const Unary op, const RM operand)
+    {
+        emit(0, true, { 0xF7 }, static_cast<uint8_t>(op), operand);
+    }
+
+    void Assembler::shift(const Shift op, const RM operand)
+    {
+        emit(0, true, { 0xD3 }, static_cast<uint8_t>(op), operand);
+    }
+
+    void Assembler::test(const RM a, const Reg b)
+    {
+        emit(0, true, { 0x85 }, static_cast<uint8_t>(b), a);
+    }
+
+    void Assembler::cqo()
+    {
+        code.push_back(0x48);
+        code.push_back(0x99);
+    }
+
+    void Assembler::setcc(const Cond cond, const Reg dst)
+    {
+        emit(0, false, { 0x0F, static_cast<uint8_t>(0x90 + static_cast<uint8_t>(cond)) }, 0, dst, true);
+    }
+
+    void Assembler::push(const Reg reg)
+    {
+        const auto r = static_cast<uint8_t>(reg);
+        if (r >= 8)
+            code.push_back(0x41);
+        code.push_back(0x50 + (r & 7));
+    }
+
+    void Assembler::pop(const Reg reg)
+    {
+        const auto r = static_cast<uint8_t>(reg);
+        if (r >= 8)
+            code.push_back(0x41);
+        code.push_back(0x58 + (r & 7));
+    }
+
+    void Assembler::call(const Label target)
+    {
+        code.push_back(0xE8);
+        rel32(target);
+    }
+
+    void Assembler::call(const Reg target)
+    {
+        emit(0, false, { 0xFF }, 2, target);
+    }
+
+    void Assembler::jmp(const Label target)
+    {
+        code.push_back(0xE9);
+        rel32(target);
+    }
+
+    void Assembler::jcc(const Cond cond, const Label target)
+    {
+        code.push_back(0x0F);
+        code.push_back(0x80 + static_cast<uint8_t>(cond));
+        rel32(target);
+    }
+
+    void Assembler::ret()
+    {
+        code.push_back(0xC3);
+    }
+
+    void Assembler::ud2()
+    {
+        code.push_back(0x0F);
+        code.push_back(0x0B);
+    }
+
+    void Assembler::sse(const Sse op, const Xmm dst, const RM src)
+    {
+        /* prefix, opcode after 0x0F */
+        static constexpr uint8_t forms[][2] = {
+            { 0xF2, 0x10 }, { 0xF2, 0x58 }, { 0xF2, 0x5C }, { 0xF2, 0x59 }, { 0xF2, 0x5E }, { 0xF2, 0x5A },
+            { 0xF3, 0x5A }, { 0x66, 0x2E },
+        };
+        const auto &[prefix, opcode] = forms[static_cast<uint8_t>(op)];
+        emit(prefix, false, { 0x0F, opcode }, static_cast<uint8_t>(dst), src);
+    }
+
+    void Assembler::movsd(const Mem dst, const Xmm src)
+    {
+        emit(0xF2, false, { 0x0F, 0x11 }, static_cast<uint8_t>(src), dst);
+    }
+
+    void Assembler::movq(const Xmm dst, const Reg src)
+    {
+        emit(0x66, true, { 0x0F, 0x6E }, static_cast<uint8_t>(dst), src);
+    }
+
+    void Assembler::movq(const Reg dst, const Xmm src)
+    {
+        emit(0x66, true, { 0x0F, 0x7E }, static_cast<uint8_t>(src), dst);
+    }
+
+    void Assembler::cvtsi2sd(const Xmm dst, const RM src)
+    {
+        emit(0xF2, true, { 0x0F, 0x2A }, static_cast<uint8_t>(dst), src);
+    }
+
+    void Assembler::cvtsi2ss(const Xmm dst, const RM src)
+    {
+        emit(0xF3, true, { 0x0F, 0x2A }, static_cast<uint8_t>(dst), src);
+    }
+
+    void Assembler::finish()
+    {
+        for (const auto &[at, label]: fixups)
+        {
+            const auto rel = static_cast<int32_t>(labels[label] - (at + 4));
+            std::memcpy(code.data() + at, &rel, sizeof(rel));
+        }
+        fixups.clear();
+    }
+
+    void Assembler::emit(const uint8_t prefix, const bool wide, const std::initializer_list<uint8_t> opcode,
+                         const uint8_t reg, const RM &rm, const bool byte)
+    {
+        if (prefix)
+            code.push_back(prefix);
+
+        const uint8_t rex = 0x40 | (wide ? 0x08 : 0) | (reg >> 3) << 2 | rm.code >> 3;
+        const bool low_byte = byte && ((reg >= 4 && reg < 8) || (!rm.memory && rm.code >= 4 && rm.code < 8));
+        if (rex != 0x40 || low_byte)
+            code.push_back(rex);
+        code.insert(code.end(), opcode.begin(), opcode.end());
+
+        if (!rm.memory)
+        {
+            code.push_back(0xC0 | (reg & 7) << 3 | (rm.code & 7));
+            return;
+        }
+
+        /* rbp and r13 have no disp-less form; rsp and r12 need a SIB */
+        const uint8_t base = rm.code & 7;
+        const uint8_t mod = rm.disp == 0 && base != 5 ? 0 : is_int8(rm.disp) ? 1 : 2;
+        code.push_back(mod << 6 | (reg & 7) << 3 | base);
+        if (base == 4)
+            code.push_back(0x24);
+        if (mod == 1)
+            code.push_back(static_cast<uint8_t>(rm.disp));
+        else if (mod == 2)
+            put32(static_cast<uint32_t>(rm.disp));
+    }
+
+    void Assembler::rel32(const Label target)
+    {
+        fixups.emplace_back(size(), target.id);
+        put32(0);
+    }
+
+    void Assembler::put32(const uint32_t value)
+    {
+        for (uint32_t i = 0; i < 4; ++i)
+            code.push_back(static_cast<uint8_t>(value >> i * 8));
+    }
+}
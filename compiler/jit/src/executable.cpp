@@ -0,0 +1,77 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/jit/include/executable.h>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace klr::compiler
+{
+    ExecutableMemory::~ExecutableMemory()
+    {
+        release();
+    }
+
+    bool ExecutableMemory::map(const std::span<const uint8_t> code)
+    {
+        release();
+        if (code.empty())
+            return true;
+
+#if defined(_WIN32)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        const size_t page = info.dwPageSize;
+#else
+        const auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+        const size_t size = (code.size() + page - 1) / page * page;
+
+#if defined(_WIN32)
+        void *memory = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if (!memory)
+            return false;
+        std::memcpy(memory, code.data(), code.size());
+        DWORD old;
+        if (!VirtualProtect(memory, size, PAGE_EXECUTE_READ, &old))
+        {
+            VirtualFree(memory, 0, MEM_RELEASE);
+            return false;
+        }
+        FlushInstructionCache(GetCurrentProcess(), memory, size);
+#else
+        void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            return false;
+        std::memcpy(memory, code.data(), code.size());
+        if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0)
+        {
+            munmap(memory, size);
+            return false;
+        }
+#endif
+
+        pages = static_cast<uint8_t *>(memory);
+        bytes = size;
+        return true;
+    }
+
+    void ExecutableMemory::release()
+    {
+        if (!pages)
+            return;
+#if defined(_WIN32)
+        VirtualFree(pages, 0, MEM_RELEASE);
+#else
+        munmap(pages, bytes);
+#endif
+        pages = nullptr;
+        bytes = 0;
+    }
+}
@@ -0,0 +1,1137 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/jit/include/jit.h>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define KLR_JIT_HOST 1
+#else
+#define KLR_JIT_HOST 0
+#endif
+
+namespace klr::compiler
+{
+    namespace
+    {
+        constexpr Reg INT_ARGS[] = { Reg::RDI, Reg::RSI, Reg::RDX, Reg::RCX, Reg::R8, Reg::R9 };
+        constexpr uint32_t FLOAT_ARGS = 8;
+        constexpr uint32_t STACK_ARG = 16;
+        constexpr Reg SAVED[] = { Reg::RBX, Reg::R12, Reg::R13, Reg::R14, Reg::R15 };
+
+        TypeKind kind_of(const TypeId type)
+        {
+            return type <= TypeTable::VOID ? static_cast<TypeKind>(type) : TypeKind::ERROR;
+        }
+
+        bool is_signed(const TypeKind kind)
+        {
+            return kind == TypeKind::I8 || kind == TypeKind::I16 || kind == TypeKind::I32 || kind == TypeKind::I64;
+        }
+
+        uint32_t width(const TypeKind kind)
+        {
+            switch (kind)
+            {
+                case TypeKind::U8:
+                case TypeKind::I8:
+                    return 8;
+                case TypeKind::U16:
+                case TypeKind::I16:
+                    return 16;
+                case TypeKind::U32:
+                case TypeKind::I32:
+                    return 32;
+                default:
+                    return 64;
+            }
+        }
+
+        bool fits_int32(const uint64_t imm)
+        {
+            return static_cast<int64_t>(imm) >= INT32_MIN && static_cast<int64_t>(imm) <= INT32_MAX;
+        }
+
+        /* what the code calls for the casts that have no short instruction sequence */
+        uint64_t convert_bits(const uint64_t kinds, const uint64_t bits)
+        {
+            uint64_t out = 0;
+            (void) convert(static_cast<TypeKind>(kinds & 0xFF), static_cast<TypeKind>(kinds >> 8), bits, out);
+            return out;
+        }
+
+        double remainder_of(const double lhs, const double rhs)
+        {
+            return std::fmod(lhs, rhs);
+        }
+
+        /* which registers, or which stack words, a call's arguments go in */
+        struct Placement
+        {
+            uint32_t ints = 0;
+            uint32_t floats = 0;
+            uint32_t stack = 0;
+        };
+    }
+
+    JIT::JIT(const IRModule &module, const TypeTable &table, const ConstantPool &constants, const size_t stack_bytes,
+             std::pmr::memory_resource *resource) : module(module), table(table), constants(constants)
+                                                  , stack_bytes(stack_bytes), assembler(resource)
+                                                  , allocator(module, resource), function_labels(resource)
+                                                  , block_labels(resource), stubs(resource), moves(resource)
+                                                  , use_counts(resource), stack_args(resource), entries(resource)
+                                                  , thunks(resource), arguments(resource) {}
+
+    bool JIT::supported()
+    {
+        return KLR_JIT_HOST;
+    }
+
+    bool JIT::compile()
+    {
+        if (!supported())
+            return false;
+        if (!entries.empty())
+            return true;
+
+        division_by_zero = assembler.label();
+        stack_overflow = assembler.label();
+        for (size_t i = 0; i < module.functions.size(); ++i)
+            function_labels.push_back(assembler.label());
+
+        for (uint32_t index = 0; index < module.functions.size(); ++index)
+            body(index);
+        traps();
+        for (uint32_t index = 0; index < module.functions.size(); ++index)
+            thunk(index);
+        assembler.finish();
+
+        for (const Label label: function_labels)
+            entries.push_back(assembler.offset(label));
+        code_size = assembler.size();
+        return memory.map(assembler.code);
+    }
+
+    uint32_t JIT::find(const uint32_t atom) const
+    {
+        for (uint32_t index = 0; index < module.functions.size(); ++index)
+        {
+            if (module.functions[index].atom == atom)
+                return index;
+        }
+        return static_cast<uint32_t>(module.functions.size());
+    }
+
+    Result JIT::run(const uint32_t function, const std::span<const Value> args)
+    {
+        if (thunks.empty() || !memory.data())
+            return { { TypeKind::VOID, 0 }, Trap::NONE };
+
+        arguments.clear();
+        for (const Value &arg: args)
+            arguments.push_back(arg.bits);
+
+        /* the budget counts from about here */
+        uint64_t result = 0;
+        const auto sp = reinterpret_cast<uintptr_t>(&result);
+        stack_limit = sp > stack_bytes ? sp - stack_bytes : 0;
+
+        using Thunk = uint32_t(const uint64_t *, uint64_t *);
+        const auto enter = reinterpret_cast<Thunk *>(const_cast<uint8_t *>(memory.data() + thunks[function]));
+        const auto trap = static_cast<Trap>(enter(arguments.data(), &result));
+        stack_limit = 0;
+
+        if (trap != Trap::NONE)
+            return { { TypeKind::VOID, 0 }, trap };
+        return { { kind_of(table.args(module.functions[function].type)[0]), result }, Trap::NONE };
+    }
+
+    void JIT::body(const uint32_t index)
+    {
+        const IRFunction &function = module.functions[index];
+        allocator.allocate(function);
+
+        /* a comparison only the branch right after it reads stays in the flags */
+        use_counts.assign(function.count, 0);
+        for (uint32_t inst = function.first; inst < function.first + function.count; ++inst)
+        {
+            const IROp op = module.ops[inst];
+            if (op == IROp::CALL || op == IROp::PHI)
+            {
+                const auto entries = module.list(inst);
+                for (uint32_t i = op == IROp::CALL; i < entries.size(); ++i)
+                    ++use_counts[entries[i] - function.first];
+                continue;
+            }
+            const uint32_t count = IRModule::value_operands(op);
+            if (count > 0 && module.a[inst] != NONE)
+                ++use_counts[module.a[inst] - function.first];
+            if (count > 1)
+                ++use_counts[module.b[inst] - function.first];
+        }
+
+        assembler.bind(function_labels[index]);
+        block_labels.clear();
+        for (uint32_t block = 0; block < function.block_count; ++block)
+            block_labels.push_back(assembler.label());
+        stubs.clear();
+        epilogue = assembler.label();
+        fused = NONE;
+
+        prologue(function);
+        for (uint32_t block = 0; block < function.block_count; ++block)
+        {
+            const IRBlock &b = module.blocks[function.first_block + block];
+            assembler.bind(block_labels[block]);
+            for (uint32_t inst = b.first; inst < b.first + b.count - 1; ++inst)
+                instruction(function, inst);
+            terminator(function, function.first_block + block,
+                       block + 1 < function.block_count ? function.first_block + block + 1 : NONE);
+        }
+
+        /* the stub of a branch edge does the edge's moves, then goes where the branch meant to */
+        for (const Stub &stub: stubs)
+        {
+            assembler.bind(stub.label);
+            edge(function, stub.pred, stub.target);
+            assembler.jmp(block_labels[stub.target - function.first_block]);
+        }
+
+        assembler.bind(epilogue);
+        assembler.lea(Reg::RSP, { Reg::RBP, -8 * static_cast<int32_t>(frame_saved) });
+        for (auto reg = std::rbegin(SAVED); reg != std::rend(SAVED); ++reg)
+        {
+            if (allocator.saved & 1U << static_cast<uint32_t>(*reg))
+                assembler.pop(*reg);
+        }
+        assembler.pop(Reg::RBP);
+        assembler.ret();
+    }
+
+    void JIT::prologue(const IRFunction &function)
+    {
+        assembler.push(Reg::RBP);
+        assembler.mov(Reg::RBP, Reg::RSP);
+
+        /* below the limit run() set is a trap, not a crash */
+        assembler.mov_imm(Reg::RAX, reinterpret_cast<uintptr_t>(&stack_limit));
+        assembler.alu(Alu::CMP, Reg::RSP, Mem{ Reg::RAX, 0 });
+        assembler.jcc(Cond::B, stack_overflow);
+
+        frame_saved = 0;
+        for (const Reg reg: SAVED)
+        {
+            if (allocator.saved & 1U << static_cast<uint32_t>(reg))
+            {
+                assembler.push(reg);
+                ++frame_saved;
+            }
+        }
+
+        /* slots below the saved registers, rsp 16-aligned for calls */
+        uint32_t frame = 8 * allocator.slots;
+        if ((8 * frame_saved + frame) % 16)
+            frame += 8;
+        if (frame)
+            assembler.alu(Alu::SUB, Reg::RSP, static_cast<int32_t>(frame));
+
+        /* the arguments move from where the ABI put them to where the allocator wants them */
+        const auto params = table.args(function.type).subspan(1);
+        Placement placement;
+        stack_args.clear();
+        for (const TypeId param: params)
+        {
+            /* a register index, or STACK_ARG plus the stack word */
+            const bool floating = TypeTable::is_float(kind_of(param));
+            if (floating ? placement.floats < FLOAT_ARGS : placement.ints < std::size(INT_ARGS))
+                stack_args.push_back(floating ? placement.floats++ : placement.ints++);
+            else
+                stack_args.push_back(STACK_ARG + placement.stack++);
+        }
+
+        for (uint32_t inst = function.first; inst < function.first + function.count; ++inst)
+        {
+            if (module.ops[inst] != IROp::PARAM)
+                continue;
+            const uint32_t source = stack_args[module.a[inst]];
+            const TypeKind kind = kind_of(params[module.a[inst]]);
+            const bool on_stack = source >= STACK_ARG;
+            const Mem stack{ Reg::RBP, static_cast<int32_t>(16 + 8 * (source - STACK_ARG)) };
+
+            if (TypeTable::is_float(kind))
+            {
+                /* xmm0 is free by the time a float comes from the stack */
+                const Xmm x = on_stack ? Xmm::XMM0 : static_cast<Xmm>(source);
+                if (kind == TypeKind::F32)
+                    assembler.sse(Sse::CVTSS2SD, x, on_stack ? RM(stack) : RM(x));
+                else if (on_stack)
+                    assembler.sse(Sse::MOVSD, x, stack);
+                store(function, inst, x);
+            }
+            else
+            {
+                const Reg t = target(function, inst, Reg::RAX);
+                assembler.mov(t, on_stack ? RM(stack) : RM(INT_ARGS[source]));
+                wrap(t, kind == TypeKind::STRING ? TypeKind::U32 : kind);
+                store(function, inst, t);
+            }
+        }
+    }
+
+    void JIT::instruction(const IRFunction &function, const uint32_t inst)
+    {
+        const IROp op = module.ops[inst];
+        const TypeKind kind = kind_of(module.types[inst]);
+        const uint32_t a = module.a[inst];
+        const uint32_t b = module.b[inst];
+
+        switch (op)
+        {
+            case IROp::ADD:
+            case IROp::SUB:
+            case IROp::MUL:
+            case IROp::AND:
+            case IROp::OR:
+            case IROp::XOR:
+            {
+                if (TypeTable::is_float(kind))
+                {
+                    static constexpr Sse forms[] = { Sse::ADDSD, Sse::SUBSD, Sse::MULSD };
+                    const Xmm x = target(function, inst, Xmm::XMM0);
+                    copy(function, x, a);
+                    assembler.sse(forms[static_cast<uint8_t>(op) - static_cast<uint8_t>(IROp::ADD)], x,
+                                  operand(function, b, Xmm::XMM1));
+                    round(x, kind);
+                    store(function, inst, x);
+                    break;
+                }
+
+                static constexpr Alu forms[] = { Alu::ADD, Alu::SUB, Alu::ADD, Alu::ADD, Alu::ADD, Alu::AND, Alu::OR,
+                                                 Alu::XOR };
+                const Alu alu = forms[static_cast<uint8_t>(op) - static_cast<uint8_t>(IROp::ADD)];
+                const Reg t = target(function, inst, Reg::RAX);
+                copy(function, t, a);
+                if (op != IROp::MUL && location(function, b).kind == Location::Kind::CONSTANT &&
+                    fits_int32(immediate(b)))
+                    assembler.alu(alu, t, static_cast<int32_t>(immediate(b)));
+                else if (op == IROp::MUL)
+                    assembler.imul(t, operand(function, b, Reg::RCX));
+                else
+                    assembler.alu(alu, t, operand(function, b, Reg::RCX));
+
+                /* and, or and xor of extended values are extended already */
+                if (op == IROp::ADD || op == IROp::SUB || op == IROp::MUL)
+                    wrap(t, kind);
+                store(function, inst, t);
+                break;
+            }
+
+            case IROp::DIV:
+            case IROp::REM:
+            {
+                if (TypeTable::is_float(kind))
+                {
+                    if (op == IROp::REM)
+                    {
+                        copy(function, Xmm::XMM0, a);
+                        copy(function, Xmm::XMM1, b);
+                        call_absolute(reinterpret_cast<const void *>(&remainder_of));
+                        round(Xmm::XMM0, kind);
+                        store(function, inst, Xmm::XMM0);
+                        break;
+                    }
+                    const Xmm x = target(function, inst, Xmm::XMM0);
+                    copy(function, x, a);
+                    assembler.sse(Sse::DIVSD, x, operand(function, b, Xmm::XMM1));
+                    round(x, kind);
+                    store(function, inst, x);
+                    break;
+                }
+                division(function, inst);
+                break;
+            }
+
+            case IROp::SHL:
+            case IROp::SHR:
+            {
+                /* the count is taken modulo the width; x86 only does that for 64 */
+                copy(function, Reg::RCX, b);
+                if (width(kind) < 64)
+                    assembler.alu(Alu::AND, Reg::RCX, static_cast<int32_t>(width(kind) - 1));
+                const Reg t = target(function, inst, Reg::RAX);
+                copy(function, t, a);
+                assembler.shift(op == IROp::SHL ? Shift::SHL : is_signed(kind) ? Shift::SAR : Shift::SHR, t);
+                if (op == IROp::SHL)
+                    wrap(t, kind);
+                store(function, inst, t);
+                break;
+            }
+
+            case IROp::EQ:
+            case IROp::NE:
+            case IROp::LT:
+            case IROp::LE:
+            case IROp::GT:
+            case IROp::GE:
+                compare(function, inst);
+                break;
+
+            case IROp::NEG:
+            {
+                const Reg t = target(function, inst, Reg::RAX);
+                copy(function, t, a);
+                if (TypeTable::is_float(kind))
+                {
+                    assembler.mov_imm(Reg::RCX, 1ULL << 63);
+                    assembler.alu(Alu::XOR, t, Reg::RCX);
+                }
+                else
+                {
+                    assembler.unary(Unary::NEG, t);
+                    wrap(t, kind);
+                }
+                store(function, inst, t);
+                break;
+            }
+
+            case IROp::NOT:
+            case IROp::COMPL:
+            {
+                const Reg t = target(function, inst, Reg::RAX);
+                copy(function, t, a);
+                if (op == IROp::NOT)
+                    assembler.alu(Alu::XOR, t, 1);
+                else
+                {
+                    assembler.unary(Unary::NOT, t);
+                    wrap(t, kind);
+                }
+                store(function, inst, t);
+                break;
+            }
+
+            case IROp::CAST:
+                cast(function, inst);
+                break;
+
+            case IROp::CALL:
+                call(function, inst);
+                break;
+
+            default:
+                /* constants are used where they are needed, parameters placed by the prologue, phis by edges */
+                break;
+        }
+    }
+
+    void JIT::division(const IRFunction &function, const uint32_t inst)
+    {
+        const bool rem = module.ops[inst] == IROp::REM;
+        const TypeKind kind = kind_of(module.types[inst]);
+        const uint32_t divisor = module.b[inst];
+        const bool constant = location(function, divisor).kind == Location::Kind::CONSTANT;
+        const uint64_t imm = constant ? immediate(divisor) : 0;
+
+        copy(function, Reg::RCX, divisor);
+        if (!constant || imm == 0)
+        {
+            assembler.test(Reg::RCX, Reg::RCX);
+            assembler.jcc(Cond::E, division_by_zero);
+        }
+        copy(function, Reg::RAX, module.a[inst]);
+
+        const Label done = assembler.label();
+        if (is_signed(kind))
+        {
+            /* INT64_MIN / -1 traps in hardware; it wraps like any other overflow */
+            if (!constant || imm == ~0ULL)
+            {
+                const Label divide = assembler.label();
+                assembler.alu(Alu::CMP, Reg::RCX, -1);
+                assembler.jcc(Cond::NE, divide);
+                if (rem)
+                    assembler.mov_imm(Reg::RDX, 0);
+                else
+                    assembler.unary(Unary::NEG, Reg::RAX);
+                assembler.jmp(done);
+                assembler.bind(divide);
+            }
+            assembler.cqo();
+            assembler.unary(Unary::IDIV, Reg::RCX);
+        }
+        else
+        {
+            assembler.alu(Alu::XOR, Reg::RDX, Reg::RDX);
+            assembler.unary(Unary::DIV, Reg::RCX);
+        }
+        assembler.bind(done);
+
+        const Reg result = rem ? Reg::RDX : Reg::RAX;
+        wrap(result, kind);
+        store(function, inst, result);
+    }
+
+    void JIT::compare(const IRFunction &function, const uint32_t inst)
+    {
+        const IROp op = module.ops[inst];
+        const uint32_t a = module.a[inst];
+        const uint32_t b = module.b[inst];
+        const TypeKind kind = kind_of(module.types[a]);
+        Cond cond;
+
+        if (TypeTable::is_float(kind))
+        {
+            /* ucomisd says unordered as "below and equal", so only above and above-or-equal are false on NaN */
+            const bool swap = op == IROp::LT || op == IROp::LE;
+            const Xmm x = load(function, swap ? b : a, Xmm::XMM0);
+            assembler.sse(Sse::UCOMISD, x, operand(function, swap ? a : b, Xmm::XMM1));
+            if (op == IROp::EQ || op == IROp::NE)
+            {
+                const Reg t = target(function, inst, Reg::RAX);
+                assembler.setcc(op == IROp::EQ ? Cond::E : Cond::NE, t);
+                assembler.extend(t, t, 8, false);
+                assembler.setcc(op == IROp::EQ ? Cond::NP : Cond::P, Reg::RCX);
+                assembler.extend(Reg::RCX, Reg::RCX, 8, false);
+                assembler.alu(op == IROp::EQ ? Alu::AND : Alu::OR, t, Reg::RCX);
+                store(function, inst, t);
+                return;
+            }
+            cond = op == IROp::LT || op == IROp::GT ? Cond::A : Cond::AE;
+        }
+        else
+        {
+            const Reg r = load(function, a, Reg::RAX);
+            if (location(function, b).kind == Location::Kind::CONSTANT && fits_int32(immediate(b)))
+                assembler.alu(Alu::CMP, r, static_cast<int32_t>(immediate(b)));
+            else
+                assembler.alu(Alu::CMP, r, operand(function, b, Reg::RCX));
+
+            const bool sign = is_signed(kind);
+            switch (op)
+            {
+                case IROp::EQ:
+                    cond = Cond::E;
+                    break;
+                case IROp::NE:
+                    cond = Cond::NE;
+                    break;
+                case IROp::LT:
+                    cond = sign ? Cond::L : Cond::B;
+                    break;
+                case IROp::LE:
+                    cond = sign ? Cond::LE : Cond::BE;
+                    break;
+                case IROp::GT:
+                    cond = sign ? Cond::G : Cond::A;
+                    break;
+                default:
+                    cond = sign ? Cond::GE : Cond::AE;
+                    break;
+            }
+        }
+
+        const uint32_t next = inst + 1;
+        if (module.ops[next] == IROp::BRANCH && module.a[next] == inst && use_counts[inst - function.first] == 1)
+        {
+            fused = inst;
+            fused_cond = cond;
+            return;
+        }
+
+        const Reg t = target(function, inst, Reg::RAX);
+        assembler.setcc(cond, t);
+        assembler.extend(t, t, 8, false);
+        store(function, inst, t);
+    }
+
+    void JIT::cast(const IRFunction &function, const uint32_t inst)
+    {
+        const uint32_t value = module.a[inst];
+        const TypeKind from = kind_of(module.types[value]);
+        const TypeKind to = kind_of(module.types[inst]);
+
+        if (LinearScan::calls(module, inst))
+        {
+            copy(function, Reg::RSI, value);
+            assembler.mov_imm(Reg::RDI, static_cast<uint64_t>(from) | static_cast<uint64_t>(to) << 8);
+            call_absolute(reinterpret_cast<const void *>(&convert_bits));
+            store(function, inst, Reg::RAX);
+            return;
+        }
+
+        if (to == TypeKind::BOOL)
+        {
+            /* doubled, a float's bits are zero for both zeros only; NaN stays nonzero */
+            if (TypeTable::is_float(from))
+            {
+                copy(function, Reg::RAX, value);
+                assembler.alu(Alu::ADD, Reg::RAX, Reg::RAX);
+            }
+            else
+            {
+                const Reg r = load(function, value, Reg::RAX);
+                assembler.test(r, r);
+            }
+            const Reg t = target(function, inst, Reg::RAX);
+            assembler.setcc(Cond::NE, t);
+            assembler.extend(t, t, 8, false);
+            store(function, inst, t);
+            return;
+        }
+
+        if (TypeTable::is_float(to))
+        {
+            const Xmm x = target(function, inst, Xmm::XMM0);
+            if (TypeTable::is_float(from))
+            {
+                copy(function, x, value);
+                round(x, to);
+            }
+            else if (to == TypeKind::F32)
+            {
+                /* straight to single precision, a detour through double would round twice */
+                assembler.cvtsi2ss(x, operand(function, value, Reg::RAX));
+                assembler.sse(Sse::CVTSS2SD, x, x);
+            }
+            else
+                assembler.cvtsi2sd(x, operand(function, value, Reg::RAX));
+            store(function, inst, x);
+            return;
+        }
+
+        const Reg t = target(function, inst, Reg::RAX);
+        copy(function, t, value);
+        wrap(t, to);
+        store(function, inst, t);
+    }
+
+    void JIT::call(const IRFunction &function, const uint32_t inst)
+    {
+        const auto entries = module.list(inst);
+        const auto args = entries.subspan(1);
+
+        /* the stack words first, as they go through rax and xmm0, then the registers */
+        Placement placement;
+        stack_args.clear();
+        for (const uint32_t arg: args)
+        {
+            const bool floating = TypeTable::is_float(kind_of(module.types[arg]));
+            if (floating ? placement.floats++ >= FLOAT_ARGS : placement.ints++ >= std::size(INT_ARGS))
+                stack_args.push_back(arg);
+        }
+
+        const uint32_t bytes = 8 * static_cast<uint32_t>(stack_args.size() + stack_args.size() % 2);
+        if (stack_args.size() % 2)
+            assembler.alu(Alu::SUB, Reg::RSP, 8);
+        for (auto arg = stack_args.rbegin(); arg != stack_args.rend(); ++arg)
+        {
+            const TypeKind kind = kind_of(module.types[*arg]);
+            if (TypeTable::is_float(kind))
+            {
+                copy(function, Xmm::XMM0, *arg);
+                if (kind == TypeKind::F32)
+                    assembler.sse(Sse::CVTSD2SS, Xmm::XMM0, Xmm::XMM0);
+                assembler.alu(Alu::SUB, Reg::RSP, 8);
+                assembler.movsd({ Reg::RSP, 0 }, Xmm::XMM0);
+            }
+            else
+                assembler.push(load(function, *arg, Reg::RAX));
+        }
+
+        uint32_t floats = 0;
+        for (const uint32_t arg: args)
+        {
+            const TypeKind kind = kind_of(module.types[arg]);
+            if (!TypeTable::is_float(kind) || floats >= FLOAT_ARGS)
+                continue;
+            const auto x = static_cast<Xmm>(floats++);
+            copy(function, x, arg);
+            if (kind == TypeKind::F32)
+                assembler.sse(Sse::CVTSD2SS, x, x);
+        }
+        uint32_t ints = 0;
+        for (const uint32_t arg: args)
+        {
+            if (!TypeTable::is_float(kind_of(module.types[arg])) && ints < std::size(INT_ARGS))
+                copy(function, INT_ARGS[ints++], arg);
+        }
+
+        assembler.call(function_labels[entries[0]]);
+        if (bytes)
+            assembler.alu(Alu::ADD, Reg::RSP, static_cast<int32_t>(bytes));
+
+        const TypeKind kind = kind_of(module.types[inst]);
+        if (TypeTable::is_float(kind))
+        {
+            if (kind == TypeKind::F32)
+                assembler.sse(Sse::CVTSS2SD, Xmm::XMM0, Xmm::XMM0);
+            store(function, inst, Xmm::XMM0);
+        }
+        else
+            store(function, inst, Reg::RAX);
+    }
+
+    void JIT::terminator(const IRFunction &function, const uint32_t block, const uint32_t next)
+    {
+        const IRBlock &b = module.blocks[block];
+        const uint32_t inst = b.first + b.count - 1;
+        const auto label = [&](const uint32_t target) { return block_labels[target - function.first_block]; };
+
+        switch (module.ops[inst])
+        {
+            case IROp::JUMP:
+            {
+                edge(function, block, b.succs[0]);
+                if (b.succs[0] != next)
+                    assembler.jmp(label(b.succs[0]));
+                break;
+            }
+
+            case IROp::BRANCH:
+            {
+                /* an edge into phis cannot share the block's code with the other edge, so it gets a stub */
+                Label targets[2];
+                bool direct[2];
+                for (uint32_t i = 0; i < 2; ++i)
+                {
+                    direct[i] = module.ops[module.blocks[b.succs[i]].first] != IROp::PHI;
+                    targets[i] = direct[i] ? label(b.succs[i]) : assembler.label();
+                    if (!direct[i])
+                        stubs.push_back({ targets[i], block, b.succs[i] });
+                }
+
+                const uint32_t condition = module.a[inst];
+                Cond cond = Cond::NE;
+                if (fused == condition)
+                    cond = fused_cond;
+                else
+                {
+                    const Location where = location(function, condition);
+                    if (where.kind == Location::Kind::CONSTANT)
+                    {
+                        assembler.jmp(targets[immediate(condition) ? 0 : 1]);
+                        break;
+                    }
+                    if (where.kind == Location::Kind::GPR)
+                        assembler.test(static_cast<Reg>(where.index), static_cast<Reg>(where.index));
+                    else
+                        assembler.alu(Alu::CMP, slot(where.index), 0);
+                }
+                fused = NONE;
+
+                const auto negate = static_cast<Cond>(static_cast<uint8_t>(cond) ^ 1);
+                if (direct[1] && b.succs[1] == next)
+                    assembler.jcc(cond, targets[0]);
+                else if (direct[0] && b.succs[0] == next)
+                    assembler.jcc(negate, targets[1]);
+                else
+                {
+                    assembler.jcc(cond, targets[0]);
+                    assembler.jmp(targets[1]);
+                }
+                break;
+            }
+
+            default:
+            {
+                const uint32_t value = module.a[inst];
+                if (value != NONE)
+                {
+                    const TypeKind kind = kind_of(module.types[value]);
+                    if (TypeTable::is_float(kind))
+                    {
+                        copy(function, Xmm::XMM0, value);
+                        if (kind == TypeKind::F32)
+                            assembler.sse(Sse::CVTSD2SS, Xmm::XMM0, Xmm::XMM0);
+                    }
+                    else
+                        copy(function, Reg::RAX, value);
+                }
+                assembler.jmp(epilogue);
+                break;
+            }
+        }
+    }
+
+    void JIT::edge(const IRFunction &function, const uint32_t pred, const uint32_t target)
+    {
+        const auto preds = module.preds(target);
+        const auto slot = static_cast<uint32_t>(std::ranges::find(preds, pred) - preds.begin());
+
+        moves.clear();
+        for (uint32_t inst = module.blocks[target].first; module.ops[inst] == IROp::PHI; ++inst)
+        {
+            const uint32_t value = module.list(inst)[slot];
+            const Location dst = location(function, inst);
+            const Location src = location(function, value);
+            if (dst != src)
+                moves.push_back({ dst, src, value, TypeTable::is_float(kind_of(module.types[inst])) });
+        }
+
+        /* a parallel copy, made sequential: a move goes once nothing left still reads its destination */
+        while (!moves.empty())
+        {
+            const auto ready = std::ranges::find_if(moves, [&](const Move &m)
+            {
+                return std::ranges::none_of(moves, [&](const Move &other) { return other.src == m.dst; });
+            });
+
+            if (ready != moves.end())
+            {
+                move(*ready);
+                *ready = moves.back();
+                moves.pop_back();
+                continue;
+            }
+
+            /* only cycles are left; save one destination, and its readers read the copy */
+            const Location saved = moves.front().dst;
+            const bool floating = moves.front().floating;
+            const Location temp = floating
+                                      ? Location{ Location::Kind::XMM, static_cast<uint32_t>(Xmm::XMM0) }
+                                      : Location{ Location::Kind::GPR, static_cast<uint32_t>(Reg::RAX) };
+            move({ temp, saved, NONE, floating });
+            for (Move &m: moves)
+            {
+                if (m.src == saved)
+                    m.src = temp;
+            }
+        }
+    }
+
+    void JIT::move(const Move &m)
+    {
+        using Kind = Location::Kind;
+        const Kind dst = m.dst.kind;
+        const Kind src = m.src.kind;
+
+        if (src == Kind::CONSTANT)
+        {
+            const uint64_t imm = immediate(m.value);
+            if (dst == Kind::GPR)
+                assembler.mov_imm(static_cast<Reg>(m.dst.index), imm);
+            else if (dst == Kind::SLOT && fits_int32(imm))
+                assembler.mov_imm(slot(m.dst.index), static_cast<int32_t>(imm));
+            else
+            {
+                assembler.mov_imm(Reg::RCX, imm);
+                if (dst == Kind::XMM)
+                    assembler.movq(static_cast<Xmm>(m.dst.index), Reg::RCX);
+                else
+                    assembler.mov(slot(m.dst.index), Reg::RCX);
+            }
+            return;
+        }
+
+        /* slot to slot goes through rcx, whatever the bits are */
+        if (dst == Kind::SLOT && src == Kind::SLOT)
+        {
+            assembler.mov(Reg::RCX, slot(m.src.index));
+            assembler.mov(slot(m.dst.index), Reg::RCX);
+        }
+        else if (dst == Kind::SLOT)
+        {
+            if (src == Kind::XMM)
+                assembler.movsd(slot(m.dst.index), static_cast<Xmm>(m.src.index));
+            else
+                assembler.mov(slot(m.dst.index), static_cast<Reg>(m.src.index));
+        }
+        else if (dst == Kind::XMM)
+        {
+            const auto x = static_cast<Xmm>(m.dst.index);
+            assembler.sse(Sse::MOVSD, x, src == Kind::SLOT ? RM(slot(m.src.index)) : RM(static_cast<Xmm>(m.src.index)));
+        }
+        else
+        {
+            const auto r = static_cast<Reg>(m.dst.index);
+            assembler.mov(r, src == Kind::SLOT ? RM(slot(m.src.index)) : RM(static_cast<Reg>(m.src.index)));
+        }
+    }
+
+    void JIT::thunk(const uint32_t index)
+    {
+        /* uint32_t thunk(const uint64_t *args, uint64_t *result), returning the Trap */
+        thunks.push_back(assembler.size());
+        assembler.push(Reg::RBP);
+        assembler.mov(Reg::RBP, Reg::RSP);
+        for (const Reg reg: SAVED)
+            assembler.push(reg);
+        assembler.mov_imm(Reg::RAX, reinterpret_cast<uintptr_t>(&exit_sp));
+        assembler.mov(Mem{ Reg::RAX, 0 }, Reg::RSP);
+        assembler.push(Reg::RSI);
+        assembler.mov(Reg::R11, Reg::RDI);
+
+        const auto params = table.args(module.functions[index].type).subspan(1);
+        Placement placement;
+        stack_args.clear();
+        for (uint32_t i = 0; i < params.size(); ++i)
+        {
+            const bool floating = TypeTable::is_float(kind_of(params[i]));
+            if (floating ? placement.floats++ >= FLOAT_ARGS : placement.ints++ >= std::size(INT_ARGS))
+                stack_args.push_back(i);
+        }
+
+        const uint32_t bytes = 8 * static_cast<uint32_t>(stack_args.size() + stack_args.size() % 2);
+        if (stack_args.size() % 2)
+            assembler.alu(Alu::SUB, Reg::RSP, 8);
+        for (auto i = stack_args.rbegin(); i != stack_args.rend(); ++i)
+        {
+            const Mem arg{ Reg::R11, static_cast<int32_t>(8 * *i) };
+            if (kind_of(params[*i]) == TypeKind::F32)
+            {
+                assembler.sse(Sse::MOVSD, Xmm::XMM0, arg);
+                assembler.sse(Sse::CVTSD2SS, Xmm::XMM0, Xmm::XMM0);
+                assembler.alu(Alu::SUB, Reg::RSP, 8);
+                assembler.movsd({ Reg::RSP, 0 }, Xmm::XMM0);
+            }
+            else
+            {
+                assembler.mov(Reg::RAX, arg);
+                assembler.push(Reg::RAX);
+            }
+        }
+
+        uint32_t ints = 0;
+        uint32_t floats = 0;
+        for (uint32_t i = 0; i < params.size(); ++i)
+        {
+            const TypeKind kind = kind_of(params[i]);
+            const Mem arg{ Reg::R11, static_cast<int32_t>(8 * i) };
+            if (TypeTable::is_float(kind) && floats < FLOAT_ARGS)
+            {
+                const auto x = static_cast<Xmm>(floats++);
+                assembler.sse(Sse::MOVSD, x, arg);
+                if (kind == TypeKind::F32)
+                    assembler.sse(Sse::CVTSD2SS, x, x);
+            }
+            else if (!TypeTable::is_float(kind) && ints < std::size(INT_ARGS))
+                assembler.mov(INT_ARGS[ints++], arg);
+        }
+
+        assembler.call(function_labels[index]);
+        if (bytes)
+            assembler.alu(Alu::ADD, Reg::RSP, static_cast<int32_t>(bytes));
+        assembler.pop(Reg::RSI);
+
+        const TypeKind returns = kind_of(table.args(module.functions[index].type)[0]);
+        if (TypeTable::is_float(returns))
+        {
+            if (returns == TypeKind::F32)
+                assembler.sse(Sse::CVTSS2SD, Xmm::XMM0, Xmm::XMM0);
+            assembler.movsd({ Reg::RSI, 0 }, Xmm::XMM0);
+        }
+        else if (returns != TypeKind::VOID)
+            assembler.mov(Mem{ Reg::RSI, 0 }, Reg::RAX);
+
+        assembler.mov_imm(Reg::RAX, reinterpret_cast<uintptr_t>(&exit_sp));
+        assembler.mov_imm(Mem{ Reg::RAX, 0 }, 0);
+        assembler.alu(Alu::XOR, Reg::RAX, Reg::RAX);
+        for (auto reg = std::rbegin(SAVED); reg != std::rend(SAVED); ++reg)
+            assembler.pop(*reg);
+        assembler.pop(Reg::RBP);
+        assembler.ret();
+    }
+
+    void JIT::traps()
+    {
+        /* back to the thunk's frame, as if the call it made had returned, with the trap in eax */
+        const Label unwind = assembler.label();
+        const Label entered = assembler.label();
+        assembler.bind(division_by_zero);
+        assembler.mov_imm(Reg::RAX, static_cast<uint64_t>(Trap::DIVISION_BY_ZERO));
+        assembler.jmp(unwind);
+        assembler.bind(stack_overflow);
+        assembler.mov_imm(Reg::RAX, static_cast<uint64_t>(Trap::STACK_OVERFLOW));
+
+        assembler.bind(unwind);
+        assembler.mov_imm(Reg::RCX, reinterpret_cast<uintptr_t>(&exit_sp));
+        assembler.mov(Reg::RDX, Mem{ Reg::RCX, 0 });
+        assembler.test(Reg::RDX, Reg::RDX);
+        assembler.jcc(Cond::NE, entered);
+        assembler.ud2(); /* not entered through run() */
+
+        assembler.bind(entered);
+        assembler.mov(Reg::RSP, Reg::RDX);
+        assembler.mov_imm(Mem{ Reg::RCX, 0 }, 0);
+        for (auto reg = std::rbegin(SAVED); reg != std::rend(SAVED); ++reg)
+            assembler.pop(*reg);
+        assembler.pop(Reg::RBP);
+        assembler.ret();
+    }
+
+    Location JIT::location(const IRFunction &function, const uint32_t value) const
+    {
+        return allocator.locations[value - function.first];
+    }
+
+    uint64_t JIT::immediate(const uint32_t value) const
+    {
+        switch (module.ops[value])
+        {
+            case IROp::CONST:
+                return constants.constants[module.a[value]].bits;
+            case IROp::STRING:
+                return module.a[value];
+            default:
+                return 0;
+        }
+    }
+
+    Mem JIT::slot(const uint32_t index) const
+    {
+        return { Reg::RBP, -8 * static_cast<int32_t>(frame_saved + 1 + index) };
+    }
+
+    RM JIT::operand(const IRFunction &function, const uint32_t value, const Reg scratch)
+    {
+        const Location where = location(function, value);
+        switch (where.kind)
+        {
+            case Location::Kind::GPR:
+                return static_cast<Reg>(where.index);
+            case Location::Kind::SLOT:
+                return slot(where.index);
+            default:
+                copy(function, scratch, value);
+                return scratch;
+        }
+    }
+
+    RM JIT::operand(const IRFunction &function, const uint32_t value, const Xmm scratch)
+    {
+        const Location where = location(function, value);
+        switch (where.kind)
+        {
+            case Location::Kind::XMM:
+                return static_cast<Xmm>(where.index);
+            case Location::Kind::SLOT:
+                return slot(where.index);
+            default:
+                copy(function, scratch, value);
+                return scratch;
+        }
+    }
+
+    Reg JIT::load(const IRFunction &function, const uint32_t value, const Reg scratch)
+    {
+        const Location where = location(function, value);
+        if (where.kind == Location::Kind::GPR)
+            return static_cast<Reg>(where.index);
+        copy(function, scratch, value);
+        return scratch;
+    }
+
+    Xmm JIT::load(const IRFunction &function, const uint32_t value, const Xmm scratch)
+    {
+        const Location where = location(function, value);
+        if (where.kind == Location::Kind::XMM)
+            return static_cast<Xmm>(where.index);
+        copy(function, scratch, value);
+        return scratch;
+    }
+
+    void JIT::copy(const IRFunction &function, const Reg dst, const uint32_t value)
+    {
+        const Location where = location(function, value);
+        switch (where.kind)
+        {
+            case Location::Kind::GPR:
+                if (static_cast<Reg>(where.index) != dst)
+                    assembler.mov(dst, static_cast<Reg>(where.index));
+                break;
+            case Location::Kind::XMM:
+                assembler.movq(dst, static_cast<Xmm>(where.index));
+                break;
+            case Location::Kind::SLOT:
+                assembler.mov(dst, slot(where.index));
+                break;
+            default:
+                assembler.mov_imm(dst, immediate(value));
+                break;
+        }
+    }
+
+    void JIT::copy(const IRFunction &function, const Xmm dst, const uint32_t value)
+    {
+        const Location where = location(function, value);
+        switch (where.kind)
+        {
+            case Location::Kind::XMM:
+                if (static_cast<Xmm>(where.index) != dst)
+                    assembler.sse(Sse::MOVSD, dst, static_cast<Xmm>(where.index));
+                break;
+            case Location::Kind::SLOT:
+                assembler.sse(Sse::MOVSD, dst, slot(where.index));
+                break;
+            default:
+                /* a constant; the bits go through rcx */
+                assembler.mov_imm(Reg::RCX, immediate(value));
+                assembler.movq(dst, Reg::RCX);
+                break;
+        }
+    }
+
+    Reg JIT::target(const IRFunction &function, const uint32_t inst, const Reg scratch) const
+    {
+        const Location where = location(function, inst);
+        return where.kind == Location::Kind::GPR ? static_cast<Reg>(where.index) : scratch;
+    }
+
+    Xmm JIT::target(const IRFunction &function, const uint32_t inst, const Xmm scratch) const
+    {
+        const Location where = location(function, inst);
+        return where.kind == Location::Kind::XMM ? static_cast<Xmm>(where.index) : scratch;
+    }
+
+    void JIT::store(const IRFunction &function, const uint32_t inst, const Reg from)
+    {
+        const Location where = location(function, inst);
+        switch (where.kind)
+        {
+            case Location::Kind::GPR:
+                if (static_cast<Reg>(where.index) != from)
+                    assembler.mov(static_cast<Reg>(where.index), from);
+                break;
+            case Location::Kind::XMM:
+                assembler.movq(static_cast<Xmm>(where.index), from);
+                break;
+            case Location::Kind::SLOT:
+                assembler.mov(slot(where.index), from);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void JIT::store(const IRFunction &function, const uint32_t inst, const Xmm from)
+    {
+        const Location where = location(function, inst);
+        if (where.kind == Location::Kind::XMM && static_cast<Xmm>(where.index) != from)
+            assembler.sse(Sse::MOVSD, static_cast<Xmm>(where.index), from);
+        else if (where.kind == Location::Kind::SLOT)
+            assembler.movsd(slot(where.index), from);
+    }
+
+    void JIT::wrap(const Reg reg, const TypeKind kind)
+    {
+        const uint32_t bits = width(kind);
+        if (bits < 64)
+            assembler.extend(reg, reg, bits, is_signed(kind));
+    }
+
+    void JIT::round(const Xmm reg, const TypeKind kind)
+    {
+        if (kind != TypeKind::F32)
+            return;
+        assembler.sse(Sse::CVTSD2SS, reg, reg);
+        assembler.sse(Sse::CVTSS2SD, reg, reg);
+    }
+
+    void JIT::call_absolute(const void *address)
+    {
+        assembler.mov_imm(Reg::RAX, reinterpret_cast<uintptr_t>(address));
+        assembler.call(Reg::RAX);
+    }
+}
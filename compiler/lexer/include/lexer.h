@@ -4,31 +4,94 @@
 #pragma once
 
 #include <memory>
+#include <memory_resource>
 #include <span>
+#include <string_view>
 #include "../../interfaces/include/tokens.h"
+#include "simd.h"
+#include "source.h"
 
 namespace klr::compiler
 {
+    class Interner;
+
     class alignas(64) Lexer
     {
     public:
         std::string_view module_name;
 
-        explicit Lexer(std::string_view mod_name, std::string_view src);
+        /*
+         * throws std::length_error if src does not fit offset_t; the token side
+         * tables are allocated from resource, e.g. the module's Arena. with an
+         * interner, usually shared by every module, names are interned into
+         * TokenList::atoms as part of tokenizing
+         */
+        explicit Lexer(std::string_view mod_name, std::string_view src, simd::Level max_simd = simd::Level::AVX2,
+                       std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+                       Interner *interner = nullptr);
+
+        /* lexes straight from the mapping; its zero padding lets block probes run up to EOF */
+        explicit Lexer(std::string_view mod_name, const SourceFile &file, simd::Level max_simd = simd::Level::AVX2,
+                       std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+                       Interner *interner = nullptr);
 
+        /* moves the tokens out; the lexer is spent afterwards */
         std::unique_ptr<TokenList> tokenize();
 
-        std::unique_ptr<std::vector<uint32_t>> get_line_starts();
+        /*
+         * same result as tokenize(), lexed as newline-aligned chunks on
+         * `threads` workers (0 = hardware concurrency); inputs below
+         * 2 * min_chunk bytes are lexed serially
+         */
+        std::unique_ptr<TokenList> tokenize_parallel(uint32_t threads = 0, uint32_t min_chunk = 1 << 18);
+
+        /* moves the line table out; call once, after tokenizing */
+        std::unique_ptr<std::vector<offset_t>> get_line_starts();
 
     private:
         TokenList tokens;
-        std::vector<uint32_t> line_starts;
+        std::vector<offset_t> line_starts;
         std::span<const char> src;
-        uint32_t current_pos;
-        uint32_t src_length;
+        const simd::Kernels &scan;
+        Interner *interner;
+        offset_t current_pos;
+        offset_t src_length;
+        offset_t scan_limit; /* readable bytes; past src_length they are zero */
+        mutable offset_t long_len = 0; /* real length of the last token lexed as LONG_TOKEN */
+        mutable NumLiteral number {}; /* value of the last NUM_LITERAL, valid if has_number */
+        mutable bool has_number = false;
+
+        /* tokenize_parallel() chunk state */
+        struct Chunk
+        {
+            offset_t begin; /* first byte this chunk lexes from */
+            offset_t stop;  /* tokens starting at or after this belong to the next chunk */
+            offset_t first; /* start of the first token found after begin */
+            offset_t sync;  /* start of the first token left to the next chunk */
+            bool eof;       /* reached END_OF_FILE, later chunks are dead */
+            TokenList tokens;
+            std::vector<offset_t> line_starts;
+        };
+
+        void lex_chunk(Chunk &chunk) const;
 
+        /* StreamLexer entry point; lexes into out and returns where the next window resumes */
+        friend class StreamLexer;
+
+        offset_t lex_window(TokenList &out, bool last);
+
+        /* the token at current_pos, without consuming it; exactly one per call and never pushed here */
         Token next_token();
 
+        /* Token::len for a token of `len` bytes; oversized ones become LONG_TOKEN */
+        [[nodiscard]] uint16_t fit_len(size_t len) const;
+
+        /* real length of a token returned by the last next_token() */
+        [[nodiscard]] offset_t length_of(const Token &t) const;
+
+        /* appends t, recording its real length if it is a LONG_TOKEN and its value if it is a number */
+        void push(TokenList &list, const Token &t) const;
+
         void skip_whitespace_comment();
 
         [[nodiscard]] Token lex_identifier() const;
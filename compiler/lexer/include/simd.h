@@ -0,0 +1,53 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "../../interfaces/include/tokens.h"
+
+namespace klr::compiler::simd
+{
+    using compiler::offset_t;
+
+    enum class Level : uint8_t
+    {
+        SCALAR,
+        SSE42,
+        AVX2
+    };
+
+    /*
+     * block scanners for the lexer's hot loops
+     *
+     * every scanner only consumes whole blocks that lie inside [pos, limit)
+     * and returns the position it stopped at; whatever is left (a hit or a
+     * partial block near EOF) is finished by the scalar loop, so the output
+     * is byte-for-byte identical regardless of the level picked
+     */
+    struct Kernels
+    {
+        Level level;
+
+        /* skips ' ', '\t', '\n', '\r' and appends (pos + 1) of every '\n' */
+        offset_t (*skip_whitespace)(const char *src, offset_t pos, offset_t limit,
+                                    std::vector<offset_t> &line_starts);
+
+        /* advances to the next '\n' */
+        offset_t (*find_newline)(const char *src, offset_t pos, offset_t limit);
+
+        /* advances to the '*' of the next comment terminator, recording the newlines skipped */
+        offset_t (*find_comment_end)(const char *src, offset_t pos, offset_t limit,
+                                     std::vector<offset_t> &line_starts);
+
+        /* advances to the next '"' or '\\', the only bytes a string literal has to look at */
+        offset_t (*find_quote_or_escape)(const char *src, offset_t pos, offset_t limit);
+    };
+
+    /* highest level supported by the running CPU; resolved once */
+    Level detect();
+
+    /* best kernels not exceeding max and supported by the running CPU */
+    const Kernels &kernels(Level max = Level::AVX2);
+}
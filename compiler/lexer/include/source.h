@@ -0,0 +1,54 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+namespace klr::compiler
+{
+    /*
+     * read-only source file mapped straight into memory
+     *
+     * the mapping is followed by at least PADDING zero bytes, so block
+     * probes may read past the end without bounds checks; a NUL is never
+     * whitespace, a digit or a newline, so every probe stops on it
+     */
+    class SourceFile
+    {
+    public:
+        static constexpr size_t PADDING = 64;
+
+        /* throws std::system_error if the file cannot be opened or mapped */
+        explicit SourceFile(const std::filesystem::path &path);
+
+        ~SourceFile();
+
+        SourceFile(SourceFile &&other) noexcept;
+
+        SourceFile &operator=(SourceFile &&other) noexcept;
+
+        SourceFile(const SourceFile &) = delete;
+
+        SourceFile &operator=(const SourceFile &) = delete;
+
+        [[nodiscard]] std::string_view view() const
+        {
+            return { data, length };
+        }
+
+        [[nodiscard]] size_t size() const
+        {
+            return length;
+        }
+
+    private:
+        char *data = nullptr;
+        size_t length = 0;
+        size_t mapped = 0; /* bytes reserved, including the padding; 0 if heap backed */
+
+        void release();
+    };
+}
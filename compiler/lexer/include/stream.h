@@ -0,0 +1,68 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <functional>
+#include <string_view>
+#include <vector>
+#include "../../interfaces/include/tokens.h"
+#include "simd.h"
+#include "source.h"
+
+namespace klr::compiler
+{
+    /*
+     * pull-based tokenizer for inputs that are never fully resident
+     * (pipes, generator processes, files above 4 GiB)
+     *
+     * input is read into a bounded window; every batch holds the complete
+     * tokens of one window and the incomplete tail is carried into the
+     * next one. memory stays at the window size, which only grows when a
+     * single token or comment does not fit into it
+     */
+    class StreamLexer
+    {
+    public:
+        /* fills up to `capacity` bytes, returns the count; 0 ends the input */
+        using Reader = std::function<size_t(char *buffer, size_t capacity)>;
+
+        std::string_view module_name;
+
+        explicit StreamLexer(std::string_view mod_name, Reader reader, uint32_t window = 1 << 20,
+                             simd::Level max_simd = simd::Level::AVX2);
+
+        /*
+         * replaces the contents of `out` (reusing its storage) with the next
+         * batch, token starts relative to batch_base(); the last batch ends
+         * with END_OF_FILE. returns false once there is nothing left
+         */
+        bool next_batch(TokenList &out);
+
+        /* absolute input offset the starts of the last batch are relative to */
+        [[nodiscard]] uint64_t batch_base() const
+        {
+            return last_base;
+        }
+
+    private:
+        Reader reader;
+        std::vector<char> window; /* followed by SourceFile::PADDING zero bytes past `filled`, the lexer reads ahead */
+        simd::Level max_simd;
+        uint32_t filled = 0;
+        uint64_t base = 0;      /* absolute offset of window[0] */
+        uint64_t last_base = 0;
+        bool input_done = false;
+        bool finished = false;
+
+        void fill();
+
+        /* zeroes the padding after the filled bytes */
+        void pad();
+
+        [[nodiscard]] size_t capacity() const
+        {
+            return window.size() - SourceFile::PADDING;
+        }
+    };
+}
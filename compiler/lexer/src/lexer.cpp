@@ -2,7 +2,14 @@
 // See LICENSE.txt for details
 
 #include <compiler/lexer/include/lexer.h>
+#include <compiler/memory/include/interner.h>
+#include <algorithm>
+#include <bit>
+#include <charconv>
 #include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <thread>
 
 namespace klr::compiler
 {
@@ -22,16 +29,35 @@ namespace klr::compiler
         std::array<uint8_t, 256> types {};
         for (auto i = 0; i < 256; ++i)
         {
+            /* <cctype> only promises non-zero, glibc returns the mask bit */
             types[i] = (i == ' ' || i == '\t' || i == '\n' || i == '\r') * 1 +
                        (i == '/') * 2 +
                        (i == '*') * 3 +
-                       (std::isalpha(i) || i == '_' || i == '@') * 4 +
-                       std::isdigit(i) * 5 +
+                       (std::isalpha(i) != 0 || i == '_' || i == '@') * 4 +
+                       (std::isdigit(i) != 0) * 5 +
                        (i == '"') * 6;
         }
         return types;
     }();
 
+    // identifier byte classes, independent of the C locale
+    // 0 = invalid (ends the identifier as UNKNOWN)
+    // 1 = identifier continuation (letter, digit, _)
+    // 2 = terminator (whitespace or punctuation)
+    static constexpr std::array<uint8_t, 256> ident_class = []
+    {
+        std::array<uint8_t, 256> classes {};
+        for (auto i = 0; i < 256; ++i)
+        {
+            const bool is_alnum = (i >= 'a' && i <= 'z') || (i >= 'A' && i <= 'Z') || (i >= '0' && i <= '9');
+            const bool is_space = i == ' ' || (i >= '\t' && i <= '\r');
+            const bool is_punct = (i >= '!' && i <= '/') || (i >= ':' && i <= '@') ||
+                                  (i >= '[' && i <= '`') || (i >= '{' && i <= '~');
+            classes[i] = (is_alnum || i == '_') ? 1 : (is_space || is_punct) ? 2 : 0;
+        }
+        return classes;
+    }();
+
     static constexpr std::array<TokenType, 256> single_char_tokens = []
     {
         /* align data + 256 bytes for SIMD */
@@ -66,6 +92,12 @@ namespace klr::compiler
         return tokens;
     }();
 
+    /* [`<<` or `>>`][followed by '='] */
+    static constexpr TokenType shift_types[2][2] = {
+        { TokenType::LEFT_SHIFT, TokenType::LEFT_SHIFT_EQ },
+        { TokenType::RIGHT_SHIFT, TokenType::RIGHT_SHIFT_EQ },
+    };
+
     static constexpr std::array<uint8_t, 256> hex_lookup = []
     {
         std::array<uint8_t, 256> table {};
@@ -98,58 +130,149 @@ namespace klr::compiler
         return condition ? static_cast<uint8_t>(flag) : 0;
     }
 
-    Lexer::Lexer(const std::string_view mod_name, const std::string_view src) : module_name(mod_name), src(src.data(), src.size())
-                                               , current_pos(0)
-                                               , src_length(src.length())
+    // SWAR: eight ASCII digits to their value with three multiplies.
+    // the first digit sits in the lowest byte, so this needs little endian
+    static uint32_t parse_eight_digits(uint64_t chunk)
     {
-        tokens.reserve(src.length() / 4);
-        line_starts.reserve(src.length() / 40);
-        line_starts.emplace_back(0);
+        chunk -= 0x3030303030303030ULL;
+        chunk = chunk * 10 + (chunk >> 8);
+        chunk = ((chunk & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)) +
+                 ((chunk >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32))) >> 32;
+        return static_cast<uint32_t>(chunk);
     }
 
-    void Lexer::skip_whitespace_comment()
+    /* [p, end) holds decimal digits only; false on u64 overflow */
+    static bool decode_decimal(const char *p, const char *end, uint64_t &value)
     {
-        /*
-         * fast path for more than 8 chars
-         * that compiles to a guaranteed SIMD
-         * handles both single & multi-line comments
-         * tracks line starts for later pipeline
-         * falls back to char-by-char near ROF
-         */
-        while (current_pos + 8 <= src_length)
+        value = 0;
+        if constexpr (std::endian::native == std::endian::little)
         {
-            uint64_t chunk;
-            memcpy(&chunk, src.data() + current_pos, sizeof(chunk));
-            const uint64_t ws_mask = (chunk == 0x2020202020202020ULL) |                           // spaces
-                                     (chunk == 0x0909090909090909ULL) |                           // tabs
-                                     ((chunk & 0xDFDFDFDFDFDFDFDFULL) == 0x0A0A0A0A0A0A0A0AULL) | // \n
-                                     ((chunk & 0xDFDFDFDFDFDFDFDFULL) == 0x0D0D0D0D0D0D0D0DULL);  // \r
-
-            if (ws_mask == 0xFFFFFFFFFFFFFFFFULL)
+            for (; end - p >= 8; p += 8)
             {
-                if (const uint64_t newline_mask = (chunk & 0xDFDFDFDFDFDFDFDFULL) == 0x0A0A0A0A0A0A0A0AULL)
-                {
-                    const uint64_t newline_positions = newline_mask & chunk;
-                    for (auto i = 0; i < 8; ++i)
-                    {
-                        if (newline_positions & (1ULL << (i * 8)))
-                        {
-                            line_starts.emplace_back(current_pos + i + 1);
-                        }
-                    }
-                }
+                uint64_t chunk;
+                memcpy(&chunk, p, sizeof(chunk));
+                if (__builtin_mul_overflow(value, 100000000ULL, &value) ||
+                    __builtin_add_overflow(value, parse_eight_digits(chunk), &value))
+                    return false;
+            }
+        }
+
+        for (; p < end; ++p)
+        {
+            if (__builtin_mul_overflow(value, 10ULL, &value) ||
+                __builtin_add_overflow(value, static_cast<uint64_t>(*p - '0'), &value))
+                return false;
+        }
+        return true;
+    }
+
+    /* [p, end) holds hex (shift 4) or binary (shift 1) digits; false on u64 overflow */
+    static bool decode_radix(const char *p, const char *end, const uint32_t shift, uint64_t &value)
+    {
+        value = 0;
+        for (; p < end; ++p)
+        {
+            if (value >> (64 - shift))
+                return false;
+
+            /* '0'-'9' keep their low nibble, letters have bit 6 set and need 9 more */
+            const auto c = static_cast<uint8_t>(*p);
+            value = value << shift | ((c & 0xF) + 9 * (c >> 6));
+        }
+        return true;
+    }
+
+    static constexpr double exact_pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
 
-                current_pos += 8;
-                continue;
+    // Clinger's fast path: a mantissa up to 2^53 and a power of ten up to
+    // 1e22 are both exact doubles, so a single multiply or divide rounds
+    // correctly. covers nearly every literal written by hand
+    static bool decode_float_fast(const char *p, const char *end, double &value)
+    {
+        uint64_t mantissa = 0;
+        int32_t digits = 0;
+        int32_t exp10 = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        }
+        if (p < end && *p == '.')
+        {
+            for (++p; p < end && *p >= '0' && *p <= '9'; ++p, --exp10)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
             }
+        }
+
+        /* past 19 significant digits the mantissa may have wrapped */
+        if (digits > 19)
+            return false;
 
-            break;
+        if (p < end && (*p | 32) == 'e')
+        {
+            ++p;
+            const bool negative = p < end && *p == '-';
+            p += p < end && (*p == '-' || *p == '+');
+
+            int32_t exponent = 0;
+            for (; p < end && *p >= '0' && *p <= '9'; ++p)
+                exponent = std::min(exponent * 10 + (*p - '0'), 100000);
+            exp10 += negative ? -exponent : exponent;
         }
 
-        /* slow path, usually runs when it is near the EOF */
-        while
-        (current_pos < src_length)
+        if (mantissa > 1ULL << 53 || exp10 < -22 || exp10 > 22)
+            return false;
+
+        value = exp10 < 0
+                    ? static_cast<double>(mantissa) / exact_pow10[-exp10]
+                    : static_cast<double>(mantissa) * exact_pow10[exp10];
+        return true;
+    }
+
+    Lexer::Lexer(const std::string_view mod_name, const std::string_view src, const simd::Level max_simd,
+                 std::pmr::memory_resource *resource, Interner *interner)
+        : module_name(mod_name), tokens(resource), src(src.data(), src.size())
+        , scan(simd::kernels(max_simd))
+        , interner(interner)
+        , current_pos(0)
+        , src_length(src.length())
+        , scan_limit(src.length())
+    {
+        /* offsets must also cover the zero padding a SourceFile adds */
+        if (src.size() > std::numeric_limits<offset_t>::max() - SourceFile::PADDING)
+            throw std::length_error("source of " + std::string(mod_name) +
+                                    " exceeds the 4 GiB offset range; build with KLR_WIDE_TOKENS");
+        line_starts.emplace_back(0);
+    }
+
+    Lexer::Lexer(const std::string_view mod_name, const SourceFile &file, const simd::Level max_simd,
+                 std::pmr::memory_resource *resource, Interner *interner)
+        : Lexer(mod_name, file.view(), max_simd, resource, interner)
+    {
+        scan_limit = src_length + SourceFile::PADDING;
+    }
+
+    void Lexer::skip_whitespace_comment()
+    {
+        /*
+         * the byte loop below is the reference; before each step the
+         * simd kernels (see simd.h) consume as many whole 16/32-byte blocks
+         * as they can and hand the remainder back, so runs of indentation,
+         * comment bodies & their newlines are classified a block at a time.
+         * line starts are tracked for the later pipeline
+         */
+        const char *data = src.data();
+        while (current_pos < src_length)
         {
+            current_pos = scan.skip_whitespace(data, current_pos, scan_limit, line_starts);
+            if (current_pos >= src_length)
+                return;
+
             const char current_char = src[current_pos];
             const uint8_t type = char_type[static_cast<uint8_t>(current_char)];
             if (current_char == '\n')
@@ -161,10 +284,15 @@ namespace klr::compiler
             const uint32_t is_single_comment = is_slash & (next_char == '/');
             const uint32_t is_multi_comment = is_slash & (next_char == '*');
             current_pos += 2 * is_single_comment;
+            if (is_single_comment)
+                current_pos = std::min(scan.find_newline(data, current_pos, scan_limit), src_length);
             while (is_single_comment && current_pos < src_length && src[current_pos] != '\n')
                 ++current_pos;
 
+            /* not scan_limit, the unterminated case must end exactly like the byte loop */
             current_pos += 2 * is_multi_comment;
+            if (is_multi_comment)
+                current_pos = scan.find_comment_end(data, current_pos, src_length, line_starts);
             uint32_t in_comment = is_multi_comment;
             while (in_comment && current_pos + 1 < src_length)
             {
@@ -187,45 +315,30 @@ namespace klr::compiler
     {
         const char *start = src.data() + current_pos;
         const char *current = start;
+        const char *end = src.data() + src_length;
         uint8_t flags = 0;
 
-        const uint32_t is_valid_start = (*current == '_' || std::isalpha(*current));
+        const uint32_t is_valid_start = ident_class[static_cast<uint8_t>(*current)] == 1 &&
+                                        char_type[static_cast<uint8_t>(*current)] == 4;
         if (!is_valid_start && *current != '@')
             return { current_pos, 1, TokenType::UNKNOWN, static_cast<TokenFlags>(flags) };
 
         const bool is_at_prefixed = (*current == '@');
         current += is_at_prefixed;
 
-        auto has_digit = false;
-        auto has_invalid = false;
-        while (current < src.data() + src_length)
-        {
-            const char c = *current;
-            const uint32_t is_alnum = std::isalnum(c);
-            const uint32_t is_underscore = c == '_';
-            const uint32_t is_space = std::isspace(c);
-            const uint32_t is_punct = std::ispunct(c);
-
-            const uint32_t is_valid = is_alnum | is_underscore;
-            const uint32_t is_terminator = (!is_valid) & (is_space | is_punct);
-
-            has_digit |= std::isdigit(c);
-            has_invalid |= (!is_valid & !is_terminator);
-            current += is_valid;
-            if (!is_valid)
-                break;
-        }
+        while (current < end && ident_class[static_cast<uint8_t>(*current)] == 1)
+            ++current;
 
-        const uint16_t length = current - start;
-        const std::string_view text(start, length);
+        /* anything but whitespace or punctuation cannot end an identifier */
+        const bool has_invalid = current < end && ident_class[static_cast<uint8_t>(*current)] == 0;
+        const uint16_t length = fit_len(current - start);
 
-        for (const auto &[next, type]: token_map)
-        {
-            if (next.length() == length && memcmp(next.data(), text.data(), length) == 0)
-                return { current_pos, length, type, static_cast<TokenFlags>(flags) };
-        }
+        /* keywords, builtin types & annotations in one probe */
+        if (const TokenType type = lookup_keyword(start, current - start);
+            type != TokenType::IDENTIFIER)
+            return { current_pos, length, type, static_cast<TokenFlags>(flags) };
 
-        if (is_at_prefixed || has_invalid || !is_valid_start)
+        if (is_at_prefixed || has_invalid)
             return { current_pos, length, TokenType::UNKNOWN, static_cast<TokenFlags>(flags) };
 
         return { current_pos, length, TokenType::IDENTIFIER, static_cast<TokenFlags>(flags) };
@@ -242,11 +355,13 @@ namespace klr::compiler
         const char *start = src.data() + current_pos;
         const char *current = start;
         const char *end = src.data() + src_length;
+        const char *probe_end = src.data() + scan_limit;
         uint8_t flags = 0;
 
+        /* with a padded source the probe runs to EOF, the zero sentinel ends it */
         if (*current >= '0' && *current <= '9')
         {
-            while (current + 8 <= end)
+            while (current + 8 <= probe_end)
             {
                 uint64_t chunk;
                 memcpy(&chunk, current, sizeof(chunk));
@@ -267,6 +382,7 @@ namespace klr::compiler
         const uint32_t is_bin = is_zero & is_b;
 
         current += 2 * (is_hex | is_bin);
+        const char *digits = current;
         uint32_t has_decimal = 0;
         while (current < end)
         {
@@ -288,6 +404,7 @@ namespace klr::compiler
             ++current;
         }
 
+        const char *digits_end = current;
         const uint32_t at_exp = current < end;
         const uint32_t is_exp = at_exp & ((*current | 32) == 'e');
         current += is_exp;
@@ -315,15 +432,50 @@ namespace klr::compiler
             }
             return {
                 current_pos,
-                static_cast<uint16_t>(current - start),
+                fit_len(current - start),
                 TokenType::UNKNOWN,
                 static_cast<TokenFlags>(flags)
             };
         }
 
+        /* decode once here so later passes never re-parse the digits */
+        has_number = false;
+        if (!(flags & (static_cast<uint8_t>(TokenFlags::MULTIPLE_DECIMAL_POINTS) |
+                       static_cast<uint8_t>(TokenFlags::INVALID_EXPONENT))))
+        {
+            bool in_range = true;
+            number.is_float = false;
+            if (is_hex | is_bin)
+            {
+                /* a binary literal followed by an exponent has no value */
+                has_number = digits != digits_end && !is_exp;
+                in_range = decode_radix(digits, digits_end, is_hex ? 4 : 1, number.bits);
+            }
+            else if (has_decimal | is_exp)
+            {
+                double value;
+                number.is_float = has_number = true;
+                if (!decode_float_fast(start, current, value))
+                {
+                    const auto [ptr, ec] = std::from_chars(start, current, value);
+                    has_number = ptr == current;
+                    in_range = ec != std::errc::result_out_of_range;
+                }
+                number.bits = std::bit_cast<uint64_t>(value);
+            }
+            else
+            {
+                has_number = true;
+                in_range = decode_decimal(start, current, number.bits);
+            }
+
+            flags |= make_flag(!in_range, TokenFlags::LITERAL_OUT_OF_RANGE);
+            has_number &= in_range;
+        }
+
         return {
             current_pos,
-            static_cast<uint16_t>(current - start),
+            fit_len(current - start),
             TokenType::NUM_LITERAL,
             static_cast<TokenFlags>(flags)
         };
@@ -340,13 +492,12 @@ namespace klr::compiler
         {
             case '>':
             {
-                if (next == '>' && third == '=')
-                    return { current_pos, 3, TokenType::RIGHT_SHIFT_EQ, static_cast<TokenFlags>(flags) };
-
+                /* `>>` stays one token; the parser splits it when it closes type arguments */
                 if (next == '>')
                 {
-                    return { current_pos, 1, TokenType::GREATER,
-                        static_cast<TokenFlags>(flags | static_cast<uint8_t>(TokenFlags::COMPOUND_START)) };
+                    const uint32_t assign = third == '=';
+                    return { current_pos, static_cast<uint16_t>(2 + assign), shift_types[1][assign],
+                        static_cast<TokenFlags>(flags) };
                 }
                 if (next == '=')
                     return { current_pos, 2, TokenType::GE, static_cast<TokenFlags>(flags) };
@@ -354,12 +505,11 @@ namespace klr::compiler
             }
             case '<':
             {
-                if (next == '<' && third == '=')
-                    return { current_pos, 3, TokenType::LEFT_SHIFT_EQ, static_cast<TokenFlags>(flags) };
                 if (next == '<')
                 {
-                    return { current_pos, 1, TokenType::LESS,
-                        static_cast<TokenFlags>(flags | static_cast<uint8_t>(TokenFlags::COMPOUND_START)) };
+                    const uint32_t assign = third == '=';
+                    return { current_pos, static_cast<uint16_t>(2 + assign), shift_types[0][assign],
+                        static_cast<TokenFlags>(flags) };
                 }
                 if (next == '=')
                     return { current_pos, 2, TokenType::LE, static_cast<TokenFlags>(flags) };
@@ -470,6 +620,12 @@ namespace klr::compiler
 
         while (current < end)
         {
+            /* plain bytes only advance; jump straight to the next quote or escape */
+            current = src.data() + std::min(scan.find_quote_or_escape(src.data(), current - src.data(), scan_limit),
+                                            src_length);
+            if (current == end)
+                break;
+
             const char c = *current;
             const uint32_t is_escape = c == '\\';
             const uint32_t has_next = current + 1 < end;
@@ -498,7 +654,7 @@ namespace klr::compiler
         flags |= make_flag(current >= end || *(current - 1) != '"', TokenFlags::UNTERMINATED_STRING);
         return {
             current_pos,
-            static_cast<uint16_t>(current - start),
+            fit_len(current - start),
             TokenType::STR_LITERAL,
             static_cast<TokenFlags>(flags)
         };
@@ -511,52 +667,225 @@ namespace klr::compiler
         if (current_pos >= src_length)
             return { current_pos, 0, TokenType::END_OF_FILE, static_cast<TokenFlags>(0) };
 
-        Token tok = [&]
-        {
-            switch (const char c = src[current_pos]; char_type[static_cast<uint8_t>(c)])
-            {
-                case 4:
-                    return lex_identifier();
-                case 5:
-                    return lex_number();
-                case 6:
-                    return lex_string();
-                default:
-                    return lex_operator();
-            }
-        }();
-
-        if (static_cast<uint8_t>(tok.flags) & static_cast<uint8_t>(TokenFlags::COMPOUND_START))
+        switch (char_type[static_cast<uint8_t>(src[current_pos])])
         {
-            tokens.push_back(tok);
-            current_pos += tok.len;
-            return { current_pos, 1, tok.type,
-                static_cast<TokenFlags>(static_cast<uint8_t>(TokenFlags::COMPOUND_END)) };
+            case 4:
+                return lex_identifier();
+            case 5:
+                return lex_number();
+            case 6:
+                return lex_string();
+            default:
+                return lex_operator();
         }
+    }
+
+    uint16_t Lexer::fit_len(const size_t len) const
+    {
+        if (len < Token::LONG_TOKEN)
+            return static_cast<uint16_t>(len);
+
+        long_len = static_cast<offset_t>(len);
+        return Token::LONG_TOKEN;
+    }
+
+    offset_t Lexer::length_of(const Token &t) const
+    {
+        return t.len == Token::LONG_TOKEN ? long_len : t.len;
+    }
 
-        return tok;
+    void Lexer::push(TokenList &list, const Token &t) const
+    {
+        if (t.len == Token::LONG_TOKEN)
+            list.emplace_long(long_len);
+        if (t.type == TokenType::NUM_LITERAL && has_number)
+            list.emplace_literal(number);
+        list.emplace_back(t);
     }
 
-    // returns a unique_ptr of TokenList because
-    // the parser needs it to process obv
+    // hands the token columns over to the caller without copying;
+    // the parser takes them by move so tokens are produced once
     std::unique_ptr<TokenList> Lexer::tokenize()
     {
+        tokens.reserve(src_length / 4);
+        line_starts.reserve(src_length / 40);
+
         uint32_t state = 1;
         while (state)
         {
             Token t = next_token();
-            tokens.emplace_back(t);
+            push(tokens, t);
 
             state = t.type != TokenType::END_OF_FILE;
-            current_pos += t.len * state;
+            current_pos += length_of(t) * state;
+        }
+
+        /* the columns are still hot in cache */
+        if (interner)
+            interner->intern_tokens({ src.data(), src_length }, tokens);
+        return std::make_unique<TokenList>(std::move(tokens));
+    }
+
+    // lexes one chunk on a private lexer over the whole buffer, so token
+    // starts are already absolute and need no rebasing when stitched.
+    // a chunk runs until the first token starting at or past `stop`
+    void Lexer::lex_chunk(Chunk &chunk) const
+    {
+        /* a re-lexed chunk must not keep the outcome of its speculative pass */
+        chunk.sync = chunk.begin;
+        chunk.eof = false;
+
+        Lexer lexer(module_name, { src.data(), src_length }, scan.level);
+        lexer.scan_limit = scan_limit;
+        lexer.current_pos = chunk.begin;
+        lexer.tokens.reserve(chunk.stop > chunk.begin ? (chunk.stop - chunk.begin) / 4 : 0);
+
+        auto first = true;
+        while (true)
+        {
+            const Token t = lexer.next_token();
+            if (first)
+                chunk.first = t.start;
+            first = false;
+
+            if (t.type == TokenType::END_OF_FILE)
+            {
+                lexer.push(lexer.tokens, t);
+                chunk.sync = src_length;
+                chunk.eof = true;
+                break;
+            }
+
+            if (t.start >= chunk.stop)
+            {
+                chunk.sync = t.start;
+                break;
+            }
+
+            lexer.push(lexer.tokens, t);
+            lexer.current_pos += lexer.length_of(t);
+        }
+
+        /* every worker interns its own chunk; a chunk re-lexed while stitching may leave unused atoms */
+        if (interner)
+            interner->intern_tokens({ src.data(), src_length }, lexer.tokens);
+        chunk.tokens = std::move(lexer.tokens);
+        chunk.line_starts = std::move(lexer.line_starts);
+    }
+
+    // every chunk speculatively assumes its first byte is outside of any
+    // string or comment. the speculation for chunk i + 1 holds iff it found
+    // its first token exactly where chunk i stopped (lexing only depends on
+    // the position). strings & block comments crossing a boundary break that
+    // and the chunk is re-lexed from the real resume point while stitching,
+    // which keeps the result identical to tokenize()
+    std::unique_ptr<TokenList> Lexer::tokenize_parallel(uint32_t threads, const uint32_t min_chunk)
+    {
+        if (threads == 0)
+            threads = std::max(1U, std::thread::hardware_concurrency());
+
+        const auto count = static_cast<uint32_t>(std::min<offset_t>(threads, src_length / std::max(1U, min_chunk)));
+        if (count < 2)
+            return tokenize();
+
+        /* pre-pass: split right after the first newline past each even share */
+        std::vector<Chunk> chunks(count);
+        offset_t begin = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            offset_t stop = src_length;
+            if (i + 1 < count)
+            {
+                stop = std::max(begin, static_cast<offset_t>(static_cast<uint64_t>(src_length) * (i + 1) / count));
+                stop = scan.find_newline(src.data(), stop, src_length);
+                while (stop < src_length && src[stop] != '\n')
+                    ++stop;
+                stop = std::min(stop + 1, src_length);
+            }
+
+            chunks[i].begin = begin;
+            chunks[i].stop = stop;
+            begin = stop;
+        }
+
+        std::vector<std::thread> workers;
+        workers.reserve(count - 1);
+        for (uint32_t i = 1; i < count; ++i)
+            workers.emplace_back([this, &chunks, i] { lex_chunk(chunks[i]); });
+        lex_chunk(chunks[0]);
+        for (auto &worker: workers)
+            worker.join();
+
+        /* stitch, repairing mis-speculated chunks serially */
+        tokens = std::move(chunks[0].tokens);
+        line_starts = std::move(chunks[0].line_starts);
+        offset_t sync = chunks[0].sync;
+        bool eof = chunks[0].eof;
+        for (uint32_t i = 1; i < count && !eof; ++i)
+        {
+            Chunk &chunk = chunks[i];
+            if (chunk.first != sync)
+            {
+                chunk.begin = sync;
+                chunk.tokens = {};
+                chunk.line_starts.clear();
+                lex_chunk(chunk);
+            }
+
+            tokens.append(chunk.tokens);
+
+            /* newlines up to sync were already seen by the previous chunk */
+            const auto fresh = std::ranges::upper_bound(chunk.line_starts, sync);
+            line_starts.insert(line_starts.end(), fresh, chunk.line_starts.end());
+
+            sync = chunk.sync;
+            eof = chunk.eof;
+        }
+
+        current_pos = src_length;
+        return std::make_unique<TokenList>(std::move(tokens));
+    }
+
+    // lexes a window of a larger stream. unless it is the last window a token
+    // is only complete if lexing saw at least one byte past it, and an
+    // operator its whole 3 byte lookahead; anything else (and trailing
+    // whitespace or comments) is left for the next window to re-lex
+    offset_t Lexer::lex_window(TokenList &out, const bool last)
+    {
+        tokens = std::move(out);
+        tokens.clear();
+
+        offset_t resume = 0;
+        while (true)
+        {
+            const Token t = next_token();
+            if (t.type == TokenType::END_OF_FILE)
+            {
+                if (last)
+                {
+                    push(tokens, t);
+                    resume = src_length;
+                }
+                break;
+            }
+
+            const offset_t end = t.start + length_of(t);
+            if (!last && (end >= src_length || t.start + 3 > src_length))
+                break;
+
+            push(tokens, t);
+            current_pos = resume = end;
         }
-        return std::make_unique<TokenList>(tokens);
+
+        out = std::move(tokens);
+        return resume;
     }
 
-    // returns a unique_ptr of uint32_t OR line because
-    // the parser needs to produce efficient errors
-    std::unique_ptr<std::vector<uint32_t> > Lexer::get_line_starts()
+    // returns a unique_ptr of offset_t OR line because
+    // the parser needs to produce efficient errors;
+    // moved out like tokenize(), so call it once after tokenizing
+    std::unique_ptr<std::vector<offset_t> > Lexer::get_line_starts()
     {
-        return std::make_unique<std::vector<uint32_t> >(line_starts);
+        return std::make_unique<std::vector<offset_t> >(std::move(line_starts));
     }
 }
@@ -0,0 +1,287 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/lexer/include/simd.h>
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define KLR_SIMD_X86 1
+#include <immintrin.h>
+#define KLR_TARGET_SSE42 __attribute__((target("sse4.2,popcnt")))
+#define KLR_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#else
+#define KLR_SIMD_X86 0
+#endif
+
+namespace klr::compiler::simd
+{
+    /*
+     * the scalar kernels consume nothing; the lexer's byte loop
+     * is the reference implementation and does all the work
+     */
+    static offset_t skip_whitespace_scalar(const char *, const offset_t pos, offset_t, std::vector<offset_t> &)
+    {
+        return pos;
+    }
+
+    static offset_t find_newline_scalar(const char *, const offset_t pos, offset_t)
+    {
+        return pos;
+    }
+
+    static offset_t find_comment_end_scalar(const char *, const offset_t pos, offset_t, std::vector<offset_t> &)
+    {
+        return pos;
+    }
+
+    static offset_t find_quote_or_escape_scalar(const char *, const offset_t pos, offset_t)
+    {
+        return pos;
+    }
+
+    static constexpr Kernels scalar_kernels {
+        .level = Level::SCALAR,
+        .skip_whitespace = skip_whitespace_scalar,
+        .find_newline = find_newline_scalar,
+        .find_comment_end = find_comment_end_scalar,
+        .find_quote_or_escape = find_quote_or_escape_scalar
+    };
+
+#if KLR_SIMD_X86
+    // ' ', '\t', '\n' and '\r' have distinct low nibbles (0x0, 0x9, 0xA, 0xD),
+    // so one pshufb maps every byte to the whitespace char it would have to be;
+    // comparing the result against the input yields the whitespace mask.
+    // unused slots hold 0x80 which never equals a byte with that low nibble
+    alignas(16) static constexpr uint8_t ws_lut[16] = {
+        ' ', 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+        0x80, '\t', '\n', 0x80, 0x80, '\r', 0x80, 0x80
+    };
+
+    /* bits [0, n) set; n may be 64 */
+    static uint64_t low_bits(const uint32_t n)
+    {
+        return n >= 64 ? ~0ULL : (1ULL << n) - 1;
+    }
+
+    /* popcount sizes the append once, then the set bits are scattered */
+    KLR_TARGET_SSE42 static void push_newlines(std::vector<offset_t> &line_starts, const offset_t base, uint64_t mask)
+    {
+        if (!mask)
+            return;
+
+        size_t at = line_starts.size();
+        line_starts.resize(at + __builtin_popcountll(mask));
+        while (mask)
+        {
+            line_starts[at++] = base + static_cast<offset_t>(__builtin_ctzll(mask)) + 1;
+            mask &= mask - 1;
+        }
+    }
+
+    /* SSE4.2, 16 bytes per block */
+    KLR_TARGET_SSE42 static offset_t skip_whitespace_sse42(const char *src, offset_t pos, const offset_t limit,
+                                                           std::vector<offset_t> &line_starts)
+    {
+        const __m128i lut = _mm_load_si128(reinterpret_cast<const __m128i *>(ws_lut));
+        const __m128i nl = _mm_set1_epi8('\n');
+        while (pos + 16 <= limit)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + pos));
+            const __m128i is_ws = _mm_cmpeq_epi8(_mm_shuffle_epi8(lut, chunk), chunk);
+            const auto ws_mask = static_cast<uint32_t>(_mm_movemask_epi8(is_ws));
+            const auto nl_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl)));
+            const uint32_t run = __builtin_ctz(~ws_mask); /* bit 16 is always clear */
+
+            push_newlines(line_starts, pos, nl_mask & low_bits(run));
+            pos += run;
+            if (run != 16)
+                break;
+        }
+        return pos;
+    }
+
+    KLR_TARGET_SSE42 static offset_t find_newline_sse42(const char *src, offset_t pos, const offset_t limit)
+    {
+        const __m128i nl = _mm_set1_epi8('\n');
+        while (pos + 16 <= limit)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + pos));
+            if (const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl))))
+                return pos + __builtin_ctz(mask);
+
+            pos += 16;
+        }
+        return pos;
+    }
+
+    KLR_TARGET_SSE42 static offset_t find_comment_end_sse42(const char *src, offset_t pos, const offset_t limit,
+                                                            std::vector<offset_t> &line_starts)
+    {
+        const __m128i star = _mm_set1_epi8('*');
+        const __m128i slash = _mm_set1_epi8('/');
+        const __m128i nl = _mm_set1_epi8('\n');
+
+        /* each candidate '*' at i needs src[i + 1], so blocks read one byte ahead */
+        while (pos + 17 <= limit)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + pos));
+            const __m128i ahead = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + pos + 1));
+            const __m128i eoc = _mm_and_si128(_mm_cmpeq_epi8(chunk, star), _mm_cmpeq_epi8(ahead, slash));
+            const auto eoc_mask = static_cast<uint32_t>(_mm_movemask_epi8(eoc));
+            const auto nl_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl)));
+            if (eoc_mask)
+            {
+                const uint32_t at = __builtin_ctz(eoc_mask);
+                push_newlines(line_starts, pos, nl_mask & low_bits(at));
+                return pos + at;
+            }
+
+            push_newlines(line_starts, pos, nl_mask);
+            pos += 16;
+        }
+        return pos;
+    }
+
+    KLR_TARGET_SSE42 static offset_t find_quote_or_escape_sse42(const char *src, offset_t pos, const offset_t limit)
+    {
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        while (pos + 16 <= limit)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + pos));
+            const __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+            if (const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(hit)))
+                return pos + __builtin_ctz(mask);
+
+            pos += 16;
+        }
+        return pos;
+    }
+
+    /* AVX2, 32 bytes per block */
+    KLR_TARGET_AVX2 static offset_t skip_whitespace_avx2(const char *src, offset_t pos, const offset_t limit,
+                                                         std::vector<offset_t> &line_starts)
+    {
+        const __m256i lut = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(ws_lut)));
+        const __m256i nl = _mm256_set1_epi8('\n');
+        while (pos + 32 <= limit)
+        {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + pos));
+            const __m256i is_ws = _mm256_cmpeq_epi8(_mm256_shuffle_epi8(lut, chunk), chunk);
+            const auto ws_mask = static_cast<uint32_t>(_mm256_movemask_epi8(is_ws));
+            const auto nl_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, nl)));
+            const uint32_t run = ws_mask == ~0U ? 32 : __builtin_ctz(~ws_mask);
+
+            push_newlines(line_starts, pos, nl_mask & low_bits(run));
+            pos += run;
+            if (run != 32)
+                break;
+        }
+        return pos;
+    }
+
+    KLR_TARGET_AVX2 static offset_t find_newline_avx2(const char *src, offset_t pos, const offset_t limit)
+    {
+        const __m256i nl = _mm256_set1_epi8('\n');
+        while (pos + 32 <= limit)
+        {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + pos));
+            if (const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, nl))))
+                return pos + __builtin_ctz(mask);
+
+            pos += 32;
+        }
+        return pos;
+    }
+
+    KLR_TARGET_AVX2 static offset_t find_comment_end_avx2(const char *src, offset_t pos, const offset_t limit,
+                                                          std::vector<offset_t> &line_starts)
+    {
+        const __m256i star = _mm256_set1_epi8('*');
+        const __m256i slash = _mm256_set1_epi8('/');
+        const __m256i nl = _mm256_set1_epi8('\n');
+        while (pos + 33 <= limit)
+        {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + pos));
+            const __m256i ahead = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + pos + 1));
+            const __m256i eoc = _mm256_and_si256(_mm256_cmpeq_epi8(chunk, star), _mm256_cmpeq_epi8(ahead, slash));
+            const auto eoc_mask = static_cast<uint32_t>(_mm256_movemask_epi8(eoc));
+            const auto nl_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, nl)));
+            if (eoc_mask)
+            {
+                const uint32_t at = __builtin_ctz(eoc_mask);
+                push_newlines(line_starts, pos, nl_mask & low_bits(at));
+                return pos + at;
+            }
+
+            push_newlines(line_starts, pos, nl_mask);
+            pos += 32;
+        }
+        return pos;
+    }
+
+    KLR_TARGET_AVX2 static offset_t find_quote_or_escape_avx2(const char *src, offset_t pos, const offset_t limit)
+    {
+        const __m256i quote = _mm256_set1_epi8('"');
+        const __m256i backslash = _mm256_set1_epi8('\\');
+        while (pos + 32 <= limit)
+        {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + pos));
+            const __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash));
+            if (const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit)))
+                return pos + __builtin_ctz(mask);
+
+            pos += 32;
+        }
+        return pos;
+    }
+
+    static constexpr Kernels sse42_kernels {
+        .level = Level::SSE42,
+        .skip_whitespace = skip_whitespace_sse42,
+        .find_newline = find_newline_sse42,
+        .find_comment_end = find_comment_end_sse42,
+        .find_quote_or_escape = find_quote_or_escape_sse42
+    };
+
+    static constexpr Kernels avx2_kernels {
+        .level = Level::AVX2,
+        .skip_whitespace = skip_whitespace_avx2,
+        .find_newline = find_newline_avx2,
+        .find_comment_end = find_comment_end_avx2,
+        .find_quote_or_escape = find_quote_or_escape_avx2
+    };
+#endif
+
+    Level detect()
+    {
+        static const Level level = []
+        {
+#if KLR_SIMD_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+                return Level::AVX2;
+            if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"))
+                return Level::SSE42;
+#endif
+            return Level::SCALAR;
+        }();
+        return level;
+    }
+
+    const Kernels &kernels(const Level max)
+    {
+        const auto level = static_cast<Level>(std::min(static_cast<uint8_t>(max), static_cast<uint8_t>(detect())));
+        switch (level)
+        {
+#if KLR_SIMD_X86
+            case Level::AVX2:
+                return avx2_kernels;
+            case Level::SSE42:
+                return sse42_kernels;
+#endif
+            default:
+                return scalar_kernels;
+        }
+    }
+}
@@ -0,0 +1,127 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/lexer/include/source.h>
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define KLR_SOURCE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define KLR_SOURCE_MMAP 0
+#include <fstream>
+#endif
+
+namespace klr::compiler
+{
+#if KLR_SOURCE_MMAP
+    // the whole range (file + padding, page rounded) is first reserved as
+    // zeroed anonymous memory, then the file is mapped over its front with
+    // MAP_FIXED. the tail of the last file page reads as zero by POSIX and
+    // the pages after it stay anonymous, so the padding never faults even
+    // when the file size is an exact multiple of the page size
+    SourceFile::SourceFile(const std::filesystem::path &path)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "cannot open " + path.string());
+
+        struct stat st {};
+        if (::fstat(fd, &st) != 0)
+        {
+            const int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "cannot stat " + path.string());
+        }
+
+        const auto page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        length = static_cast<size_t>(st.st_size);
+        mapped = (length + PADDING + page - 1) / page * page;
+
+        void *base = ::mmap(nullptr, mapped, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED)
+        {
+            const int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "cannot reserve " + path.string());
+        }
+
+        if (length && ::mmap(base, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+        {
+            const int err = errno;
+            ::munmap(base, mapped);
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "cannot map " + path.string());
+        }
+
+        /* the descriptor is not needed once the mapping exists */
+        ::close(fd);
+        data = static_cast<char *>(base);
+
+        /* the lexer reads front to back exactly once; hints are best effort */
+        if (length)
+        {
+            ::madvise(base, length, MADV_SEQUENTIAL);
+            ::madvise(base, length, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+            ::madvise(base, length, MADV_HUGEPAGE);
+#endif
+        }
+    }
+
+    void SourceFile::release()
+    {
+        if (data)
+            ::munmap(data, mapped);
+        data = nullptr;
+        length = mapped = 0;
+    }
+#else
+    // no mmap, read into a zero padded heap buffer instead
+    SourceFile::SourceFile(const std::filesystem::path &path)
+    {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in)
+            throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory),
+                                    "cannot open " + path.string());
+
+        length = static_cast<size_t>(in.tellg());
+        data = new char[length + PADDING]();
+        in.seekg(0);
+        in.read(data, static_cast<std::streamsize>(length));
+    }
+
+    void SourceFile::release()
+    {
+        delete[] data;
+        data = nullptr;
+        length = mapped = 0;
+    }
+#endif
+
+    SourceFile::~SourceFile()
+    {
+        release();
+    }
+
+    SourceFile::SourceFile(SourceFile &&other) noexcept : data(std::exchange(other.data, nullptr))
+                                                        , length(std::exchange(other.length, 0))
+                                                        , mapped(std::exchange(other.mapped, 0)) {}
+
+    SourceFile &SourceFile::operator=(SourceFile &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            data = std::exchange(other.data, nullptr);
+            length = std::exchange(other.length, 0);
+            mapped = std::exchange(other.mapped, 0);
+        }
+        return *this;
+    }
+}
@@ -0,0 +1,65 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/lexer/include/stream.h>
+#include <compiler/lexer/include/lexer.h>
+#include <algorithm>
+#include <cstring>
+
+namespace klr::compiler
+{
+    StreamLexer::StreamLexer(const std::string_view mod_name, Reader reader, const uint32_t window,
+                             const simd::Level max_simd) : module_name(mod_name), reader(std::move(reader))
+                                                         , window(std::max(window, 16U) + SourceFile::PADDING)
+                                                         , max_simd(max_simd) {}
+
+    void StreamLexer::fill()
+    {
+        /* readers may return short counts (pipes), keep going until full or done */
+        while (!input_done && filled < capacity())
+        {
+            const size_t n = reader(window.data() + filled, capacity() - filled);
+            input_done = n == 0;
+            filled += static_cast<uint32_t>(n);
+        }
+        pad();
+    }
+
+    void StreamLexer::pad()
+    {
+        memset(window.data() + filled, 0, SourceFile::PADDING);
+    }
+
+    bool StreamLexer::next_batch(TokenList &out)
+    {
+        if (finished)
+        {
+            out.clear();
+            return false;
+        }
+
+        while (true)
+        {
+            fill();
+
+            Lexer lexer(module_name, { window.data(), filled }, max_simd);
+            /* a window is below 4 GiB, so its offsets fit 32 bits in either mode */
+            const auto resume = static_cast<uint32_t>(lexer.lex_window(out, input_done));
+
+            /* a single token or comment larger than the window; grow and retry */
+            if (resume == 0 && out.size() == 0 && !input_done)
+            {
+                window.resize(capacity() * 2 + SourceFile::PADDING);
+                continue;
+            }
+
+            last_base = base;
+            base += resume;
+            filled -= resume;
+            memmove(window.data(), window.data() + resume, filled);
+            pad();
+            finished = input_done;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,112 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+namespace klr::compiler
+{
+    /*
+     * monotonic per-module allocator
+     *
+     * memory comes in chunks straight from the OS and is handed out by
+     * bumping a cursor; deallocation is a no-op. reset() rewinds to the
+     * first chunk in O(1) and keeps every chunk for the next module, so a
+     * whole compilation unit (AST, literal tables, diagnostics) is freed
+     * at once. it is a std::pmr::memory_resource, so containers opt in by
+     * taking it as their resource
+     *
+     * an arena has no locks and no shared state: give every thread (or
+     * every module in flight) its own arena rather than sharing one
+     */
+    class Arena final : public std::pmr::memory_resource
+    {
+    public:
+        static constexpr size_t DEFAULT_CHUNK = 1 << 20;
+        static constexpr size_t HUGE_PAGE = 2 << 20;
+
+        /* huge_pages rounds chunks to 2 MiB and asks for transparent huge pages; best effort */
+        explicit Arena(size_t chunk_size = DEFAULT_CHUNK, bool huge_pages = false);
+
+        ~Arena() override;
+
+        Arena(Arena &&other) noexcept;
+
+        Arena &operator=(Arena &&other) noexcept;
+
+        Arena(const Arena &) = delete;
+
+        Arena &operator=(const Arena &) = delete;
+
+        /* forgets every allocation and rewinds to the first chunk; nothing is unmapped */
+        void reset();
+
+        /* returns every chunk to the OS */
+        void release();
+
+        /* allocation requests served since construction */
+        [[nodiscard]] uint64_t allocations() const
+        {
+            return allocation_count;
+        }
+
+        /* chunks mapped since construction, i.e. system allocations */
+        [[nodiscard]] uint64_t chunks() const
+        {
+            return chunk_count;
+        }
+
+        /* bytes handed out since the last reset() */
+        [[nodiscard]] size_t used() const
+        {
+            return used_bytes;
+        }
+
+        /* bytes currently mapped */
+        [[nodiscard]] size_t reserved() const
+        {
+            return reserved_bytes;
+        }
+
+    private:
+        struct Chunk
+        {
+            Chunk *next;
+            size_t size; /* including this header */
+        };
+
+        Chunk *head = nullptr;
+        Chunk *current = nullptr;
+        char *cursor = nullptr;
+        char *limit = nullptr;
+        size_t chunk_size;
+        bool huge_pages;
+
+        uint64_t allocation_count = 0;
+        uint64_t chunk_count = 0;
+        size_t used_bytes = 0;
+        size_t reserved_bytes = 0;
+
+        void *do_allocate(size_t bytes, size_t alignment) override;
+
+        void do_deallocate(void *, size_t, size_t) override {}
+
+        [[nodiscard]] bool do_is_equal(const memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+
+        void *bump(size_t bytes, size_t alignment);
+
+        void enter(Chunk *chunk);
+
+        void *grow(size_t bytes, size_t alignment);
+
+        Chunk *map_chunk(size_t bytes);
+
+        void unmap_chunk(Chunk *chunk) const;
+    };
+}
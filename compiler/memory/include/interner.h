@@ -0,0 +1,123 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "../../interfaces/include/tokens.h"
+#include "arena.h"
+
+namespace klr::compiler
+{
+    /*
+     * concurrent string interner
+     *
+     * every distinct identifier or string literal gets a dense 32-bit atom,
+     * so name equality anywhere after lexing is a single integer compare.
+     * one interner is meant to be shared by every module of a compilation
+     * and every lexer thread; atoms and the views str() returns stay valid
+     * for its whole lifetime
+     *
+     * strings are split into shards by hash, each behind its own lock with
+     * an open-addressing table and an Arena for the bytes. atoms come from
+     * one counter, so they stay dense across shards: 1..size(), 0 = none
+     */
+    class Interner
+    {
+    public:
+        static constexpr uint32_t NONE = 0;
+
+        struct Stats
+        {
+            uint64_t lookups = 0;      /* intern requests, i.e. occurrences */
+            uint64_t bytes_seen = 0;   /* bytes of every occurrence */
+            uint64_t bytes_stored = 0; /* bytes of the distinct strings, stored once */
+        };
+
+        Interner();
+
+        ~Interner();
+
+        Interner(const Interner &) = delete;
+
+        Interner &operator=(const Interner &) = delete;
+
+        /* 64-bit hash of s; the top bits pick the shard, the low 32 bits are kept as the probe tag */
+        static uint64_t hash(std::string_view s);
+
+        uint32_t intern(std::string_view s);
+
+        /* hash must be hash(s) */
+        uint32_t intern(std::string_view s, uint64_t hash);
+
+        /*
+         * bulk form for the lexer: hashes every IDENTIFIER and STR_LITERAL of
+         * tokens[from, size()) in one pass over the fresh columns, then interns
+         * them shard by shard, taking each lock once. fills tokens.atoms, NONE
+         * for every other token. string literals are interned without their
+         * quotes and with escapes left as written
+         */
+        void intern_tokens(std::string_view src, TokenList &tokens, size_t from = 0);
+
+        /* what intern_tokens() interns for an IDENTIFIER or STR_LITERAL token */
+        static std::string_view token_text(std::string_view src, const TokenList &tokens, size_t index);
+
+        /* the text of an atom; NONE is the empty string */
+        [[nodiscard]] std::string_view str(uint32_t atom) const;
+
+        /* distinct strings interned so far */
+        [[nodiscard]] uint32_t size() const
+        {
+            return next.load(std::memory_order_acquire) - 1;
+        }
+
+        [[nodiscard]] Stats stats() const;
+
+        /* bytes held by the tables, the atom directory and the string arenas */
+        [[nodiscard]] size_t memory_bytes() const;
+
+    private:
+        static constexpr uint32_t SHARD_BITS = 6;
+        static constexpr uint32_t SHARDS = 1U << SHARD_BITS;
+
+        /* the atom directory is segmented: block b holds FIRST_BLOCK << b entries and never moves */
+        static constexpr uint32_t FIRST_BLOCK_BITS = 10;
+        static constexpr uint32_t FIRST_BLOCK = 1U << FIRST_BLOCK_BITS;
+
+        struct Entry
+        {
+            const char *data;
+            uint32_t len;
+        };
+
+        struct alignas(64) Shard
+        {
+            mutable std::mutex lock;
+            std::vector<std::pair<uint32_t, uint32_t> > slots; /* (tag, atom), atom NONE = empty */
+            uint32_t count = 0;
+            Arena bytes { 64 << 10 };
+            Stats stats;
+        };
+
+        std::unique_ptr<Shard[]> shards;
+        std::atomic<uint32_t> next { 1 };
+        std::array<std::atomic<Entry *>, 32 - FIRST_BLOCK_BITS + 1> blocks {};
+
+        /* caller holds shard.lock */
+        uint32_t insert(Shard &shard, std::string_view s, uint64_t hash);
+
+        static void grow(Shard &shard);
+
+        [[nodiscard]] const Entry &entry(uint32_t atom) const;
+
+        /* the directory slot of a fresh atom, allocating its block if no other shard did yet */
+        Entry &claim(uint32_t atom);
+    };
+}
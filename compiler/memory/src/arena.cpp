@@ -0,0 +1,165 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/memory/include/arena.h>
+#include <algorithm>
+#include <new>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define KLR_ARENA_MMAP 1
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#define KLR_ARENA_MMAP 0
+#endif
+
+namespace klr::compiler
+{
+    Arena::Arena(const size_t chunk_size, const bool huge_pages) : chunk_size(std::max<size_t>(chunk_size, 4096))
+                                                                 , huge_pages(huge_pages) {}
+
+    Arena::~Arena()
+    {
+        release();
+    }
+
+    Arena::Arena(Arena &&other) noexcept : head(std::exchange(other.head, nullptr))
+                                         , current(std::exchange(other.current, nullptr))
+                                         , cursor(std::exchange(other.cursor, nullptr))
+                                         , limit(std::exchange(other.limit, nullptr))
+                                         , chunk_size(other.chunk_size)
+                                         , huge_pages(other.huge_pages)
+                                         , allocation_count(std::exchange(other.allocation_count, 0))
+                                         , chunk_count(std::exchange(other.chunk_count, 0))
+                                         , used_bytes(std::exchange(other.used_bytes, 0))
+                                         , reserved_bytes(std::exchange(other.reserved_bytes, 0)) {}
+
+    Arena &Arena::operator=(Arena &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            head = std::exchange(other.head, nullptr);
+            current = std::exchange(other.current, nullptr);
+            cursor = std::exchange(other.cursor, nullptr);
+            limit = std::exchange(other.limit, nullptr);
+            chunk_size = other.chunk_size;
+            huge_pages = other.huge_pages;
+            allocation_count = std::exchange(other.allocation_count, 0);
+            chunk_count = std::exchange(other.chunk_count, 0);
+            used_bytes = std::exchange(other.used_bytes, 0);
+            reserved_bytes = std::exchange(other.reserved_bytes, 0);
+        }
+        return *this;
+    }
+
+    void Arena::reset()
+    {
+        current = nullptr;
+        cursor = limit = nullptr;
+        used_bytes = 0;
+        if (head)
+            enter(head);
+    }
+
+    void Arena::release()
+    {
+        for (Chunk *chunk = head; chunk;)
+        {
+            Chunk *next = chunk->next;
+            unmap_chunk(chunk);
+            chunk = next;
+        }
+        head = current = nullptr;
+        cursor = limit = nullptr;
+        used_bytes = reserved_bytes = 0;
+    }
+
+    void *Arena::do_allocate(size_t bytes, const size_t alignment)
+    {
+        /* zero sized requests still need a distinct address */
+        bytes = std::max<size_t>(bytes, 1);
+        ++allocation_count;
+        used_bytes += bytes;
+        if (void *p = bump(bytes, alignment))
+            return p;
+        return grow(bytes, alignment);
+    }
+
+    void *Arena::bump(const size_t bytes, const size_t alignment)
+    {
+        const auto at = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(alignment - 1);
+        if (!cursor || at + bytes > reinterpret_cast<uintptr_t>(limit))
+            return nullptr;
+
+        cursor = reinterpret_cast<char *>(at + bytes);
+        return reinterpret_cast<void *>(at);
+    }
+
+    void Arena::enter(Chunk *chunk)
+    {
+        current = chunk;
+        cursor = reinterpret_cast<char *>(chunk + 1);
+        limit = reinterpret_cast<char *>(chunk) + chunk->size;
+    }
+
+    // chunks kept by reset() are reused in order before mapping new ones;
+    // a request larger than the chunk size gets a chunk of its own
+    void *Arena::grow(const size_t bytes, const size_t alignment)
+    {
+        while (current && current->next)
+        {
+            enter(current->next);
+            if (void *p = bump(bytes, alignment))
+                return p;
+        }
+
+        Chunk *chunk = map_chunk(std::max(chunk_size, sizeof(Chunk) + bytes + alignment));
+        if (current)
+            current->next = chunk;
+        else
+            head = chunk;
+
+        enter(chunk);
+        return bump(bytes, alignment);
+    }
+
+#if KLR_ARENA_MMAP
+    Arena::Chunk *Arena::map_chunk(size_t bytes)
+    {
+        const size_t granule = huge_pages ? HUGE_PAGE : static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        bytes = (bytes + granule - 1) / granule * granule;
+
+        void *base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED)
+            throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+        if (huge_pages)
+            ::madvise(base, bytes, MADV_HUGEPAGE);
+#endif
+
+        ++chunk_count;
+        reserved_bytes += bytes;
+        return new(base) Chunk { nullptr, bytes };
+    }
+
+    void Arena::unmap_chunk(Chunk *chunk) const
+    {
+        ::munmap(chunk, chunk->size);
+    }
+#else
+    Arena::Chunk *Arena::map_chunk(const size_t bytes)
+    {
+        void *base = ::operator new(bytes, std::align_val_t { alignof(std::max_align_t) });
+        ++chunk_count;
+        reserved_bytes += bytes;
+        return new(base) Chunk { nullptr, bytes };
+    }
+
+    void Arena::unmap_chunk(Chunk *chunk) const
+    {
+        ::operator delete(chunk, std::align_val_t { alignof(std::max_align_t) });
+    }
+#endif
+}
@@ -0,0 +1,238 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/memory/include/interner.h>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace klr::compiler
+{
+    Interner::Interner() : shards(std::make_unique<Shard[]>(SHARDS)) {}
+
+    Interner::~Interner()
+    {
+        for (auto &block: blocks)
+            delete[] block.load(std::memory_order_relaxed);
+    }
+
+    // eight bytes per round, so most identifiers take one or two multiplies;
+    // the finalizer spreads them into the top bits that pick the shard
+    uint64_t Interner::hash(const std::string_view s)
+    {
+        constexpr uint64_t k = 0x9E3779B97F4A7C15ULL;
+        const char *p = s.data();
+        size_t n = s.size();
+        uint64_t h = n * k;
+        while (n >= 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, p, 8);
+            h = (h ^ word) * k;
+            h ^= h >> 29;
+            p += 8;
+            n -= 8;
+        }
+        if (n)
+        {
+            uint64_t word = 0;
+            std::memcpy(&word, p, n);
+            h = (h ^ word) * k;
+            h ^= h >> 29;
+        }
+
+        h ^= h >> 32;
+        h *= 0xD6E8FEB86659FD93ULL;
+        h ^= h >> 32;
+        return h;
+    }
+
+    uint32_t Interner::intern(const std::string_view s)
+    {
+        return intern(s, hash(s));
+    }
+
+    uint32_t Interner::intern(const std::string_view s, const uint64_t hash)
+    {
+        Shard &shard = shards[hash >> (64 - SHARD_BITS)];
+        const std::lock_guard guard(shard.lock);
+        return insert(shard, s, hash);
+    }
+
+    void Interner::intern_tokens(const std::string_view src, TokenList &tokens, const size_t from)
+    {
+        const size_t n = tokens.size();
+        tokens.atoms.resize(n, NONE);
+
+        /* hash pass: (hash, token index) of every name, bucketed by shard */
+        struct Name
+        {
+            uint64_t hash;
+            uint32_t index;
+        };
+
+        std::vector<Name> names;
+        std::array<uint32_t, SHARDS + 1> offsets {};
+        for (size_t i = from; i < n; ++i)
+        {
+            const TokenType type = tokens.types[i];
+            if (type != TokenType::IDENTIFIER && type != TokenType::STR_LITERAL)
+                continue;
+
+            const uint64_t h = hash(token_text(src, tokens, i));
+            names.push_back({ h, static_cast<uint32_t>(i) });
+            ++offsets[(h >> (64 - SHARD_BITS)) + 1];
+        }
+
+        for (uint32_t s = 0; s < SHARDS; ++s)
+            offsets[s + 1] += offsets[s];
+
+        std::vector<Name> by_shard(names.size());
+        std::array<uint32_t, SHARDS> fill {};
+        std::copy_n(offsets.begin(), SHARDS, fill.begin());
+        for (const Name &name: names)
+            by_shard[fill[name.hash >> (64 - SHARD_BITS)]++] = name;
+
+        /* insert pass: one lock per shard instead of one per name */
+        for (uint32_t s = 0; s < SHARDS; ++s)
+        {
+            if (offsets[s] == offsets[s + 1])
+                continue;
+
+            Shard &shard = shards[s];
+            const std::lock_guard guard(shard.lock);
+            for (uint32_t i = offsets[s]; i < offsets[s + 1]; ++i)
+            {
+                const auto [h, index] = by_shard[i];
+                tokens.atoms[index] = insert(shard, token_text(src, tokens, index), h);
+            }
+        }
+    }
+
+    std::string_view Interner::token_text(const std::string_view src, const TokenList &tokens, const size_t index)
+    {
+        const std::string_view text = src.substr(tokens.starts[index], tokens.length(index));
+        if (tokens.types[index] != TokenType::STR_LITERAL)
+            return text;
+
+        /* drop the quotes; an unterminated literal only has the opening one */
+        const bool closed = !(static_cast<uint8_t>(tokens.flags[index]) &
+                              static_cast<uint8_t>(TokenFlags::UNTERMINATED_STRING));
+        return text.substr(1, text.size() - 1 - (closed && text.size() > 1));
+    }
+
+    std::string_view Interner::str(const uint32_t atom) const
+    {
+        if (atom == NONE)
+            return {};
+
+        const Entry &e = entry(atom);
+        return { e.data, e.len };
+    }
+
+    Interner::Stats Interner::stats() const
+    {
+        Stats total;
+        for (uint32_t s = 0; s < SHARDS; ++s)
+        {
+            const std::lock_guard guard(shards[s].lock);
+            total.lookups += shards[s].stats.lookups;
+            total.bytes_seen += shards[s].stats.bytes_seen;
+            total.bytes_stored += shards[s].stats.bytes_stored;
+        }
+        return total;
+    }
+
+    size_t Interner::memory_bytes() const
+    {
+        size_t bytes = 0;
+        for (uint32_t s = 0; s < SHARDS; ++s)
+        {
+            const std::lock_guard guard(shards[s].lock);
+            bytes += shards[s].slots.capacity() * sizeof(shards[s].slots[0]) + shards[s].bytes.reserved();
+        }
+        for (uint32_t b = 0; b < blocks.size(); ++b)
+        {
+            if (blocks[b].load(std::memory_order_acquire))
+                bytes += (static_cast<size_t>(FIRST_BLOCK) << b) * sizeof(Entry);
+        }
+        return bytes;
+    }
+
+    uint32_t Interner::insert(Shard &shard, const std::string_view s, const uint64_t hash)
+    {
+        ++shard.stats.lookups;
+        shard.stats.bytes_seen += s.size();
+
+        /* at most half full */
+        if ((shard.count + 1) * 2 > shard.slots.size())
+            grow(shard);
+
+        const auto tag = static_cast<uint32_t>(hash);
+        const size_t mask = shard.slots.size() - 1;
+        size_t i = tag & mask;
+        while (shard.slots[i].second != NONE)
+        {
+            if (const auto [t, atom] = shard.slots[i]; t == tag)
+            {
+                if (const Entry &e = entry(atom);
+                    e.len == s.size() && std::memcmp(e.data, s.data(), s.size()) == 0)
+                    return atom;
+            }
+            i = (i + 1) & mask;
+        }
+
+        const uint32_t atom = next.fetch_add(1, std::memory_order_acq_rel);
+        auto *copy = static_cast<char *>(shard.bytes.allocate(std::max<size_t>(s.size(), 1), 1));
+        std::memcpy(copy, s.data(), s.size());
+        claim(atom) = { copy, static_cast<uint32_t>(s.size()) };
+
+        shard.slots[i] = { tag, atom };
+        ++shard.count;
+        shard.stats.bytes_stored += s.size();
+        return atom;
+    }
+
+    void Interner::grow(Shard &shard)
+    {
+        std::vector<std::pair<uint32_t, uint32_t> > old(std::max<size_t>(shard.slots.size() * 2, 64));
+        old.swap(shard.slots);
+
+        /* the tag holds the low hash bits, so slots move without touching the strings */
+        const size_t mask = shard.slots.size() - 1;
+        for (const auto &[tag, atom]: old)
+        {
+            if (atom == NONE)
+                continue;
+
+            size_t i = tag & mask;
+            while (shard.slots[i].second != NONE)
+                i = (i + 1) & mask;
+            shard.slots[i] = { tag, atom };
+        }
+    }
+
+    const Interner::Entry &Interner::entry(const uint32_t atom) const
+    {
+        const uint64_t v = static_cast<uint64_t>(atom) + FIRST_BLOCK;
+        const auto block = static_cast<uint32_t>(std::bit_width(v) - 1 - FIRST_BLOCK_BITS);
+        return blocks[block].load(std::memory_order_acquire)[v - (static_cast<uint64_t>(FIRST_BLOCK) << block)];
+    }
+
+    Interner::Entry &Interner::claim(const uint32_t atom)
+    {
+        const uint64_t v = static_cast<uint64_t>(atom) + FIRST_BLOCK;
+        const auto block = static_cast<uint32_t>(std::bit_width(v) - 1 - FIRST_BLOCK_BITS);
+
+        Entry *entries = blocks[block].load(std::memory_order_acquire);
+        if (!entries)
+        {
+            auto *fresh = new Entry[static_cast<size_t>(FIRST_BLOCK) << block] {};
+            if (blocks[block].compare_exchange_strong(entries, fresh, std::memory_order_acq_rel))
+                entries = fresh;
+            else
+                delete[] fresh;
+        }
+        return entries[v - (static_cast<uint64_t>(FIRST_BLOCK) << block)];
+    }
+}
@@ -1,38 +1,123 @@
 #pragma once
 
+#include <array>
+#include <memory>
+#include <memory_resource>
 #include <vector>
+#include <compiler/diagnostics/include/renderer.h>
+#include <compiler/interfaces/include/diagnostics.h>
 #include <compiler/interfaces/include/tokens.h>
 #include <compiler/analysis/include/ast.h>
 
 namespace klr::compiler
 {
+    /* how binary, ternary and assignment expressions are parsed; both build the same AST */
+    enum class ExprStrategy : uint8_t
+    {
+        PRATT,   /* one loop driven by the binding power table */
+        DESCENT, /* the original one-function-per-precedence-level chain, kept as the reference */
+    };
+
     /* TODO: change void type to AST */
     class Parser
     {
     public:
-        explicit Parser(std::string_view module_name, std::string_view source, TokenList &tokens, const std::unique_ptr<std::vector<uint32_t>> &starts);
-
-        /* entry point & global scope parsing; returns the AST root */
+        /* nesting allowed before E0009; see max_depth */
+        static constexpr uint32_t DEFAULT_MAX_DEPTH = 1024;
+
+        /*
+         * takes ownership of the lexer's output; call tokenize() before get_line_starts(),
+         * as separate statements since argument evaluation order is unspecified.
+         * the AST, the diagnostics and the parse stacks are allocated from resource,
+         * e.g. the module's Arena
+         */
+        explicit Parser(std::string_view module_name, std::string_view source, std::unique_ptr<TokenList> tokens,
+                        std::unique_ptr<std::vector<offset_t>> starts,
+                        std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+                        ExprStrategy strategy = ExprStrategy::PRATT, uint32_t max_depth = DEFAULT_MAX_DEPTH);
+
+        /* the cursor points into tokens */
+        Parser(const Parser &) = delete;
+
+        Parser &operator=(const Parser &) = delete;
+
+        /*
+         * entry point & global scope parsing; returns the AST root, moved out of the parser.
+         * never throws on malformed input: every error becomes a diagnostic and an ERROR
+         * node, and parsing resumes at the next statement
+         */
         AST parse();
 
+        /* in the order they were found, at most one per statement */
+        [[nodiscard]] const std::pmr::vector<Diagnostic> &get_diagnostics() const
+        {
+            return diagnostics;
+        }
+
+        [[nodiscard]] bool has_errors() const;
+
+        [[nodiscard]] size_t error_count() const;
+
+        /* the tokens the AST points into, with any `>>` split by match_close_angle(); for later passes */
+        [[nodiscard]] const TokenList &get_tokens() const
+        {
+            return tokens;
+        }
+
+        /* renders the diagnostics; a view over the parser's tokens and source, so it must not outlive either */
+        [[nodiscard]] DiagnosticRenderer renderer() const;
+
     private:
-        enum class ErrorLevel
+        /* an operator, '(' or '?' whose operand is still being parsed */
+        struct ExprFrame
         {
-            ERROR,
-            WARNING,
-            NOTE,
+            enum class Kind : uint8_t { UNARY, PAREN, BINARY, TERNARY_THEN, TERNARY_ELSE };
+
+            Token token;
+            uint32_t lhs;         /* BINARY: left operand; TERNARY_*: condition */
+            uint32_t then_branch; /* TERNARY_ELSE */
+            uint8_t min_power;    /* operators binding at least this tightly extend the operand */
+            Kind kind;
+        };
+
+        /* a block whose statements are still being parsed, and the statement that owns it */
+        struct BlockFrame
+        {
+            enum class Kind : uint8_t { BODY, IF_THEN, IF_ELSE, WHILE, FOR };
+
+            Token owner;                   /* IF/WHILE/FOR token; the '{' for BODY */
+            std::array<uint32_t, 3> parts; /* IF: condition, then, else-if parent; WHILE: condition; FOR: header */
+            uint32_t block = 0;            /* BLOCK node collecting the statements */
+            offset_t open = 0;             /* token index of the '{' */
+            Kind kind;
         };
 
         AST ast;
-        std::vector<uint32_t> line_starts;
+        std::pmr::vector<Diagnostic> diagnostics;
+        std::vector<offset_t> line_starts;
         std::string_view mod_name;
         std::string_view src;
-        TokenList &tokens;
-        size_t current = 0;
+        TokenList tokens;   /* only ever modified by match_close_angle() */
+        TokenCursor cursor; /* over tokens; most decisions only read its type column */
+        ExprStrategy strategy;
+        bool panicking = false; /* set by error(), cleared by synchronize() */
+
+        /*
+         * nesting is tracked on heap stacks instead of the call stack: expressions in
+         * expr_stack, blocks in block_stack. depth counts their frames plus the few
+         * constructs that still recurse (call arguments, types, lambdas), so both the
+         * heap and the native stack stay bounded by max_depth
+         */
+        std::pmr::vector<ExprFrame> expr_stack;
+        std::pmr::vector<BlockFrame> block_stack;
+        uint32_t depth = 0;
+        uint32_t max_depth;
 
         /* parsing utils */
         [[nodiscard]] Token peek() const;
 
+        [[nodiscard]] TokenType peek_type() const;
+
         Token advance();
 
         [[nodiscard]] bool is_at_end() const;
@@ -41,11 +126,25 @@ namespace klr::compiler
 
         Token expect(TokenType type, bool err = false);
 
-        Token expect(TokenType type, const char *str);
+        Token expect(TokenType type, DiagCode code);
+
+        /*
+         * takes the '>' closing a type argument list. the lexer keeps `>>`, `>=` and
+         * `>>=` whole, so one of those is split in place: its first '>' is consumed
+         * and the token shrinks to the rest, e.g. the `>>` of Own<Ref<T>>
+         */
+        bool match_close_angle();
+
+        void expect_close_angle();
 
-        [[nodiscard]] std::pair<uint32_t, uint32_t> get_position(uint32_t offset) const;
+        /* records a diagnostic at a token index unless one is already pending for this statement */
+        void error(DiagCode code, size_t token, uint32_t arg = 0);
 
-        [[noreturn]] void error(Token token, std::string_view message, std::string_view help = "") const;
+        /* records the error and returns an ERROR node in place of the missing construct */
+        uint32_t error_node(DiagCode code, size_t token);
+
+        /* panic mode: skips to the end of the broken statement, a '}' or a statement keyword */
+        void synchronize();
 
         /* subroutines */
         uint32_t parse_decl();
@@ -58,7 +157,12 @@ namespace klr::compiler
 
         uint32_t parse_expression();
 
-        /* parse_expression subroutines */
+        /* ExprStrategy::PRATT; see binding_powers in parser.cpp */
+        uint32_t parse_binary();
+
+        uint32_t parse_new();
+
+        /* ExprStrategy::DESCENT subroutines */
         uint32_t parse_assignment();
 
         uint32_t parse_ternary();
@@ -87,12 +191,28 @@ namespace klr::compiler
 
         /*                              */
 
-        uint32_t parse_if();
+        /* statements */
+        uint32_t parse_block(Token brace);
 
-        uint32_t parse_for();
+        void parse_statement();
 
-        uint32_t parse_block(Token brace);
+        /* the header of an if statement; the IF node becomes the else branch of chain unless 0 */
+        void parse_if(uint32_t chain);
+
+        void parse_while();
+
+        void parse_for();
+
+        /* opens the block a statement's header ends in; false (and the block skipped) if too deep */
+        bool push_block(Token brace, BlockFrame frame);
+
+        /* completes the statement owning a block that just closed */
+        void close_block(BlockFrame frame);
+
+        /* adds a finished statement to the innermost open block */
+        void add_statement(uint32_t node);
 
-        uint32_t parse_while();
+        /* skips a construct nested too deeply, through the '}' closing its block ('{' already consumed if opened) */
+        void skip_block(bool opened);
     };
 }
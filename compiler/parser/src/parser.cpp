@@ -1,20 +1,75 @@
 #include <compiler/parser/include/parser.h>
-#include <sstream>
+#include <algorithm>
+#include <array>
 
 namespace klr::compiler
 {
-    Parser::Parser(const std::string_view module_name, const std::string_view source, TokenList &tokens,
-                   const std::unique_ptr<std::vector<uint32_t> > &starts) : line_starts(std::move(*starts)),
-                                                                            mod_name(module_name), src(source),
-                                                                            tokens(tokens) {}
+    /*
+     * binding powers of the infix operators, indexed by TokenType; 0 = not infix.
+     * left-associative levels bind their right operand one step tighter; assignment
+     * binds it at its own power, which makes it right-associative. the order matches
+     * the DESCENT chain from parse_assignment down to parse_factor
+     */
+    struct BindingPower
+    {
+        uint8_t left;
+        uint8_t right;
+    };
+
+    static constexpr uint8_t ASSIGNMENT_POWER = 2;
+    static constexpr uint8_t TERNARY_POWER = 4;
+    static constexpr uint8_t UNARY_POWER = 0xFF; /* a prefix operator takes its operand before any infix one */
+
+    static constexpr auto binding_powers = []
+    {
+        std::array<BindingPower, static_cast<size_t>(TokenType::END_OF_FILE) + 1> table {};
+        const auto set = [&](const uint8_t left, const uint8_t right, const std::initializer_list<TokenType> types)
+        {
+            for (const auto type: types)
+                table[static_cast<size_t>(type)] = { left, right };
+        };
+
+        using enum TokenType;
+        set(ASSIGNMENT_POWER, ASSIGNMENT_POWER, {
+                EQUAL, PLUS_EQ, MINUS_EQ, STAR_EQ, SLASH_EQ, PERCENT_EQ,
+                AND_EQ, OR_EQ, XOR_EQ, LEFT_SHIFT_EQ, RIGHT_SHIFT_EQ
+            });
+        set(TERNARY_POWER, 0, { QUESTION });
+        set(6, 7, { LOGICAL_OR });
+        set(8, 9, { LOGICAL_AND });
+        set(10, 11, { OR });
+        set(12, 13, { XOR });
+        set(14, 15, { AND });
+        set(16, 17, { LEFT_SHIFT, RIGHT_SHIFT });
+        set(18, 19, { EQ, NE });
+        set(20, 21, { LESS, LE, GREATER, GE });
+        set(22, 23, { PLUS, MINUS });
+        set(24, 25, { STAR, SLASH, PERCENT });
+        return table;
+    }();
+
+    Parser::Parser(const std::string_view module_name, const std::string_view source,
+                   const std::unique_ptr<TokenList> tokens,
+                   const std::unique_ptr<std::vector<offset_t> > starts,
+                   std::pmr::memory_resource *resource, const ExprStrategy strategy,
+                   const uint32_t max_depth) : ast(resource), diagnostics(resource),
+                                               line_starts(std::move(*starts)),
+                                               mod_name(module_name), src(source),
+                                               tokens(std::move(*tokens)), cursor(this->tokens),
+                                               strategy(strategy),
+                                               expr_stack(resource), block_stack(resource),
+                                               max_depth(max_depth) {}
 
     AST Parser::parse()
     {
+        /* about one node per two tokens in typical modules; at most one regrowth */
+        ast.reserve(tokens.size() / 2);
+
         constexpr Token root_token {};
         const uint32_t root = ast.add_node(ASTNodeType::ROOT, root_token);
         while (!is_at_end())
         {
-            switch (peek().type)
+            switch (peek_type())
             {
                 case TokenType::VAR:
                 case TokenType::CONST:
@@ -33,124 +88,208 @@ namespace klr::compiler
                 case TokenType::STRUCT:
                 default:
                 {
-                    advance();
+                    cursor.skip();
                 }
             }
+
+            if (panicking)
+                synchronize();
         }
 
-        return ast;
+        return std::move(ast);
     }
 
     Token Parser::peek() const
     {
-        return tokens[current];
+        return cursor.token();
     }
 
+    TokenType Parser::peek_type() const
+    {
+        return cursor.peek_type();
+    }
+
+    /* stops on the trailing EOF token, so recovery can never run past the end */
     Token Parser::advance()
     {
-        return tokens[current++];
+        return cursor.advance();
     }
 
     bool Parser::is_at_end() const
     {
-        return current >= tokens.size();
+        return cursor.at_end();
     }
 
     bool Parser::match(const TokenType type)
     {
-        if (is_at_end())
-            return false;
-        if (peek().type != type)
+        if (is_at_end() || peek_type() != type)
             return false;
 
-        advance();
+        cursor.skip();
         return true;
     }
 
     Token Parser::expect(const TokenType type, const bool err)
     {
-        if (const auto ne = peek();
-            is_at_end() || ne.type != type)
+        if (is_at_end() || peek_type() != type)
         {
             if (err)
-                error(ne, "unexpected token");
+                error(DiagCode::EXPECTED_TOKEN, cursor.position(), static_cast<uint32_t>(type));
             return {};
         }
 
         return advance();
     }
 
-    Token Parser::expect(const TokenType type, const char* str)
+    Token Parser::expect(const TokenType type, const DiagCode code)
     {
-        if (const auto ne = peek();
-            is_at_end() || ne.type != type)
+        if (is_at_end() || peek_type() != type)
         {
-            error(ne, str);
+            error(code, cursor.position());
+            return {};
         }
 
         return advance();
     }
 
-    std::pair<uint32_t, uint32_t> Parser::get_position(const uint32_t offset) const
+    bool Parser::match_close_angle()
     {
-        const auto line_it = std::ranges::upper_bound(line_starts, offset);
-        size_t line = std::distance(line_starts.begin(), line_it) - 1;
-        uint32_t column = offset - line_starts[line];
-        return { line, column };
+        TokenType rest;
+        switch (peek_type())
+        {
+            case TokenType::GREATER:
+            {
+                cursor.skip();
+                return true;
+            }
+            case TokenType::RIGHT_SHIFT:
+            {
+                rest = TokenType::GREATER;
+                break;
+            }
+            case TokenType::GE:
+            {
+                rest = TokenType::EQUAL;
+                break;
+            }
+            case TokenType::RIGHT_SHIFT_EQ:
+            {
+                rest = TokenType::GE;
+                break;
+            }
+            default:
+                return false;
+        }
+
+        /* operators are never LONG_TOKENs, and the column sizes stay the same for the cursor */
+        const size_t at = cursor.position();
+        tokens.types[at] = rest;
+        ++tokens.starts[at];
+        --tokens.lens[at];
+        return true;
     }
 
-    void Parser::error(const Token token, std::string_view message, std::string_view help) const
+    void Parser::expect_close_angle()
     {
-        auto [line, column] = get_position(token.start);
+        if (!match_close_angle())
+            error(DiagCode::EXPECTED_TOKEN, cursor.position(), static_cast<uint32_t>(TokenType::GREATER));
+    }
 
-        const uint32_t display_line = line + 1;
-        const uint32_t display_column = column;
+    void Parser::error(const DiagCode code, const size_t token, const uint32_t arg)
+    {
+        /* everything after the first error of a statement is usually fallout from it */
+        if (panicking)
+            return;
+
+        panicking = true;
+        diagnostics.push_back({
+            .token = static_cast<offset_t>(token),
+            .args = { arg, 0 },
+            .code = code,
+            .level = ErrorLevel::ERROR
+        });
+    }
 
-        const std::string RED = "\033[31m";
-        const std::string BRIGHT_RED = "\033[91m";
-        const std::string RESET = "\033[0m";
+    uint32_t Parser::error_node(const DiagCode code, const size_t token)
+    {
+        error(code, token);
+        return ast.add_node(ASTNodeType::ERROR, tokens[token]);
+    }
 
-        std::stringstream error_msg;
-        error_msg << RED << mod_name << ":" << display_line << ":" << display_column << RESET
-                  << " " << BRIGHT_RED << "\n" << "error" << ": " << message << "\n";
+    void Parser::synchronize()
+    {
+        panicking = false;
+        while (!is_at_end())
+        {
+            switch (peek_type())
+            {
+                case TokenType::SEMICOLON:
+                {
+                    cursor.skip();
+                    return;
+                }
 
-        const std::string_view pline = line_starts.size() > 1 ? src.substr(
-                                               line_starts[line],
-                                               line_starts[line + 1] - line_starts[line]) : src;
+                /* left for the enclosing block (or the top level) to consume */
+                case TokenType::RIGHT_BRACE:
+                case TokenType::VAR:
+                case TokenType::CONST:
+                case TokenType::FUNCTION:
+                case TokenType::CLASS:
+                case TokenType::STRUCT:
+                case TokenType::RETURN:
+                case TokenType::IF:
+                case TokenType::WHILE:
+                case TokenType::FOR:
+                case TokenType::BREAK:
+                case TokenType::CONTINUE:
+                    return;
 
-        error_msg << "\n";
-        error_msg << " " << RED << display_line << " | " << BRIGHT_RED << pline << RESET << "\n";
-        error_msg << std::string(std::to_string(display_line).length() + 2 + display_column - 1, ' ');
-        error_msg << BRIGHT_RED << "^" << "\n";
+                default:
+                    cursor.skip();
+            }
+        }
+    }
+
+    bool Parser::has_errors() const
+    {
+        return std::ranges::find(diagnostics, ErrorLevel::ERROR, &Diagnostic::level) != diagnostics.end();
+    }
 
-        if (!help.empty())
-            error_msg << RESET << RED << help << "\n";
+    size_t Parser::error_count() const
+    {
+        return std::ranges::count(diagnostics, ErrorLevel::ERROR, &Diagnostic::level);
+    }
 
-        throw std::runtime_error(error_msg.str());
+    DiagnosticRenderer Parser::renderer() const
+    {
+        return { mod_name, src, tokens, line_starts };
     }
 
     uint32_t Parser::parse_decl() // NOLINT(*-no-recursion)
     {
         auto flags = ASTNodeFlags::NONE;
-        if (peek().type == TokenType::CONST)
+        if (peek_type() == TokenType::CONST)
             flags = flags | ASTNodeFlags::IS_CONST;
 
-        advance();
-        const Token name = expect(TokenType::IDENTIFIER, "is this a valid name?");
+        cursor.skip();
+        const uint32_t atom = cursor.atom();
+        const Token name = expect(TokenType::IDENTIFIER, DiagCode::EXPECTED_NAME);
 
-        const uint32_t decl_node = ast.add_node(ASTNodeType::DECL, name);
-        ast.nodes[decl_node].data.decl.flags = flags;
+        /* a missing name has no atom; expect() returned an empty token */
+        const uint32_t decl_node = ast.add_node(ASTNodeType::DECL, name,
+                                                name.type == TokenType::IDENTIFIER ? atom : 0);
+        ast.data[decl_node].decl.flags = flags;
         if (const Token colon = expect(TokenType::COLON);
             colon.type != TokenType::COLON)
         {
             flags = flags | ASTNodeFlags::TYPE_INFER;
-            ast.nodes[decl_node].data.decl.flags = flags;
-            ast.nodes[decl_node].data.decl.type_node = 0;
+            ast.data[decl_node].decl.flags = flags;
+            ast.data[decl_node].decl.type_node = 0;
         }
         else
         {
             const uint32_t type_idx = parse_type();
-            ast.nodes[decl_node].data.decl.type_node = type_idx;
+            ast.data[decl_node].decl.type_node = type_idx;
             ast.add_child(decl_node, type_idx);
         }
 
@@ -158,12 +297,12 @@ namespace klr::compiler
             eq.type == TokenType::EQUAL)
         {
             const uint32_t init_idx = parse_expression();
-            ast.nodes[decl_node].data.decl.init_node = init_idx;
+            ast.data[decl_node].decl.init_node = init_idx;
             ast.add_child(decl_node, init_idx);
         }
         else
         {
-            ast.nodes[decl_node].data.decl.init_node = 0;
+            ast.data[decl_node].decl.init_node = 0;
         }
 
         expect(TokenType::SEMICOLON, true);
@@ -176,18 +315,21 @@ namespace klr::compiler
         const Token func_token = advance();
         const uint32_t func = ast.add_node(ASTNodeType::FUNCTION, func_token);
 
-        /* for regular functions (not lambdas) parse name*/
+        /* for regular functions (not lambdas) parse name; the FUNCTION node keeps its atom */
         if (!is_lambda)
         {
-            expect(TokenType::IDENTIFIER, "is this a valid name?");
+            const uint32_t atom = cursor.atom();
+            if (expect(TokenType::IDENTIFIER, DiagCode::EXPECTED_NAME).type == TokenType::IDENTIFIER)
+                ast.atoms[func] = atom;
         }
 
         if (match(TokenType::LESS))
         {
             do
             {
+                const uint32_t atom = cursor.atom();
                 const Token param = expect(TokenType::IDENTIFIER, true);
-                const uint32_t generic_param = ast.add_node(ASTNodeType::TYPE, param);
+                const uint32_t generic_param = ast.add_node(ASTNodeType::TYPE, param, atom);
                 if (match(TokenType::DOT))
                 {
                     expect(TokenType::DOT);
@@ -197,15 +339,15 @@ namespace klr::compiler
                 ast.add_child(func, generic_param);
             }
             while (match(TokenType::COMMA));
-            expect(TokenType::GREATER, true);
+            expect_close_angle();
         }
 
-        /* parameter list */
         /* parameter list */
         expect(TokenType::LEFT_PAREN, true);
-        while (peek().type != TokenType::RIGHT_PAREN)
+        while (peek_type() != TokenType::RIGHT_PAREN)
         {
-            const Token param_name = expect(TokenType::IDENTIFIER, "invalid parameter");
+            const uint32_t atom = cursor.atom();
+            const Token param_name = expect(TokenType::IDENTIFIER, DiagCode::EXPECTED_PARAMETER);
             if (param_name.type != TokenType::IDENTIFIER)
                 break;
 
@@ -216,15 +358,13 @@ namespace klr::compiler
             if (param_type == 0)
                 break;
 
-            const uint32_t param_node = ast.add_node(ASTNodeType::DECL, param_name);
-            ast.nodes[param_node].data.decl.type_node = param_type;
+            const uint32_t param_node = ast.add_node(ASTNodeType::DECL, param_name, atom);
+            ast.data[param_node].decl.type_node = param_type;
             ast.add_child(param_node, param_type);
             ast.add_child(func, param_node);
-            if (peek().type != TokenType::COMMA && peek().type != TokenType::RIGHT_PAREN)
+            if (peek_type() != TokenType::COMMA && peek_type() != TokenType::RIGHT_PAREN)
             {
-                error(peek(),
-                      "invalid parameter list",
-                      "parameters must be separated by commas");
+                error(DiagCode::EXPECTED_COMMA, cursor.position());
             }
 
             if (!match(TokenType::COMMA))
@@ -235,12 +375,12 @@ namespace klr::compiler
         /* return type */
         expect(TokenType::ARROW, true);
         const uint32_t return_type = parse_type();
-        ast.nodes[func].data.function.ret_type = return_type;
+        ast.data[func].function.ret_type = return_type;
         ast.add_child(func, return_type);
 
         const Token brace = expect(TokenType::LEFT_BRACE, true);
         const uint32_t body = parse_block(brace);
-        ast.nodes[func].data.function.body = body;
+        ast.data[func].function.body = body;
         ast.add_child(func, body);
 
         return func;
@@ -248,6 +388,11 @@ namespace klr::compiler
 
     uint32_t Parser::parse_type() // NOLINT(*-no-recursion)
     {
+        /* generic and pointer arguments recurse */
+        if (depth >= max_depth)
+            return error_node(DiagCode::NESTING_TOO_DEEP, cursor.position());
+
+        ++depth;
         const Token type_tk = peek();
         uint32_t type_index = 0;
 
@@ -268,7 +413,7 @@ namespace klr::compiler
             case TokenType::BOOL:
             case TokenType::VOID:
             {
-                advance();
+                cursor.skip();
                 type_index = ast.add_node(ASTNodeType::TYPE, type_tk);
                 break;
             }
@@ -279,32 +424,28 @@ namespace klr::compiler
             case TokenType::REF:
             case TokenType::PIN:
             {
-                advance();
+                cursor.skip();
                 expect(TokenType::LESS, true);
                 type_index = ast.add_node(ASTNodeType::TYPE, type_tk);
                 const uint32_t inner_type = parse_type();
                 ast.add_child(type_index, inner_type);
-                expect(TokenType::GREATER, true);
+                expect_close_angle();
                 break;
             }
 
             /* user defined & generics */
             case TokenType::IDENTIFIER:
             {
-                advance();
-                type_index = ast.add_node(ASTNodeType::TYPE, type_tk);
+                type_index = ast.add_node(ASTNodeType::TYPE, type_tk, cursor.atom());
+                cursor.skip();
 
                 /* if this is a generic identifier type */
-                if (match(TokenType::LESS))
+                if (match(TokenType::LESS) && !match_close_angle())
                 {
-                    while (!match(TokenType::GREATER))
-                    {
-                        const uint32_t param_type = parse_type();
-                        ast.add_child(type_index, param_type);
-
-                        if (!match(TokenType::COMMA))
-                            break;
-                    }
+                    do
+                        ast.add_child(type_index, parse_type());
+                    while (match(TokenType::COMMA));
+                    expect_close_angle();
                 }
                 break;
             }
@@ -312,9 +453,7 @@ namespace klr::compiler
             /* unexpected token! */
             default:
             {
-                error(peek(),
-                      "unexpected token in type parsing",
-                      "expected a valid type");
+                type_index = error_node(DiagCode::EXPECTED_TYPE, cursor.position());
             }
         }
 
@@ -324,9 +463,11 @@ namespace klr::compiler
             expect(TokenType::RIGHT_BRACKET, true);
             const uint32_t arr_type = ast.add_node(ASTNodeType::ARRAY_TYPE, type_tk);
             ast.add_child(arr_type, type_index);
+            --depth;
             return arr_type;
         }
 
+        --depth;
         return type_index;
     }
 
@@ -334,73 +475,77 @@ namespace klr::compiler
     {
         switch (const Token tk = peek(); tk.type)
         {
-            case TokenType::STRING:
+            case TokenType::STR_LITERAL:
             case TokenType::NUM_LITERAL:
             case TokenType::TRUE:
             case TokenType::FALSE:
             case TokenType::NIL:
             {
-                advance();
-                return ast.add_node(ASTNodeType::LITERAL, tk);
+                const uint32_t literal = ast.add_node(ASTNodeType::LITERAL, tk, cursor.atom());
+                cursor.skip();
+                return literal;
             }
             case TokenType::LEFT_BRACE:
             {
-                advance();
+                cursor.skip();
                 const uint32_t arr_init = ast.add_node(ASTNodeType::ARRAY_INIT, tk);
-                while (!match(TokenType::RIGHT_BRACE))
+                if (!match(TokenType::RIGHT_BRACE))
                 {
-                    ast.add_child(arr_init, parse_expression());
-                    if (!match(TokenType::COMMA))
-                        break;
+                    do
+                        ast.add_child(arr_init, parse_expression());
+                    while (match(TokenType::COMMA));
+                    expect(TokenType::RIGHT_BRACE, true);
                 }
-                expect(TokenType::RIGHT_BRACE, true);
                 return arr_init;
             }
             case TokenType::LEFT_PAREN:
             {
-                advance();
+                cursor.skip();
                 const uint32_t expr = parse_expression();
                 expect(TokenType::RIGHT_PAREN, true);
                 return expr;
             }
             case TokenType::IDENTIFIER:
             {
-                advance();
-                uint32_t id = ast.add_node(ASTNodeType::IDENTIFIER, tk);
+                const uint32_t atom = cursor.atom();
+                cursor.skip();
+                uint32_t id = ast.add_node(ASTNodeType::IDENTIFIER, tk, atom);
 
                 while (true)
                 {
                     if (match(TokenType::DOT))
                     {
+                        const uint32_t method_atom = cursor.atom();
                         const Token method = expect(TokenType::IDENTIFIER, true);
                         if (!match(TokenType::LEFT_PAREN))
                         {
-                            error(peek(),
-                                  "invalid method call",
-                                  "method calls must be followed by parentheses");
+                            return error_node(DiagCode::EXPECTED_CALL, cursor.position());
                         }
 
-                        const uint32_t call = ast.add_node(ASTNodeType::METHOD_CALL, method);
+                        const uint32_t call = ast.add_node(ASTNodeType::METHOD_CALL, method,
+                                                           method.type == TokenType::IDENTIFIER ? method_atom : 0);
                         ast.add_child(call, id);
 
-                        while (!match(TokenType::RIGHT_PAREN))
+                        if (!match(TokenType::RIGHT_PAREN))
                         {
-                            ast.add_child(call, parse_expression());
-                            if (!match(TokenType::COMMA))
-                                break;
+                            do
+                                ast.add_child(call, parse_expression());
+                            while (match(TokenType::COMMA));
+                            expect(TokenType::RIGHT_PAREN, true);
                         }
                         id = call;
                     }
                     else if (match(TokenType::LEFT_PAREN))
                     {
-                        const uint32_t call = ast.add_node(ASTNodeType::CALL, tk);
+                        const uint32_t call = ast.add_node(ASTNodeType::CALL, tk, atom);
                         ast.add_child(call, id);
 
-                        while (!match(TokenType::RIGHT_PAREN))
+                        if (!match(TokenType::RIGHT_PAREN))
                         {
-                            ast.add_child(call, parse_expression());
-                            if (!match(TokenType::COMMA))
-                                break;
+                            do
+                                ast.add_child(call, parse_expression());
+                            while (match(TokenType::COMMA));
+                            expect(TokenType::RIGHT_PAREN, true);
                         }
                         id = call;
                     }
@@ -413,16 +558,16 @@ namespace klr::compiler
             }
             case TokenType::CAST:
             {
-                advance();
+                cursor.skip();
                 expect(TokenType::LESS, true);
                 const uint32_t cast_type = parse_type();
-                expect(TokenType::GREATER, true);
+                expect_close_angle();
                 expect(TokenType::LEFT_PAREN, true);
                 const uint32_t expr = parse_expression();
                 expect(TokenType::RIGHT_PAREN, true);
 
                 const uint32_t cast = ast.add_node(ASTNodeType::CAST_EXPR, tk);
-                ast.nodes[cast].data.cast_expr = {
+                ast.data[cast].cast_expr = {
                     .operand = expr,
                     .type_node = cast_type
                 };
@@ -438,16 +583,160 @@ namespace klr::compiler
 
             default:
             {
-                error(peek(),
-                      "unexpected token in primary expression",
-                      "unable to parse this token as a primary expression");
+                return error_node(DiagCode::EXPECTED_EXPRESSION, cursor.position());
             }
         }
     }
 
     uint32_t Parser::parse_expression() // NOLINT(*-no-recursion)
     {
-        return parse_assignment();
+        /* re-entered for call arguments, array elements, casts and lambdas */
+        if (depth >= max_depth)
+            return error_node(DiagCode::NESTING_TOO_DEEP, cursor.position());
+
+        ++depth;
+        const uint32_t expr = strategy == ExprStrategy::PRATT ? parse_binary() : parse_assignment();
+        --depth;
+        return expr;
+    }
+
+    // operator precedence on an explicit stack: prefix operators, '(' and every
+    // infix operator whose right operand is pending get a frame, and a frame is
+    // reduced once the next operator binds looser than its min_power. frames are
+    // created and reduced in the order the recursive form would, so the nodes
+    // come out identical to ExprStrategy::DESCENT
+    uint32_t Parser::parse_binary() // NOLINT(*-no-recursion)
+    {
+        using Kind = ExprFrame::Kind;
+        const size_t base = expr_stack.size();
+        uint32_t expr = 0;
+        bool need_operand = true;
+        bool too_deep = false; /* past max_depth: no new frames, unwind what is open */
+
+        while (true)
+        {
+            if (need_operand)
+            {
+                const TokenType type = peek_type();
+                const bool paren = type == TokenType::LEFT_PAREN;
+                if (paren || type == TokenType::BANG || type == TokenType::MINUS || type == TokenType::TILDE ||
+                    type == TokenType::AND || type == TokenType::STAR || type == TokenType::DELETE)
+                {
+                    if (depth >= max_depth)
+                    {
+                        expr = error_node(DiagCode::NESTING_TOO_DEEP, cursor.position());
+                        too_deep = true;
+                        need_operand = false;
+                        continue;
+                    }
+
+                    ++depth;
+                    expr_stack.push_back({
+                        .token = advance(),
+                        .lhs = 0,
+                        .then_branch = 0,
+                        .min_power = paren ? uint8_t { 0 } : UNARY_POWER,
+                        .kind = paren ? Kind::PAREN : Kind::UNARY
+                    });
+                    continue;
+                }
+
+                expr = type == TokenType::NEW ? parse_new() : parse_primary();
+                need_operand = false;
+                continue;
+            }
+
+            /* only the type column is read until an operator is actually taken */
+            const uint8_t min_power = expr_stack.size() > base ? expr_stack.back().min_power : 0;
+            if (const auto [left, right] = binding_powers[static_cast<size_t>(peek_type())];
+                !too_deep && left != 0 && left >= min_power)
+            {
+                if (depth >= max_depth)
+                {
+                    error(DiagCode::NESTING_TOO_DEEP, cursor.position());
+                    too_deep = true;
+                    continue;
+                }
+
+                ++depth;
+                const bool ternary = left == TERNARY_POWER;
+                expr_stack.push_back({
+                    .token = advance(),
+                    .lhs = expr,
+                    .then_branch = 0,
+                    .min_power = ternary ? uint8_t { 0 } : right,
+                    .kind = ternary ? Kind::TERNARY_THEN : Kind::BINARY
+                });
+                need_operand = true;
+                continue;
+            }
+
+            if (expr_stack.size() == base)
+                return expr;
+
+            const ExprFrame frame = expr_stack.back();
+            expr_stack.pop_back();
+            --depth;
+            switch (frame.kind)
+            {
+                case Kind::UNARY:
+                {
+                    const uint32_t unary = ast.add_node(ASTNodeType::UNARY_EXPR, frame.token);
+                    ast.data[unary].unary_expr = {
+                        .operand = expr,
+                        .op = frame.token.type
+                    };
+                    expr = unary;
+                    break;
+                }
+                case Kind::PAREN:
+                {
+                    expect(TokenType::RIGHT_PAREN, true);
+                    break;
+                }
+                case Kind::BINARY:
+                {
+                    const uint32_t binary = ast.add_node(ASTNodeType::BINARY_EXPR, frame.token);
+                    ast.data[binary].binary_expr = {
+                        .left = frame.lhs,
+                        .right = expr,
+                        .op = frame.token.type
+                    };
+                    expr = binary;
+                    break;
+                }
+                case Kind::TERNARY_THEN:
+                {
+                    expect(TokenType::COLON, true);
+                    if (too_deep)
+                    {
+                        expr = error_node(DiagCode::NESTING_TOO_DEEP, cursor.position());
+                        break;
+                    }
+
+                    /* the frame was just popped, so there is room for its successor */
+                    ++depth;
+                    expr_stack.push_back({
+                        .token = frame.token,
+                        .lhs = frame.lhs,
+                        .then_branch = expr,
+                        .min_power = 0,
+                        .kind = Kind::TERNARY_ELSE
+                    });
+                    need_operand = true;
+                    break;
+                }
+                case Kind::TERNARY_ELSE:
+                {
+                    const uint32_t ternary = ast.add_node(ASTNodeType::TERNARY, frame.token);
+                    ast.add_child(ternary, frame.lhs);
+                    ast.add_child(ternary, frame.then_branch);
+                    ast.add_child(ternary, expr);
+                    expr = ternary;
+                    break;
+                }
+            }
+        }
     }
 
     uint32_t Parser::parse_assignment() // NOLINT(*-no-recursion)
@@ -456,17 +745,17 @@ namespace klr::compiler
 
         Token op_token {};
         auto is_assignment = false;
-        if (peek().type == TokenType::EQUAL ||
-            peek().type == TokenType::PLUS_EQ ||
-            peek().type == TokenType::MINUS_EQ ||
-            peek().type == TokenType::STAR_EQ ||
-            peek().type == TokenType::SLASH_EQ ||
-            peek().type == TokenType::PERCENT_EQ ||
-            peek().type == TokenType::AND_EQ ||
-            peek().type == TokenType::OR_EQ ||
-            peek().type == TokenType::XOR_EQ ||
-            peek().type == TokenType::LEFT_SHIFT_EQ ||
-            peek().type == TokenType::RIGHT_SHIFT_EQ)
+        if (peek_type() == TokenType::EQUAL ||
+            peek_type() == TokenType::PLUS_EQ ||
+            peek_type() == TokenType::MINUS_EQ ||
+            peek_type() == TokenType::STAR_EQ ||
+            peek_type() == TokenType::SLASH_EQ ||
+            peek_type() == TokenType::PERCENT_EQ ||
+            peek_type() == TokenType::AND_EQ ||
+            peek_type() == TokenType::OR_EQ ||
+            peek_type() == TokenType::XOR_EQ ||
+            peek_type() == TokenType::LEFT_SHIFT_EQ ||
+            peek_type() == TokenType::RIGHT_SHIFT_EQ)
         {
             op_token = advance();
             is_assignment = true;
@@ -476,7 +765,7 @@ namespace klr::compiler
         {
             const uint32_t value = parse_expression();
             const uint32_t assign = ast.add_node(ASTNodeType::BINARY_EXPR, op_token);
-            ast.nodes[assign].data.binary_expr = {
+            ast.data[assign].binary_expr = {
                 .left = expr,
                 .right = value,
                 .op = op_token.type
@@ -490,7 +779,7 @@ namespace klr::compiler
     uint32_t Parser::parse_ternary() // NOLINT(*-no-recursion)
     {
         const uint32_t expr = parse_logical_or();
-        if (peek().type == TokenType::QUESTION)
+        if (peek_type() == TokenType::QUESTION)
         {
             const Token question = advance();
             const uint32_t then_branch = parse_expression();
@@ -510,12 +799,12 @@ namespace klr::compiler
     uint32_t Parser::parse_logical_or() // NOLINT(*-no-recursion)
     {
         uint32_t expr = parse_logical_and();
-        while (peek().type == TokenType::LOGICAL_OR)
+        while (peek_type() == TokenType::LOGICAL_OR)
         {
             const Token op = advance();
             const uint32_t right = parse_logical_and();
             const uint32_t binary = ast.add_node(ASTNodeType::BINARY_EXPR, op);
-            ast.nodes[binary].data.binary_expr = {
+            ast.data[binary].binary_expr = {
                 .left = expr,
                 .right = right,
                 .op = op.type
@@ -529,12 +818,12 @@ namespace klr::compiler
     uint32_t Parser::parse_logical_and() // NOLINT(*-no-recursion)
     {
         uint32_t expr = parse_bitwise_or();
-        while (peek().type == TokenType::LOGICAL_AND)
+        while (peek_type() == TokenType::LOGICAL_AND)
         {
             const Token op = advance();
             const uint32_t right = parse_bitwise_or();
             const uint32_t binary = ast.add_node(ASTNodeType::BINARY_EXPR, op);
-            ast.nodes[binary].data.binary_expr = {
+            ast.data[binary].binary_expr = {
                 .left = expr,
                 .right = right,
                 .op = op.type
@@ -548,12 +837,12 @@ namespace klr::compiler
     uint32_t Parser::parse_bitwise_or() // NOLINT(*-no-recursion)
     {
         uint32_t expr = parse_bitwise_xor();
-        while (peek().type == TokenType::OR)
+        while (peek_type() == TokenType::OR)
         {
             const Token op = advance();
             const uint32_t right = parse_bitwise_xor();
             const uint32_t binary = ast.add_node(ASTNodeType::BINARY_EXPR, op);
-            ast.nodes[binary].data.binary_expr = {
+            ast.data[binary].binary_expr = {
                 .left = expr,
                 .right = right,
                 .op = op.type
@@ -567,12 +856,12 @@ namespace klr::compiler
     uint32_t Parser::parse_bitwise_xor() // NOLINT(*-no-recursion)
     {
         uint32_t expr = parse_bitwise_and();
-        while (peek().type == TokenType::XOR)
+        while (peek_type() == TokenType::XOR)
         {
             const Token op = advance();
             const uint32_t right = parse_bitwise_and();
             const uint32_t binary = ast.add_node(ASTNodeType::BINARY_EXPR, op);
-            ast.nodes[binary].data.binary_expr = {
+            ast.data[binary].binary_expr = {
                 .left = expr,
                 .right = right,
                 .op = op.type
@@ -586,12 +875,12 @@ namespace klr::compiler
     uint32_t Parser::parse_bitwise_and() // NOLINT(*-no-recursion)
     {
         uint32_t expr = parse_shift();
-        while (peek().type == TokenType::AND)
+        while (peek_type() == TokenType::AND)
         {
             const Token op = advance();
             const uint32_t right = parse_shift();
             const uint32_t binary = ast.add_node(ASTNodeType::BINARY_EXPR, op);
-            ast.nodes[binary].data.binary_expr = {
+            ast.data[binary].binary_expr = {
                 .left = expr,
                 .right = right,
                 .op = op.type
@@ -605,12 +894,12 @@ namespace klr::compiler
     uint32_t Parser::parse_shift() // NOLINT(*-no-recursion)
     {
         uint32_t expr = parse_equality();
-        while (peek().type == TokenType::LEFT_SHIFT || peek().type == TokenType::RIGHT_SHIFT)
+        while (peek_type() == TokenType::LEFT_SHIFT || peek_type() == TokenType::RIGHT_SHIFT)
         {
             const Token op = advance();
             const uint32_t right = parse_equality();
             const uint32_t binary = ast.add_node(ASTNodeType::BINARY_EXPR, op);
-            ast.nodes[binary].data.binary_expr = {
+            ast.data[binary].binary_expr = {
                 .left = expr,
                 .right = right,
                 .op = op.type
@@ -624,12 +913,12 @@ namespace klr::compiler
     uint32_t Parser::parse_equality() // NOLINT(*-no-recursion)
     {
         uint32_t expr = parse_comparison();
-        while (peek().type == TokenType::EQ || peek().type == TokenType::NE)
+        while (peek_type() == TokenType::EQ || peek_type() == TokenType::NE)
         {
             const Token op = advance();
             const uint32_t right = parse_comparison();
             const uint32_t binary = ast.add_node(ASTNodeType::BINARY_EXPR, op);
-            ast.nodes[binary].data.binary_expr = {
+            ast.data[binary].binary_expr = {
                 .left = expr,
                 .right = right,
                 .op = op.type
@@ -643,13 +932,13 @@ namespace klr::compiler
     uint32_t Parser::parse_comparison() // NOLINT(*-no-recursion)
     {
         uint32_t expr = parse_term();
-        while (peek().type == TokenType::LESS || peek().type == TokenType::LE ||
-               peek().type == TokenType::GREATER || peek().type == TokenType::GE)
+        while (peek_type() == TokenType::LESS || peek_type() == TokenType::LE ||
+               peek_type() == TokenType::GREATER || peek_type() == TokenType::GE)
         {
             const Token op = advance();
             const uint32_t right = parse_term();
             const uint32_t binary = ast.add_node(ASTNodeType::BINARY_EXPR, op);
-            ast.nodes[binary].data.binary_expr = {
+            ast.data[binary].binary_expr = {
                 .left = expr,
                 .right = right,
                 .op = op.type
@@ -663,12 +952,12 @@ namespace klr::compiler
     uint32_t Parser::parse_term() // NOLINT(*-no-recursion)
     {
         uint32_t expr = parse_factor();
-        while (peek().type == TokenType::PLUS || peek().type == TokenType::MINUS)
+        while (peek_type() == TokenType::PLUS || peek_type() == TokenType::MINUS)
         {
             const Token op = advance();
             const uint32_t right = parse_factor();
             const uint32_t binary = ast.add_node(ASTNodeType::BINARY_EXPR, op);
-            ast.nodes[binary].data.binary_expr = {
+            ast.data[binary].binary_expr = {
                 .left = expr,
                 .right = right,
                 .op = op.type
@@ -682,13 +971,13 @@ namespace klr::compiler
     uint32_t Parser::parse_factor() // NOLINT(*-no-recursion)
     {
         uint32_t expr = parse_unary();
-        while (peek().type == TokenType::STAR || peek().type == TokenType::SLASH ||
-               peek().type == TokenType::PERCENT)
+        while (peek_type() == TokenType::STAR || peek_type() == TokenType::SLASH ||
+               peek_type() == TokenType::PERCENT)
         {
             const Token op = advance();
             const uint32_t right = parse_unary();
             const uint32_t binary = ast.add_node(ASTNodeType::BINARY_EXPR, op);
-            ast.nodes[binary].data.binary_expr = {
+            ast.data[binary].binary_expr = {
                 .left = expr,
                 .right = right,
                 .op = op.type
@@ -701,53 +990,41 @@ namespace klr::compiler
 
     uint32_t Parser::parse_unary() // NOLINT(*-no-recursion)
     {
-        if (peek().type == TokenType::BANG ||
-            peek().type == TokenType::MINUS ||
-            peek().type == TokenType::TILDE ||
-            peek().type == TokenType::AND || /* ref op */
-            peek().type == TokenType::STAR)  /* ptr deref op */
+        if (peek_type() == TokenType::BANG ||
+            peek_type() == TokenType::MINUS ||
+            peek_type() == TokenType::TILDE ||
+            peek_type() == TokenType::AND || /* ref op */
+            peek_type() == TokenType::STAR)  /* ptr deref op */
         {
+            /* prefix chains recurse here without passing through parse_expression */
+            if (depth >= max_depth)
+                return error_node(DiagCode::NESTING_TOO_DEEP, cursor.position());
+
             const Token op = advance();
+            ++depth;
             const uint32_t right = parse_unary();
+            --depth;
             const uint32_t unary = ast.add_node(ASTNodeType::UNARY_EXPR, op);
-            ast.nodes[unary].data.unary_expr = {
+            ast.data[unary].unary_expr = {
                 .operand = right,
                 .op = op.type
             };
             return unary;
         }
-        if (peek().type == TokenType::NEW)
-        {
-            const Token op = advance();
-            const uint32_t type_node = parse_type();
+        if (peek_type() == TokenType::NEW)
+            return parse_new();
 
-            const uint32_t unary = ast.add_node(ASTNodeType::UNARY_EXPR, op);
-            if (peek().type == TokenType::LEFT_BRACE || peek().type == TokenType::LEFT_PAREN)
-            {
-                const uint32_t init = parse_primary();
-                ast.nodes[unary].data.unary_expr = {
-                    .operand = init,
-                    .op = op.type
-                };
-                ast.add_child(unary, type_node);
-                ast.add_child(unary, init);
-            }
-            else
-            {
-                ast.nodes[unary].data.unary_expr = {
-                    .operand = type_node,
-                    .op = op.type
-                };
-                ast.add_child(unary, type_node);
-            }
-            return unary;
-        }
-        if (peek().type == TokenType::DELETE)
+        if (peek_type() == TokenType::DELETE)
         {
+            if (depth >= max_depth)
+                return error_node(DiagCode::NESTING_TOO_DEEP, cursor.position());
+
             const Token op = advance();
+            ++depth;
             const uint32_t right = parse_unary();
+            --depth;
             const uint32_t unary = ast.add_node(ASTNodeType::UNARY_EXPR, op);
-            ast.nodes[unary].data.unary_expr = {
+            ast.data[unary].unary_expr = {
                 .operand = right,
                 .op = op.type
             };
@@ -757,67 +1034,189 @@ namespace klr::compiler
         return parse_primary();
     }
 
-    uint32_t Parser::parse_if() // NOLINT(*-no-recursion)
+    uint32_t Parser::parse_new() // NOLINT(*-no-recursion)
     {
-        const Token if_token = advance(); // Save IF token
-        expect(TokenType::LEFT_PAREN, true);
-        const uint32_t condition = parse_expression();
-        expect(TokenType::RIGHT_PAREN, true);
+        const Token op = advance();
+        const uint32_t type_node = parse_type();
 
-        const Token then_brace = expect(TokenType::LEFT_BRACE, true);
-        const uint32_t then_branch = parse_block(then_brace);
-        uint32_t else_branch = 0;
+        const uint32_t unary = ast.add_node(ASTNodeType::UNARY_EXPR, op);
+        if (peek_type() == TokenType::LEFT_BRACE || peek_type() == TokenType::LEFT_PAREN)
+        {
+            const uint32_t init = parse_primary();
+            ast.data[unary].unary_expr = {
+                .operand = init,
+                .op = op.type
+            };
+            ast.add_child(unary, type_node);
+            ast.add_child(unary, init);
+        }
+        else
+        {
+            ast.data[unary].unary_expr = {
+                .operand = type_node,
+                .op = op.type
+            };
+            ast.add_child(unary, type_node);
+        }
+        return unary;
+    }
 
-        if (match(TokenType::ELSE))
+    // statements nest through block_stack rather than the call stack: a header
+    // (if, while, for) pushes the frame of the block it opens, and the statement
+    // node is only built in close_block once that block's '}' is reached
+    uint32_t Parser::parse_block(const Token brace) // NOLINT(*-no-recursion)
+    {
+        const size_t base = block_stack.size();
+        if (!push_block(brace, { .owner = brace, .parts = {}, .kind = BlockFrame::Kind::BODY }))
+            return ast.add_node(ASTNodeType::ERROR, brace);
+
+        while (true)
         {
-            if (match(TokenType::IF))
+            const size_t start = cursor.position();
+            if (const bool closed = match(TokenType::RIGHT_BRACE); closed || is_at_end())
             {
-                else_branch = parse_if();
+                if (!closed)
+                    error(DiagCode::UNTERMINATED_BLOCK, block_stack.back().open);
+
+                const BlockFrame frame = block_stack.back();
+                block_stack.pop_back();
+                --depth;
+                if (block_stack.size() == base)
+                    return frame.block;
+
+                close_block(frame);
             }
             else
             {
-                const Token else_brace = expect(TokenType::LEFT_BRACE, true);
-                else_branch = parse_block(else_brace);
+                parse_statement();
+            }
+
+            if (panicking)
+            {
+                /* the statement could not even start, e.g. a stray keyword; drop that token too */
+                if (cursor.position() == start)
+                    cursor.skip();
+                synchronize();
             }
         }
+    }
 
-        const uint32_t if_node = ast.add_node(ASTNodeType::IF, if_token);
-        ast.add_child(if_node, condition);
-        ast.add_child(if_node, then_branch);
-        if (else_branch)
-            ast.add_child(if_node, else_branch);
+    void Parser::parse_statement() // NOLINT(*-no-recursion)
+    {
+        switch (peek_type())
+        {
+            case TokenType::VAR:
+            case TokenType::CONST:
+            {
+                add_statement(parse_decl());
+                break;
+            }
 
-        return if_node;
+            case TokenType::RETURN:
+            {
+                const Token return_token = advance();
+                const uint32_t ret = ast.add_node(ASTNodeType::RETURN, return_token);
+                if (!match(TokenType::SEMICOLON))
+                {
+                    ast.add_child(ret, parse_expression());
+                    expect(TokenType::SEMICOLON, true);
+                }
+                add_statement(ret);
+                break;
+            }
+
+            case TokenType::IF:
+            case TokenType::WHILE:
+            case TokenType::FOR:
+            {
+                /* caught before the header, whose condition would not fit either */
+                if (depth >= max_depth)
+                {
+                    error(DiagCode::NESTING_TOO_DEEP, cursor.position());
+                    skip_block(false);
+                    break;
+                }
+
+                if (peek_type() == TokenType::IF)
+                    parse_if(0);
+                else if (peek_type() == TokenType::WHILE)
+                    parse_while();
+                else
+                    parse_for();
+                break;
+            }
+
+            case TokenType::BREAK:
+            {
+                const Token break_token = advance();
+                add_statement(ast.add_node(ASTNodeType::BREAK, break_token));
+                expect(TokenType::SEMICOLON, true);
+                break;
+            }
+
+            case TokenType::CONTINUE:
+            {
+                const Token continue_token = advance();
+                add_statement(ast.add_node(ASTNodeType::CONTINUE, continue_token));
+                expect(TokenType::SEMICOLON, true);
+                break;
+            }
+
+            default:
+            {
+                const uint32_t expr = parse_expression();
+                expect(TokenType::SEMICOLON, true);
+                add_statement(expr);
+                break;
+            }
+        }
     }
 
-    uint32_t Parser::parse_while() // NOLINT(*-no-recursion)
+    void Parser::parse_if(const uint32_t chain) // NOLINT(*-no-recursion)
     {
-        const Token while_token = advance();
+        const Token if_token = advance(); // Save IF token
         expect(TokenType::LEFT_PAREN, true);
         const uint32_t condition = parse_expression();
         expect(TokenType::RIGHT_PAREN, true);
 
-        const Token brace = expect(TokenType::LEFT_BRACE, true);
-        const uint32_t body = parse_block(brace);
+        const Token then_brace = expect(TokenType::LEFT_BRACE, true);
+        if (!push_block(then_brace, {
+            .owner = if_token,
+            .parts = { condition, 0, chain },
+            .kind = BlockFrame::Kind::IF_THEN
+        }))
+        {
+            const uint32_t err = ast.add_node(ASTNodeType::ERROR, if_token);
+            chain ? ast.add_child(chain, err) : add_statement(err);
+        }
+    }
 
-        const uint32_t while_node = ast.add_node(ASTNodeType::WHILE, while_token);
-        ast.add_child(while_node, condition);
-        ast.add_child(while_node, body);
+    void Parser::parse_while() // NOLINT(*-no-recursion)
+    {
+        const Token while_token = advance();
+        expect(TokenType::LEFT_PAREN, true);
+        const uint32_t condition = parse_expression();
+        expect(TokenType::RIGHT_PAREN, true);
 
-        return while_node;
+        const Token brace = expect(TokenType::LEFT_BRACE, true);
+        if (!push_block(brace, { .owner = while_token, .parts = { condition, 0, 0 }, .kind = BlockFrame::Kind::WHILE }))
+            add_statement(ast.add_node(ASTNodeType::ERROR, while_token));
     }
 
-    uint32_t Parser::parse_for() // NOLINT(*-no-recursion)
+    void Parser::parse_for() // NOLINT(*-no-recursion)
     {
         const Token for_token = advance();
         expect(TokenType::LEFT_PAREN, true);
 
         uint32_t init = 0;
-        if (!match(TokenType::SEMICOLON))
+        if (peek_type() == TokenType::VAR || peek_type() == TokenType::CONST)
+        {
+            /* parse_decl consumes the ';' itself */
+            init = parse_decl();
+        }
+        else if (!match(TokenType::SEMICOLON))
         {
-            init = match(TokenType::VAR) || match(TokenType::CONST)
-                       ? parse_decl()
-                       : parse_expression();
+            init = parse_expression();
             expect(TokenType::SEMICOLON, true);
         }
 
@@ -836,91 +1235,136 @@ namespace klr::compiler
         }
 
         const Token brace = expect(TokenType::LEFT_BRACE, true);
-        const uint32_t body = parse_block(brace);
-        const uint32_t for_node = ast.add_node(ASTNodeType::FOR, for_token);
+        if (!push_block(brace, {
+            .owner = for_token,
+            .parts = { init, condition, increment },
+            .kind = BlockFrame::Kind::FOR
+        }))
+            add_statement(ast.add_node(ASTNodeType::ERROR, for_token));
+    }
 
-        if (init)
-            ast.add_child(for_node, init);
-        if (condition)
-            ast.add_child(for_node, condition);
-        if (increment)
-            ast.add_child(for_node, increment);
-        ast.add_child(for_node, body);
+    bool Parser::push_block(const Token brace, BlockFrame frame)
+    {
+        /* callers consume the '{' right before pushing */
+        const size_t at = cursor.position();
+        frame.open = static_cast<offset_t>(brace.type == TokenType::LEFT_BRACE ? at - 1 : at);
+        if (depth >= max_depth)
+        {
+            error(DiagCode::NESTING_TOO_DEEP, frame.open);
+            skip_block(brace.type == TokenType::LEFT_BRACE);
+            return false;
+        }
 
-        return for_node;
+        ++depth;
+        frame.block = ast.add_node(ASTNodeType::BLOCK, brace);
+        block_stack.push_back(frame);
+        return true;
     }
 
-    uint32_t Parser::parse_block(const Token brace) // NOLINT(*-no-recursion)
+    void Parser::close_block(BlockFrame frame)
     {
-        const uint32_t block = ast.add_node(ASTNodeType::BLOCK, brace);
-        while (!match(TokenType::RIGHT_BRACE))
+        using Kind = BlockFrame::Kind;
+        const auto finish_if = [&](const uint32_t then_branch, const uint32_t else_branch)
         {
-            switch (peek().type)
+            const uint32_t if_node = ast.add_node(ASTNodeType::IF, frame.owner);
+            ast.add_child(if_node, frame.parts[0]);
+            ast.add_child(if_node, then_branch);
+            if (else_branch)
+                ast.add_child(if_node, else_branch);
+
+            /* an else-if is the else branch of the IF before it */
+            frame.parts[2] ? ast.add_child(frame.parts[2], if_node) : add_statement(if_node);
+            return if_node;
+        };
+
+        switch (frame.kind)
+        {
+            case Kind::IF_THEN:
             {
-                case TokenType::VAR:
-                case TokenType::CONST:
+                if (!match(TokenType::ELSE))
                 {
-                    ast.add_child(block, parse_decl());
+                    finish_if(frame.block, 0);
                     break;
                 }
 
-                case TokenType::RETURN:
+                /* the chain continues with a fresh frame, so `else if` never deepens the stack */
+                if (peek_type() == TokenType::IF)
                 {
-                    const Token return_token = advance();
-                    const uint32_t ret = ast.add_node(ASTNodeType::RETURN, return_token);
-                    if (!match(TokenType::SEMICOLON))
-                    {
-                        ast.add_child(ret, parse_expression());
-                        expect(TokenType::SEMICOLON, true);
-                    }
-                    ast.add_child(block, ret);
+                    parse_if(finish_if(frame.block, 0));
                     break;
                 }
 
-                case TokenType::IF:
-                {
-                    ast.add_child(block, parse_if());
-                    break;
-                }
-
-                case TokenType::WHILE:
-                {
-                    ast.add_child(block, parse_while());
-                    break;
-                }
+                const Token else_brace = expect(TokenType::LEFT_BRACE, true);
+                const uint32_t then_branch = frame.block;
+                frame.parts[1] = then_branch;
+                frame.kind = Kind::IF_ELSE;
+                if (!push_block(else_brace, frame))
+                    finish_if(then_branch, ast.add_node(ASTNodeType::ERROR, else_brace));
+                break;
+            }
 
-                case TokenType::FOR:
-                {
-                    ast.add_child(block, parse_for());
-                    break;
-                }
+            case Kind::IF_ELSE:
+            {
+                finish_if(frame.parts[1], frame.block);
+                break;
+            }
 
-                case TokenType::BREAK:
-                {
-                    const Token break_token = advance();
-                    ast.add_child(block, ast.add_node(ASTNodeType::BREAK, break_token));
-                    expect(TokenType::SEMICOLON, true);
-                    break;
-                }
+            case Kind::WHILE:
+            {
+                const uint32_t while_node = ast.add_node(ASTNodeType::WHILE, frame.owner);
+                ast.add_child(while_node, frame.parts[0]);
+                ast.add_child(while_node, frame.block);
+                add_statement(while_node);
+                break;
+            }
 
-                case TokenType::CONTINUE:
+            case Kind::FOR:
+            {
+                const uint32_t for_node = ast.add_node(ASTNodeType::FOR, frame.owner);
+                ast.data[for_node].for_stmt = {
+                    .init = frame.parts[0],
+                    .condition = frame.parts[1],
+                    .step = frame.parts[2]
+                };
+                for (const uint32_t part: frame.parts)
                 {
-                    const Token continue_token = advance();
-                    ast.add_child(block, ast.add_node(ASTNodeType::CONTINUE, continue_token));
-                    expect(TokenType::SEMICOLON, true);
-                    break;
+                    if (part)
+                        ast.add_child(for_node, part);
                 }
+                ast.add_child(for_node, frame.block);
+                add_statement(for_node);
+                break;
+            }
 
-                default:
-                {
-                    const uint32_t expr = parse_expression();
-                    expect(TokenType::SEMICOLON, true);
-                    ast.add_child(block, expr);
-                    break;
-                }
+            case Kind::BODY:
+            {
+                add_statement(frame.block);
+                break;
             }
         }
+    }
+
+    void Parser::add_statement(const uint32_t node)
+    {
+        /* looked up after the statement is parsed: parsing it may have grown block_stack */
+        ast.add_child(block_stack.back().block, node);
+    }
 
-        return block;
+    void Parser::skip_block(const bool opened)
+    {
+        size_t open = opened;
+        while (!is_at_end())
+        {
+            const TokenType type = peek_type();
+            /* a '}' or ';' outside any brace belongs to the enclosing block */
+            if (open == 0 && (type == TokenType::RIGHT_BRACE || type == TokenType::SEMICOLON))
+                return;
+
+            cursor.skip();
+            if (type == TokenType::LEFT_BRACE)
+                ++open;
+            else if (type == TokenType::RIGHT_BRACE && --open == 0)
+                return;
+        }
     }
 }
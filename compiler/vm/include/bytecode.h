@@ -0,0 +1,146 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <memory_resource>
+#include <vector>
+#include <compiler/analysis/include/types.h>
+
+namespace klr::compiler
+{
+    class Interner;
+
+    /*
+     * register machine instructions; a, b and c name registers of the
+     * current frame unless said otherwise, and "wide" is b | c << 16
+     */
+    enum class Opcode : uint8_t
+    {
+        MOV,   /* a = b */
+        LOADK, /* a = Program::constants[wide] */
+
+        /* integers; x is the wrap: 64 - width, | UNSIGNED */
+        ADD,
+        SUB,
+        MUL,
+        DIVS, /* traps on a zero divisor, like the U and REM forms */
+        DIVU,
+        REMS,
+        REMU,
+        AND,
+        OR,
+        XOR,
+        SHL,  /* the count is taken modulo the width */
+        SHRS, /* arithmetic */
+        SHRU,
+        NEG,
+        COMPL,
+        NOT, /* bool */
+
+        /* floats, kept as the bits of a double; x is 1 for f32, which rounds every result to float */
+        FADD,
+        FSUB,
+        FMUL,
+        FDIV,
+        FREM,
+        FNEG,
+
+        /* a = bool; > and >= swap their operands */
+        EQ,
+        NE,
+        LTS,
+        LES,
+        LTU,
+        LEU,
+        FEQ,
+        FNE,
+        FLT,
+        FLE,
+
+        CAST, /* a = b converted from kind c to kind x, see convert() */
+
+        JMP,  /* to wide, an index into Program::code */
+        JT,   /* to wide if a */
+        JF,   /* to wide unless a */
+        CALL, /* a = the function in the next word's wide, its frame starting at register b, where its args are */
+        RET,  /* a: the value */
+        RETV,
+        TRAP, /* x: the Trap */
+
+        COUNT
+    };
+
+    /* fixed width: 8 bytes, so code is an array indexed by pc */
+    struct Instruction
+    {
+        Opcode op;
+        uint8_t x;
+        uint16_t a;
+        uint16_t b;
+        uint16_t c;
+
+        [[nodiscard]] uint32_t wide() const
+        {
+            return b | static_cast<uint32_t>(c) << 16;
+        }
+    };
+
+    static_assert(sizeof(Instruction) == 8);
+
+    struct BytecodeFunction
+    {
+        uint32_t atom;      /* its name */
+        TypeId type;        /* its signature */
+        TypeKind returns;   /* the kind of what it returns, VOID included */
+        uint32_t first;     /* index into Program::code */
+        uint32_t count;     /* instructions */
+        uint32_t params;    /* registers 0 .. params - 1 on entry */
+        uint32_t registers; /* frame size, the outgoing arguments of its calls included */
+    };
+
+    /* why a run stopped early */
+    enum class Trap : uint8_t
+    {
+        NONE,
+        DIVISION_BY_ZERO,
+        STACK_OVERFLOW,
+        TOO_LARGE, /* the function needs more registers than an instruction can name */
+    };
+
+    /*
+     * a module compiled for the VM
+     *
+     * every function's code is a contiguous run of `code`. registers are
+     * untyped 64-bit slots holding values in the Constant encoding; the IR
+     * is typed, so each instruction already knows what its registers hold
+     * and no tag is checked while running. values are only tagged where
+     * they cross into or out of the VM, see Value
+     *
+     * made by BytecodeEmitter, run by VM
+     */
+    class Program
+    {
+    public:
+        static constexpr uint8_t UNSIGNED = 0x80;
+
+        std::pmr::vector<Instruction> code;
+        std::pmr::vector<uint64_t> constants; /* the ConstantPool's bits by index, then string atoms */
+        std::pmr::vector<BytecodeFunction> functions;
+
+        explicit Program(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+        /* the first function named atom, or functions.size() */
+        [[nodiscard]] uint32_t find(uint32_t atom) const;
+
+        /* as text, e.g. `  4: add.i32 r2, r0, r1`; names need the interner the atoms came from */
+        void dump(std::ostream &os, const TypeTable &table, const Interner *names = nullptr) const;
+
+        /* heap bytes held by the columns, capacity included */
+        [[nodiscard]] size_t memory_bytes() const;
+
+        [[nodiscard]] static const char *op_to_string(Opcode op);
+    };
+}
@@ -0,0 +1,105 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+#include <compiler/analysis/include/constants.h>
+#include <compiler/ir/include/ir.h>
+#include <compiler/vm/include/bytecode.h>
+
+namespace klr::compiler
+{
+    /*
+     * IR to bytecode, one function at a time
+     *
+     * every IR value gets a register of its own, parameters the first ones,
+     * so the code is still in SSA form and needs no allocator. constants are
+     * loaded once, up front, into one register per distinct constant. phis
+     * become moves at the end of each incoming edge, ordered so none
+     * overwrites a register another still reads; a branch edge that needs
+     * moves gets a stub of its own after the function's blocks. calls copy
+     * their arguments above the caller's values, where the callee's frame
+     * then starts, so the arguments are its first registers
+     *
+     * expects a module that verify() accepts
+     */
+    class BytecodeEmitter
+    {
+    public:
+        BytecodeEmitter(Program &program, const IRModule &module, const TypeTable &table,
+                        const ConstantPool &constants,
+                        std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+        /* appends every function of the module, keeping their indexes */
+        void emit();
+
+    private:
+        static constexpr uint32_t NONE = IRModule::NONE;
+
+        /* a jump waiting for its target's address */
+        struct Fixup
+        {
+            uint32_t at;    /* the jump, in Program::code */
+            uint32_t block; /* IR block, or a stub when STUB is set */
+        };
+
+        /* a branch edge into a block with phis */
+        struct Stub
+        {
+            uint32_t pred;
+            uint32_t target;
+        };
+
+        static constexpr uint32_t STUB = 1U << 31;
+
+        Program &program;
+        const IRModule &module;
+        const TypeTable &table;
+        const ConstantPool &constants;
+
+        /* per instruction of the function: its register */
+        std::pmr::vector<uint32_t> registers;
+        /* per pool constant, reset after each function: its register */
+        std::pmr::vector<uint32_t> constant_registers;
+        std::pmr::vector<uint32_t> touched;
+
+        /* per block of the function: its address */
+        std::pmr::vector<uint32_t> addresses;
+        std::pmr::vector<Fixup> fixups;
+        std::pmr::vector<Stub> stubs;
+        std::pmr::vector<uint32_t> stub_addresses;
+
+        /* pending moves of one edge: dst, src */
+        std::pmr::vector<std::pair<uint32_t, uint32_t>> moves;
+
+        uint32_t pool_first = 0;     /* where the pool's constants start in Program::constants */
+        uint32_t function_first = 0; /* where the module's functions start in Program::functions */
+        uint32_t scratch = 0;        /* register for breaking a cycle of moves */
+
+        void function(uint32_t index);
+
+        /* false if the function needs more registers than an instruction can name */
+        bool assign(const IRFunction &function, uint32_t &count);
+
+        void instruction(const IRFunction &function, uint32_t inst, uint32_t out);
+
+        void terminator(const IRFunction &function, uint32_t block, uint32_t next);
+
+        /* the moves for the phis of target on the edge from pred */
+        void edge(const IRFunction &function, uint32_t pred, uint32_t target);
+
+        void jump(Opcode op, uint32_t tested, uint32_t target);
+
+        [[nodiscard]] bool has_phis(uint32_t block) const;
+
+        void put(Opcode op, uint8_t x = 0, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0);
+
+        void put_wide(Opcode op, uint32_t a, uint32_t wide);
+
+        /* the x of an integer instruction on values of type */
+        [[nodiscard]] static uint8_t wrap(TypeId type);
+    };
+}
@@ -0,0 +1,90 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+#include <compiler/analysis/include/constants.h>
+#include <compiler/vm/include/bytecode.h>
+
+namespace klr::compiler
+{
+    /* a value as it crosses into or out of the VM: its kind and its bits, in the Constant encoding */
+    struct Value
+    {
+        TypeKind kind;
+        uint64_t bits;
+
+        /* wrapped to the width of kind */
+        [[nodiscard]] static Value integer(const TypeKind kind, const int64_t value)
+        {
+            return { kind, wrap_integer(kind, static_cast<uint64_t>(value)) };
+        }
+
+        [[nodiscard]] static Value number(const TypeKind kind, const double value)
+        {
+            return { kind, std::bit_cast<uint64_t>(kind == TypeKind::F32
+                                                       ? static_cast<double>(static_cast<float>(value))
+                                                       : value) };
+        }
+
+        [[nodiscard]] int64_t as_int() const
+        {
+            return static_cast<int64_t>(bits);
+        }
+
+        [[nodiscard]] double as_float() const
+        {
+            return std::bit_cast<double>(bits);
+        }
+    };
+
+    struct Result
+    {
+        Value value; /* VOID for a void function or a trap */
+        Trap trap;
+    };
+
+    /*
+     * the bytecode interpreter
+     *
+     * frames are windows onto one register stack: a call's frame starts at
+     * the register its arguments were copied to, so calling copies nothing.
+     * dispatch is a computed goto from each handler straight to the next
+     * where the compiler has it, a switch elsewhere. one VM runs one call at
+     * a time; the stack is reused between them
+     */
+    class VM
+    {
+    public:
+        static constexpr size_t STACK_REGISTERS = 1 << 20;
+        static constexpr size_t MAX_DEPTH = 1 << 16;
+
+        explicit VM(const Program &program, size_t stack_registers = STACK_REGISTERS,
+                    std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+        /* args must match the function's parameters in number and kind */
+        Result run(uint32_t function, std::span<const Value> args);
+
+        /* run, also counting the instructions executed */
+        Result profile(uint32_t function, std::span<const Value> args, uint64_t &executed);
+
+    private:
+        struct Frame
+        {
+            const Instruction *ret; /* the CALL's second word, past which the caller resumes */
+            uint64_t *registers;
+        };
+
+        const Program &program;
+        std::pmr::vector<uint64_t> stack;
+        std::pmr::vector<Frame> frames;
+
+        template <bool Counting>
+        Result execute(uint32_t function, std::span<const Value> args, uint64_t &executed);
+    };
+}
@@ -0,0 +1,112 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/vm/include/bytecode.h>
+#include <compiler/memory/include/interner.h>
+#include <string>
+
+namespace klr::compiler
+{
+    Program::Program(std::pmr::memory_resource *resource) : code(resource), constants(resource)
+                                                          , functions(resource) {}
+
+    uint32_t Program::find(const uint32_t atom) const
+    {
+        for (uint32_t index = 0; index < functions.size(); ++index)
+        {
+            if (functions[index].atom == atom)
+                return index;
+        }
+        return static_cast<uint32_t>(functions.size());
+    }
+
+    void Program::dump(std::ostream &os, const TypeTable &table, const Interner *names) const
+    {
+        const auto name = [&](const uint32_t atom)
+        {
+            return names ? std::string(names->str(atom)) : "#" + std::to_string(atom);
+        };
+        const auto reg = [](const uint32_t r) { return "r" + std::to_string(r); };
+
+        for (const BytecodeFunction &function: functions)
+        {
+            os << "function " << name(function.atom) << table.to_string(function.type, names).substr(8) << ", "
+                    << function.registers << " registers\n";
+
+            for (uint32_t pc = function.first; pc < function.first + function.count; ++pc)
+            {
+                const Instruction &in = code[pc];
+                os << "  " << pc - function.first << ": " << op_to_string(in.op);
+                if (in.op >= Opcode::ADD && in.op <= Opcode::COMPL)
+                    os << "." << (in.x & UNSIGNED ? "u" : "i") << 64 - (in.x & 63);
+                else if (in.op >= Opcode::FADD && in.op <= Opcode::FNEG)
+                    os << (in.x ? ".f32" : ".f64");
+
+                switch (in.op)
+                {
+                    case Opcode::MOV:
+                    case Opcode::NEG:
+                    case Opcode::COMPL:
+                    case Opcode::NOT:
+                    case Opcode::FNEG:
+                        os << " " << reg(in.a) << ", " << reg(in.b);
+                        break;
+                    case Opcode::LOADK:
+                        os << " " << reg(in.a) << ", k" << in.wide();
+                        break;
+                    case Opcode::CAST:
+                        os << " " << reg(in.a) << ", " << reg(in.b) << ", "
+                                << table.to_string(TypeTable::builtin(static_cast<TypeKind>(in.c))) << " -> "
+                                << table.to_string(TypeTable::builtin(static_cast<TypeKind>(in.x)));
+                        break;
+                    case Opcode::JMP:
+                        os << " " << in.wide() - function.first;
+                        break;
+                    case Opcode::JT:
+                    case Opcode::JF:
+                        os << " " << reg(in.a) << ", " << in.wide() - function.first;
+                        break;
+                    case Opcode::CALL:
+                        os << " " << reg(in.a) << ", " << name(functions[code[pc + 1].wide()].atom) << ", "
+                                << reg(in.b);
+                        ++pc; /* the callee's word */
+                        break;
+                    case Opcode::RET:
+                        os << " " << reg(in.a);
+                        break;
+                    case Opcode::RETV:
+                        break;
+                    case Opcode::TRAP:
+                        os << " " << static_cast<uint32_t>(in.x);
+                        break;
+                    default:
+                        os << " " << reg(in.a) << ", " << reg(in.b) << ", " << reg(in.c);
+                        break;
+                }
+                os << "\n";
+            }
+            os << "\n";
+        }
+    }
+
+    size_t Program::memory_bytes() const
+    {
+        return code.capacity() * sizeof(Instruction) + constants.capacity() * sizeof(uint64_t) +
+               functions.capacity() * sizeof(BytecodeFunction);
+    }
+
+    const char *Program::op_to_string(const Opcode op)
+    {
+        static constexpr const char *names[] = {
+            "mov", "loadk",
+            "add", "sub", "mul", "divs", "divu", "rems", "remu", "and", "or", "xor", "shl", "shrs", "shru", "neg",
+            "compl", "not",
+            "fadd", "fsub", "fmul", "fdiv", "frem", "fneg",
+            "eq", "ne", "lts", "les", "ltu", "leu", "feq", "fne", "flt", "fle",
+            "cast",
+            "jmp", "jt", "jf", "call", "ret", "retv", "trap",
+        };
+        static_assert(std::size(names) == static_cast<size_t>(Opcode::COUNT), "every Opcode needs a name");
+        return op < Opcode::COUNT ? names[static_cast<size_t>(op)] : "unknown";
+    }
+}
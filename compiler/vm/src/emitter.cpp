@@ -0,0 +1,429 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/vm/include/emitter.h>
+#include <algorithm>
+
+namespace klr::compiler
+{
+    namespace
+    {
+        constexpr uint32_t MAX_REGISTERS = 1U << 16;
+
+        TypeKind kind_of(const TypeId type)
+        {
+            return type <= TypeTable::VOID ? static_cast<TypeKind>(type) : TypeKind::ERROR;
+        }
+
+        bool is_unsigned(const TypeKind kind)
+        {
+            return kind == TypeKind::U8 || kind == TypeKind::U16 || kind == TypeKind::U32 || kind == TypeKind::U64 ||
+                   kind == TypeKind::BOOL;
+        }
+    }
+
+    BytecodeEmitter::BytecodeEmitter(Program &program, const IRModule &module, const TypeTable &table,
+                                     const ConstantPool &constants,
+                                     std::pmr::memory_resource *resource) : program(program), module(module)
+                                                                          , table(table), constants(constants)
+                                                                          , registers(resource)
+                                                                          , constant_registers(resource)
+                                                                          , touched(resource), addresses(resource)
+                                                                          , fixups(resource), stubs(resource)
+                                                                          , stub_addresses(resource)
+                                                                          , moves(resource) {}
+
+    void BytecodeEmitter::emit()
+    {
+        pool_first = static_cast<uint32_t>(program.constants.size());
+        for (const Constant &constant: constants.constants)
+            program.constants.push_back(constant.bits);
+        constant_registers.assign(constants.size(), NONE);
+
+        /* all of them up front, so a call can name one emitted later */
+        function_first = static_cast<uint32_t>(program.functions.size());
+        for (const IRFunction &function: module.functions)
+        {
+            const TypeId returns = table.args(function.type)[0];
+            program.functions.push_back({
+                function.atom, function.type, kind_of(returns), 0, 0,
+                static_cast<uint32_t>(table.args(function.type).size() - 1), 0
+            });
+        }
+
+        for (uint32_t index = 0; index < module.functions.size(); ++index)
+            function(index);
+    }
+
+    void BytecodeEmitter::function(const uint32_t index)
+    {
+        const IRFunction &function = module.functions[index];
+        BytecodeFunction &out = program.functions[function_first + index];
+        out.first = static_cast<uint32_t>(program.code.size());
+
+        uint32_t count = 0;
+        const bool fits = assign(function, count);
+        out.registers = fits ? count : out.params;
+        if (fits)
+        {
+            /* constants are loaded once, on entry, so a loop does not reload them */
+            for (const uint32_t constant: touched)
+                put_wide(Opcode::LOADK, constant_registers[constant], pool_first + constant);
+            for (uint32_t inst = function.first; inst < function.first + function.count; ++inst)
+            {
+                const IROp op = module.ops[inst];
+                if (op == IROp::STRING)
+                {
+                    put_wide(Opcode::LOADK, registers[inst - function.first],
+                             static_cast<uint32_t>(program.constants.size()));
+                    program.constants.push_back(module.a[inst]);
+                }
+                else if (op == IROp::UNDEF)
+                {
+                    put_wide(Opcode::LOADK, registers[inst - function.first], pool_first + ConstantPool::NONE);
+                }
+            }
+
+            addresses.assign(function.block_count, NONE);
+            fixups.clear();
+            stubs.clear();
+            stub_addresses.clear();
+
+            for (uint32_t block = 0; block < function.block_count; ++block)
+            {
+                const IRBlock &b = module.blocks[function.first_block + block];
+                addresses[block] = static_cast<uint32_t>(program.code.size());
+                for (uint32_t inst = b.first; inst < b.first + b.count - 1; ++inst)
+                    instruction(function, inst, scratch + 1);
+                terminator(function, function.first_block + block,
+                           block + 1 < function.block_count ? function.first_block + block + 1 : NONE);
+            }
+
+            /* the stub of a branch edge does the edge's moves, then goes where the branch meant to */
+            for (uint32_t i = 0; i < stubs.size(); ++i)
+            {
+                stub_addresses.push_back(static_cast<uint32_t>(program.code.size()));
+                edge(function, stubs[i].pred, stubs[i].target);
+                jump(Opcode::JMP, 0, stubs[i].target);
+            }
+
+            for (const auto [at, target]: fixups)
+            {
+                const uint32_t address = target & STUB
+                                             ? stub_addresses[target & ~STUB]
+                                             : addresses[target - function.first_block];
+                program.code[at].b = static_cast<uint16_t>(address);
+                program.code[at].c = static_cast<uint16_t>(address >> 16);
+            }
+        }
+        else
+        {
+            put(Opcode::TRAP, static_cast<uint8_t>(Trap::TOO_LARGE));
+        }
+
+        out.count = static_cast<uint32_t>(program.code.size()) - out.first;
+        for (const uint32_t constant: touched)
+            constant_registers[constant] = NONE;
+        touched.clear();
+    }
+
+    bool BytecodeEmitter::assign(const IRFunction &function, uint32_t &count)
+    {
+        /* parameters are where the caller put the arguments */
+        const auto params = static_cast<uint32_t>(table.args(function.type).size() - 1);
+        uint32_t next = params;
+        uint32_t arguments = 0;
+        registers.assign(function.count, NONE);
+        for (uint32_t inst = function.first; inst < function.first + function.count; ++inst)
+        {
+            uint32_t &reg = registers[inst - function.first];
+            switch (const IROp op = module.ops[inst])
+            {
+                case IROp::PARAM:
+                    reg = module.a[inst];
+                    break;
+                case IROp::CONST:
+                {
+                    uint32_t &shared = constant_registers[module.a[inst]];
+                    if (shared == NONE)
+                    {
+                        shared = next++;
+                        touched.push_back(module.a[inst]);
+                    }
+                    reg = shared;
+                    break;
+                }
+                default:
+                {
+                    if (op == IROp::CALL)
+                        arguments = std::max(arguments, module.b[inst] - 1);
+                    if (!IRModule::is_terminator(op))
+                        reg = next++;
+                    break;
+                }
+            }
+        }
+
+        /* one register to break cycles of moves, then the outgoing arguments */
+        scratch = next;
+        count = next + 1 + arguments;
+        return count <= MAX_REGISTERS;
+    }
+
+    void BytecodeEmitter::instruction(const IRFunction &function, const uint32_t inst, const uint32_t out)
+    {
+        const IROp op = module.ops[inst];
+        const uint32_t dst = registers[inst - function.first];
+        const auto reg = [&](const uint32_t value) { return registers[value - function.first]; };
+
+        if (op >= IROp::ADD && op <= IROp::SHR)
+        {
+            const TypeKind kind = kind_of(module.types[inst]);
+            const uint32_t lhs = reg(module.a[inst]);
+            const uint32_t rhs = reg(module.b[inst]);
+            if (TypeTable::is_float(kind))
+            {
+                static constexpr Opcode floats[] = { Opcode::FADD, Opcode::FSUB, Opcode::FMUL, Opcode::FDIV,
+                                                     Opcode::FREM };
+                put(floats[static_cast<uint8_t>(op) - static_cast<uint8_t>(IROp::ADD)], kind == TypeKind::F32, dst,
+                    lhs, rhs);
+                return;
+            }
+
+            const bool sign = !is_unsigned(kind);
+            Opcode code;
+            switch (op)
+            {
+                case IROp::ADD:
+                    code = Opcode::ADD;
+                    break;
+                case IROp::SUB:
+                    code = Opcode::SUB;
+                    break;
+                case IROp::MUL:
+                    code = Opcode::MUL;
+                    break;
+                case IROp::DIV:
+                    code = sign ? Opcode::DIVS : Opcode::DIVU;
+                    break;
+                case IROp::REM:
+                    code = sign ? Opcode::REMS : Opcode::REMU;
+                    break;
+                case IROp::AND:
+                    code = Opcode::AND;
+                    break;
+                case IROp::OR:
+                    code = Opcode::OR;
+                    break;
+                case IROp::XOR:
+                    code = Opcode::XOR;
+                    break;
+                case IROp::SHL:
+                    code = Opcode::SHL;
+                    break;
+                default:
+                    code = sign ? Opcode::SHRS : Opcode::SHRU;
+                    break;
+            }
+            put(code, wrap(module.types[inst]), dst, lhs, rhs);
+            return;
+        }
+
+        if (op >= IROp::EQ && op <= IROp::GE)
+        {
+            /* > and >= are < and <= the other way round */
+            const TypeKind kind = kind_of(module.types[module.a[inst]]);
+            const bool swap = op == IROp::GT || op == IROp::GE;
+            const uint32_t lhs = reg(swap ? module.b[inst] : module.a[inst]);
+            const uint32_t rhs = reg(swap ? module.a[inst] : module.b[inst]);
+            const bool strict = op == IROp::LT || op == IROp::GT;
+            Opcode code;
+            if (op == IROp::EQ || op == IROp::NE)
+            {
+                code = TypeTable::is_float(kind)
+                           ? op == IROp::EQ ? Opcode::FEQ : Opcode::FNE
+                           : op == IROp::EQ ? Opcode::EQ : Opcode::NE;
+            }
+            else if (TypeTable::is_float(kind))
+                code = strict ? Opcode::FLT : Opcode::FLE;
+            else if (is_unsigned(kind))
+                code = strict ? Opcode::LTU : Opcode::LEU;
+            else
+                code = strict ? Opcode::LTS : Opcode::LES;
+            put(code, 0, dst, lhs, rhs);
+            return;
+        }
+
+        switch (op)
+        {
+            case IROp::NEG:
+            {
+                const TypeKind kind = kind_of(module.types[inst]);
+                if (TypeTable::is_float(kind))
+                    put(Opcode::FNEG, 0, dst, reg(module.a[inst]));
+                else
+                    put(Opcode::NEG, wrap(module.types[inst]), dst, reg(module.a[inst]));
+                break;
+            }
+            case IROp::NOT:
+                put(Opcode::NOT, 0, dst, reg(module.a[inst]));
+                break;
+            case IROp::COMPL:
+                put(Opcode::COMPL, wrap(module.types[inst]), dst, reg(module.a[inst]));
+                break;
+            case IROp::CAST:
+            {
+                const TypeKind from = kind_of(module.types[module.a[inst]]);
+                const TypeKind to = kind_of(module.types[inst]);
+                if (from == to)
+                    put(Opcode::MOV, 0, dst, reg(module.a[inst]));
+                else
+                    put(Opcode::CAST, static_cast<uint8_t>(to), dst, reg(module.a[inst]), static_cast<uint32_t>(from));
+                break;
+            }
+            case IROp::CALL:
+            {
+                /* the callee's frame starts at out, so its parameters are these registers */
+                const auto entries = module.list(inst);
+                for (uint32_t i = 1; i < entries.size(); ++i)
+                    put(Opcode::MOV, 0, out + i - 1, reg(entries[i]));
+                put(Opcode::CALL, 0, dst, out);
+                put_wide(Opcode::TRAP, 0, function_first + entries[0]);
+                break;
+            }
+            default:
+                /* values loaded on entry, parameters, and phis, which are moves on the edges */
+                break;
+        }
+    }
+
+    void BytecodeEmitter::terminator(const IRFunction &function, const uint32_t block, const uint32_t next)
+    {
+        const IRBlock &b = module.blocks[block];
+        const uint32_t inst = b.first + b.count - 1;
+        switch (module.ops[inst])
+        {
+            case IROp::JUMP:
+            {
+                edge(function, block, b.succs[0]);
+                if (b.succs[0] != next)
+                    jump(Opcode::JMP, 0, b.succs[0]);
+                break;
+            }
+
+            case IROp::BRANCH:
+            {
+                /* an edge into phis cannot share the block's code with the other edge, so it gets a stub */
+                uint32_t targets[2];
+                for (uint32_t i = 0; i < 2; ++i)
+                {
+                    targets[i] = b.succs[i];
+                    if (has_phis(b.succs[i]))
+                    {
+                        targets[i] = STUB | static_cast<uint32_t>(stubs.size());
+                        stubs.push_back({ block, b.succs[i] });
+                    }
+                }
+
+                const uint32_t condition = registers[module.a[inst] - function.first];
+                if (targets[1] == next)
+                    jump(Opcode::JT, condition, targets[0]);
+                else if (targets[0] == next)
+                    jump(Opcode::JF, condition, targets[1]);
+                else
+                {
+                    jump(Opcode::JT, condition, targets[0]);
+                    jump(Opcode::JMP, 0, targets[1]);
+                }
+                break;
+            }
+
+            default:
+            {
+                if (module.a[inst] == NONE)
+                    put(Opcode::RETV);
+                else
+                    put(Opcode::RET, 0, registers[module.a[inst] - function.first]);
+                break;
+            }
+        }
+    }
+
+    void BytecodeEmitter::edge(const IRFunction &function, const uint32_t pred, const uint32_t target)
+    {
+        const auto preds = module.preds(target);
+        const auto slot = static_cast<uint32_t>(std::ranges::find(preds, pred) - preds.begin());
+
+        moves.clear();
+        for (uint32_t inst = module.blocks[target].first; module.ops[inst] == IROp::PHI; ++inst)
+        {
+            const uint32_t dst = registers[inst - function.first];
+            const uint32_t src = registers[module.list(inst)[slot] - function.first];
+            if (dst != src)
+                moves.emplace_back(dst, src);
+        }
+
+        /* a parallel copy, made sequential: a move goes once nothing left still reads its destination */
+        while (!moves.empty())
+        {
+            const auto ready = std::ranges::find_if(moves, [&](const std::pair<uint32_t, uint32_t> &move)
+            {
+                return std::ranges::none_of(moves, [&](const std::pair<uint32_t, uint32_t> &other)
+                {
+                    return other.second == move.first;
+                });
+            });
+
+            if (ready != moves.end())
+            {
+                put(Opcode::MOV, 0, ready->first, ready->second);
+                *ready = moves.back();
+                moves.pop_back();
+                continue;
+            }
+
+            /* only cycles are left; save one destination, and its readers read the copy */
+            const uint32_t saved = moves.front().first;
+            put(Opcode::MOV, 0, scratch, saved);
+            for (auto &[dst, src]: moves)
+            {
+                if (src == saved)
+                    src = scratch;
+            }
+        }
+    }
+
+    void BytecodeEmitter::jump(const Opcode op, const uint32_t tested, const uint32_t target)
+    {
+        fixups.push_back({ static_cast<uint32_t>(program.code.size()), target });
+        put(op, 0, tested);
+    }
+
+    bool BytecodeEmitter::has_phis(const uint32_t block) const
+    {
+        return module.ops[module.blocks[block].first] == IROp::PHI;
+    }
+
+    void BytecodeEmitter::put(const Opcode op, const uint8_t x, const uint32_t a, const uint32_t b, const uint32_t c)
+    {
+        program.code.push_back({ op, x, static_cast<uint16_t>(a), static_cast<uint16_t>(b), static_cast<uint16_t>(c) });
+    }
+
+    void BytecodeEmitter::put_wide(const Opcode op, const uint32_t a, const uint32_t wide)
+    {
+        put(op, 0, a, wide & 0xFFFF, wide >> 16);
+    }
+
+    uint8_t BytecodeEmitter::wrap(const TypeId type)
+    {
+        const TypeKind kind = kind_of(type);
+        const uint32_t width = kind == TypeKind::U8 || kind == TypeKind::I8
+                                   ? 8
+                                   : kind == TypeKind::U16 || kind == TypeKind::I16
+                                         ? 16
+                                         : kind == TypeKind::U32 || kind == TypeKind::I32
+                                               ? 32
+                                               : 64;
+        return static_cast<uint8_t>((64 - width) | (is_unsigned(kind) ? Program::UNSIGNED : 0));
+    }
+}
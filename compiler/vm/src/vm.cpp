@@ -0,0 +1,412 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <compiler/vm/include/vm.h>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define KLR_COMPUTED_GOTO 1
+#else
+#define KLR_COMPUTED_GOTO 0
+#endif
+
+namespace klr::compiler
+{
+    namespace
+    {
+        /* back to the width in x, sign- or zero-extending; a no-op for 64-bit types */
+        inline uint64_t wrap(const uint64_t value, const uint8_t x)
+        {
+            const uint32_t shift = x & 63;
+            return x & Program::UNSIGNED
+                       ? value << shift >> shift
+                       : static_cast<uint64_t>(static_cast<int64_t>(value << shift) >> shift);
+        }
+
+        inline double f(const uint64_t bits)
+        {
+            return std::bit_cast<double>(bits);
+        }
+
+        /* an f32 result is rounded to float, as ConstantFolder does */
+        inline uint64_t bits(const double value, const uint8_t x)
+        {
+            return std::bit_cast<uint64_t>(x ? static_cast<double>(static_cast<float>(value)) : value);
+        }
+    }
+
+    VM::VM(const Program &program, const size_t stack_registers,
+           std::pmr::memory_resource *resource) : program(program), stack(stack_registers, 0, resource)
+                                                , frames(resource) {}
+
+    Result VM::run(const uint32_t function, const std::span<const Value> args)
+    {
+        uint64_t executed = 0;
+        return execute<false>(function, args, executed);
+    }
+
+    Result VM::profile(const uint32_t function, const std::span<const Value> args, uint64_t &executed)
+    {
+        executed = 0;
+        return execute<true>(function, args, executed);
+    }
+
+    template <bool Counting>
+    Result VM::execute(const uint32_t function, const std::span<const Value> args, uint64_t &executed)
+    {
+        const BytecodeFunction &entry = program.functions[function];
+        if (entry.registers > stack.size())
+            return { { TypeKind::VOID, 0 }, Trap::STACK_OVERFLOW };
+
+        const Instruction *const code = program.code.data();
+        const uint64_t *const constants = program.constants.data();
+        const uint64_t *const end = stack.data() + stack.size();
+        const Instruction *ip = code + entry.first;
+        uint64_t *r = stack.data();
+        TypeKind returns = entry.returns;
+        frames.clear();
+        for (size_t i = 0; i < std::min<size_t>(args.size(), entry.params); ++i)
+            r[i] = args[i].bits;
+
+#define A r[ip->a]
+#define B r[ip->b]
+#define C r[ip->c]
+
+#if KLR_COMPUTED_GOTO
+        static const void *const targets[] = {
+            &&op_MOV, &&op_LOADK,
+            &&op_ADD, &&op_SUB, &&op_MUL, &&op_DIVS, &&op_DIVU, &&op_REMS, &&op_REMU, &&op_AND, &&op_OR, &&op_XOR,
+            &&op_SHL, &&op_SHRS, &&op_SHRU, &&op_NEG, &&op_COMPL, &&op_NOT,
+            &&op_FADD, &&op_FSUB, &&op_FMUL, &&op_FDIV, &&op_FREM, &&op_FNEG,
+            &&op_EQ, &&op_NE, &&op_LTS, &&op_LES, &&op_LTU, &&op_LEU, &&op_FEQ, &&op_FNE, &&op_FLT, &&op_FLE,
+            &&op_CAST,
+            &&op_JMP, &&op_JT, &&op_JF, &&op_CALL, &&op_RET, &&op_RETV, &&op_TRAP,
+        };
+        static_assert(std::size(targets) == static_cast<size_t>(Opcode::COUNT), "every Opcode needs a handler");
+
+#define TARGET(name) op_##name:
+#define DISPATCH()                                                                                                     \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if constexpr (Counting)                                                                                        \
+            ++executed;                                                                                                \
+        goto *targets[static_cast<uint8_t>(ip->op)];                                                                   \
+    } while (0)
+
+        DISPATCH();
+#else
+#define TARGET(name) case Opcode::name:
+#define DISPATCH()                                                                                                     \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if constexpr (Counting)                                                                                        \
+            ++executed;                                                                                                \
+        goto dispatch;                                                                                                 \
+    } while (0)
+
+        if constexpr (Counting)
+            ++executed;
+    dispatch:
+        switch (ip->op)
+        {
+#endif
+            TARGET(MOV)
+            {
+                A = B;
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(LOADK)
+            {
+                A = constants[ip->wide()];
+                ++ip;
+                DISPATCH();
+            }
+
+            TARGET(ADD)
+            {
+                A = wrap(B + C, ip->x);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(SUB)
+            {
+                A = wrap(B - C, ip->x);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(MUL)
+            {
+                A = wrap(B * C, ip->x);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(DIVS)
+            {
+                /* INT64_MIN / -1 traps in hardware; it wraps like any other overflow */
+                if (C == 0)
+                    return { { TypeKind::VOID, 0 }, Trap::DIVISION_BY_ZERO };
+                A = static_cast<int64_t>(C) == -1
+                        ? wrap(0 - B, ip->x)
+                        : wrap(static_cast<uint64_t>(static_cast<int64_t>(B) / static_cast<int64_t>(C)), ip->x);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(DIVU)
+            {
+                if (C == 0)
+                    return { { TypeKind::VOID, 0 }, Trap::DIVISION_BY_ZERO };
+                A = B / C;
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(REMS)
+            {
+                if (C == 0)
+                    return { { TypeKind::VOID, 0 }, Trap::DIVISION_BY_ZERO };
+                A = static_cast<int64_t>(C) == -1
+                        ? 0
+                        : wrap(static_cast<uint64_t>(static_cast<int64_t>(B) % static_cast<int64_t>(C)), ip->x);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(REMU)
+            {
+                if (C == 0)
+                    return { { TypeKind::VOID, 0 }, Trap::DIVISION_BY_ZERO };
+                A = B % C;
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(AND)
+            {
+                A = B & C;
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(OR)
+            {
+                A = B | C;
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(XOR)
+            {
+                A = B ^ C;
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(SHL)
+            {
+                A = wrap(B << (C & (63 - (ip->x & 63))), ip->x);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(SHRS)
+            {
+                A = static_cast<uint64_t>(static_cast<int64_t>(B) >> (C & (63 - (ip->x & 63))));
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(SHRU)
+            {
+                A = B >> (C & (63 - (ip->x & 63)));
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(NEG)
+            {
+                A = wrap(0 - B, ip->x);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(COMPL)
+            {
+                A = wrap(~B, ip->x);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(NOT)
+            {
+                A = B ^ 1;
+                ++ip;
+                DISPATCH();
+            }
+
+            TARGET(FADD)
+            {
+                A = bits(f(B) + f(C), ip->x);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(FSUB)
+            {
+                A = bits(f(B) - f(C), ip->x);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(FMUL)
+            {
+                A = bits(f(B) * f(C), ip->x);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(FDIV)
+            {
+                A = bits(f(B) / f(C), ip->x);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(FREM)
+            {
+                A = bits(std::fmod(f(B), f(C)), ip->x);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(FNEG)
+            {
+                A = B ^ 1ULL << 63;
+                ++ip;
+                DISPATCH();
+            }
+
+            TARGET(EQ)
+            {
+                A = B == C;
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(NE)
+            {
+                A = B != C;
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(LTS)
+            {
+                A = static_cast<int64_t>(B) < static_cast<int64_t>(C);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(LES)
+            {
+                A = static_cast<int64_t>(B) <= static_cast<int64_t>(C);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(LTU)
+            {
+                A = B < C;
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(LEU)
+            {
+                A = B <= C;
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(FEQ)
+            {
+                A = f(B) == f(C);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(FNE)
+            {
+                A = f(B) != f(C);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(FLT)
+            {
+                A = f(B) < f(C);
+                ++ip;
+                DISPATCH();
+            }
+            TARGET(FLE)
+            {
+                A = f(B) <= f(C);
+                ++ip;
+                DISPATCH();
+            }
+
+            TARGET(CAST)
+            {
+                uint64_t out = 0;
+                (void) convert(static_cast<TypeKind>(ip->c), static_cast<TypeKind>(ip->x), B, out);
+                A = out;
+                ++ip;
+                DISPATCH();
+            }
+
+            TARGET(JMP)
+            {
+                ip = code + ip->wide();
+                DISPATCH();
+            }
+            TARGET(JT)
+            {
+                ip = A ? code + ip->wide() : ip + 1;
+                DISPATCH();
+            }
+            TARGET(JF)
+            {
+                ip = A ? ip + 1 : code + ip->wide();
+                DISPATCH();
+            }
+
+            TARGET(CALL)
+            {
+                const BytecodeFunction &callee = program.functions[ip[1].wide()];
+                uint64_t *const window = r + ip->b;
+                if (frames.size() >= MAX_DEPTH || window + callee.registers > end)
+                    return { { TypeKind::VOID, 0 }, Trap::STACK_OVERFLOW };
+                frames.push_back({ ip + 1, r });
+                r = window;
+                ip = code + callee.first;
+                DISPATCH();
+            }
+            TARGET(RET)
+            {
+                const uint64_t value = A;
+                if (frames.empty())
+                    return { { returns, value }, Trap::NONE };
+                const Frame frame = frames.back();
+                frames.pop_back();
+                r = frame.registers;
+                r[frame.ret[-1].a] = value;
+                ip = frame.ret + 1;
+                DISPATCH();
+            }
+            TARGET(RETV)
+            {
+                if (frames.empty())
+                    return { { returns, 0 }, Trap::NONE };
+                const Frame frame = frames.back();
+                frames.pop_back();
+                r = frame.registers;
+                ip = frame.ret + 1;
+                DISPATCH();
+            }
+            TARGET(TRAP)
+            {
+                return { { TypeKind::VOID, 0 }, static_cast<Trap>(ip->x) };
+            }
+#if !KLR_COMPUTED_GOTO
+            default:
+                return { { TypeKind::VOID, 0 }, Trap::NONE };
+        }
+#endif
+
+#undef TARGET
+#undef DISPATCH
+#undef A
+#undef B
+#undef C
+    }
+
+    template Result VM::execute<false>(uint32_t, std::span<const Value>, uint64_t &);
+    template Result VM::execute<true>(uint32_t, std::span<const Value>, uint64_t &);
+}
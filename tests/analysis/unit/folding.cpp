@@ -0,0 +1,214 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/analysis/include/folder.h>
+#include <tests/pipeline.h>
+#include <cmath>
+#include <filesystem>
+#include <limits>
+
+using namespace klr::compiler;
+
+namespace
+{
+    /* one module checked and folded */
+    struct Folded : test::Pipeline
+    {
+        Folded(const std::string &name, std::string source) : Pipeline(name, std::move(source), test::Stage::FOLD) {}
+
+        /* the initializer of the declaration named name */
+        uint32_t init(const std::string_view name) const
+        {
+            for (uint32_t i = 0; i < ast.size(); ++i)
+            {
+                if (ast.types[i] == ASTNodeType::DECL && interner.str(ast.atoms[i]) == name)
+                    return ast.data[i].decl.init_node;
+            }
+            return 0;
+        }
+
+        /* what the initializer of name folded to, "-" if it did not */
+        std::string value(const std::string_view name) const
+        {
+            const uint32_t node = init(name);
+            return ast.types[node] == ASTNodeType::LITERAL && ast.data[node].literal.constant
+                       ? pool.to_string(ast.data[node].literal.constant)
+                       : "-";
+        }
+    };
+}
+
+TEST_CASE("Constant folding")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    SECTION("The pool keeps each typed value once")
+    {
+        ConstantPool pool;
+        const uint32_t five = pool.add(TypeTable::I32, 5);
+        CHECK(five != ConstantPool::NONE);
+        CHECK(pool.add(TypeTable::I32, 5) == five);
+        CHECK(pool.add(TypeTable::builtin(TypeKind::I64), 5) != five);
+        CHECK(pool.add(TypeTable::I32, static_cast<uint64_t>(-7)) != five);
+        CHECK(pool.to_string(pool.add(TypeTable::I32, static_cast<uint64_t>(-7))) == "-7");
+        CHECK(pool.to_string(pool.add(TypeTable::builtin(TypeKind::U64), ~0ULL)) == "18446744073709551615");
+        CHECK(pool.to_string(pool.add(TypeTable::F64, std::bit_cast<uint64_t>(2.5))) == "2.5");
+        CHECK(pool.to_string(pool.add(TypeTable::BOOL, 1)) == "true");
+
+        for (uint64_t i = 0; i < 10000; ++i)
+            REQUIRE(pool.add(TypeTable::I32, i) == pool.add(TypeTable::I32, i));
+        CHECK(pool.size() == 1 + 6 + 9999); /* NONE, the six above, 5 was there already */
+    }
+
+    SECTION("Integers wrap at their width")
+    {
+        const auto binary = [](const TokenType op, const TypeKind kind, const int64_t a, const int64_t b)
+        {
+            uint64_t out = 0;
+            REQUIRE(evaluate_binary(op, kind, wrap_integer(kind, a), wrap_integer(kind, b), out));
+            return static_cast<int64_t>(out);
+        };
+        constexpr int64_t i64_min = std::numeric_limits<int64_t>::min();
+
+        CHECK(binary(TokenType::PLUS, TypeKind::I8, 127, 1) == -128);
+        CHECK(binary(TokenType::PLUS, TypeKind::U8, 255, 1) == 0);
+        CHECK(binary(TokenType::MINUS, TypeKind::U16, 0, 1) == 65535);
+        CHECK(binary(TokenType::STAR, TypeKind::I32, 65536, 65536) == 0);
+        CHECK(binary(TokenType::SLASH, TypeKind::I32, -2147483648, -1) == -2147483648);
+        CHECK(binary(TokenType::SLASH, TypeKind::I64, i64_min, -1) == i64_min);
+        CHECK(binary(TokenType::PERCENT, TypeKind::I64, i64_min, -1) == 0);
+        CHECK(binary(TokenType::SLASH, TypeKind::I32, -7, 2) == -3);
+        CHECK(binary(TokenType::PERCENT, TypeKind::I32, -7, 2) == -1);
+        CHECK(binary(TokenType::SLASH, TypeKind::U32, -7, 2) == 2147483644);
+
+        /* shift counts are modulo the width, >> keeps the sign of signed types */
+        CHECK(binary(TokenType::LEFT_SHIFT, TypeKind::I32, 1, 33) == 2);
+        CHECK(binary(TokenType::LEFT_SHIFT, TypeKind::U8, 1, 7) == 128);
+        CHECK(binary(TokenType::LEFT_SHIFT, TypeKind::I8, 1, 7) == -128);
+        CHECK(binary(TokenType::RIGHT_SHIFT, TypeKind::I8, -128, 1) == -64);
+        CHECK(binary(TokenType::RIGHT_SHIFT, TypeKind::U8, 128, 1) == 64);
+        CHECK(binary(TokenType::RIGHT_SHIFT, TypeKind::I64, -1, 63) == -1);
+
+        CHECK(binary(TokenType::LESS, TypeKind::I8, -1, 1) == 1);
+        CHECK(binary(TokenType::LESS, TypeKind::U8, -1, 1) == 0);
+
+        uint64_t out;
+        CHECK(!evaluate_binary(TokenType::SLASH, TypeKind::I32, 1, 0, out));
+        CHECK(!evaluate_binary(TokenType::PERCENT, TypeKind::U8, 1, 0, out));
+        CHECK(!evaluate_binary(TokenType::EQUAL, TypeKind::I32, 1, 1, out));
+        CHECK(!evaluate_binary(TokenType::PLUS, TypeKind::STRING, 1, 1, out));
+
+        REQUIRE(evaluate_unary(TokenType::MINUS, TypeKind::I16, wrap_integer(TypeKind::I16, -32768), out));
+        CHECK(static_cast<int64_t>(out) == -32768);
+        REQUIRE(evaluate_unary(TokenType::TILDE, TypeKind::U8, 0, out));
+        CHECK(out == 255);
+    }
+
+    SECTION("Floats round at their width and casts saturate")
+    {
+        const auto f64 = [](const double value) { return std::bit_cast<uint64_t>(value); };
+        uint64_t out;
+
+        REQUIRE(evaluate_binary(TokenType::PLUS, TypeKind::F64, f64(0.1), f64(0.2), out));
+        CHECK(std::bit_cast<double>(out) == 0.1 + 0.2);
+        REQUIRE(evaluate_binary(TokenType::PLUS, TypeKind::F32, f64(0.1f), f64(0.2f), out));
+        CHECK(std::bit_cast<double>(out) == static_cast<double>(0.1f + 0.2f));
+        REQUIRE(evaluate_binary(TokenType::SLASH, TypeKind::F64, f64(1), f64(0), out));
+        CHECK(std::isinf(std::bit_cast<double>(out)));
+
+        const auto cast = [&](const TypeKind from, const TypeKind to, const uint64_t bits)
+        {
+            REQUIRE(convert(from, to, bits, out));
+            return out;
+        };
+        CHECK(static_cast<int64_t>(cast(TypeKind::F64, TypeKind::I32, f64(-2.9))) == -2);
+        CHECK(static_cast<int64_t>(cast(TypeKind::F64, TypeKind::I32, f64(1e20))) == 2147483647);
+        CHECK(static_cast<int64_t>(cast(TypeKind::F64, TypeKind::I32, f64(-1e20))) == -2147483648);
+        CHECK(static_cast<int64_t>(cast(TypeKind::F64, TypeKind::I64, f64(1e19))) ==
+              std::numeric_limits<int64_t>::max());
+        CHECK(cast(TypeKind::F64, TypeKind::U64, f64(1e30)) == ~0ULL);
+        CHECK(cast(TypeKind::F64, TypeKind::U8, f64(-1)) == 0);
+        CHECK(cast(TypeKind::F64, TypeKind::U8, f64(std::nan(""))) == 0);
+        CHECK(cast(TypeKind::I32, TypeKind::U8, wrap_integer(TypeKind::I32, -1)) == 255);
+        CHECK(static_cast<int64_t>(cast(TypeKind::U8, TypeKind::I8, 200)) == -56);
+        CHECK(std::bit_cast<double>(cast(TypeKind::I8, TypeKind::F64, wrap_integer(TypeKind::I8, -5))) == -5.0);
+        CHECK(std::bit_cast<double>(cast(TypeKind::F64, TypeKind::F32, f64(0.1))) == static_cast<double>(0.1f));
+
+        /* 2^53 + 2^29 + 1 rounds to 2^53 by way of double, but up to 2^53 + 2^30 when rounded once */
+        CHECK(std::bit_cast<double>(cast(TypeKind::I64, TypeKind::F32, 9007199791611905)) == 9007200328482816.0);
+        CHECK(std::bit_cast<double>(cast(TypeKind::U64, TypeKind::F32, 9007199791611905)) == 9007200328482816.0);
+        CHECK(std::bit_cast<double>(cast(TypeKind::I64, TypeKind::F32, wrap_integer(TypeKind::I64, -9007199791611905))) ==
+              -9007200328482816.0);
+        CHECK(cast(TypeKind::I32, TypeKind::BOOL, 7) == 1);
+        CHECK(!convert(TypeKind::STRING, TypeKind::I32, 0, out));
+    }
+
+    SECTION("Constant expressions become literals")
+    {
+        const Folded f(relative_filename,
+                       "const A: i32 = 1 << 4;\n"
+                       "const B: u8 = 250 + 10;\n"
+                       "const C: i32 = A * 3 - cast<i32>(2.9);\n"
+                       "const D: bool = A > 10 && !false;\n"
+                       "const E: f32 = 0.1 + 0.2;\n"
+                       "const G: f64 = 0.1 + 0.2;\n"
+                       "const H: i32 = D ? A : C;\n"
+                       "const I: i8 = -(-128);\n"
+                       "const J: i64 = cast<i64>(~0) >> 40;\n"
+                       "const L: i64 = 9007199791611905;\n"
+                       "const K: f32 = cast<f32>(L);\n"
+                       "function main() -> i32 {\n"
+                       "    var x = A + 1;\n"
+                       "    var y = x + 1;\n"
+                       "    var z = false && y > 0;\n"
+                       "    var w = true ? B : cast<u8>(y);\n"
+                       "    var v = y > 0 ? 1 : 2;\n"
+                       "    return C;\n"
+                       "}\n");
+        CHECK(f.folder->get_diagnostics().empty());
+        CHECK(f.value("A") == "16");
+        CHECK(f.value("B") == "4");
+        CHECK(f.value("C") == "46");
+        CHECK(f.value("D") == "true");
+        CHECK(f.value("E") == "0.3");
+        CHECK(f.value("G") == "0.30000000000000004");
+        CHECK(f.value("H") == "16");
+        CHECK(f.value("I") == "-128");
+        CHECK(f.value("J") == "-1");
+        CHECK(f.value("K") == "9.0072e+15"); /* double rounding gives 9.007199e+15 */
+        CHECK(f.value("x") == "17");
+        CHECK(f.value("y") == "-");
+        CHECK(f.value("z") == "false");
+        CHECK(f.value("w") == "4");
+        CHECK(f.value("v") == "-");
+
+        /* types survive the rewrite, and the operands are unlinked */
+        CHECK(f.types.to_string(f.checker->type_of(f.init("B"))) == "u8");
+        CHECK(f.ast.first_child[f.init("C")] == 0);
+        CHECK(f.ast.first_child[f.init("H")] == 0);
+        CHECK(f.ast.types[f.init("y")] == ASTNodeType::BINARY_EXPR);
+        CHECK(f.folded == 20);
+
+        /* folding again finds nothing new */
+        CHECK(f.folder->fold() == 0);
+    }
+
+    SECTION("Integer division by zero is reported, not folded")
+    {
+        const Folded f(relative_filename,
+                       "const Z: i32 = 0;\n"
+                       "const Q: i32 = 10 / Z;\n"
+                       "const R: f64 = 1.0 / 0;\n");
+        REQUIRE(f.folder->get_diagnostics().size() == 1);
+        CHECK(f.folder->get_diagnostics()[0].code == DiagCode::DIVISION_BY_ZERO);
+        CHECK(f.value("Q") == "-");
+        CHECK(f.value("R") == "inf");
+
+        std::ostringstream text;
+        f.parser->renderer().text(text, f.folder->get_diagnostics()[0]);
+        CHECK(text.str().find("division by zero in '/'") != std::string::npos);
+    }
+}
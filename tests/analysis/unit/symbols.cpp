@@ -0,0 +1,238 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/analysis/include/symbols.h>
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/memory/include/interner.h>
+#include <compiler/parser/include/parser.h>
+#include <algorithm>
+#include <filesystem>
+
+using namespace klr::compiler;
+
+namespace
+{
+    struct Resolved
+    {
+        AST ast;
+        SymbolTable table;
+    };
+
+    Resolved resolve(const std::string &name, const std::string &src, Interner &interner,
+                     const uint32_t max_depth = Parser::DEFAULT_MAX_DEPTH)
+    {
+        Lexer lexer(name, src, simd::Level::AVX2, std::pmr::get_default_resource(), &interner);
+        auto tokens = lexer.tokenize();
+        Parser parser(name, src, std::move(tokens), lexer.get_line_starts(), std::pmr::get_default_resource(),
+                      ExprStrategy::PRATT, max_depth);
+
+        Resolved out { parser.parse(), SymbolTable() };
+        REQUIRE(!parser.has_errors());
+        out.table.resolve(out.ast);
+        return out;
+    }
+
+    /* every IDENTIFIER in source order as name@line of its declaration, name@? if unresolved */
+    std::vector<std::string> uses(const std::string &src, const Resolved &r)
+    {
+        std::vector<std::string> out;
+        for (uint32_t i = 0; i < r.ast.size(); ++i)
+        {
+            if (r.ast.types[i] != ASTNodeType::IDENTIFIER)
+                continue;
+
+            const Token tk = r.ast.tokens[i];
+            std::string use(src.substr(tk.start, tk.len));
+            if (const uint32_t decl = r.table.declaration(i))
+            {
+                const auto start = static_cast<std::ptrdiff_t>(r.ast.tokens[decl].start);
+                use += "@" + std::to_string(1 + std::count(src.begin(), src.begin() + start, '\n'));
+            }
+            else
+                use += "@?";
+            out.push_back(use);
+        }
+        return out;
+    }
+}
+
+TEST_CASE("Symbol resolution")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+    Interner interner;
+
+    SECTION("Parameters, locals and shadowing in nested blocks")
+    {
+        const std::string src =
+                "function f(a: i32, b: i32) -> i32 {\n" // 1
+                "    var c: i32 = a + b;\n"             // 2
+                "    if (c) {\n"                        // 3
+                "        var a: i32 = c;\n"             // 4
+                "        c = a;\n"                      // 5
+                "    }\n"                               // 6
+                "    return a + c;\n"                   // 7
+                "}\n";
+        const auto r = resolve(relative_filename, src, interner);
+        CHECK(uses(src, r) == std::vector<std::string> { "a@1", "b@1", "c@2", "c@2", "c@2", "a@4", "a@1", "c@2" });
+        CHECK(r.table.unresolved.empty());
+        CHECK(r.table.redeclared.empty());
+
+        /* the inner `a` shadows the parameter and its scope is the if's block */
+        uint32_t shadowing = 0;
+        for (uint32_t s = 1; s < r.table.symbols.size(); ++s)
+        {
+            if (r.table.symbols[s].shadowed != SymbolTable::NONE)
+                shadowing = s;
+        }
+        REQUIRE(shadowing != 0);
+        const Symbol &local = r.table.symbols[shadowing];
+        CHECK(interner.str(local.atom) == "a");
+        CHECK(r.ast.types[r.table.symbols[local.shadowed].node] == ASTNodeType::DECL);
+        CHECK(r.ast.types[r.table.scopes[local.scope].node] == ASTNodeType::BLOCK);
+        CHECK(r.table.scopes[local.scope].depth == 3); /* module, function, body, if block */
+    }
+
+    SECTION("A local's initializer sees the outer name")
+    {
+        const std::string src =
+                "var x: i32 = 1;\n"                  // 1
+                "function f() -> i32 {\n"            // 2
+                "    var x: i32 = x + 1;\n"          // 3
+                "    return x;\n"                    // 4
+                "}\n";
+        const auto r = resolve(relative_filename, src, interner);
+        CHECK(uses(src, r) == std::vector<std::string> { "x@1", "x@3" });
+    }
+
+    SECTION("Module-level names are visible before their declaration")
+    {
+        const std::string src =
+                "function even(n: i32) -> i32 {\n"  // 1
+                "    return odd(n) + limit;\n"      // 2
+                "}\n"                               // 3
+                "function odd(n: i32) -> i32 {\n"   // 4
+                "    return even(n);\n"             // 5
+                "}\n"                               // 6
+                "var limit: i32 = even(2);\n";      // 7
+        const auto r = resolve(relative_filename, src, interner);
+        CHECK(uses(src, r) == std::vector<std::string> { "odd@4", "n@1", "limit@7", "even@1", "n@4", "even@1" });
+
+        /* the CALL nodes carry the callee too */
+        for (uint32_t i = 0; i < r.ast.size(); ++i)
+        {
+            if (r.ast.types[i] == ASTNodeType::CALL)
+                CHECK(r.ast.types[r.table.declaration(i)] == ASTNodeType::FUNCTION);
+        }
+    }
+
+    SECTION("Generic parameters bind named types")
+    {
+        const std::string src = "function id<T>(v: T) -> T { var w: T = v; return w; }";
+        const auto r = resolve(relative_filename, src, interner);
+
+        uint32_t generic = 0;
+        uint32_t bound = 0;
+        for (uint32_t i = 0; i < r.ast.size(); ++i)
+        {
+            if (r.ast.types[i] != ASTNodeType::TYPE || interner.str(r.ast.atoms[i]) != "T")
+                continue;
+            if (r.ast.types[r.ast.parents[i]] == ASTNodeType::FUNCTION && r.ast.data[r.ast.parents[i]].function.ret_type != i)
+                generic = i;
+            else
+            {
+                CHECK(r.table.declaration(i) != 0);
+                ++bound;
+            }
+        }
+        REQUIRE(generic != 0);
+        CHECK(bound == 3);
+        for (uint32_t i = 0; i < r.ast.size(); ++i)
+        {
+            if (r.ast.types[i] == ASTNodeType::TYPE && i != generic && interner.str(r.ast.atoms[i]) == "T")
+                CHECK(r.table.declaration(i) == generic);
+        }
+        CHECK(uses(src, r) == std::vector<std::string> { "v@1", "w@1" });
+    }
+
+    SECTION("A for header's declaration is scoped to the loop")
+    {
+        const std::string src =
+                "function f(n: i32) -> i32 {\n"                      // 1
+                "    for (var i: i32 = 0; i < n; i = i + 1) {\n"     // 2
+                "        n = n - i;\n"                               // 3
+                "    }\n"                                            // 4
+                "    return i;\n"                                    // 5
+                "}\n";
+        const auto r = resolve(relative_filename, src, interner);
+        CHECK(uses(src, r) == std::vector<std::string> { "i@2", "n@1", "i@2", "i@2", "n@1", "n@1", "i@2", "i@?" });
+        REQUIRE(r.table.unresolved.size() == 1);
+        CHECK(src.substr(r.ast.tokens[r.table.unresolved[0]].start, 1) == "i");
+    }
+
+    SECTION("Lambdas capture enclosing locals")
+    {
+        const std::string src =
+                "function f(k: i32) -> i32 {\n"                                   // 1
+                "    var g = function(x: i32) -> i32 { return x * k + y; };\n"  // 2
+                "    return g(k);\n"                                              // 3
+                "}\n";
+        const auto r = resolve(relative_filename, src, interner);
+        CHECK(uses(src, r) == std::vector<std::string> { "x@2", "k@1", "y@?", "g@2", "k@1" });
+    }
+
+    SECTION("Redeclarations in one scope are reported")
+    {
+        const std::string src =
+                "var top: i32 = 0;\n"                   // 1
+                "var top: i32 = 1;\n"                   // 2
+                "function f(a: i32) -> i32 {\n"         // 3
+                "    var a: i32 = 0;\n"                 // 4
+                "    var b: i32 = a;\n"                 // 5
+                "    var b: i32 = b;\n"                 // 6
+                "    return b;\n"                       // 7
+                "}\n";
+        const auto r = resolve(relative_filename, src, interner);
+        REQUIRE(r.table.redeclared.size() == 2);
+        CHECK(src.substr(r.ast.tokens[r.table.redeclared[0]].start, 3) == "top");
+        CHECK(src.substr(r.ast.tokens[r.table.redeclared[1]].start, 1) == "b");
+
+        /* the parameter lives in the function's scope, the local in the body's */
+        CHECK(uses(src, r) == std::vector<std::string> { "a@4", "b@5", "b@6" });
+    }
+
+    SECTION("Deep nesting resolves without recursion")
+    {
+        constexpr int levels = 20000;
+        std::string src = "function f(v0: i32) -> i32 {\n";
+        for (int i = 1; i <= levels; ++i)
+            src += "if (v" + std::to_string(i - 1) + ") { var v" + std::to_string(i) + ": i32 = v0;\n";
+        src += "return v" + std::to_string(levels) + ";\n";
+        for (int i = 0; i < levels; ++i)
+            src += "}";
+        src += "\n return v1; }";
+
+        const auto r = resolve(relative_filename, src, interner, levels + 64);
+        const auto all = uses(src, r);
+        REQUIRE(all.size() == 2 * levels + 2);
+        CHECK(all[2 * levels] == "v20000@20001");
+        CHECK(all.back() == "v1@?");
+        CHECK(r.table.unresolved.size() == 1);
+        CHECK(r.table.scopes.size() == 3 + levels);
+    }
+
+    SECTION("Resolving again starts over")
+    {
+        const std::string src = "function f(a: i32) -> i32 { return a + q; }";
+        auto r = resolve(relative_filename, src, interner);
+        const auto first = uses(src, r);
+        const size_t symbols = r.table.symbols.size();
+
+        r.table.resolve(r.ast);
+        CHECK(uses(src, r) == first);
+        CHECK(r.table.symbols.size() == symbols);
+        CHECK(r.table.unresolved.size() == 1);
+    }
+}
@@ -0,0 +1,206 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/analysis/include/checker.h>
+#include <tests/pipeline.h>
+#include <filesystem>
+#include <sstream>
+
+using namespace klr::compiler;
+
+namespace
+{
+    /* one module through every pass up to type checking */
+    struct Checked : test::Pipeline
+    {
+        Checked(const std::string &name, std::string source) : Pipeline(name, std::move(source), test::Stage::CHECK) {}
+
+        /* the type of the first declaration named name */
+        std::string type(const std::string_view name) const
+        {
+            for (uint32_t i = 0; i < ast.size(); ++i)
+            {
+                if ((ast.types[i] == ASTNodeType::DECL || ast.types[i] == ASTNodeType::FUNCTION) &&
+                    interner.str(ast.atoms[i]) == name)
+                    return types.to_string(checker->type_of(i), &interner);
+            }
+            return "<none>";
+        }
+
+        /* every type diagnostic as id:token text */
+        std::vector<std::string> errors() const
+        {
+            std::vector<std::string> out;
+            const TokenList &tokens = parser->get_tokens();
+            for (const Diagnostic &d: checker->get_diagnostics())
+            {
+                out.push_back(std::string(diag_info(d.code).id) + ":" +
+                              std::string(src.substr(tokens.starts[d.token], tokens.length(d.token))));
+            }
+            return out;
+        }
+    };
+}
+
+TEST_CASE("Type table and inference")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    SECTION("Types are hash-consed")
+    {
+        TypeTable types;
+        CHECK(types.size() == static_cast<size_t>(TypeKind::VOID) + 1);
+        CHECK(TypeTable::builtin(TypeKind::I32) == TypeTable::I32);
+        CHECK(types.intern(TypeKind::I32) == TypeTable::I32);
+
+        const TypeId array = types.wrap(TypeKind::ARRAY, TypeTable::I32);
+        const TypeId own = types.wrap(TypeKind::OWN, array);
+        CHECK(types.wrap(TypeKind::OWN, types.wrap(TypeKind::ARRAY, TypeTable::I32)) == own);
+        CHECK(types.wrap(TypeKind::SHARE, array) != own);
+
+        const TypeId sig[] = { TypeTable::BOOL, own, TypeTable::STRING };
+        const TypeId swapped[] = { TypeTable::BOOL, TypeTable::STRING, own };
+        const TypeId function = types.intern(TypeKind::FUNCTION, 0, sig);
+        CHECK(types.intern(TypeKind::FUNCTION, 0, sig) == function);
+        CHECK(types.intern(TypeKind::FUNCTION, 0, swapped) != function);
+        CHECK(types.to_string(function) == "function(Own<i32[]>, string) -> bool");
+
+        /* many distinct types survive table growth */
+        TypeId nested = TypeTable::builtin(TypeKind::U8);
+        std::vector<TypeId> chain;
+        for (int i = 0; i < 5000; ++i)
+            chain.push_back(nested = types.wrap(i % 2 ? TypeKind::REF : TypeKind::ARRAY, nested));
+        nested = TypeTable::builtin(TypeKind::U8);
+        for (int i = 0; i < 5000; ++i)
+            REQUIRE((nested = types.wrap(i % 2 ? TypeKind::REF : TypeKind::ARRAY, nested)) == chain[i]);
+    }
+
+    SECTION("Declarations without annotations are inferred")
+    {
+        const Checked c(relative_filename,
+                        "function main() -> i32 {\n"
+                        "    var a = 1;\n"
+                        "    var b = 2.5;\n"
+                        "    var s = \"text\";\n"
+                        "    var t = a < 3 && true;\n"
+                        "    var arr = {a, 2, 3};\n"
+                        "    var p = new i32(4);\n"
+                        "    var v = *p;\n"
+                        "    var r = &v;\n"
+                        "    var big = 1 << 40;\n"
+                        "    var half = b / 2;\n"
+                        "    var cat = s + \"!\";\n"
+                        "    return a;\n"
+                        "}\n");
+        CHECK(c.errors().empty());
+        CHECK(c.type("a") == "i32");
+        CHECK(c.type("b") == "f64");
+        CHECK(c.type("s") == "string");
+        CHECK(c.type("t") == "bool");
+        CHECK(c.type("arr") == "i32[]");
+        CHECK(c.type("p") == "Own<i32>");
+        CHECK(c.type("v") == "i32");
+        CHECK(c.type("r") == "Ref<i32>");
+        CHECK(c.type("big") == "i32");
+        CHECK(c.type("half") == "f64");
+        CHECK(c.type("cat") == "string");
+        CHECK(c.type("main") == "function() -> i32");
+    }
+
+    SECTION("Later uses pin down a literal's type")
+    {
+        const Checked c(relative_filename,
+                        "function sq(v: f32) -> f32 { return v * v; }\n"
+                        "function main() -> i32 {\n"
+                        "    var x = 1;\n"
+                        "    var y: u8 = x;\n"
+                        "    var r = sq(2);\n"
+                        "    var z = 3;\n"
+                        "    var w = sq(z);\n"
+                        "    return 0;\n"
+                        "}\n");
+        CHECK(c.errors().empty());
+        CHECK(c.type("x") == "u8");
+        CHECK(c.type("r") == "f32");
+        CHECK(c.type("z") == "f32");
+        CHECK(c.type("w") == "f32");
+    }
+
+    SECTION("Generic functions are instantiated per call")
+    {
+        const Checked c(relative_filename,
+                        "function id<T>(v: T) -> T { return v; }\n"
+                        "function pair<A, B>(a: A, b: B) -> B { return b; }\n"
+                        "function main() -> i32 {\n"
+                        "    var one = id(1);\n"
+                        "    var text = id(\"s\");\n"
+                        "    var list = pair(true, {1.5});\n"
+                        "    var add = function(x: i32, y: i32) -> i32 { return x + y; };\n"
+                        "    var sum = add(one, 2);\n"
+                        "    return sum;\n"
+                        "}\n");
+        CHECK(c.errors().empty());
+        CHECK(c.type("id") == "function(T) -> T");
+        CHECK(c.type("one") == "i32");
+        CHECK(c.type("text") == "string");
+        CHECK(c.type("list") == "f64[]");
+        CHECK(c.type("add") == "function(i32, i32) -> i32");
+        CHECK(c.type("sum") == "i32");
+    }
+
+    SECTION("Type errors are reported where they happen")
+    {
+        const Checked c(relative_filename,
+                        "const limit: i32 = 10;\n"
+                        "function f(n: i32) -> bool { return n; }\n"
+                        "function g<T>(v: T) -> i32 { return v; }\n"
+                        "function main() -> i32 {\n"
+                        "    var a: i32 = \"s\";\n"
+                        "    var b = true + 1;\n"
+                        "    if (1) { limit = 3; }\n"
+                        "    f(1, 2);\n"
+                        "    f(\"x\");\n"
+                        "    a(2);\n"
+                        "    var n = null;\n"
+                        "    var e = {};\n"
+                        "    return 0;\n"
+                        "}\n");
+        CHECK(c.errors() == std::vector<std::string> {
+            "E0010:n", "E0010:v", "E0010:\"s\"", "E0011:+", "E0015:limit", "E0010:1", "E0013:f", "E0010:\"x\"",
+            "E0012:a", "E0014:n", "E0014:e"
+        });
+
+        /* the renderer the parser hands out renders them too */
+        std::ostringstream text;
+        c.parser->renderer().text(text, c.checker->get_diagnostics()[2]);
+        CHECK(text.str().find("mismatched types at '\"s\"'") != std::string::npos);
+        CHECK(c.checker->get_diagnostics()[2].args[0] == TypeTable::I32);
+        CHECK(c.checker->get_diagnostics()[2].args[1] == TypeTable::STRING);
+    }
+
+    SECTION("Errors do not cascade")
+    {
+        const Checked c(relative_filename,
+                        "function main() -> i32 {\n"
+                        "    var u = missing(1);\n"
+                        "    var w: i32 = u + 1;\n"
+                        "    var m = u.size();\n"
+                        "    var q = {m, \"s\"};\n"
+                        "    return w;\n"
+                        "}\n");
+        CHECK(c.errors().empty());
+        CHECK(c.type("u") == "{error}");
+        CHECK(c.type("w") == "i32");
+    }
+
+    SECTION("Infinite types are rejected")
+    {
+        const Checked c(relative_filename, "var a = {a};\n");
+        const auto errors = c.errors();
+        REQUIRE(!errors.empty());
+        CHECK(errors[0] == "E0010:{");
+    }
+}
@@ -0,0 +1,97 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/parser/include/parser.h>
+#include <filesystem>
+#include <sstream>
+
+using namespace klr::compiler;
+
+static_assert(std::is_trivially_copyable_v<Diagnostic>);
+static_assert(sizeof(Diagnostic) <= 2 * sizeof(uint64_t) + sizeof(offset_t));
+
+TEST_CASE("Diagnostic rendering")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    const std::string src = "var a: i32 = 1;\n"
+                            "var b: i32 = a +;\n"
+                            "const \"name\\\"quoted\": i32 = 2;\n"
+                            "var c: i32 = (1";
+    Lexer lexer(relative_filename, src);
+    auto tokens = lexer.tokenize();
+    Parser parser(relative_filename, src, std::move(tokens), lexer.get_line_starts());
+    const AST ast = parser.parse();
+
+    const auto &diagnostics = parser.get_diagnostics();
+    const DiagnosticRenderer renderer = parser.renderer();
+    REQUIRE(diagnostics.size() == 3);
+    CHECK(parser.error_count() == 3);
+
+    SECTION("Records and locations")
+    {
+        CHECK(diagnostics[0].code == DiagCode::EXPECTED_EXPRESSION);
+        CHECK(diagnostics[1].code == DiagCode::EXPECTED_NAME);
+        CHECK(diagnostics[2].code == DiagCode::EXPECTED_TOKEN);
+        CHECK(static_cast<TokenType>(diagnostics[2].args[0]) == TokenType::RIGHT_PAREN);
+
+        const auto [line, column, length] = renderer.locate(diagnostics[1]);
+        CHECK(line == 3);
+        CHECK(column == 7);
+        CHECK(length == 14);
+    }
+
+    SECTION("Messages")
+    {
+        CHECK(renderer.message(diagnostics[0]) == "expected an expression, found ';'");
+        CHECK(renderer.message(diagnostics[1]) == "expected a name, found '\"name\\\"quoted\"'");
+        CHECK(renderer.message(diagnostics[2]) == "expected ')', found end of file");
+    }
+
+    SECTION("Plain and colored text")
+    {
+        std::ostringstream plain;
+        renderer.text(plain, diagnostics[0]);
+        CHECK(plain.str() == relative_filename + ":2:17\n"
+                             "error[E0006]: expected an expression, found ';'\n"
+                             "\n"
+                             " 2 | var b: i32 = a +;\n"
+                             "   |                 ^\n"
+                             "help: unable to parse this token as a primary expression\n");
+
+        std::ostringstream colored;
+        renderer.text(colored, diagnostics[1], true);
+        CHECK(colored.str().find("\033[91merror[E0002]") != std::string::npos);
+        CHECK(colored.str().find("^~~~~~~~~~~~~~") != std::string::npos);
+    }
+
+    SECTION("JSON")
+    {
+        std::ostringstream json;
+        renderer.json(json, diagnostics);
+        const std::string out = json.str();
+        CHECK(out.front() == '[');
+        CHECK(out.find("\"code\": \"E0006\", \"severity\": \"error\"") != std::string::npos);
+        CHECK(out.find("\"line\": 3, \"column\": 7, \"length\": 14") != std::string::npos);
+        CHECK(out.find(R"("message": "expected a name, found '\"name\\\"quoted\"'")") != std::string::npos);
+
+        std::ostringstream empty;
+        renderer.json(empty, {});
+        CHECK(empty.str() == "[]\n");
+    }
+
+    SECTION("SARIF")
+    {
+        std::ostringstream sarif;
+        renderer.sarif(sarif, diagnostics);
+        const std::string out = sarif.str();
+        CHECK(out.find("\"version\": \"2.1.0\"") != std::string::npos);
+        CHECK(out.find("{ \"id\": \"E0008\"") != std::string::npos);
+        CHECK(out.find("\"ruleId\": \"E0001\", \"ruleIndex\": 0, \"level\": \"error\"") != std::string::npos);
+        CHECK(out.find("\"region\": { \"startLine\": 2, \"startColumn\": 17, \"endColumn\": 18 }") != std::string::npos);
+    }
+}
@@ -0,0 +1,304 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/ir/include/lowering.h>
+#include <tests/pipeline.h>
+#include <filesystem>
+#include <sstream>
+
+using namespace klr::compiler;
+
+namespace
+{
+    /* one module checked, folded and lowered */
+    struct Lowered : test::Pipeline
+    {
+        Lowered(const std::string &name, std::string source) : Pipeline(name, std::move(source), test::Stage::LOWER) {}
+
+        std::string dump() const
+        {
+            std::ostringstream os;
+            module.dump(os, types, pool, &interner);
+            return os.str();
+        }
+
+        /* the codes of the lowering's diagnostics, in order */
+        std::vector<std::string> errors() const
+        {
+            std::vector<std::string> codes;
+            for (const Diagnostic &diagnostic: lowering->get_diagnostics())
+                codes.emplace_back(diag_info(diagnostic.code).id);
+            return codes;
+        }
+    };
+}
+
+TEST_CASE("IR lowering")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    SECTION("Branches join in phis, returns end their block")
+    {
+        const Lowered lowered(relative_filename, R"(
+            function abs(x: i32) -> i32 { if (x < 0) { return -x; } return x; }
+            function fib(n: i32) -> i32 { return n < 2 ? n : fib(n - 1) + fib(n - 2); }
+        )");
+        CHECK(lowered.errors().empty());
+        CHECK(verify(lowered.module, lowered.types).empty());
+        CHECK(lowered.dump() ==
+              "function abs(i32) -> i32\n"
+              "b0:\n"
+              "    %0: i32 = param 0\n"
+              "    %1: i32 = const 0\n"
+              "    %2: bool = lt %0, %1\n"
+              "    branch %2, b1, b2\n"
+              "b1: <- b0\n"
+              "    %4: i32 = neg %0\n"
+              "    return %4\n"
+              "b2: <- b0\n"
+              "    return %0\n"
+              "\n"
+              "function fib(i32) -> i32\n"
+              "b0:\n"
+              "    %0: i32 = param 0\n"
+              "    %1: i32 = const 2\n"
+              "    %2: bool = lt %0, %1\n"
+              "    branch %2, b1, b2\n"
+              "b1: <- b0\n"
+              "    jump b3\n"
+              "b2: <- b0\n"
+              "    %5: i32 = const 1\n"
+              "    %6: i32 = sub %0, %5\n"
+              "    %7: i32 = call fib(%6)\n"
+              "    %8: i32 = const 2\n"
+              "    %9: i32 = sub %0, %8\n"
+              "    %10: i32 = call fib(%9)\n"
+              "    %11: i32 = add %7, %10\n"
+              "    jump b3\n"
+              "b3: <- b1, b2\n"
+              "    %13: i32 = phi [%0, b1], [%11, b2]\n"
+              "    return %13\n"
+              "\n");
+    }
+
+    SECTION("Loop headers keep only the phis of what the loop changes")
+    {
+        const Lowered lowered(relative_filename, R"(
+            function sum(n: i32) -> i32 {
+                var s: i32 = 0;
+                var i: i32 = 0;
+                while (i < n) { s += i; i += 1; }
+                return s;
+            }
+        )");
+        CHECK(verify(lowered.module, lowered.types).empty());
+        CHECK(lowered.dump() ==
+              "function sum(i32) -> i32\n"
+              "b0:\n"
+              "    %0: i32 = param 0\n"
+              "    %1: i32 = const 0\n"
+              "    %2: i32 = const 0\n"
+              "    jump b1\n"
+              "b1: <- b0, b2\n"
+              "    %4: i32 = phi [%1, b0], [%8, b2]\n"
+              "    %5: i32 = phi [%2, b0], [%10, b2]\n"
+              "    %6: bool = lt %5, %0\n"
+              "    branch %6, b2, b3\n"
+              "b2: <- b1\n"
+              "    %8: i32 = add %4, %5\n"
+              "    %9: i32 = const 1\n"
+              "    %10: i32 = add %5, %9\n"
+              "    jump b1\n"
+              "b3: <- b1\n"
+              "    return %4\n"
+              "\n");
+    }
+
+    SECTION("Break leaves through the exit, continue through the step")
+    {
+        const Lowered lowered(relative_filename, R"(
+            function skip(n: i32) -> i32 {
+                var s: i32 = 0;
+                for (var i: i32 = 0; i < n; i += 1) {
+                    if (i == 3) { continue; }
+                    if (i == 7) { break; }
+                    s += i;
+                }
+                return s;
+            }
+        )");
+        CHECK(verify(lowered.module, lowered.types).empty());
+
+        const std::string dump = lowered.dump();
+        CHECK(dump.find("b1: <- b0, b7\n") != std::string::npos);        /* the step is the one back edge */
+        CHECK(dump.find("b7: <- b3, b6\n") != std::string::npos);        /* the continue and the end of the body */
+        CHECK(dump.find("%18: i32 = phi [%4, b3], [%16, b6]\n") != std::string::npos);
+        CHECK(dump.find("b8: <- b1, b5\n    return %4\n") != std::string::npos);
+    }
+
+    SECTION("Short circuits and conditionals are branches")
+    {
+        const Lowered lowered(relative_filename, R"(
+            function both(a: bool, b: bool) -> bool { return a && b; }
+            function either(a: bool, b: bool) -> bool { return a || b; }
+            function clamp(x: f64) -> i64 {
+                var y: f64 = x;
+                if (y > 1.0) { y = 1.0; } else if (y < 0.0) { y = 0.0; }
+                return cast<i64>(y * 20.0);
+            }
+        )");
+        CHECK(lowered.errors().empty());
+        CHECK(verify(lowered.module, lowered.types).empty());
+
+        const std::string dump = lowered.dump();
+        CHECK(dump.find("function both(bool, bool) -> bool\n"
+                        "b0:\n"
+                        "    %0: bool = param 0\n"
+                        "    %1: bool = param 1\n"
+                        "    branch %0, b1, b2\n"
+                        "b1: <- b0\n"
+                        "    jump b2\n"
+                        "b2: <- b0, b1\n"
+                        "    %4: bool = phi [%0, b0], [%1, b1]\n"
+                        "    return %4\n") != std::string::npos);
+        CHECK(dump.find("    branch %0, b2, b1\n") != std::string::npos); /* || skips the right side when true */
+        CHECK(dump.find("%13: f64 = phi [%4, b1], [%11, b4]\n") != std::string::npos);
+        CHECK(dump.find("%16: i64 = cast %15\n") != std::string::npos);
+    }
+
+    SECTION("Falling off the end returns, code after a return is dropped")
+    {
+        const Lowered lowered(relative_filename, R"(
+            const LIMIT: i32 = 10 * 2;
+            function nothing(x: i32) -> void { var y: i32 = x; y += LIMIT; }
+            function forever() -> i32 { var i: i32 = 0; for (;;) { i += 1; if (i > 5) { return i; } } }
+            function early() -> i32 { return 1; return 2; }
+        )");
+        CHECK(lowered.errors().empty());
+        CHECK(verify(lowered.module, lowered.types).empty());
+
+        const std::string dump = lowered.dump();
+        CHECK(dump.find("    %1: i32 = const 20\n    %2: i32 = add %0, %1\n    return\n") != std::string::npos);
+        CHECK(dump.find("const 2\n") == std::string::npos);
+
+        /* the loop has no exit, so its exit block is never made */
+        REQUIRE(lowered.module.functions.size() == 3);
+        CHECK(lowered.module.functions[1].block_count == 5);
+    }
+
+    SECTION("What the IR does not cover yet is reported and stands in as undef")
+    {
+        const Lowered lowered(relative_filename, R"(
+            function arr() -> i32 { var a = {1, 2, 3}; return 0; }
+            function text(s: string) -> string { var t = "x"; return t; }
+        )");
+        CHECK(lowered.errors() == std::vector<std::string>{ "E0017" });
+        CHECK(verify(lowered.module, lowered.types).empty());
+        CHECK(lowered.dump().find("%0: i32[] = undef\n") != std::string::npos);
+        CHECK(lowered.dump().find("%1: string = string \"x\"\n    return %1\n") != std::string::npos);
+    }
+
+    SECTION("Deep nesting and many locals stay well formed")
+    {
+        std::string src = "function deep(n: i32) -> i32 {\n";
+        for (int i = 0; i < 40; ++i)
+            src += "var v" + std::to_string(i) + ": i32 = n;\n";
+        for (int i = 0; i < 40; ++i)
+            src += "while (v" + std::to_string(i) + " > 0) { v" + std::to_string(i) + " -= 1; if (v" +
+                    std::to_string(i) + " == 5) { break; }\n";
+        for (int i = 0; i < 40; ++i)
+            src += "}\n";
+        src += "return v0 + v39;\n}\n";
+
+        const Lowered lowered(relative_filename, src);
+        CHECK(lowered.errors().empty());
+        CHECK(verify(lowered.module, lowered.types).empty());
+
+        /* loop k changes v(k) and what the loops inside it change: 40 + 39 + ... + 1 header phis, and one per exit */
+        size_t phis = 0;
+        for (const IROp op: lowered.module.ops)
+            phis += op == IROp::PHI;
+        CHECK(phis == 820 + 40);
+    }
+
+    SECTION("Long operator chains do not recurse")
+    {
+        /* 60,000 terms deep on the left; the native stack would overflow */
+        std::string sum = "a";
+        std::string all = "p";
+        for (int i = 1; i < 60000; ++i)
+        {
+            sum += " + a";
+            all += " && p";
+        }
+        const Lowered lowered(relative_filename,
+                              "function f(a: i32, p: bool) -> i32 {\n"
+                              "    var b: bool = " + all + ";\n"
+                              "    return b ? " + sum + " : 0;\n"
+                              "}\n");
+        CHECK(lowered.errors().empty());
+
+        /* one add per +, one branch per && and the ternary */
+        size_t adds = 0;
+        size_t branches = 0;
+        for (const IROp op: lowered.module.ops)
+        {
+            adds += op == IROp::ADD;
+            branches += op == IROp::BRANCH;
+        }
+        CHECK(adds == 59999);
+        CHECK(branches == 60000);
+    }
+}
+
+TEST_CASE("IR verifier")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    Lowered lowered(relative_filename, R"(
+        function sum(n: i32) -> i32 {
+            var s: i32 = 0;
+            var i: i32 = 0;
+            while (i < n) { s += i; i += 1; }
+            return s;
+        }
+    )");
+    IRModule &module = lowered.module;
+    REQUIRE(verify(module, lowered.types).empty());
+
+    /* %4 = phi [%1, b0], [%8, b2]; %5 = phi; %6 = lt %5, %0; %8 = add %4, %5; b3 returns %4 */
+    SECTION("A use before its definition")
+    {
+        module.a[6] = 8;
+        CHECK(!verify(module, lowered.types).empty());
+    }
+
+    SECTION("A phi operand that does not dominate its edge")
+    {
+        module.extra[module.a[4]] = 8;
+        CHECK(!verify(module, lowered.types).empty());
+    }
+
+    SECTION("A predecessor without its edge")
+    {
+        module.edges[module.blocks[1].preds + 1] = 3;
+        CHECK(!verify(module, lowered.types).empty());
+    }
+
+    SECTION("A terminator in the middle of a block")
+    {
+        module.ops[9] = IROp::RETURN;
+        CHECK(!verify(module, lowered.types).empty());
+    }
+
+    SECTION("Mismatched types")
+    {
+        module.types[8] = TypeTable::BOOL;
+        CHECK(!verify(module, lowered.types).empty());
+    }
+}
@@ -0,0 +1,424 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/jit/include/jit.h>
+#include <compiler/vm/include/emitter.h>
+#include <tests/pipeline.h>
+#include <bit>
+#include <cmath>
+#include <filesystem>
+#include <limits>
+#include <memory>
+
+using namespace klr::compiler;
+
+namespace
+{
+    /* one module taken to both bytecode and machine code */
+    struct Jitted : test::Pipeline
+    {
+        Program program;
+        std::unique_ptr<VM> vm;
+        std::unique_ptr<JIT> jit;
+
+        Jitted(const std::string &name, std::string source) : Pipeline(name, std::move(source), test::Stage::LOWER)
+        {
+            REQUIRE(lowering->get_diagnostics().empty());
+            REQUIRE(verify(module, types).empty());
+
+            BytecodeEmitter(program, module, types, pool).emit();
+            vm = std::make_unique<VM>(program);
+            jit = std::make_unique<JIT>(module, types, pool);
+            REQUIRE(jit->compile());
+        }
+
+        uint32_t function(const std::string_view name)
+        {
+            const uint32_t index = jit->find(interner.intern(name));
+            REQUIRE(index < module.functions.size());
+            return index;
+        }
+
+        /* runs both, which must agree to the bit */
+        Result agree(const uint32_t fn, const std::vector<Value> &args)
+        {
+            const Result expected = vm->run(fn, args);
+            const Result result = jit->run(fn, args);
+            CHECK(result.trap == expected.trap);
+            CHECK(result.value.kind == expected.value.kind);
+            CHECK(result.value.bits == expected.value.bits);
+            return result;
+        }
+
+        Result agree(const std::string_view name, const std::vector<Value> &args = {})
+        {
+            return agree(function(name), args);
+        }
+    };
+}
+
+TEST_CASE("Assembler")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    const auto bytes = [](const Assembler &assembler) { return std::vector(assembler.code.begin(), assembler.code.end()); };
+
+    SECTION("Registers, memory and immediates encode as the manual says")
+    {
+        Assembler assembler;
+        assembler.mov(Reg::RAX, Reg::RBX);
+        assembler.alu(Alu::ADD, Reg::R12, Mem{ Reg::RBP, -8 });
+        assembler.mov(Reg::RAX, Mem{ Reg::RSP, 8 });
+        assembler.mov(Mem{ Reg::R13, 0 }, Reg::R9);
+        assembler.setcc(Cond::E, Reg::RSI);
+        CHECK(bytes(assembler) == std::vector<uint8_t>{
+            0x48, 0x8B, 0xC3,
+            0x4C, 0x03, 0x65, 0xF8,
+            0x48, 0x8B, 0x44, 0x24, 0x08,
+            0x4D, 0x89, 0x4D, 0x00,
+            0x40, 0x0F, 0x94, 0xC6,
+        });
+    }
+
+    SECTION("Immediates take the shortest move")
+    {
+        Assembler assembler;
+        assembler.mov_imm(Reg::RAX, 1);
+        assembler.mov_imm(Reg::RAX, ~0ULL);
+        assembler.mov_imm(Reg::R8, 0x123456789ULL);
+        CHECK(bytes(assembler) == std::vector<uint8_t>{
+            0xB8, 0x01, 0x00, 0x00, 0x00,
+            0x48, 0xC7, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF,
+            0x49, 0xB8, 0x89, 0x67, 0x45, 0x23, 0x01, 0x00, 0x00, 0x00,
+        });
+    }
+
+    SECTION("SSE and labels")
+    {
+        Assembler assembler;
+        const Label label = assembler.label();
+        assembler.sse(Sse::ADDSD, Xmm::XMM9, Xmm::XMM1);
+        assembler.jmp(label);
+        assembler.ud2();
+        assembler.bind(label);
+        assembler.ret();
+        assembler.finish();
+        CHECK(bytes(assembler) == std::vector<uint8_t>{
+            0xF2, 0x44, 0x0F, 0x58, 0xC9,
+            0xE9, 0x02, 0x00, 0x00, 0x00,
+            0x0F, 0x0B,
+            0xC3,
+        });
+        CHECK(assembler.offset(label) == 12);
+    }
+}
+
+TEST_CASE("JIT")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    if (!JIT::supported())
+        SKIP("no x86-64 System V host");
+
+    SECTION("Compiled functions are C functions")
+    {
+        Jitted jitted(relative_filename, R"(
+            function fib(n: i32) -> i32 { return n < 2 ? n : fib(n - 1) + fib(n - 2); }
+            function ratio(x: f32, y: f32) -> f32 { return x / y; }
+            function hyp(x: f64, y: f64) -> f64 { return x * x + y * y; }
+            function small(x: u8) -> u8 { return x + 1; }
+        )");
+        CHECK(jitted.jit->function<int32_t(int32_t)>(jitted.function("fib"))(20) == 6765);
+        CHECK(jitted.jit->function<float(float, float)>(jitted.function("ratio"))(1.0F, 3.0F) == 1.0F / 3.0F);
+        CHECK(jitted.jit->function<double(double, double)>(jitted.function("hyp"))(3.0, 4.0) == 25.0);
+        CHECK(jitted.jit->function<uint8_t(uint8_t)>(jitted.function("small"))(255) == 0);
+        CHECK(jitted.jit->code_bytes() > 0);
+    }
+
+    SECTION("Recursion, loops, break and continue")
+    {
+        Jitted jitted(relative_filename, R"(
+            function fib(n: i32) -> i32 { return n < 2 ? n : fib(n - 1) + fib(n - 2); }
+            function skip(n: i32) -> i32 {
+                var s: i32 = 0;
+                for (var i: i32 = 0; i < n; i += 1) {
+                    if (i == 3) { continue; }
+                    if (i == 7) { break; }
+                    s += i;
+                }
+                return s;
+            }
+            function nothing(x: i32) -> void { var y: i32 = x; y += 1; }
+        )");
+        CHECK(jitted.agree("fib", { Value::integer(TypeKind::I32, 20) }).value.as_int() == 6765);
+        CHECK(jitted.agree("skip", { Value::integer(TypeKind::I32, 100) }).value.as_int() == 0 + 1 + 2 + 4 + 5 + 6);
+        CHECK(jitted.agree("skip", { Value::integer(TypeKind::I32, 5) }).value.as_int() == 0 + 1 + 2 + 4);
+        CHECK(jitted.agree("nothing", { Value::integer(TypeKind::I32, 1) }).value.kind == TypeKind::VOID);
+    }
+
+    SECTION("Phis that swap each other on the back edge")
+    {
+        Jitted jitted(relative_filename, R"(
+            function swaps(n: i32) -> i32 {
+                var a: i32 = 1;
+                var b: i32 = 2;
+                var i: i32 = 0;
+                while (i < n) { var t: i32 = a; a = b; b = t; i += 1; }
+                return a * 10 + b;
+            }
+            function rotate(n: i32) -> f64 {
+                var a: f64 = 1.0;
+                var b: f64 = 2.0;
+                var c: f64 = 3.0;
+                while (n > 0) { var t: f64 = a; a = b; b = c; c = t; n -= 1; }
+                return a * 100.0 + b * 10.0 + c;
+            }
+            function fib(n: i64) -> i64 {
+                var a: i64 = 0;
+                var b: i64 = 1;
+                while (n > 0) { var t: i64 = a + b; a = b; b = t; n -= 1; }
+                return a;
+            }
+        )");
+        CHECK(jitted.agree("swaps", { Value::integer(TypeKind::I32, 3) }).value.as_int() == 21);
+        CHECK(jitted.agree("swaps", { Value::integer(TypeKind::I32, 4) }).value.as_int() == 12);
+        CHECK(jitted.agree("rotate", { Value::integer(TypeKind::I32, 4) }).value.as_float() == 231.0);
+        CHECK(jitted.agree("fib", { Value::integer(TypeKind::I64, 90) }).value.as_int() == 2880067194370816120LL);
+    }
+
+    SECTION("Integer arithmetic agrees with the VM for every kind")
+    {
+        static constexpr const char *ops[] = { "+", "-", "*", "/", "%", "&", "|", "^", "<<", ">>", "<", ">=", "==" };
+        static constexpr std::pair<const char *, TypeKind> kinds[] = {
+            { "i8", TypeKind::I8 }, { "u8", TypeKind::U8 }, { "i16", TypeKind::I16 }, { "u16", TypeKind::U16 },
+            { "i32", TypeKind::I32 }, { "u32", TypeKind::U32 }, { "i64", TypeKind::I64 }, { "u64", TypeKind::U64 },
+        };
+        static constexpr int64_t samples[] = { 0, 1, -1, 7, -128, 127, 255, 40000, -9, 63, INT64_MIN, INT64_MAX };
+
+        /* each op twice: on two parameters, and on a parameter and a constant */
+        std::string src;
+        for (size_t k = 0; k < std::size(kinds); ++k)
+        {
+            for (size_t o = 0; o < std::size(ops); ++o)
+            {
+                const std::string suffix = std::to_string(k) + "_" + std::to_string(o);
+                const std::string type = kinds[k].first;
+                const std::string result = o >= 10 ? "bool" : type;
+                src += "function f" + suffix + "(a: " + type + ", b: " + type + ") -> " + result + " { return a " +
+                        ops[o] + " b; }\n";
+                src += "function k" + suffix + "(a: " + type + ") -> " + result + " { return a " + ops[o] + " cast<" +
+                        type + ">(-3); }\n";
+            }
+        }
+        Jitted jitted(relative_filename, src);
+
+        for (size_t k = 0; k < std::size(kinds); ++k)
+        {
+            const TypeKind kind = kinds[k].second;
+            for (size_t o = 0; o < std::size(ops); ++o)
+            {
+                const std::string suffix = std::to_string(k) + "_" + std::to_string(o);
+                const uint32_t f = jitted.function("f" + suffix);
+                const uint32_t c = jitted.function("k" + suffix);
+                for (const int64_t lhs: samples)
+                {
+                    INFO(kinds[k].first << " " << lhs << " " << ops[o] << " -3");
+                    jitted.agree(c, { Value::integer(kind, lhs) });
+                    for (const int64_t rhs: samples)
+                    {
+                        INFO(kinds[k].first << " " << lhs << " " << ops[o] << " " << rhs);
+                        jitted.agree(f, { Value::integer(kind, lhs), Value::integer(kind, rhs) });
+                    }
+                }
+            }
+        }
+    }
+
+    SECTION("Float arithmetic and comparisons agree with the VM, NaN included")
+    {
+        static constexpr const char *ops[] = { "+", "-", "*", "/", "%", "<", "<=", ">", ">=", "==", "!=" };
+        static constexpr std::pair<const char *, TypeKind> kinds[] = { { "f32", TypeKind::F32 }, { "f64", TypeKind::F64 } };
+        const double samples[] = {
+            0.0, -0.0, 1.0, -2.5, 1.0 / 3.0, 1e300, std::numeric_limits<double>::infinity(),
+            std::numeric_limits<double>::quiet_NaN(),
+        };
+
+        std::string src;
+        for (size_t k = 0; k < std::size(kinds); ++k)
+        {
+            const std::string type = kinds[k].first;
+            for (size_t o = 0; o < std::size(ops); ++o)
+            {
+                src += "function f" + std::to_string(k) + "_" + std::to_string(o) + "(a: " + type + ", b: " + type +
+                        ") -> " + (o >= 5 ? "bool" : type) + " { return a " + ops[o] + " b; }\n";
+            }
+            src += "function neg" + std::to_string(k) + "(a: " + type + ") -> " + type + " { return -a; }\n";
+            src += "function branch" + std::to_string(k) + "(a: " + type + ", b: " + type +
+                    ") -> i32 { if (a < b) { return 1; } if (a == b) { return 2; } return 3; }\n";
+        }
+        Jitted jitted(relative_filename, src);
+
+        for (size_t k = 0; k < std::size(kinds); ++k)
+        {
+            const TypeKind kind = kinds[k].second;
+            for (const double lhs: samples)
+            {
+                jitted.agree("neg" + std::to_string(k), { Value::number(kind, lhs) });
+                for (const double rhs: samples)
+                {
+                    INFO(kinds[k].first << " " << lhs << " ? " << rhs);
+                    const std::vector args = { Value::number(kind, lhs), Value::number(kind, rhs) };
+                    jitted.agree("branch" + std::to_string(k), args);
+                    for (size_t o = 0; o < std::size(ops); ++o)
+                        jitted.agree(jitted.function("f" + std::to_string(k) + "_" + std::to_string(o)), args);
+                }
+            }
+        }
+    }
+
+    SECTION("Casts agree with the VM between every pair of kinds")
+    {
+        static constexpr std::pair<const char *, TypeKind> kinds[] = {
+            { "i8", TypeKind::I8 }, { "u8", TypeKind::U8 }, { "i16", TypeKind::I16 }, { "u32", TypeKind::U32 },
+            { "i64", TypeKind::I64 }, { "u64", TypeKind::U64 }, { "f32", TypeKind::F32 }, { "f64", TypeKind::F64 },
+            { "bool", TypeKind::BOOL },
+        };
+        static constexpr int64_t integers[] = { 0, 1, -1, 300, -129, INT64_MIN, INT64_MAX, 9007199791611905 };
+        const double floats[] = {
+            0.0, -0.0, 0.75, -1.5, 300.5, 1e30, -1e30, std::numeric_limits<double>::quiet_NaN(),
+        };
+
+        std::string src;
+        for (size_t from = 0; from < std::size(kinds); ++from)
+        {
+            for (size_t to = 0; to < std::size(kinds); ++to)
+            {
+                src += "function c" + std::to_string(from) + "_" + std::to_string(to) + "(x: " + kinds[from].first +
+                        ") -> " + kinds[to].first + " { return cast<" + kinds[to].first + ">(x); }\n";
+            }
+        }
+        Jitted jitted(relative_filename, src);
+
+        for (size_t from = 0; from < std::size(kinds); ++from)
+        {
+            const TypeKind kind = kinds[from].second;
+            std::vector<Value> values;
+            if (TypeTable::is_float(kind))
+                for (const double x: floats)
+                    values.push_back(Value::number(kind, x));
+            else if (kind == TypeKind::BOOL)
+                values = { { kind, 0 }, { kind, 1 } };
+            else
+                for (const int64_t x: integers)
+                    values.push_back(Value::integer(kind, x));
+
+            for (size_t to = 0; to < std::size(kinds); ++to)
+            {
+                const uint32_t fn = jitted.function("c" + std::to_string(from) + "_" + std::to_string(to));
+                for (const Value &value: values)
+                {
+                    INFO(kinds[from].first << " " << value.bits << " to " << kinds[to].first);
+                    jitted.agree(fn, { value });
+                }
+            }
+        }
+    }
+
+    SECTION("Arguments past the registers go on the stack, both ways")
+    {
+        Jitted jitted(relative_filename, R"(
+            function many(a: i32, b: i64, c: f64, d: u8, e: i16, f: f32, g: i32, h: i64, i: i32, j: f64, k: u32,
+                          l: i8) -> f64 {
+                return cast<f64>(a) + cast<f64>(b) * 2.0 + c * 3.0 + cast<f64>(d) * 4.0 + cast<f64>(e) * 5.0 +
+                       cast<f64>(f) * 6.0 + cast<f64>(g) * 7.0 + cast<f64>(h) * 8.0 + cast<f64>(i) * 9.0 + j * 10.0 +
+                       cast<f64>(k) * 11.0 + cast<f64>(l) * 12.0;
+            }
+            function floats(a: f64, b: f64, c: f64, d: f64, e: f64, f: f32, g: f64, h: f64, i: f32, j: f64) -> f64 {
+                return a - b + c - d + e - cast<f64>(f) + g - h + cast<f64>(i) * 0.5 - j;
+            }
+            function caller(x: i32) -> f64 {
+                return many(x, 2, 3.5, 4, -5, 6.25, 7, 8, 9, 10.5, 11, -12) +
+                       floats(1.0, 2.0, 3.0, 4.0, 5.0, 6.5, 7.0, 8.0, 9.5, cast<f64>(x));
+            }
+        )");
+        const std::vector many = {
+            Value::integer(TypeKind::I32, 1), Value::integer(TypeKind::I64, 2), Value::number(TypeKind::F64, 3.5),
+            Value::integer(TypeKind::U8, 4), Value::integer(TypeKind::I16, -5), Value::number(TypeKind::F32, 6.25),
+            Value::integer(TypeKind::I32, 7), Value::integer(TypeKind::I64, 8), Value::integer(TypeKind::I32, 9),
+            Value::number(TypeKind::F64, 10.5), Value::integer(TypeKind::U32, 11), Value::integer(TypeKind::I8, -12),
+        };
+        jitted.agree("many", many);
+
+        std::vector<Value> floats;
+        for (int i = 0; i < 10; ++i)
+            floats.push_back(Value::number(i == 5 || i == 8 ? TypeKind::F32 : TypeKind::F64, i * 1.25));
+        jitted.agree("floats", floats);
+
+        for (const int32_t x: { 0, 3, -40 })
+            jitted.agree("caller", { Value::integer(TypeKind::I32, x) });
+    }
+
+    SECTION("Values live across calls survive them, spilled or in callee-saved registers")
+    {
+        Jitted jitted(relative_filename, R"(
+            function id(x: i64) -> i64 { return x; }
+            function twice(x: f64) -> f64 { return x * 2.0; }
+            function pressure(a: i64) -> i64 {
+                var b: i64 = a + 1;
+                var c: i64 = a * 3;
+                var d: i64 = b ^ c;
+                var e: i64 = d - a;
+                var f: i64 = e + b;
+                var g: i64 = f * 5;
+                var h: i64 = g - c;
+                var i: i64 = h + d;
+                var j: i64 = i ^ e;
+                var k: i64 = id(j);
+                return a + b * 2 + c * 3 + d * 4 + e * 5 + f * 6 + g * 7 + h * 8 + i * 9 + j * 10 + k * 11;
+            }
+            function mixed(x: f64, n: i32) -> f64 {
+                var s: f64 = 0.0;
+                var y: f64 = x + 1.0;
+                for (var i: i32 = 0; i < n; i += 1) { s += twice(y) + cast<f64>(i); y = y * 0.5; }
+                return s + y;
+            }
+        )");
+        for (const int64_t a: { 0LL, 7LL, -123456789LL })
+            jitted.agree("pressure", { Value::integer(TypeKind::I64, a) });
+        jitted.agree("mixed", { Value::number(TypeKind::F64, 3.0), Value::integer(TypeKind::I32, 10) });
+    }
+
+    SECTION("Traps come out of run(), which is usable again after one")
+    {
+        Jitted jitted(relative_filename, R"(
+            function div(a: i32, b: i32) -> i32 { return a / b; }
+            function down(n: i32) -> i32 { return down(n + 1); }
+            function nested(n: i32) -> i32 { return div(n, n - 1); }
+        )");
+        CHECK(jitted.agree("div", { Value::integer(TypeKind::I32, 1), Value::integer(TypeKind::I32, 0) }).trap ==
+              Trap::DIVISION_BY_ZERO);
+        CHECK(jitted.agree("nested", { Value::integer(TypeKind::I32, 1) }).trap == Trap::DIVISION_BY_ZERO);
+        CHECK(jitted.agree("nested", { Value::integer(TypeKind::I32, 4) }).value.as_int() == 1);
+        CHECK(jitted.jit->run(jitted.function("down"), std::vector{ Value::integer(TypeKind::I32, 0) }).trap ==
+              Trap::STACK_OVERFLOW);
+        CHECK(jitted.agree("nested", { Value::integer(TypeKind::I32, 3) }).value.as_int() == 1);
+    }
+
+    SECTION("Strings are their atoms")
+    {
+        Jitted jitted(relative_filename, R"(
+            function text() -> string { return "hi"; }
+            function pick(a: string, b: string, first: bool) -> string { return first ? a : b; }
+        )");
+        CHECK(jitted.agree("text").value.bits == jitted.interner.intern("hi"));
+        const Value hi{ TypeKind::STRING, jitted.interner.intern("hi") };
+        const Value ho{ TypeKind::STRING, jitted.interner.intern("ho") };
+        CHECK(jitted.agree("pick", { hi, ho, { TypeKind::BOOL, 1 } }).value.bits == hi.bits);
+        CHECK(jitted.agree("pick", { hi, ho, { TypeKind::BOOL, 0 } }).value.bits == ho.bits);
+    }
+}
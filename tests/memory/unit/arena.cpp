@@ -0,0 +1,138 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/memory/include/arena.h>
+#include <compiler/parser/include/parser.h>
+#include <filesystem>
+#include <thread>
+
+using namespace klr::compiler;
+
+static AST parse(const std::string &name, const std::string &src, std::pmr::memory_resource *resource)
+{
+    Lexer lexer(name, src, simd::Level::AVX2, resource);
+    auto tokens = lexer.tokenize();
+    Parser parser(name, src, std::move(tokens), lexer.get_line_starts(), resource);
+    return parser.parse();
+}
+
+static void check_same(const AST &a, const AST &b)
+{
+    REQUIRE(a.size() == b.size());
+    for (uint32_t i = 0; i < a.size(); ++i)
+    {
+        CHECK(a[i].type == b[i].type);
+        CHECK(a[i].parent == b[i].parent);
+        CHECK(a[i].token.start == b[i].token.start);
+        CHECK(a.child_count(i) == b.child_count(i));
+    }
+}
+
+TEST_CASE("Arena allocator")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    SECTION("Alignment and oversized requests")
+    {
+        Arena arena(4096);
+        for (const size_t alignment: { 1, 2, 8, 16, 64, 256 })
+        {
+            void *p = arena.allocate(3, alignment);
+            CHECK(reinterpret_cast<uintptr_t>(p) % alignment == 0);
+        }
+
+        /* larger than a chunk, gets a chunk of its own */
+        auto *big = static_cast<char *>(arena.allocate(10000, 64));
+        big[0] = big[9999] = 1;
+        CHECK(reinterpret_cast<uintptr_t>(big) % 64 == 0);
+        CHECK(arena.reserved() >= 10000 + 4096);
+        CHECK(arena.allocations() == 7);
+    }
+
+    SECTION("Reset keeps chunks")
+    {
+        Arena arena(4096);
+        for (int i = 0; i < 100; ++i)
+            CHECK(arena.allocate(1000, 8) != nullptr);
+
+        const auto chunks = arena.chunks();
+        const auto reserved = arena.reserved();
+        CHECK(chunks > 1);
+        CHECK(arena.used() >= 100000);
+
+        arena.reset();
+        CHECK(arena.used() == 0);
+        for (int i = 0; i < 100; ++i)
+            CHECK(arena.allocate(1000, 8) != nullptr);
+
+        CHECK(arena.chunks() == chunks);
+        CHECK(arena.reserved() == reserved);
+
+        arena.release();
+        CHECK(arena.reserved() == 0);
+        CHECK(arena.allocate(16, 16) != nullptr);
+    }
+
+    SECTION("Move transfers ownership")
+    {
+        Arena a(4096);
+        auto *p = static_cast<int *>(a.allocate(sizeof(int), alignof(int)));
+        *p = 42;
+
+        Arena b(std::move(a));
+        CHECK(*p == 42);
+        CHECK(b.reserved() > 0);
+        CHECK(a.reserved() == 0);
+
+        a = std::move(b);
+        CHECK(*p == 42);
+        CHECK(a.reserved() > 0);
+    }
+
+    SECTION("Polymorphic containers")
+    {
+        Arena arena(4096);
+        std::pmr::vector<uint64_t> values(&arena);
+        for (uint64_t i = 0; i < 10000; ++i)
+            values.push_back(i * i);
+
+        CHECK(values.size() == 10000);
+        CHECK(values[9999] == 9999ULL * 9999ULL);
+        CHECK(arena.allocations() > 1);
+    }
+
+    SECTION("One arena per thread")
+    {
+        const std::string src =
+                "function f(a: i32, b: i32) -> i32\n{\n    var x: i32 = a * b + 3;\n    return x - 1;\n}\n"
+                "var s: string = \"text\";\nconst y: f64 = 2.5;\nconst arr: i32[] = { 1, 2, 3 };\n";
+        const AST reference = parse(relative_filename, src, std::pmr::get_default_resource());
+
+        std::vector<std::thread> threads;
+        std::vector<AST> results(4);
+        for (size_t t = 0; t < results.size(); ++t)
+        {
+            threads.emplace_back([&, t]
+            {
+                Arena arena(4096);
+                for (int run = 0; run < 20; ++run)
+                {
+                    arena.reset();
+                    const AST ast = parse(relative_filename, src, &arena);
+                    /* copy assignment keeps the target's (heap) resource */
+                    if (run == 19)
+                        results[t] = ast;
+                }
+            });
+        }
+        for (auto &thread: threads)
+            thread.join();
+
+        for (const auto &ast: results)
+            check_same(ast, reference);
+    }
+}
@@ -0,0 +1,160 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/memory/include/interner.h>
+#include <compiler/parser/include/parser.h>
+#include <filesystem>
+#include <set>
+#include <thread>
+
+using namespace klr::compiler;
+
+TEST_CASE("String interner")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    SECTION("Equal strings share one dense atom")
+    {
+        Interner interner;
+        const uint32_t a = interner.intern("alpha");
+        const uint32_t b = interner.intern("beta");
+        CHECK(a != Interner::NONE);
+        CHECK(b != a);
+        CHECK(interner.intern(std::string("alp") + "ha") == a);
+        CHECK(interner.intern("") != Interner::NONE);
+        CHECK(interner.size() == 3);
+
+        CHECK(interner.str(a) == "alpha");
+        CHECK(interner.str(b) == "beta");
+        CHECK(interner.str(Interner::NONE).empty());
+
+        const auto stats = interner.stats();
+        CHECK(stats.lookups == 4);
+        CHECK(stats.bytes_seen == 14);
+        CHECK(stats.bytes_stored == 9);
+    }
+
+    SECTION("Atoms stay dense and views stable across growth")
+    {
+        constexpr uint32_t n = 100000;
+        Interner interner;
+        std::vector<std::string_view> views;
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            const std::string name = "name_" + std::to_string(i);
+            REQUIRE(interner.intern(name) == i + 1);
+            views.push_back(interner.str(i + 1));
+        }
+
+        CHECK(interner.size() == n);
+        for (uint32_t i = 0; i < n; i += 997)
+        {
+            CHECK(views[i] == "name_" + std::to_string(i));
+            CHECK(interner.intern("name_" + std::to_string(i)) == i + 1);
+        }
+    }
+
+    SECTION("Concurrent interning agrees on every atom")
+    {
+        constexpr uint32_t threads = 8;
+        constexpr uint32_t names = 20000;
+        Interner interner;
+        std::vector<std::vector<uint32_t> > seen(threads, std::vector<uint32_t>(names));
+
+        std::vector<std::thread> workers;
+        for (uint32_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t]
+            {
+                /* every thread walks the same names from a different start */
+                for (uint32_t k = 0; k < names; ++k)
+                {
+                    const uint32_t i = (k + t * names / threads) % names;
+                    seen[t][i] = interner.intern("v" + std::to_string(i));
+                }
+            });
+        }
+        for (auto &worker: workers)
+            worker.join();
+
+        CHECK(interner.size() == names);
+        std::set<uint32_t> distinct;
+        for (uint32_t i = 0; i < names; ++i)
+        {
+            for (uint32_t t = 1; t < threads; ++t)
+                REQUIRE(seen[t][i] == seen[0][i]);
+            CHECK(interner.str(seen[0][i]) == "v" + std::to_string(i));
+            distinct.insert(seen[0][i]);
+        }
+        CHECK(distinct.size() == names);
+        CHECK(*distinct.begin() == 1);
+        CHECK(*distinct.rbegin() == names);
+    }
+
+    SECTION("Lexing fills the atom column")
+    {
+        Interner interner;
+        const std::string src = "var count: i32 = other + count; var s = \"count\"; var u = \"open";
+        Lexer lexer(relative_filename, src, simd::Level::AVX2, std::pmr::get_default_resource(), &interner);
+        const auto tokens = lexer.tokenize();
+        REQUIRE(tokens->atoms.size() == tokens->size());
+
+        for (size_t i = 0; i < tokens->size(); ++i)
+        {
+            const TokenType type = tokens->types[i];
+            if (type == TokenType::IDENTIFIER || type == TokenType::STR_LITERAL)
+                CHECK(interner.str(tokens->atoms[i]) == Interner::token_text(src, *tokens, i));
+            else
+                CHECK(tokens->atoms[i] == Interner::NONE);
+        }
+
+        /* `count` the identifier and "count" the literal are one atom */
+        CHECK(tokens->atoms[1] == tokens->atoms[7]);
+        CHECK(tokens->atoms[1] == tokens->atoms[12]);
+        CHECK(interner.str(tokens->atoms[17]) == "open");
+    }
+
+    SECTION("Modules and lexing modes share atoms")
+    {
+        std::string src;
+        for (int i = 0; i < 4000; ++i)
+            src += "function fn_" + std::to_string(i % 300) + "(a: i32) -> i32 { return a + g" +
+                    std::to_string(i % 7) + "(\"s\"); }\n";
+
+        Interner interner;
+        Lexer serial(relative_filename, src, simd::Level::AVX2, std::pmr::get_default_resource(), &interner);
+        const auto expected = serial.tokenize();
+        const uint32_t atoms = interner.size();
+
+        Lexer parallel(relative_filename, src, simd::Level::AVX2, std::pmr::get_default_resource(), &interner);
+        const auto tokens = parallel.tokenize_parallel(4, 1 << 12);
+        CHECK(tokens->atoms == expected->atoms);
+        CHECK(interner.size() == atoms);
+
+        /* fn_0..fn_299, g0..g6, a and the literal s */
+        CHECK(atoms == 300 + 7 + 2);
+    }
+
+    SECTION("The AST carries the atoms of names")
+    {
+        Interner interner;
+        const std::string src = "function main(x: i32) -> i32 { var y: Vec<T> = x; return f(y, \"y\"); }";
+        Lexer lexer(relative_filename, src, simd::Level::AVX2, std::pmr::get_default_resource(), &interner);
+        auto tokens = lexer.tokenize();
+        Parser parser(relative_filename, src, std::move(tokens), lexer.get_line_starts());
+        const AST ast = parser.parse();
+        REQUIRE(!parser.has_errors());
+
+        std::vector<std::string_view> named;
+        for (uint32_t i = 0; i < ast.size(); ++i)
+        {
+            if (ast[i].atom != Interner::NONE)
+                named.push_back(interner.str(ast[i].atom));
+        }
+        CHECK(named == std::vector<std::string_view> { "main", "x", "y", "Vec", "T", "x", "f", "f", "y", "y" });
+    }
+}
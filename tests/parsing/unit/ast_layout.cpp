@@ -0,0 +1,91 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/parser/include/parser.h>
+#include <filesystem>
+#include <sstream>
+
+using namespace klr::compiler;
+
+static AST parse(const std::string &name, const std::string &src)
+{
+    Lexer lexer(name, src);
+    auto tokens = lexer.tokenize();
+    Parser parser(name, src, std::move(tokens), lexer.get_line_starts());
+    return parser.parse();
+}
+
+TEST_CASE("Flat AST layout")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    SECTION("Children keep insertion order")
+    {
+        AST ast;
+        const uint32_t root = ast.add_node(ASTNodeType::ROOT, {});
+        const uint32_t block = ast.add_node(ASTNodeType::BLOCK, {});
+        const uint32_t a = ast.add_node(ASTNodeType::IDENTIFIER, {});
+        const uint32_t b = ast.add_node(ASTNodeType::LITERAL, {});
+        const uint32_t c = ast.add_node(ASTNodeType::IDENTIFIER, {});
+
+        /* interleaved like the parser does: a parent's children are not contiguous */
+        ast.add_child(block, a);
+        ast.add_child(root, block);
+        ast.add_child(block, b);
+        ast.add_child(block, c);
+
+        CHECK(ast.size() == 5);
+        CHECK(ast.child_count(root) == 1);
+        CHECK(ast.child_count(block) == 3);
+        CHECK(ast.child_count(a) == 0);
+        CHECK(std::vector(ast.children(block).begin(), ast.children(block).end()) == std::vector<uint32_t> { a, b, c });
+        CHECK(ast[b].parent == block);
+        CHECK(ast[block].parent == root);
+        CHECK(ast[b].type == ASTNodeType::LITERAL);
+    }
+
+    SECTION("Invalid links are ignored")
+    {
+        AST ast;
+        const uint32_t root = ast.add_node(ASTNodeType::ROOT, {});
+        ast.add_child(root, 7);
+        ast.add_child(7, root);
+        ast.add_child(root, root);
+        CHECK(ast.child_count(root) == 0);
+    }
+
+    SECTION("Parsed module")
+    {
+        const AST ast = parse(relative_filename,
+                              "var x: u32 = 1 + 2;\n"
+                              "function f(a: u32) -> u32 { return a * x; }\n");
+
+        REQUIRE(ast.child_count(0) == 2);
+        const uint32_t decl = *ast.children(0).begin();
+        CHECK(ast.types[decl] == ASTNodeType::DECL);
+        CHECK(ast.types[ast.data[decl].decl.init_node] == ASTNodeType::BINARY_EXPR);
+        CHECK(ast.child_count(decl) == 2);
+
+        /* a linear scan over the columns visits every sibling list once */
+        for (uint32_t i = 0; i < ast.size(); ++i)
+        {
+            for (const uint32_t child: ast.children(i))
+                CHECK(ast.parents[child] == i);
+        }
+        CHECK(ast.memory_bytes() >= ast.size() * AST::bytes_per_node);
+    }
+
+    SECTION("Dump lists children")
+    {
+        const AST ast = parse(relative_filename, "var y = (3);");
+        std::ostringstream os;
+        ast.dump(os);
+        CHECK(os.str().find("children: [1]") != std::string::npos);
+        CHECK(os.str().find("DECL") != std::string::npos);
+        CHECK(os.str().find("LITERAL") != std::string::npos);
+    }
+}
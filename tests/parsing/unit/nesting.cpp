@@ -0,0 +1,208 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/parser/include/parser.h>
+#include <filesystem>
+#include <sstream>
+
+using namespace klr::compiler;
+
+namespace
+{
+    struct Parsed
+    {
+        AST ast;
+        std::vector<Diagnostic> diagnostics;
+    };
+
+    Parsed parse(const std::string &name, const std::string &src, const ExprStrategy strategy = ExprStrategy::PRATT,
+                 const uint32_t max_depth = Parser::DEFAULT_MAX_DEPTH)
+    {
+        Lexer lexer(name, src);
+        auto tokens = lexer.tokenize();
+        Parser parser(name, src, std::move(tokens), lexer.get_line_starts(), std::pmr::get_default_resource(), strategy,
+                      max_depth);
+
+        Parsed out { parser.parse(), {} };
+        out.diagnostics.assign(parser.get_diagnostics().begin(), parser.get_diagnostics().end());
+        return out;
+    }
+
+    std::string repeat(const std::string &s, const size_t n)
+    {
+        std::string out;
+        out.reserve(s.size() * n);
+        for (size_t i = 0; i < n; ++i)
+            out += s;
+        return out;
+    }
+
+    std::string in_function(const std::string &body)
+    {
+        return "function main() -> i32 {\n" + body + "\nreturn 0;\n}\n";
+    }
+
+    size_t count(const AST &ast, const ASTNodeType type)
+    {
+        size_t n = 0;
+        for (uint32_t i = 0; i < ast.size(); ++i)
+            n += ast[i].type == type;
+        return n;
+    }
+
+    bool has_code(const Parsed &parsed, const DiagCode code)
+    {
+        return std::ranges::find(parsed.diagnostics, code, &Diagnostic::code) != parsed.diagnostics.end();
+    }
+}
+
+TEST_CASE("Deep nesting")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    SECTION("Parentheses past the limit are a diagnostic, not a crash")
+    {
+        constexpr size_t n = 100000;
+        const auto src = in_function("var x: i32 = " + repeat("(", n) + "1" + repeat(")", n) + ";");
+        const auto parsed = parse(relative_filename, src);
+
+        REQUIRE(parsed.diagnostics.size() == 1);
+        CHECK(parsed.diagnostics[0].code == DiagCode::NESTING_TOO_DEEP);
+        /* recovery picks up again at the next statement */
+        CHECK(count(parsed.ast, ASTNodeType::RETURN) == 1);
+    }
+
+    SECTION("Unary operators and binary chains count towards the limit")
+    {
+        for (const auto strategy: { ExprStrategy::PRATT, ExprStrategy::DESCENT })
+        {
+            const auto unary = parse(relative_filename, in_function("var x: i32 = " + repeat("-", 100000) + "1;"),
+                                     strategy);
+            CHECK(has_code(unary, DiagCode::NESTING_TOO_DEEP));
+        }
+
+        /* right-associative, so every '=' waits for the rest of the chain */
+        const auto assign = parse(relative_filename, in_function(repeat("a = ", 5000) + "1;"));
+        CHECK(has_code(assign, DiagCode::NESTING_TOO_DEEP));
+
+        /* left-associative chains reduce as they go and never get deep */
+        const auto sum = parse(relative_filename, in_function("var x: i32 = 1" + repeat(" + 1", 100000) + ";"));
+        CHECK(sum.diagnostics.empty());
+        CHECK(count(sum.ast, ASTNodeType::BINARY_EXPR) == 100000);
+    }
+
+    SECTION("Deep nested calls are a diagnostic in both strategies")
+    {
+        constexpr size_t n = 20000;
+        const auto src = in_function(repeat("f(", n) + "1" + repeat(")", n) + ";");
+        for (const auto strategy: { ExprStrategy::PRATT, ExprStrategy::DESCENT })
+        {
+            const auto parsed = parse(relative_filename, src, strategy);
+            REQUIRE(parsed.diagnostics.size() == 1);
+            CHECK(parsed.diagnostics[0].code == DiagCode::NESTING_TOO_DEEP);
+        }
+    }
+
+    SECTION("Nested blocks past the limit are skipped")
+    {
+        constexpr size_t n = 100000;
+        const auto src = in_function(repeat("if (x) { ", n) + "y = 1;" + repeat(" }", n)) +
+                         "function after() -> i32 { return 1; }\n";
+        const auto parsed = parse(relative_filename, src);
+
+        REQUIRE(parsed.diagnostics.size() == 1);
+        CHECK(parsed.diagnostics[0].code == DiagCode::NESTING_TOO_DEEP);
+        CHECK(count(parsed.ast, ASTNodeType::FUNCTION) == 2);
+        CHECK(count(parsed.ast, ASTNodeType::RETURN) == 2);
+    }
+
+    SECTION("A raised limit parses deep input on the heap stacks")
+    {
+        constexpr size_t n = 200000;
+        constexpr uint32_t limit = 1000000;
+
+        const auto parens = parse(relative_filename,
+                                  in_function("var x: i32 = " + repeat("(", n) + "1" + repeat(")", n) + ";"),
+                                  ExprStrategy::PRATT, limit);
+        CHECK(parens.diagnostics.empty());
+
+        const auto ternaries = parse(relative_filename,
+                                     in_function("var x: i32 = " + repeat("a ? b : ", n) + "c;"),
+                                     ExprStrategy::PRATT, limit);
+        CHECK(ternaries.diagnostics.empty());
+        CHECK(count(ternaries.ast, ASTNodeType::TERNARY) == n);
+
+        const auto blocks = parse(relative_filename,
+                                  in_function(repeat("while (x) { ", n) + "break;" + repeat(" }", n)),
+                                  ExprStrategy::PRATT, limit);
+        REQUIRE(blocks.diagnostics.empty());
+        CHECK(count(blocks.ast, ASTNodeType::WHILE) == n);
+
+    }
+
+    SECTION("Dumping a deep tree does not recurse")
+    {
+        /* output grows with depth squared (indentation), so keep this one moderate */
+        constexpr size_t n = 5000;
+        const auto parsed = parse(relative_filename, in_function("var x: i32 = " + repeat("-", n) + "1;"),
+                                  ExprStrategy::PRATT, 2 * n);
+        REQUIRE(parsed.diagnostics.empty());
+
+        std::ostringstream os;
+        parsed.ast.dump(os);
+        CHECK(std::ranges::count(os.str(), '\n') >= static_cast<std::ptrdiff_t>(n));
+    }
+
+    SECTION("Else-if chains are flat")
+    {
+        constexpr size_t n = 50000;
+        const auto src = in_function("if (a) { x = 0; }" + repeat(" else if (a) { x = 1; }", n) + " else { x = 2; }");
+        const auto parsed = parse(relative_filename, src);
+
+        REQUIRE(parsed.diagnostics.empty());
+        CHECK(count(parsed.ast, ASTNodeType::IF) == n + 1);
+
+        /* each IF holds condition, then and the next IF (or the final else) */
+        uint32_t node = 0;
+        for (uint32_t i = 0; i < parsed.ast.size(); ++i)
+        {
+            if (parsed.ast[i].type == ASTNodeType::IF && parsed.ast[parsed.ast[i].parent].type == ASTNodeType::BLOCK)
+                node = i;
+        }
+        size_t links = 0;
+        while (true)
+        {
+            const std::vector children(parsed.ast.children(node).begin(), parsed.ast.children(node).end());
+            REQUIRE(children.size() == 3);
+            CHECK(parsed.ast[children[1]].type == ASTNodeType::BLOCK);
+            if (parsed.ast[children[2]].type != ASTNodeType::IF)
+            {
+                CHECK(parsed.ast[children[2]].type == ASTNodeType::BLOCK);
+                break;
+            }
+            node = children[2];
+            ++links;
+        }
+        CHECK(links == n);
+    }
+
+    SECTION("Ordinary nesting is unaffected")
+    {
+        const auto src = in_function(
+            "for (var i: i32 = 0; i < 10; i = i + 1) {\n"
+            "    while (i) { if (i > 2) { break; } else if (i) { continue; } else { i = -(~i); } }\n"
+            "}\n"
+            "var f: i32 = a ? (b ? 1 : 2) : ((3 + 4) * 5);");
+        const auto parsed = parse(relative_filename, src, ExprStrategy::PRATT, 16);
+
+        CHECK(parsed.diagnostics.empty());
+        CHECK(count(parsed.ast, ASTNodeType::FOR) == 1);
+        CHECK(count(parsed.ast, ASTNodeType::WHILE) == 1);
+        CHECK(count(parsed.ast, ASTNodeType::IF) == 2);
+        CHECK(count(parsed.ast, ASTNodeType::TERNARY) == 2);
+    }
+}
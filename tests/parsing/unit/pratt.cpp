@@ -0,0 +1,187 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/parser/include/parser.h>
+#include <filesystem>
+#include <random>
+
+using namespace klr::compiler;
+
+namespace
+{
+    struct Parsed
+    {
+        AST ast;
+        std::vector<Diagnostic> diagnostics;
+    };
+
+    Parsed parse(const std::string &name, const std::string &src, const ExprStrategy strategy)
+    {
+        Lexer lexer(name, src);
+        auto tokens = lexer.tokenize();
+        Parser parser(name, src, std::move(tokens), lexer.get_line_starts(), std::pmr::get_default_resource(),
+                      strategy);
+
+        Parsed out { parser.parse(), {} };
+        out.diagnostics.assign(parser.get_diagnostics().begin(), parser.get_diagnostics().end());
+        return out;
+    }
+
+    /* the Pratt loop must build exactly what the precedence chain builds, node for node */
+    void check_same_as_descent(const std::string &name, const std::string &src)
+    {
+        const auto pratt = parse(name, src, ExprStrategy::PRATT);
+        const auto descent = parse(name, src, ExprStrategy::DESCENT);
+
+        INFO("source: " << src);
+        REQUIRE(pratt.ast.size() == descent.ast.size());
+        for (uint32_t i = 0; i < pratt.ast.size(); ++i)
+        {
+            const ASTNode a = pratt.ast[i];
+            const ASTNode b = descent.ast[i];
+            REQUIRE(a.type == b.type);
+            CHECK(a.parent == b.parent);
+            CHECK(a.token.start == b.token.start);
+            CHECK(a.token.type == b.token.type);
+            CHECK(std::vector(pratt.ast.children(i).begin(), pratt.ast.children(i).end()) ==
+                  std::vector(descent.ast.children(i).begin(), descent.ast.children(i).end()));
+
+            if (a.type == ASTNodeType::BINARY_EXPR)
+            {
+                CHECK(a.data.binary_expr.left == b.data.binary_expr.left);
+                CHECK(a.data.binary_expr.right == b.data.binary_expr.right);
+                CHECK(a.data.binary_expr.op == b.data.binary_expr.op);
+            }
+            else if (a.type == ASTNodeType::UNARY_EXPR)
+            {
+                CHECK(a.data.unary_expr.operand == b.data.unary_expr.operand);
+                CHECK(a.data.unary_expr.op == b.data.unary_expr.op);
+            }
+        }
+
+        REQUIRE(pratt.diagnostics.size() == descent.diagnostics.size());
+        for (size_t i = 0; i < pratt.diagnostics.size(); ++i)
+        {
+            CHECK(pratt.diagnostics[i].code == descent.diagnostics[i].code);
+            CHECK(pratt.diagnostics[i].token == descent.diagnostics[i].token);
+        }
+    }
+}
+
+TEST_CASE("Pratt expression parsing")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    SECTION("Precedence and associativity")
+    {
+        const std::vector<std::string> sources = {
+            "var x = a + b * c - d / e % f;",
+            "var x = a || b && c | d ^ e & f == g < h + i * j;",
+            "var x = a * b + c * d == e * f + g * h;",
+            "var x = a - b - c - d;",
+            "var x = a ? b : c ? d : e;",
+            "var x = a || b ? c + d : e && f;",
+            "var x = -a * !b + ~c - *d & &e;",
+            "var x = (a + b) * (c - (d / e));",
+            "var x = f(a + b, c * d).g(e ? 1 : 2) + h(i)(j);",
+            "var x = cast<i32>(a + b) * new i32[] { 1 + 2, 3 * 4 };",
+            "function f() -> void { a = b = c + d; a += b *= c - 1; a = b ? c : d = e; a + b = c; }",
+            "function f() -> void { x = a <= b != c >= d; y = a < b > c; return a ? b : c; }",
+        };
+
+        for (const auto &src: sources)
+            check_same_as_descent(relative_filename, src);
+    }
+
+    SECTION("Left-associative chains bind left")
+    {
+        const auto [ast, diagnostics] = parse(relative_filename, "var x = a - b - c;", ExprStrategy::PRATT);
+        REQUIRE(diagnostics.empty());
+
+        /* DECL -> BINARY(-) whose left operand is BINARY(a - b) */
+        const uint32_t outer = ast[1].data.decl.init_node;
+        REQUIRE(ast[outer].type == ASTNodeType::BINARY_EXPR);
+        const uint32_t inner = ast[outer].data.binary_expr.left;
+        CHECK(ast[inner].type == ASTNodeType::BINARY_EXPR);
+        CHECK(ast[ast[outer].data.binary_expr.right].type == ASTNodeType::IDENTIFIER);
+    }
+
+    SECTION("Malformed expressions recover identically")
+    {
+        const std::vector<std::string> sources = {
+            "var x = a + ;",
+            "var x = a ? b ;",
+            "var x = * / c;",
+            "var x = (a + b;",
+            "function f() -> void { a = ; b = c ? : d; e +; }",
+        };
+
+        for (const auto &src: sources)
+            check_same_as_descent(relative_filename, src);
+    }
+
+    SECTION("Random expressions")
+    {
+        constexpr const char *binary[] = {
+            "=", "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=", "||", "&&", "|", "^", "&",
+            "==", "!=", "<", "<=", ">", ">=", "+", "-", "*", "/", "%"
+        };
+        constexpr const char *unary[] = { "-", "!", "~", "*", "&" };
+        constexpr const char *operands[] = { "a", "b1", "42", "3.5", "\"s\"", "true", "null", "f(x)", "o.m()" };
+
+        std::mt19937 rng(0x707261);
+        const auto below = [&](const size_t n) { return std::uniform_int_distribution<size_t>(0, n - 1)(rng); };
+
+        /* mostly valid, sometimes an operand or a parenthesis goes missing */
+        const auto expression = [&](auto &self, std::string &out, const int depth) -> void
+        {
+            if (below(4) == 0)
+                out += unary[below(std::size(unary))];
+
+            if (depth > 0 && below(3) == 0)
+            {
+                out += '(';
+                self(self, out, depth - 1);
+                out += below(40) ? ")" : "";
+            }
+            else if (below(60))
+            {
+                out += operands[below(std::size(operands))];
+            }
+
+            if (depth > 0 && below(3))
+            {
+                if (below(8) == 0)
+                {
+                    out += " ? ";
+                    self(self, out, depth - 1);
+                    out += " : ";
+                }
+                else
+                {
+                    out += ' ';
+                    out += binary[below(std::size(binary))];
+                    out += ' ';
+                }
+                self(self, out, depth - 1);
+            }
+        };
+
+        for (auto i = 0; i < 2000; ++i)
+        {
+            std::string src = "function f() -> void {\n";
+            for (size_t j = 0, n = 1 + below(4); j < n; ++j)
+            {
+                src += "    ";
+                expression(expression, src, static_cast<int>(1 + below(7)));
+                src += ";\n";
+            }
+            src += "}\n";
+            check_same_as_descent(relative_filename, src);
+        }
+    }
+}
@@ -0,0 +1,134 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/parser/include/parser.h>
+#include <filesystem>
+
+using namespace klr::compiler;
+
+namespace
+{
+    struct Parsed
+    {
+        AST ast;
+        std::vector<Diagnostic> diagnostics;
+    };
+
+    Parsed parse(const std::string &name, const std::string &src)
+    {
+        Lexer lexer(name, src);
+        auto tokens = lexer.tokenize();
+        Parser parser(name, src, std::move(tokens), lexer.get_line_starts());
+
+        Parsed out { parser.parse(), {} };
+        out.diagnostics.assign(parser.get_diagnostics().begin(), parser.get_diagnostics().end());
+        return out;
+    }
+
+    std::vector<uint32_t> children(const AST &ast, const uint32_t node)
+    {
+        return { ast.children(node).begin(), ast.children(node).end() };
+    }
+
+    /* the chain of token types from a TYPE node down through its first type argument */
+    std::vector<TokenType> type_chain(const AST &ast, uint32_t node)
+    {
+        std::vector<TokenType> out;
+        while (true)
+        {
+            REQUIRE(ast[node].type == ASTNodeType::TYPE);
+            out.push_back(ast[node].token.type);
+            const auto args = children(ast, node);
+            if (args.empty())
+                return out;
+            node = args[0];
+        }
+    }
+
+    /* the first top-level declaration */
+    ASTNode first_decl(const AST &ast)
+    {
+        const auto top = children(ast, 0);
+        REQUIRE(!top.empty());
+        REQUIRE(ast[top[0]].type == ASTNodeType::DECL);
+        return ast[top[0]];
+    }
+}
+
+TEST_CASE("Pointer declarations")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    SECTION("Nested wrappers close on a single '>>'")
+    {
+        const auto parsed = parse(relative_filename, "var p: Own<Ref<i32>> = q;");
+        REQUIRE(parsed.diagnostics.empty());
+
+        const ASTNode decl = first_decl(parsed.ast);
+        CHECK(type_chain(parsed.ast, decl.data.decl.type_node) ==
+              std::vector { TokenType::OWN, TokenType::REF, TokenType::I32 });
+        CHECK(parsed.ast[decl.data.decl.init_node].type == ASTNodeType::IDENTIFIER);
+    }
+
+    SECTION("Closers fused with the '=' that follows")
+    {
+        /* `>>>=` lexes as `>>` then `>=`, `>>=` as one token */
+        for (const std::string src: { "var p: Own<Share<Pin<u8>>>= q;", "var p: Own<Ref<u8>>= q;",
+                                      "var p: Own<u8>= q;" })
+        {
+            INFO("source: " << src);
+            const auto parsed = parse(relative_filename, src);
+            REQUIRE(parsed.diagnostics.empty());
+
+            const ASTNode decl = first_decl(parsed.ast);
+            CHECK(type_chain(parsed.ast, decl.data.decl.type_node).back() == TokenType::U8);
+            REQUIRE(decl.data.decl.init_node != 0);
+            CHECK(parsed.ast[decl.data.decl.init_node].type == ASTNodeType::IDENTIFIER);
+        }
+    }
+
+    SECTION("Generic arguments")
+    {
+        const auto parsed = parse(relative_filename, "var m: Map<string, Own<Node<T>>> = q;");
+        REQUIRE(parsed.diagnostics.empty());
+
+        const ASTNode decl = first_decl(parsed.ast);
+        const auto args = children(parsed.ast, decl.data.decl.type_node);
+        REQUIRE(args.size() == 2);
+        CHECK(parsed.ast[args[0]].token.type == TokenType::STRING);
+        CHECK(type_chain(parsed.ast, args[1]) ==
+              std::vector { TokenType::OWN, TokenType::IDENTIFIER, TokenType::IDENTIFIER });
+    }
+
+    SECTION("Casts and shifts in one expression")
+    {
+        const auto parsed = parse(relative_filename, "var s: u32 = cast<Own<Ref<u32>>>(a) >> 2 << b;");
+        REQUIRE(parsed.diagnostics.empty());
+
+        const ASTNode decl = first_decl(parsed.ast);
+        const ASTNode shl = parsed.ast[decl.data.decl.init_node];
+        REQUIRE(shl.type == ASTNodeType::BINARY_EXPR);
+        CHECK(shl.data.binary_expr.op == TokenType::LEFT_SHIFT);
+
+        const ASTNode shr = parsed.ast[shl.data.binary_expr.left];
+        REQUIRE(shr.type == ASTNodeType::BINARY_EXPR);
+        CHECK(shr.data.binary_expr.op == TokenType::RIGHT_SHIFT);
+
+        const ASTNode cast = parsed.ast[shr.data.binary_expr.left];
+        REQUIRE(cast.type == ASTNodeType::CAST_EXPR);
+        CHECK(type_chain(parsed.ast, cast.data.cast_expr.type_node) ==
+              std::vector { TokenType::OWN, TokenType::REF, TokenType::U32 });
+    }
+
+    SECTION("Missing closer")
+    {
+        const auto parsed = parse(relative_filename, "var p: Own<i32 = q;\nvar r: i32 = 1;");
+        REQUIRE(parsed.diagnostics.size() == 1);
+        CHECK(parsed.diagnostics[0].code == DiagCode::EXPECTED_TOKEN);
+        CHECK(parsed.diagnostics[0].args[0] == static_cast<uint32_t>(TokenType::GREATER));
+    }
+}
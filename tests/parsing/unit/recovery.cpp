@@ -0,0 +1,178 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/parser/include/parser.h>
+#include <filesystem>
+#include <random>
+#include <sstream>
+
+using namespace klr::compiler;
+
+namespace
+{
+    struct Parsed
+    {
+        AST ast;
+        std::vector<Diagnostic> diagnostics;
+        std::vector<std::string> rendered;
+        size_t token_count;
+    };
+
+    Parsed parse(const std::string &name, const std::string &src)
+    {
+        Lexer lexer(name, src);
+        auto tokens = lexer.tokenize();
+        const size_t token_count = tokens->size();
+        Parser parser(name, src, std::move(tokens), lexer.get_line_starts());
+
+        Parsed out { parser.parse(), {}, {}, token_count };
+        for (const auto &d: parser.get_diagnostics())
+        {
+            std::ostringstream text;
+            parser.renderer().text(text, d);
+            out.diagnostics.push_back(d);
+            out.rendered.push_back(text.str());
+        }
+        return out;
+    }
+
+    size_t count(const AST &ast, const ASTNodeType type)
+    {
+        size_t n = 0;
+        for (uint32_t i = 0; i < ast.size(); ++i)
+            n += ast[i].type == type;
+        return n;
+    }
+
+    /* line of a diagnostic, 1-based, counted independently of the renderer */
+    size_t line_of(const std::string &src, const Diagnostic &d)
+    {
+        Lexer lexer("", src);
+        const offset_t start = lexer.tokenize()->starts[d.token];
+        return 1 + std::count(src.begin(), src.begin() + start, '\n');
+    }
+}
+
+TEST_CASE("Parser error recovery")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    SECTION("Valid code has no diagnostics")
+    {
+        const auto [ast, diagnostics, rendered, token_count] = parse(relative_filename,
+                                                        "var x: i32 = 1;\n"
+                                                        "function f(a: i32) -> i32\n{\n"
+                                                        "    for (var i: i32 = 0; i < a; i += 1) { x += i; }\n"
+                                                        "    return x;\n}\n");
+        CHECK(diagnostics.empty());
+        CHECK(count(ast, ASTNodeType::ERROR) == 0);
+        CHECK(count(ast, ASTNodeType::FOR) == 1);
+    }
+
+    SECTION("Every broken statement is reported in one pass")
+    {
+        const std::string src = "var a: i32 = ;\n"
+                                "var b: i32 = 2;\n"
+                                "const c: = 3;\n"
+                                "var d: i32 = (1 + ;\n"
+                                "var e: i32 = 5;\n";
+        const auto [ast, diagnostics, rendered, token_count] = parse(relative_filename, src);
+
+        REQUIRE(diagnostics.size() == 3);
+        CHECK(line_of(src, diagnostics[0]) == 1);
+        CHECK(line_of(src, diagnostics[1]) == 3);
+        CHECK(line_of(src, diagnostics[2]) == 4);
+        for (const auto &d: diagnostics)
+            CHECK(d.level == ErrorLevel::ERROR);
+
+        /* all five declarations survive, the broken ones with ERROR nodes inside */
+        CHECK(count(ast, ASTNodeType::DECL) == 5);
+        CHECK(count(ast, ASTNodeType::ERROR) == 3);
+        CHECK(ast.child_count(0) == 5);
+    }
+
+    SECTION("Errors inside function bodies")
+    {
+        const std::string src = "function f() -> i32\n{\n"
+                                "    var x: i32 = 1 +;\n"
+                                "    x = x * 2;\n"
+                                "    return ) x;\n"
+                                "}\n"
+                                "function g() -> void\n{\n"
+                                "    if (x { y = 1; }\n"
+                                "    class;\n"
+                                "    return;\n"
+                                "}\n"
+                                "var z: i32 = 3;\n";
+        const auto [ast, diagnostics, rendered, token_count] = parse(relative_filename, src);
+
+        REQUIRE(diagnostics.size() == 4);
+        CHECK(line_of(src, diagnostics[0]) == 3);
+        CHECK(line_of(src, diagnostics[1]) == 5);
+        CHECK(line_of(src, diagnostics[2]) == 9);
+        CHECK(line_of(src, diagnostics[3]) == 10);
+        CHECK(count(ast, ASTNodeType::FUNCTION) == 2);
+        CHECK(count(ast, ASTNodeType::RETURN) == 2);
+
+        /* the declaration after both functions is still at the top level */
+        const auto top = std::vector(ast.children(0).begin(), ast.children(0).end());
+        REQUIRE(top.size() == 3);
+        CHECK(ast[top[2]].type == ASTNodeType::DECL);
+    }
+
+    SECTION("Unterminated blocks stop at the end of the file")
+    {
+        const std::string src = "function f() -> i32\n{\n    var x: i32 = 1;\n    while (x) {\n        x = 0;\n";
+        const auto [ast, diagnostics, rendered, token_count] = parse(relative_filename, src);
+
+        REQUIRE(diagnostics.size() == 2);
+        CHECK(diagnostics[0].code == DiagCode::UNTERMINATED_BLOCK);
+        CHECK(line_of(src, diagnostics[0]) == 4);
+        CHECK(line_of(src, diagnostics[1]) == 2);
+        CHECK(count(ast, ASTNodeType::WHILE) == 1);
+    }
+
+    SECTION("Rendered diagnostics")
+    {
+        const std::string src = "var a: i32 = 1;\nvar b: i32 = ];";
+        const auto [ast, diagnostics, rendered, token_count] = parse(relative_filename, src);
+
+        REQUIRE(rendered.size() == 1);
+        CHECK(diagnostics[0].code == DiagCode::EXPECTED_EXPRESSION);
+        CHECK(rendered[0].find(":2:14") != std::string::npos);
+        CHECK(rendered[0].find("expected an expression, found ']'") != std::string::npos);
+        CHECK(rendered[0].find("var b: i32 = ];") != std::string::npos);
+    }
+
+    SECTION("Token soup always terminates")
+    {
+        constexpr const char *pieces[] = {
+            "var ", "const ", "function ", "f", "(", ")", "{", "}", "[", "]", ";", ",", ":", "=", "+",
+            "i32", "1", "\"s\"", "if", "else", "while", "for", "return", "->", "<", ">", ".", "cast", "new"
+        };
+        std::mt19937 rng(0x726563);
+        std::uniform_int_distribution<size_t> pick(0, std::size(pieces) - 1);
+        std::uniform_int_distribution<size_t> length(0, 120);
+
+        for (auto i = 0; i < 1000; ++i)
+        {
+            std::string src;
+            for (size_t j = 0, n = length(rng); j < n; ++j)
+            {
+                src += pieces[pick(rng)];
+                src += ' ';
+            }
+
+            const auto [ast, diagnostics, rendered, token_count] = parse(relative_filename, src);
+            INFO(src);
+            for (const auto &d: diagnostics)
+                CHECK(d.token < token_count);
+            for (uint32_t n = 1; n < ast.size(); ++n)
+                CHECK(ast[n].parent < ast.size());
+        }
+    }
+}
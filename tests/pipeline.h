@@ -0,0 +1,69 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <catch2.hpp>
+#include <compiler/analysis/include/folder.h>
+#include <compiler/ir/include/lowering.h>
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/memory/include/interner.h>
+#include <compiler/parser/include/parser.h>
+#include <memory>
+#include <string>
+
+namespace klr::compiler::test
+{
+    /* the last pass a Pipeline runs */
+    enum class Stage : uint8_t
+    {
+        CHECK,
+        FOLD,
+        LOWER,
+    };
+
+    /*
+     * one module taken through the passes up to a stage, for the test
+     * fixtures to build on. it must parse cleanly, and type check cleanly
+     * to go any further; diagnostics of the last pass are left to the test
+     */
+    struct Pipeline
+    {
+        std::string src;
+        Interner interner;
+        std::unique_ptr<Parser> parser;
+        AST ast;
+        SymbolTable symbols;
+        TypeTable types;
+        ConstantPool pool;
+        std::unique_ptr<TypeChecker> checker;
+        std::unique_ptr<ConstantFolder> folder;
+        size_t folded = 0;
+        IRModule module;
+        std::unique_ptr<IRLowering> lowering;
+
+        Pipeline(const std::string &name, std::string source, const Stage until) : src(std::move(source))
+        {
+            Lexer lexer(name, src, simd::Level::AVX2, std::pmr::get_default_resource(), &interner);
+            auto tokens = lexer.tokenize();
+            parser = std::make_unique<Parser>(name, src, std::move(tokens), lexer.get_line_starts());
+            ast = parser->parse();
+            REQUIRE(!parser->has_errors());
+
+            symbols.resolve(ast);
+            checker = std::make_unique<TypeChecker>(types, ast, symbols, parser->get_tokens());
+            checker->check();
+            if (until == Stage::CHECK)
+                return;
+            REQUIRE(!checker->has_errors());
+
+            folder = std::make_unique<ConstantFolder>(ast, pool, *checker, symbols, parser->get_tokens());
+            folded = folder->fold();
+            if (until == Stage::FOLD)
+                return;
+
+            lowering = std::make_unique<IRLowering>(module, ast, symbols, types, *checker, pool, parser->get_tokens());
+            lowering->lower();
+        }
+    };
+}
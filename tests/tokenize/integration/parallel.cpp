@@ -0,0 +1,123 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/lexer/include/lexer.h>
+#include <filesystem>
+#include <random>
+
+using namespace klr::compiler;
+
+static void check_same_as_serial(const std::string &name, const std::string &src, const uint32_t threads,
+                                 const uint32_t min_chunk)
+{
+    Lexer serial(name, src);
+    const auto expected = serial.tokenize();
+    const auto expected_lines = serial.get_line_starts();
+
+    Lexer parallel(name, src);
+    const auto tokens = parallel.tokenize_parallel(threads, min_chunk);
+    const auto lines = parallel.get_line_starts();
+
+    INFO("threads " << threads << ", min_chunk " << min_chunk);
+    CHECK(tokens->starts == expected->starts);
+    CHECK(tokens->lens == expected->lens);
+    CHECK(tokens->types == expected->types);
+    CHECK(tokens->flags == expected->flags);
+    CHECK(*lines == *expected_lines);
+}
+
+TEST_CASE("Parallel tokenize")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    SECTION("Generated module")
+    {
+        std::string src;
+        for (auto i = 0; i < 2000; ++i)
+        {
+            src += "function f" + std::to_string(i) + "(a: i32, b: Own<Ref<T>>) -> i32\n{\n";
+            src += "    var x = a >> 2 + b * 0x1F; // trailing comment\n";
+            src += "    const s: string = \"text with // and /* inside\";\n";
+            src += "    return x >= 3.14e2 ? x : -x;\n}\n";
+        }
+
+        for (const uint32_t threads: { 2U, 3U, 8U })
+            check_same_as_serial(relative_filename, src, threads, 64);
+    }
+
+    SECTION("Strings and comments across chunk boundaries")
+    {
+        /* boundaries land inside these multi-line constructs */
+        std::string src;
+        for (auto i = 0; i < 200; ++i)
+        {
+            src += "var a = 1;\n/* block comment\n var fake = 2;\n \"still comment\n*/\n";
+            src += "const s = \"string spanning\nlines /* not a comment\n\";\nvar b = a;\n";
+        }
+        src += "/* unterminated\n var never = 0;\n";
+
+        for (const uint32_t threads: { 2U, 5U, 16U })
+        {
+            for (const uint32_t min_chunk: { 1U, 7U, 33U })
+                check_same_as_serial(relative_filename, src, threads, min_chunk);
+        }
+    }
+
+    SECTION("Random sources")
+    {
+        constexpr char alphabet[] = { ' ', '\n', '\n', '/', '*', '"', '\\', 'a', '1', '.', ';', '>', '<' };
+        std::mt19937 rng(0x706172);
+        std::uniform_int_distribution<size_t> pick(0, sizeof(alphabet) - 1);
+        for (auto i = 0; i < 100; ++i)
+        {
+            std::string src(2000, ' ');
+            for (auto &c: src)
+                c = alphabet[pick(rng)];
+            check_same_as_serial(relative_filename, src, 6, 16);
+        }
+    }
+
+    SECTION("Re-lexed chunk that speculated into end of file")
+    {
+        /* chunk 1 starts inside the comment, so its speculative pass opens a
+           string at the lone quote that runs to end of file */
+        std::string src;
+        for (auto i = 0; i < 20; ++i)
+            src += "var a" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+        src += "/* a comment crossing the first chunk boundary\n";
+        for (auto i = 0; i < 20; ++i)
+            src += " still inside the comment\n";
+        src += " with a lone \" quote\n*/\n";
+        for (auto i = 0; i < 40; ++i)
+            src += "var b" + std::to_string(i) + " = a0 + " + std::to_string(i) + ";\n";
+
+        for (const uint32_t threads: { 3U, 4U })
+            check_same_as_serial(relative_filename, src, threads, 16);
+    }
+
+    SECTION("Random modules")
+    {
+        /* whole lines, so comments and strings open and close across boundaries */
+        constexpr const char *fragments[] = {
+            "var x = 1;", "/*", "*/", "\"", "// line comment \" /*", "a + b * 3.5", "\"text\";",
+            "return x;", "{", "}", "/* short */", "\\\"",
+        };
+        std::mt19937 rng(0x6d6f64);
+        std::uniform_int_distribution<size_t> pick(0, std::size(fragments) - 1);
+        std::uniform_int_distribution<int> width(0, 4);
+        for (auto i = 0; i < 3000; ++i)
+        {
+            std::string src;
+            for (auto line = 0; line < 60; ++line)
+            {
+                for (auto n = width(rng); n > 0; --n)
+                    (src += fragments[pick(rng)]) += ' ';
+                src += '\n';
+            }
+            check_same_as_serial(relative_filename, src, 3 + i % 4, 16);
+        }
+    }
+}
@@ -0,0 +1,77 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/lexer/include/lexer.h>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+using namespace klr::compiler;
+
+static void check_same_as_string(const std::filesystem::path &path, const std::string &src)
+{
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << src;
+    }
+
+    const SourceFile file(path);
+    REQUIRE(file.view() == src);
+    for (size_t i = 0; i < SourceFile::PADDING; ++i)
+        REQUIRE(file.view().data()[src.size() + i] == '\0');
+
+    Lexer reference(path.string(), src);
+    const auto expected = reference.tokenize();
+    const auto expected_lines = reference.get_line_starts();
+
+    Lexer lexer(path.string(), file);
+    const auto tokens = lexer.tokenize();
+    const auto lines = lexer.get_line_starts();
+
+    CHECK(tokens->starts == expected->starts);
+    CHECK(tokens->lens == expected->lens);
+    CHECK(tokens->types == expected->types);
+    CHECK(tokens->flags == expected->flags);
+    CHECK(*lines == *expected_lines);
+}
+
+TEST_CASE("Source file")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+
+    SECTION("Module")
+    {
+        check_same_as_string(test_file_path, R"(
+            // entry point
+            function main() -> i32
+            {
+                var x: u64 = 12345678901234;   /* trailing */
+                return cast<i32>(x % 0xFF);
+            }
+        )");
+    }
+
+    SECTION("Ends without padding in the file")
+    {
+        /* a page sized file ending in a number and in whitespace */
+        std::string digits(4096, ' ');
+        digits.replace(digits.size() - 20, 20, "12345678901234567890");
+        check_same_as_string(test_file_path, digits);
+        check_same_as_string(test_file_path, std::string(4096, '\n'));
+        check_same_as_string(test_file_path, "var x = 1; // no newline at the end");
+    }
+
+    SECTION("Empty")
+    {
+        check_same_as_string(test_file_path, "");
+    }
+
+    SECTION("Missing")
+    {
+        CHECK_THROWS_AS(SourceFile(test_file_path.string() + ".missing"), std::system_error);
+    }
+
+    std::filesystem::remove(test_file_path);
+}
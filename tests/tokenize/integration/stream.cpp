@@ -0,0 +1,93 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/lexer/include/lexer.h>
+#include <compiler/lexer/include/stream.h>
+#include <cstring>
+#include <filesystem>
+#include <random>
+
+using namespace klr::compiler;
+
+/* streams src through short, uneven reads and checks the stitched batches against tokenize() */
+static void check_same_as_tokenize(const std::string &name, const std::string &src, const uint32_t window)
+{
+    Lexer lexer(name, src);
+    const auto expected = lexer.tokenize();
+
+    std::mt19937 rng(window);
+    size_t offset = 0;
+    StreamLexer stream(name, [&](char *buffer, const size_t capacity)
+    {
+        const size_t n = std::min({ capacity, src.size() - offset, static_cast<size_t>(rng() % 23 + 1) });
+        memcpy(buffer, src.data() + offset, n);
+        offset += n;
+        return n;
+    }, window);
+
+    std::vector<uint64_t> starts;
+    TokenList all;
+    TokenList batch;
+    while (stream.next_batch(batch))
+    {
+        for (size_t i = 0; i < batch.size(); ++i)
+            starts.push_back(stream.batch_base() + batch.starts[i]);
+        all.append(batch);
+    }
+
+    INFO("window " << window);
+    REQUIRE(starts.size() == expected->size());
+    for (size_t i = 0; i < starts.size(); ++i)
+        CHECK(starts[i] == expected->starts[i]);
+    CHECK(all.lens == expected->lens);
+    CHECK(all.types == expected->types);
+    CHECK(all.flags == expected->flags);
+}
+
+TEST_CASE("Stream tokenize")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    SECTION("Module")
+    {
+        std::string src;
+        for (auto i = 0; i < 50; ++i)
+        {
+            src += "function f" + std::to_string(i) + "(a: Own<Ref<T>>) -> i32\n{\n";
+            src += "    var x = a >>= 2 <<= 3 >> 1; // comment\n";
+            src += "    /* block\n comment */ const s = \"esc \\x41 \\n\";\n";
+            src += "    return x >= 3.14e+2 ? 0x1F : 0b101;\n}\n";
+        }
+
+        for (const uint32_t window: { 16U, 17U, 64U, 4096U })
+            check_same_as_tokenize(relative_filename, src, window);
+    }
+
+    SECTION("Tokens larger than the window")
+    {
+        const std::string src = "var s = \"" + std::string(300, 'x') + "\"; /*" + std::string(200, ' ') + "*/ x";
+        check_same_as_tokenize(relative_filename, src, 16);
+    }
+
+    SECTION("Empty")
+    {
+        check_same_as_tokenize(relative_filename, "", 16);
+    }
+
+    SECTION("Random sources")
+    {
+        constexpr char alphabet[] = { ' ', '\n', '/', '*', '"', '\\', 'x', 'a', '1', '0', '.', 'e', '>', '<', '=' };
+        std::mt19937 rng(0x737472);
+        std::uniform_int_distribution<size_t> pick(0, sizeof(alphabet) - 1);
+        for (auto i = 0; i < 200; ++i)
+        {
+            std::string src(rng() % 400, ' ');
+            for (auto &c: src)
+                c = alphabet[pick(rng)];
+            check_same_as_tokenize(relative_filename, src, 16 + i % 40);
+        }
+    }
+}
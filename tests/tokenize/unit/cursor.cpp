@@ -0,0 +1,77 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/lexer/include/lexer.h>
+#include <filesystem>
+
+using namespace klr::compiler;
+
+TEST_CASE("Token cursor")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    const std::string src = "var x: i32 = (a + 1);";
+    Lexer lexer(relative_filename, src);
+    const auto tokens = lexer.tokenize();
+    REQUIRE(tokens->size() == 12);
+
+    SECTION("Peek and lookahead read the types column")
+    {
+        TokenCursor cursor(*tokens);
+        CHECK(cursor.peek_type() == TokenType::VAR);
+        CHECK(cursor.peek_type(0) == TokenType::VAR);
+        CHECK(cursor.peek_type(1) == TokenType::IDENTIFIER);
+        CHECK(cursor.peek_type(5) == TokenType::LEFT_PAREN);
+        CHECK(cursor.peek_type(10) == TokenType::SEMICOLON);
+
+        /* past the end is the trailing EOF */
+        CHECK(cursor.peek_type(11) == TokenType::END_OF_FILE);
+        CHECK(cursor.peek_type(1000) == TokenType::END_OF_FILE);
+        CHECK(cursor.position() == 0);
+    }
+
+    SECTION("Advance gathers the same token as operator[]")
+    {
+        TokenCursor cursor(*tokens);
+        for (size_t i = 0; i + 1 < tokens->size(); ++i)
+        {
+            const Token expected = (*tokens)[i];
+            const Token tk = cursor.advance();
+            CHECK(tk.start == expected.start);
+            CHECK(tk.len == expected.len);
+            CHECK(tk.type == expected.type);
+            CHECK(tk.flags == expected.flags);
+        }
+
+        CHECK(cursor.at_end());
+        /* EOF is never stepped past */
+        CHECK(cursor.advance().type == TokenType::END_OF_FILE);
+        CHECK(cursor.position() == tokens->size() - 1);
+    }
+
+    SECTION("Bulk skip")
+    {
+        TokenCursor cursor(*tokens);
+        cursor.skip(5);
+        CHECK(cursor.peek_type() == TokenType::LEFT_PAREN);
+        CHECK(cursor.token().start == 13);
+
+        CHECK(cursor.skip_to(TokenType::RIGHT_PAREN) == 4);
+        CHECK(cursor.peek_type() == TokenType::RIGHT_PAREN);
+        CHECK(cursor.skip_to(TokenType::RIGHT_PAREN) == 0);
+
+        /* a type that never comes stops at EOF */
+        CHECK(cursor.skip_to(TokenType::WHILE) == 2);
+        CHECK(cursor.at_end());
+
+        cursor.seek(1);
+        CHECK(cursor.peek_type() == TokenType::IDENTIFIER);
+        cursor.skip(1000);
+        CHECK(cursor.at_end());
+        cursor.seek(1000);
+        CHECK(cursor.position() == tokens->size() - 1);
+    }
+}
@@ -23,7 +23,8 @@ TEST_CASE("Keyword")
         { "function", TokenType::FUNCTION },
         { "inline", TokenType::INLINE },
         { "return", TokenType::RETURN },
-        { "enum", TokenType::ENUM }
+        { "enum", TokenType::ENUM },
+        { "int", TokenType::I32 }
     };
 
     for (const auto &[keyword, type]: keywords)
@@ -34,4 +35,7 @@ TEST_CASE("Keyword")
         CHECK(tokens->types[0] == type);
         CHECK(tokens->lens[0] == keyword.length());
     }
+
+    /* `int` is only another spelling */
+    CHECK(token_to_str(TokenType::I32) == "i32");
 }
\ No newline at end of file
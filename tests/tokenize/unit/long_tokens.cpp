@@ -0,0 +1,64 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/lexer/include/lexer.h>
+#include <filesystem>
+
+using namespace klr::compiler;
+
+TEST_CASE("Tokens longer than 65535 bytes")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    SECTION("String literal")
+    {
+        const std::string literal = '"' + std::string(100000, 'a') + '"';
+        const std::string src = "var s = " + literal + "; x";
+        Lexer lexer(relative_filename, src);
+        const auto tokens = lexer.tokenize();
+
+        REQUIRE(tokens->size() == 7);
+        CHECK((*tokens)[3].type == TokenType::STR_LITERAL);
+        CHECK((*tokens)[3].len == Token::LONG_TOKEN);
+        CHECK(tokens->length(3) == literal.size());
+        CHECK((*tokens)[4].type == TokenType::SEMICOLON);
+        CHECK((*tokens)[4].start == 8 + literal.size());
+        CHECK((*tokens)[5].type == TokenType::IDENTIFIER);
+        CHECK(tokens->length(5) == 1);
+    }
+
+    SECTION("Identifier and number")
+    {
+        const std::string ident(70000, 'x');
+        const std::string number(Token::LONG_TOKEN, '7');
+        const std::string src = ident + " + " + number;
+        Lexer lexer(relative_filename, src);
+        const auto tokens = lexer.tokenize();
+
+        REQUIRE(tokens->size() == 4);
+        CHECK((*tokens)[0].type == TokenType::IDENTIFIER);
+        CHECK(tokens->length(0) == ident.size());
+        CHECK((*tokens)[1].type == TokenType::PLUS);
+        CHECK((*tokens)[2].type == TokenType::NUM_LITERAL);
+        CHECK(tokens->length(2) == number.size());
+        CHECK((*tokens)[3].type == TokenType::END_OF_FILE);
+    }
+
+    SECTION("Side table survives append")
+    {
+        const std::string src = "a \"" + std::string(80000, 'b') + "\" c";
+        Lexer first(relative_filename, src);
+        Lexer second(relative_filename, src);
+        auto tokens = first.tokenize();
+        tokens->pop_back();
+        tokens->append(*second.tokenize());
+
+        REQUIRE(tokens->size() == 7);
+        CHECK(tokens->length(1) == 80002);
+        CHECK(tokens->length(4) == 80002);
+        CHECK(tokens->length(5) == 1);
+    }
+}
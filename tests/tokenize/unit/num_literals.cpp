@@ -3,7 +3,9 @@
 
 #include <catch2.hpp>
 #include <compiler/lexer/include/lexer.h>
+#include <charconv>
 #include <filesystem>
+#include <random>
 
 using namespace klr::compiler;
 
@@ -50,4 +52,114 @@ TEST_CASE("Number literals")
             CHECK(tokens->lens[0] == num.length());
         }
     }
-}
\ No newline at end of file
+
+    SECTION("Decoded integer values")
+    {
+        const std::vector<std::pair<std::string, uint64_t> > integers = {
+            { "0", 0 },
+            { "7", 7 },
+            { "12345678", 12345678 },
+            { "123456789012", 123456789012ULL },
+            { "18446744073709551615", 18446744073709551615ULL },
+            { "0xFF", 0xFF },
+            { "0xdeadBEEF", 0xDEADBEEF },
+            { "0xFFFFFFFFFFFFFFFF", ~0ULL },
+            { "0b1010", 10 },
+            { "0b" + std::string(64, '1'), ~0ULL },
+        };
+
+        for (const auto &[num, value]: integers)
+        {
+            Lexer lexer(relative_filename, num);
+            const auto tokens = lexer.tokenize();
+            INFO(num);
+            REQUIRE(tokens->literal(0) != nullptr);
+            CHECK_FALSE(tokens->literal(0)->is_float);
+            CHECK(tokens->literal(0)->bits == value);
+            CHECK(tokens->literal(1) == nullptr);
+        }
+    }
+
+    SECTION("Decoded float values")
+    {
+        const std::vector<std::string> floats = {
+            "0.0", "123.456", "1e10", "1.23e-4", "2.5E+3", "1.", "0.1", "3.141592653589793",
+            "12345678901234567890.5", "1e300", "4.9e-324", "0.000000000000000000000000001",
+            "1.7976931348623157e308", "0.123456789012345678901234567890123",
+        };
+
+        for (const auto &num: floats)
+        {
+            double expected;
+            std::from_chars(num.data(), num.data() + num.size(), expected);
+
+            Lexer lexer(relative_filename, num);
+            const auto tokens = lexer.tokenize();
+            INFO(num);
+            REQUIRE(tokens->literal(0) != nullptr);
+            CHECK(tokens->literal(0)->is_float);
+            CHECK(tokens->literal(0)->as_float() == expected);
+        }
+    }
+
+    SECTION("Random floats round trip")
+    {
+        std::mt19937_64 rng(0x6e756d);
+        for (auto i = 0; i < 2000; ++i)
+        {
+            const std::string num = std::to_string(rng() % 100000) + "." + std::to_string(rng() % 1000000) +
+                                    "e" + std::to_string(static_cast<int>(rng() % 40) - 20);
+            double expected;
+            std::from_chars(num.data(), num.data() + num.size(), expected);
+
+            Lexer lexer(relative_filename, num);
+            const auto tokens = lexer.tokenize();
+            INFO(num);
+            REQUIRE(tokens->literal(0) != nullptr);
+            CHECK(tokens->literal(0)->as_float() == expected);
+        }
+    }
+
+    SECTION("Out of range")
+    {
+        const std::vector<std::string> numbers = {
+            "18446744073709551616",
+            "99999999999999999999999",
+            "0x10000000000000000",
+            "0b1" + std::string(64, '0'),
+            "1e400",
+        };
+
+        for (const auto &num: numbers)
+        {
+            Lexer lexer(relative_filename, num);
+            const auto tokens = lexer.tokenize();
+            INFO(num);
+            CHECK(tokens->types[0] == TokenType::NUM_LITERAL);
+            CHECK(static_cast<uint8_t>(tokens->flags[0]) & static_cast<uint8_t>(TokenFlags::LITERAL_OUT_OF_RANGE));
+            CHECK(tokens->literal(0) == nullptr);
+        }
+    }
+
+    SECTION("Malformed literals have no value")
+    {
+        for (const std::string num: { "1.2.3", "1e", "0x" })
+        {
+            Lexer lexer(relative_filename, num);
+            const auto tokens = lexer.tokenize();
+            INFO(num);
+            CHECK(tokens->literal(0) == nullptr);
+        }
+    }
+
+    SECTION("Values are indexed by token")
+    {
+        Lexer lexer(relative_filename, "var x = 42 + 0x10 * 2.5;");
+        const auto tokens = lexer.tokenize();
+        REQUIRE(tokens->literals.size() == 3);
+        CHECK(tokens->literal(3)->bits == 42);
+        CHECK(tokens->literal(5)->bits == 16);
+        CHECK(tokens->literal(7)->as_float() == 2.5);
+        CHECK(tokens->literal(4) == nullptr);
+    }
+}
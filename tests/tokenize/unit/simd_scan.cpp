@@ -0,0 +1,102 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/lexer/include/lexer.h>
+#include <filesystem>
+#include <random>
+
+using namespace klr::compiler;
+
+static void check_same_as_scalar(const std::string &name, const std::string &src)
+{
+    Lexer reference(name, src, simd::Level::SCALAR);
+    const auto ref_tokens = reference.tokenize();
+    const auto ref_lines = reference.get_line_starts();
+
+    for (const auto level: { simd::Level::SSE42, simd::Level::AVX2 })
+    {
+        Lexer lexer(name, src, level);
+        const auto tokens = lexer.tokenize();
+        const auto lines = lexer.get_line_starts();
+
+        INFO("level " << static_cast<int>(level) << ", source: " << src);
+        CHECK(tokens->starts == ref_tokens->starts);
+        CHECK(tokens->lens == ref_tokens->lens);
+        CHECK(tokens->types == ref_tokens->types);
+        CHECK(tokens->flags == ref_tokens->flags);
+        CHECK(*lines == *ref_lines);
+    }
+}
+
+TEST_CASE("SIMD whitespace, comment and string scanning")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    SECTION("Indentation and comments")
+    {
+        const std::vector<std::string> sources = {
+            "                                                                var x = 1;",
+            "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\treturn;",
+            "\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\nx",
+            "\r\n    \r\n    \r\n    \r\n    \r\n    \r\n    \r\n    \r\n    \r\n    y",
+            "// a fairly long single-line comment that spans several blocks\nvar y = 2;",
+            "/* a block comment\n spanning\n many\n lines\n of\n text and more text */ z",
+            "/* unterminated block comment that runs past every single block boundary",
+            "/*****************************************************************/ w",
+            "********************************",
+            "--------------------------------",
+            "a /* x */ b // y\n c /**/ d /* \n\n\n */ e",
+        };
+
+        for (const auto &src: sources)
+            check_same_as_scalar(relative_filename, src);
+    }
+
+    SECTION("String literals")
+    {
+        const std::vector<std::string> sources = {
+            "var s = \"a long string literal that needs more than one block to scan\";",
+            "\"escapes \\n \\t \\\" \\\\ spread over a literal that is longer than thirty two bytes\" x",
+            "\"invalid \\q escape sitting past the first block of plain text bytes\";",
+            "\"hex escape \\x41 after a run of plain bytes that spans several blocks\"",
+            "\"unterminated literal running over every block boundary up to the end",
+            "\"ends in a lone backslash after enough bytes to fill a couple of blocks\\",
+            "\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"",
+        };
+
+        for (const auto &src: sources)
+            check_same_as_scalar(relative_filename, src);
+
+        constexpr char alphabet[] = { 'a', 'a', 'a', 'a', ' ', '\n', '"', '\\', 'n', 'x', 'q', '0', 'F' };
+        std::mt19937 rng(0x737472);
+        std::uniform_int_distribution<size_t> pick(0, sizeof(alphabet) - 1);
+        std::uniform_int_distribution<size_t> length(0, 200);
+
+        for (auto i = 0; i < 500; ++i)
+        {
+            std::string src = "\"" + std::string(length(rng), ' ');
+            for (size_t j = 1; j < src.size(); ++j)
+                src[j] = alphabet[pick(rng)];
+            check_same_as_scalar(relative_filename, src);
+        }
+    }
+
+    SECTION("Random sources")
+    {
+        constexpr char alphabet[] = { ' ', ' ', ' ', '\t', '\n', '\n', '\r', '/', '/', '*', 'a', '1', ';', '"' };
+        std::mt19937 rng(0x6b6c72);
+        std::uniform_int_distribution<size_t> pick(0, sizeof(alphabet) - 1);
+        std::uniform_int_distribution<size_t> length(0, 300);
+
+        for (auto i = 0; i < 500; ++i)
+        {
+            std::string src(length(rng), ' ');
+            for (auto &c: src)
+                c = alphabet[pick(rng)];
+            check_same_as_scalar(relative_filename, src);
+        }
+    }
+}
@@ -0,0 +1,249 @@
+// This file is part of the Klare programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <catch2.hpp>
+#include <compiler/vm/include/emitter.h>
+#include <compiler/vm/include/vm.h>
+#include <tests/pipeline.h>
+#include <filesystem>
+#include <sstream>
+
+using namespace klr::compiler;
+
+namespace
+{
+    /* one module taken all the way to bytecode */
+    struct Compiled : test::Pipeline
+    {
+        Program program;
+
+        Compiled(const std::string &name, std::string source) : Pipeline(name, std::move(source), test::Stage::LOWER)
+        {
+            REQUIRE(lowering->get_diagnostics().empty());
+            REQUIRE(verify(module, types).empty());
+
+            BytecodeEmitter(program, module, types, pool).emit();
+        }
+
+        uint32_t function(const std::string_view name)
+        {
+            const uint32_t index = program.find(interner.intern(name));
+            REQUIRE(index < program.functions.size());
+            return index;
+        }
+
+        Result run(const std::string_view name, const std::vector<Value> &args = {})
+        {
+            VM vm(program);
+            return vm.run(function(name), args);
+        }
+
+        std::string dump() const
+        {
+            std::ostringstream os;
+            program.dump(os, types, &interner);
+            return os.str();
+        }
+    };
+}
+
+TEST_CASE("VM")
+{
+    std::string test_name = Catch::getResultCapture().getCurrentTestName();
+    std::filesystem::path test_file_path = std::filesystem::current_path() / (test_name + ".klr");
+    std::string relative_filename = test_file_path.string();
+
+    SECTION("The README's example")
+    {
+        Compiled compiled(relative_filename, "function main() -> int\n{\n    return 0;\n}\n");
+        const Result result = compiled.run("main");
+        CHECK(result.trap == Trap::NONE);
+        CHECK(result.value.kind == TypeKind::I32);
+        CHECK(result.value.as_int() == 0);
+    }
+
+    SECTION("Recursion, loops, break and continue")
+    {
+        Compiled compiled(relative_filename, R"(
+            function fib(n: i32) -> i32 { return n < 2 ? n : fib(n - 1) + fib(n - 2); }
+            function skip(n: i32) -> i32 {
+                var s: i32 = 0;
+                for (var i: i32 = 0; i < n; i += 1) {
+                    if (i == 3) { continue; }
+                    if (i == 7) { break; }
+                    s += i;
+                }
+                return s;
+            }
+            function nothing(x: i32) -> void { var y: i32 = x; y += 1; }
+        )");
+        CHECK(compiled.run("fib", { Value::integer(TypeKind::I32, 20) }).value.as_int() == 6765);
+        CHECK(compiled.run("skip", { Value::integer(TypeKind::I32, 100) }).value.as_int() == 0 + 1 + 2 + 4 + 5 + 6);
+        CHECK(compiled.run("skip", { Value::integer(TypeKind::I32, 5) }).value.as_int() == 0 + 1 + 2 + 4);
+
+        const Result result = compiled.run("nothing", { Value::integer(TypeKind::I32, 1) });
+        CHECK(result.trap == Trap::NONE);
+        CHECK(result.value.kind == TypeKind::VOID);
+    }
+
+    SECTION("Phis that swap each other on the back edge")
+    {
+        Compiled compiled(relative_filename, R"(
+            function swaps(n: i32) -> i32 {
+                var a: i32 = 1;
+                var b: i32 = 2;
+                var i: i32 = 0;
+                while (i < n) { var t: i32 = a; a = b; b = t; i += 1; }
+                return a * 10 + b;
+            }
+            function fib(n: i64) -> i64 {
+                var a: i64 = 0;
+                var b: i64 = 1;
+                while (n > 0) { var t: i64 = a + b; a = b; b = t; n -= 1; }
+                return a;
+            }
+        )");
+        CHECK(compiled.run("swaps", { Value::integer(TypeKind::I32, 3) }).value.as_int() == 21);
+        CHECK(compiled.run("swaps", { Value::integer(TypeKind::I32, 4) }).value.as_int() == 12);
+        CHECK(compiled.run("fib", { Value::integer(TypeKind::I64, 90) }).value.as_int() == 2880067194370816120LL);
+    }
+
+    SECTION("Integer arithmetic wraps and shifts exactly as constant folding does")
+    {
+        static constexpr std::pair<const char *, TokenType> ops[] = {
+            { "+", TokenType::PLUS }, { "-", TokenType::MINUS }, { "*", TokenType::STAR },
+            { "/", TokenType::SLASH }, { "%", TokenType::PERCENT }, { "&", TokenType::AND },
+            { "|", TokenType::OR }, { "^", TokenType::XOR }, { "<<", TokenType::LEFT_SHIFT },
+            { ">>", TokenType::RIGHT_SHIFT }, { "<", TokenType::LESS }, { ">=", TokenType::GE },
+        };
+        static constexpr std::pair<const char *, TypeKind> kinds[] = {
+            { "i8", TypeKind::I8 }, { "u8", TypeKind::U8 }, { "i16", TypeKind::I16 },
+            { "u32", TypeKind::U32 }, { "i64", TypeKind::I64 }, { "u64", TypeKind::U64 },
+        };
+        static constexpr int64_t samples[] = { 0, 1, -1, 7, -128, 127, 255, 40000, -9, INT64_MIN, INT64_MAX };
+
+        std::string src;
+        for (size_t k = 0; k < std::size(kinds); ++k)
+        {
+            for (size_t o = 0; o < std::size(ops); ++o)
+            {
+                const char *result = o >= 10 ? "bool" : kinds[k].first;
+                src += "function f" + std::to_string(k) + "_" + std::to_string(o) + "(a: " + kinds[k].first + ", b: " +
+                        kinds[k].first + ") -> " + result + " { return a " + ops[o].first + " b; }\n";
+            }
+        }
+        Compiled compiled(relative_filename, src);
+        VM vm(compiled.program);
+
+        for (size_t k = 0; k < std::size(kinds); ++k)
+        {
+            const TypeKind kind = kinds[k].second;
+            for (size_t o = 0; o < std::size(ops); ++o)
+            {
+                const uint32_t fn = compiled.function("f" + std::to_string(k) + "_" + std::to_string(o));
+                for (const int64_t lhs: samples)
+                {
+                    for (const int64_t rhs: samples)
+                    {
+                        const Value args[] = { Value::integer(kind, lhs), Value::integer(kind, rhs) };
+                        uint64_t expected = 0;
+                        const bool folds = evaluate_binary(ops[o].second, kind, args[0].bits, args[1].bits, expected);
+                        const Result result = vm.run(fn, args);
+                        INFO(kinds[k].first << " " << lhs << " " << ops[o].first << " " << rhs);
+                        if (folds)
+                        {
+                            CHECK(result.trap == Trap::NONE);
+                            CHECK(result.value.bits == expected);
+                        }
+                        else
+                            CHECK(result.trap == Trap::DIVISION_BY_ZERO);
+                    }
+                }
+            }
+        }
+    }
+
+    SECTION("Floats round like their type, casts saturate")
+    {
+        Compiled compiled(relative_filename, R"(
+            function ratio(x: f32, y: f32) -> f32 { return x / y; }
+            function wide(x: f64, y: f64) -> f64 { return -(x / y); }
+            function narrow(x: f64) -> i8 { return cast<i8>(x); }
+            function flag(x: f64) -> bool { return x > 0.5; }
+        )");
+        const Result f32 = compiled.run("ratio", { Value::number(TypeKind::F32, 1.0), Value::number(TypeKind::F32, 3.0) });
+        CHECK(f32.value.kind == TypeKind::F32);
+        CHECK(f32.value.as_float() == static_cast<double>(1.0F / 3.0F));
+        CHECK(compiled.run("wide", { Value::number(TypeKind::F64, 1.0), Value::number(TypeKind::F64, 3.0) }).value.
+              as_float() == -(1.0 / 3.0));
+
+        for (const double x: { 1000.0, -1000.0, 12.75, std::numeric_limits<double>::quiet_NaN() })
+        {
+            uint64_t expected = 0;
+            REQUIRE(convert(TypeKind::F64, TypeKind::I8, std::bit_cast<uint64_t>(x), expected));
+            CHECK(compiled.run("narrow", { Value::number(TypeKind::F64, x) }).value.bits == expected);
+        }
+        CHECK(compiled.run("flag", { Value::number(TypeKind::F64, 0.75) }).value.bits == 1);
+        CHECK(compiled.run("flag", { Value::number(TypeKind::F64, 0.25) }).value.bits == 0);
+    }
+
+    SECTION("Traps stop the run")
+    {
+        Compiled compiled(relative_filename, R"(
+            function div(a: i32, b: i32) -> i32 { return a / b; }
+            function down(n: i32) -> i32 { return down(n + 1); }
+            function nested(n: i32) -> i32 { return div(n, n - 1); }
+        )");
+        CHECK(compiled.run("div", { Value::integer(TypeKind::I32, 1), Value::integer(TypeKind::I32, 0) }).trap ==
+              Trap::DIVISION_BY_ZERO);
+        CHECK(compiled.run("nested", { Value::integer(TypeKind::I32, 1) }).trap == Trap::DIVISION_BY_ZERO);
+        CHECK(compiled.run("nested", { Value::integer(TypeKind::I32, 4) }).value.as_int() == 1);
+        CHECK(compiled.run("down", { Value::integer(TypeKind::I32, 0) }).trap == Trap::STACK_OVERFLOW);
+
+        /* the VM is usable again after a trap */
+        VM vm(compiled.program, 64);
+        CHECK(vm.run(compiled.function("down"), std::vector{ Value::integer(TypeKind::I32, 0) }).trap ==
+              Trap::STACK_OVERFLOW);
+        CHECK(vm.run(compiled.function("nested"), std::vector{ Value::integer(TypeKind::I32, 3) }).value.as_int() == 1);
+    }
+
+    SECTION("Strings are their atoms")
+    {
+        Compiled compiled(relative_filename, R"(function text() -> string { return "hi"; })");
+        const Result result = compiled.run("text");
+        CHECK(result.value.kind == TypeKind::STRING);
+        CHECK(result.value.bits == compiled.interner.intern("hi"));
+    }
+
+    SECTION("Constants are loaded once, on entry")
+    {
+        Compiled compiled(relative_filename, R"(
+            function sum(n: i32) -> i32 {
+                var s: i32 = 0;
+                var i: i32 = 0;
+                while (i < n) { s += i; i += 1; }
+                return s;
+            }
+        )");
+        CHECK(compiled.dump() ==
+              "function sum(i32) -> i32, 9 registers\n"
+              "  0: loadk r1, k1\n"
+              "  1: loadk r6, k2\n"
+              "  2: mov r2, r1\n"
+              "  3: mov r3, r1\n"
+              "  4: lts r4, r3, r0\n"
+              "  5: jf r4, 11\n"
+              "  6: add.i32 r5, r2, r3\n"
+              "  7: add.i32 r7, r3, r6\n"
+              "  8: mov r2, r5\n"
+              "  9: mov r3, r7\n"
+              "  10: jmp 4\n"
+              "  11: ret r2\n"
+              "\n");
+
+        uint64_t executed = 0;
+        VM vm(compiled.program);
+        CHECK(vm.profile(0, std::vector{ Value::integer(TypeKind::I32, 10) }, executed).value.as_int() == 45);
+        CHECK(executed == 4 + 10 * 7 + 3); /* the entry, ten turns of the loop, the last test and the return */
+    }
+}